@@ -2,6 +2,7 @@
 #define DJDWJBHNDAYTNOXLFOBDSGAQAAYPWMXJGEBYIRKEAKAQUUWVGDUGGDKSDXUKSPCYYNTWTDNII
 
 #include "./operation.hpp"
+#include "./fusion.hpp"
 #include "./tensor.hpp"
 #include "./utils/range.hpp"
 #include "./utils/better_assert.hpp"
@@ -27,7 +28,7 @@ namespace ceras
     {
         return [=]<Expression Ex>( Ex const& ex ) noexcept
         {
-            return sigmoid( value( f+f ) * ex );
+            return fuse( [f]( auto x ){ return sigmoid( (f+f) * x ); }, "HeavisideStep" )( ex );
         };
     }
 
@@ -68,7 +69,7 @@ namespace ceras
     template <Expression Ex>
     auto constexpr gaussian( Ex const& ex ) noexcept
     {
-        return exp( negative( square(ex) ) );
+        return fuse( []( auto x ){ return exp( -square( x ) ); }, "Gaussian" )( ex );
     }
 
 
@@ -99,7 +100,7 @@ namespace ceras
                                         {
                                             auto [begin, end] = std::make_tuple( x.begin()+idx*last_dim, x.begin()+(idx+1)*last_dim );
                                             typename Tsor::value_type const mx = *std::max_element( begin, end );
-                                            for_each( begin, end, [mx]( auto & v ){ v = std::exp( v-mx ); } );
+                                            backend::vector_math::transform( [mx]( auto v ){ return backend::vector_math::exp( v-mx ); }, last_dim, x.data()+idx*last_dim, x.data()+idx*last_dim );
                                             typename Tsor::value_type const sum = std::accumulate( begin, end, typename Tsor::value_type{0} );
                                             for_each( begin, end, [sum]( auto & v ){ v /= sum; } );
                                         }
@@ -140,10 +141,10 @@ namespace ceras
                                         value_type const alpha = 1.67326;
                                         Tsor& ans = context_cast<Tsor>( forward_cache );
                                         ans.resize( input.shape() );
-                                        std::copy( input.begin(), input.end(), ans.begin() );
+                                        backend::vector_math::transform( []( auto x ){ return backend::vector_math::expm1( x ); }, input.size(), ans.data(), input.data() );
                                         // if x >= 0:  \lambda x
                                         // if x <  0:  \lambda \alpha (exp(x) - 1)
-                                        ans.map( [lambda, alpha](auto& x){ x = (x >= value_type{0}) ? (lambda * x) : (lambda * alpha * (std::exp(x) - value_type{1})); } );
+                                        for_each( ans.begin(), ans.end(), input.begin(), [lambda, alpha]( auto& a, auto x ){ a = (x >= value_type{0}) ? (lambda * x) : (lambda * alpha * a); } );
                                         return ans;
                                     },
                                     [backward_cache]<Tensor Tsor>( Tsor const& input, Tsor const&, Tsor const& grad ) noexcept
@@ -152,10 +153,11 @@ namespace ceras
                                         value_type const lambda = 1.0507;
                                         value_type const alpha = 1.67326;
                                         Tsor& ans = context_cast<Tsor>( backward_cache );
-                                        ans.resize( input.shape() ); // 1 / ( 1 + exp(-x) )
+                                        ans.resize( input.shape() );
+                                        backend::vector_math::transform( []( auto x ){ return backend::vector_math::exp( x ); }, input.size(), ans.data(), input.data() );
                                         // if x >= 0: \lambda
                                         // if x <  0: \lambda \alpha exp( x )
-                                        for_each( ans.begin(), ans.end(), input.begin(), grad.begin(), [lambda, alpha]( auto& a, auto i, auto g ){ a = (i >= value_type{0}) ? (g * lambda) : (g * lambda * alpha * std::exp(i)); } );
+                                        for_each( ans.begin(), ans.end(), input.begin(), grad.begin(), [lambda, alpha]( auto& a, auto i, auto g ){ a = (i >= value_type{0}) ? (g * lambda) : (g * lambda * alpha * a); } );
                                         return ans;
                                     },
                                     "SeLU"
@@ -183,15 +185,14 @@ namespace ceras
                                     {
                                         Tsor& ans = context_cast<Tsor>( forward_cache );
                                         ans.resize( input.shape() );
-                                        std::copy( input.begin(), input.end(), ans.begin() );
-                                        ans.map( [](auto& x){ x = std::log(1.0+std::exp(x)); } ); // ln( 1+e^x )
+                                        backend::vector_math::transform( []( auto x ){ return backend::vector_math::softplus( x ); }, input.size(), ans.data(), input.data() ); // ln( 1+e^x )
                                         return ans;
                                     },
                                     [backward_cache]<Tensor Tsor>( Tsor const& input, Tsor const&, Tsor const& grad ) noexcept
                                     {
                                         Tsor& ans = context_cast<Tsor>( backward_cache );
                                         ans.resize( input.shape() ); // 1 / ( 1 + exp(-x) )
-                                        for_each( ans.begin(), ans.end(), input.begin(), grad.begin(), []( auto& a, auto i, auto g ){ a = g / ( typename Tsor::value_type{1} - std::exp(-i) ); } );
+                                        backend::vector_math::transform( []( auto i, auto g ){ return g * backend::vector_math::sigmoid( i ); }, input.size(), ans.data(), input.data(), grad.data() );
                                         return ans;
                                     },
                                     "SoftPlus"
@@ -255,9 +256,7 @@ namespace ceras
                                     {
                                         Tsor& ans = context_cast<Tsor>( forward_cache );
                                         ans.resize( input.shape() );
-                                        std::copy( input.begin(), input.end(), ans.begin() );
-                                        //auto ans = input.deep_copy();
-                                        ans.map( [](auto& x){ x = 1.0 / (1.0+std::exp(-x)); } );
+                                        backend::vector_math::transform( []( auto x ){ return backend::vector_math::sigmoid( x ); }, input.size(), ans.data(), input.data() );
                                         return ans;
                                     },
                                     [backward_cache]<Tensor Tsor>( Tsor const&, Tsor const& output, Tsor const& grad ) noexcept
@@ -279,16 +278,21 @@ namespace ceras
         {
             auto make_forward() const noexcept
             {
-                return []( std::shared_ptr<std::any> forward_cache ) noexcept
+                return []( std::shared_ptr<std::any> forward_cache, std::shared_ptr<folding_state> folding ) noexcept
                 {
-                    return [forward_cache]<Tensor Tsor>( Tsor const& input ) noexcept
+                    return [forward_cache, folding]<Tensor Tsor>( Tsor const& input ) noexcept
                     {
+                        if ( folding->folded() ) // applied by the preceding Conv2D or Dense, see `folding.hpp`
+                            return input;
+
                         typedef typename Tsor::value_type value_type;
                         Tsor& ans = context_cast<Tsor>( forward_cache );
                         ans.resize( input.shape()  );
 
                         for_each( ans.begin(), ans.end(), input.begin(), [](auto& o, auto x){ o = std::max(x, value_type{0}); } );
 
+                        if ( auto& trace = get_folding_trace(); trace.active )
+                            trace.record( folding_kind::relu, folding, input, static_cast<Tsor const*>( nullptr ), ans );
                         return ans;
                     };
                 };
@@ -324,7 +328,8 @@ namespace ceras
     auto relu( Ex const& ex ) noexcept
     {
         std::shared_ptr<std::any> forward_cache = std::make_shared<std::any>();
-        return make_unary_operator( relu_context{}.make_forward()( forward_cache ), relu_context{}.make_backward(), "Relu")( ex );
+        std::shared_ptr<folding_state> folding = std::make_shared<folding_state>();
+        return make_unary_operator( relu_context{}.make_forward()( forward_cache, folding ), relu_context{}.make_backward(), "Relu")( ex );
     }
 
 
@@ -400,11 +405,16 @@ namespace ceras
         return [factor]<Expression Ex>( Ex const& ex ) noexcept
         {
             std::shared_ptr<std::any> forward_cache = std::make_shared<std::any>();
-            return make_unary_operator( [factor, forward_cache]<Tensor Tsor>( Tsor const& input ) noexcept
+            std::shared_ptr<folding_state> folding = std::make_shared<folding_state>();
+            return make_unary_operator( [factor, forward_cache, folding]<Tensor Tsor>( Tsor const& input ) noexcept
                                         {
+                                            if ( folding->folded() ) // applied by the preceding Conv2D or Dense, see `folding.hpp`
+                                                return input;
                                             Tsor& ans = context_cast<Tsor>( forward_cache );
                                             ans.resize( input.shape()  );
                                             for_each( ans.begin(), ans.end(), input.begin(), [factor]( auto& v_out, auto v_in ){ v_out = std::max( T{v_in}, T{factor*v_in} ); } );
+                                            if ( auto& trace = get_folding_trace(); trace.active )
+                                                trace.record( folding_kind::leaky_relu, folding, input, static_cast<Tsor const*>( nullptr ), ans, {}, factor );
                                             return ans;
                                         },
                                         [factor]<Tensor Tsor>( Tsor const& input, Tsor const&, Tsor const& grad ) noexcept
@@ -452,19 +462,23 @@ namespace ceras
         return [alpha]<Expression Ex>( Ex const& ex ) noexcept
         {
             std::shared_ptr<std::any> forward_cache = std::make_shared<std::any>();
+            std::shared_ptr<std::any> backward_cache = std::make_shared<std::any>();
             return make_unary_operator( [alpha, forward_cache]<Tensor Tsor>( Tsor const& input ) noexcept
                                         {
                                             typedef typename Tsor::value_type value_type;
                                             Tsor& ans = context_cast<Tsor>( forward_cache );
                                             ans.resize( input.shape()  );
-                                            for_each( ans.begin(), ans.end(), input.begin(), [alpha]( auto& v_out, auto v_in ){ v_out = (v_in > value_type{0}) ? v_in : (alpha * (std::exp(v_in) - value_type{1})); } );
+                                            backend::vector_math::transform( []( auto x ){ return backend::vector_math::expm1( x ); }, input.size(), ans.data(), input.data() );
+                                            for_each( ans.begin(), ans.end(), input.begin(), [alpha]( auto& v_out, auto v_in ){ v_out = (v_in > value_type{0}) ? v_in : (alpha * v_out); } );
                                             return ans;
                                         },
-                                        [alpha]<Tensor Tsor>( Tsor const& input, Tsor const&, Tsor const& grad ) noexcept
+                                        [alpha, backward_cache]<Tensor Tsor>( Tsor const& input, Tsor const&, Tsor const& grad ) noexcept
                                         {
                                             typedef typename Tsor::value_type value_type;
-                                            Tsor ans = grad;// OK for shallow copy
-                                            for_each( ans.begin(), ans.end(), input.begin(), [alpha]( value_type& v_back, value_type const v_in ){ v_back = (v_in >= value_type{0}) ? v_back : alpha*std::exp(v_back); } );
+                                            Tsor& ans = context_cast<Tsor>( backward_cache );
+                                            ans.resize( input.shape() );
+                                            backend::vector_math::transform( []( auto x ){ return backend::vector_math::exp( x ); }, input.size(), ans.data(), input.data() );
+                                            for_each( ans.begin(), ans.end(), input.begin(), grad.begin(), [alpha]( value_type& v_back, value_type const v_in, value_type const g ){ v_back = (v_in >= value_type{0}) ? g : g*alpha*v_back; } );
                                             return ans;
                                         },
                                         "ELU"
@@ -492,8 +506,7 @@ namespace ceras
                                     {
                                         Tsor& ans = context_cast<Tsor>( forward_cache );
                                         ans.resize( input.shape() );
-                                        std::copy( input.begin(), input.end(), ans.begin() );
-                                        ans.map( [](auto& x){ x = std::exp(x); } ); // exp(x)
+                                        backend::vector_math::transform( []( auto x ){ return backend::vector_math::exp( x ); }, input.size(), ans.data(), input.data() ); // exp(x)
                                         better_assert( !has_nan( ans ), "exponential operator forward output contains nan." );
                                         better_assert( !has_inf( ans ), "exponential operator forward output contains inf." );
                                         return ans;
@@ -6,6 +6,18 @@
 
 #include "./cuda.hpp"
 #include "./cblas.hpp"
+#include "./gemm_autotuner.hpp"
+#include "./packed_gemm.hpp"
+#include "./direct_conv2d.hpp"
+#include "./winograd_conv2d.hpp"
+#include "./implicit_gemm_conv2d.hpp"
+#include "./grouped_conv2d.hpp"
+#include "./transposed_conv2d.hpp"
+#include "./pooling_2d.hpp"
+#include "./conv2d_autotuner.hpp"
+#include "./nchwc_conv2d.hpp"
+#include "./vector_math.hpp"
+#include "./reduction.hpp"
 
 namespace ceras::backend
 {
@@ -30,16 +30,13 @@ void cblas_dgemm(CBLAS_LAYOUT layout, CBLAS_TRANSPOSE TransA,
 namespace ceras
 {
 
-    // C <= A * B
+    // C <= alpha * A * B + beta * C
     // where A or A' is [m x n], B or B' is [n x k] and C is [m x k]
     template< typename T > requires std::floating_point<T>
-    void cblas_gemm( T const* A, bool a_transposed, T const* B, bool b_transposed, std::size_t m, std::size_t n, std::size_t k, T* C )
+    void cblas_gemm( T const* A, bool a_transposed, T const* B, bool b_transposed, std::size_t m, std::size_t n, std::size_t k, T* C, T alpha = T{1}, T beta = T{0} )
     {
         if constexpr( cblas_mode )
         {
-            T const alpha = 1.0;
-            T const beta = 0.0;
-
             T* result_ptr = C;
             T const * first_ptr = B;
             T const * second_ptr = A;
@@ -0,0 +1,195 @@
+#ifndef CONVAUTOTUNERHPPZQXKRWMVNTJYLOBUEADCFIHSPGZQXKRWMVNTJYLOBUEADCFIHSPGZQXKRW
+#define CONVAUTOTUNERHPPZQXKRWMVNTJYLOBUEADCFIHSPGZQXKRWMVNTJYLOBUEADCFIHSPGZQXKRW
+
+#include "../includes.hpp"
+#include "../config.hpp"
+#include "../utils/debug.hpp"
+#include "../utils/fmt.hpp"
+#include "../utils/better_assert.hpp"
+#include "../utils/range.hpp"
+#include "../utils/singleton.hpp"
+#include "./gemm_autotuner.hpp"
+#include "./conv2d_geometry.hpp"
+
+//
+// Autotuning of the algorithm of every convolution.
+//
+// Inside a `conv2d_autotuning_scope`, which the compiled models open around their training and their inference, a convolution meeting a new geometry
+// times the algorithms able to run it on this geometry, and keeps the fastest one. In training, a run is the forward pass and both gradients.
+// If a tuning file is given, the choices are written to it, keyed by the CPU, the type, the learning phase and the geometry, so that later processes
+// on the same CPU pick the tuned algorithms without timing them again.
+//
+// The tuning file is `$CERAS_CONV2D_TUNING_FILE`. Without it, the choices are kept in memory for the lifetime of the process only.
+// Autotuning is disabled by setting `conv2d_autotuning = 0` (see `../config.hpp`), or by the environment variable `CERAS_CONV2D_AUTOTUNING=0`.
+//
+
+namespace ceras::backend
+{
+
+    ///
+    /// @brief The key of a convolution in the tuning file.
+    ///
+    inline std::string conv2d_tuning_key( conv2d_geometry const& g, bool training )
+    {
+        return fmt::format( "{} {}x{}x{}x{} {}x{}x{} s{}x{} p{}x{} d{}x{}", std::string{ training ? "training" : "inference" }, g.batch, g.rows, g.cols, g.channels,
+                            g.new_channels, g.kernel_rows, g.kernel_cols, g.row_stride, g.col_stride, g.row_padding, g.col_padding, g.row_dilation, g.col_dilation );
+    }
+
+    inline std::string default_conv2d_tuning_file()
+    {
+        if ( char const* path = std::getenv( "CERAS_CONV2D_TUNING_FILE" ); path && *path )
+            return std::string{ path };
+        return std::string{}; // no persistence
+    }
+
+    template< typename T > requires std::floating_point<T>
+    struct conv2d_autotuner
+    {
+        std::string file_path_; ///< empty for no tuning file
+        std::string cpu_model_;
+        std::map<std::string, std::string> tunings_; ///< the name of the fastest algorithm of every key
+        std::mutex mutex_;
+        bool loaded_ = false;
+
+        conv2d_autotuner( std::string const& file_path = default_conv2d_tuning_file() ) : file_path_{ file_path }, cpu_model_{ cpu_model() } {}
+
+        ///
+        /// @brief Returns the index of the fastest of the candidate algorithms of a convolution, timing them first if necessary.
+        /// @param key The key of the convolution, see `conv2d_tuning_key`.
+        /// @param candidates The names of the algorithms able to run the convolution.
+        /// @param time A function returning the time in seconds taken by the candidate of the index passed.
+        ///
+        template< typename Timer >
+        unsigned long query( std::string const& key, std::vector<std::string> const& candidates, Timer const& time )
+        {
+            better_assert( !candidates.empty(), "conv2d_autotuner: no candidate algorithm." );
+            if ( candidates.size() == 1 )
+                return 0;
+
+            std::lock_guard<std::mutex> lock{ mutex_ };
+            if ( !loaded_ )
+            {
+                load();
+                loaded_ = true;
+            }
+
+            // a record naming an algorithm which is not a candidate any more is tuned again
+            if ( auto itor = tunings_.find( key ); itor != tunings_.end() )
+                if ( auto position = std::find( candidates.begin(), candidates.end(), (*itor).second ); position != candidates.end() )
+                    return static_cast<unsigned long>( std::distance( candidates.begin(), position ) );
+
+            unsigned long ans = 0;
+            double best_time = std::numeric_limits<double>::max();
+            for ( auto idx : range( candidates.size() ) )
+                if ( double const t = time( idx ); t < best_time )
+                {
+                    best_time = t;
+                    ans = idx;
+                }
+
+            if constexpr( debug_mode )
+                debug_log( "conv2d_autotuner: ", key, " tuned to ", candidates[ans] );
+            tunings_[key] = candidates[ans];
+            save();
+            return ans;
+        }
+
+        static std::string type_name()
+        {
+            return std::string{ "float" } + std::to_string( sizeof(T) * 8 );
+        }
+
+        void load()
+        {
+            if ( file_path_.empty() )
+                return;
+
+            std::ifstream ifs{ file_path_ };
+            std::string line;
+            while ( ifs.good() && std::getline( ifs, line ) )
+            {
+                // cpu model \t type \t key \t algorithm
+                std::stringstream ss{ line };
+                std::string model, type, key, algorithm;
+                if ( !std::getline( ss, model, '\t' ) || !std::getline( ss, type, '\t' ) || !std::getline( ss, key, '\t' ) || !std::getline( ss, algorithm ) ) continue;
+                if ( model != cpu_model_ || type != type_name() || algorithm.empty() ) continue;
+                tunings_[key] = algorithm;
+            }
+        }
+
+        void save() const
+        {
+            if ( file_path_.empty() )
+                return;
+
+            // keeps the records of other CPUs and other types
+            std::vector<std::string> lines;
+            {
+                std::ifstream ifs{ file_path_ };
+                std::string line;
+                std::string const& prefix = cpu_model_ + "\t" + type_name() + "\t";
+                while ( ifs.good() && std::getline( ifs, line ) )
+                    if ( !line.empty() && !line.starts_with( prefix ) )
+                        lines.push_back( line );
+            }
+
+            std::error_code ec;
+            auto const& parent = std::filesystem::path{ file_path_ }.parent_path();
+            if ( !parent.empty() )
+                std::filesystem::create_directories( parent, ec );
+
+            std::ofstream ofs{ file_path_ };
+            if ( !ofs.good() )
+            {
+                if constexpr( debug_mode )
+                    debug_log( "conv2d_autotuner: failed to write tuning file ", file_path_ );
+                return;
+            }
+            for ( auto const& line : lines )
+                ofs << line << "\n";
+            for ( auto const& [key, algorithm] : tunings_ )
+                ofs << cpu_model_ << "\t" << type_name() << "\t" << key << "\t" << algorithm << "\n";
+        }
+    };
+
+    ///
+    /// @brief Number of the `conv2d_autotuning_scope`s open.
+    ///
+    inline unsigned long conv2d_autotuning_scopes = 0;
+
+    ///
+    /// @brief Enables the autotuning of the convolutions during its lifetime.
+    ///
+    /// Example code:
+    ///
+    /// \code{.cpp}
+    /// {
+    ///     backend::conv2d_autotuning_scope scope;
+    ///     s.run( y ); // the convolutions in y run with their fastest algorithms
+    /// }
+    /// \endcode
+    ///
+    struct conv2d_autotuning_scope
+    {
+        conv2d_autotuning_scope() noexcept { ++conv2d_autotuning_scopes; }
+        ~conv2d_autotuning_scope() noexcept { --conv2d_autotuning_scopes; }
+        conv2d_autotuning_scope( conv2d_autotuning_scope const& ) = delete;
+        conv2d_autotuning_scope& operator = ( conv2d_autotuning_scope const& ) = delete;
+    };
+
+    ///
+    /// @brief True if the convolutions meeting a new geometry should time their algorithms.
+    ///
+    inline bool conv2d_autotuning_enabled()
+    {
+        static bool const enabled_by_environment = []()
+        {
+            char const* flag = std::getenv( "CERAS_CONV2D_AUTOTUNING" );
+            return !( flag && std::string{ flag } == std::string{ "0" } );
+        }();
+        return conv2d_autotuning && enabled_by_environment && conv2d_autotuning_scopes != 0;
+    }
+
+}//namespace ceras::backend
+
+#endif//CONVAUTOTUNERHPPZQXKRWMVNTJYLOBUEADCFIHSPGZQXKRWMVNTJYLOBUEADCFIHSPGZQXKRW
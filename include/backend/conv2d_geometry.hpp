@@ -0,0 +1,147 @@
+#ifndef CONVGEOMETRYHPPXKQZWMVRNTYJLOBUEADCFIHSPGXKQZWMVRNTYJLOBUEADCFIHSPGXKQZWMV
+#define CONVGEOMETRYHPPXKQZWMVRNTYJLOBUEADCFIHSPGXKQZWMVRNTYJLOBUEADCFIHSPGXKQZWMV
+
+#include "../includes.hpp"
+#include "../config.hpp"
+#include "../utils/parallel.hpp"
+
+namespace ceras::backend
+{
+
+    ///
+    /// @brief Shape of a 2D convolution of a NHWC input [BS, R, C, CH] with NC kernels of [r, c, CH], producing a NHWC output [BS, new_R, new_C, NC].
+    ///
+    /// The element (nc, ch, kh, kw) of the kernel is `kernel[(nc*channels+ch)*taps()+kh*kernel_cols+kw]`, which is the order of the rows of the `img2col` matrix.
+    ///
+    struct conv2d_geometry
+    {
+        unsigned long batch;
+        unsigned long rows;
+        unsigned long cols;
+        unsigned long channels;
+        unsigned long new_channels;
+        unsigned long kernel_rows;
+        unsigned long kernel_cols;
+        unsigned long row_stride = 1;
+        unsigned long col_stride = 1;
+        unsigned long row_padding = 0;
+        unsigned long col_padding = 0;
+        unsigned long row_dilation = 1;
+        unsigned long col_dilation = 1;
+
+        unsigned long output_rows() const noexcept { return ( rows + 2 * row_padding - ( row_dilation * (kernel_rows - 1) + 1 ) ) / row_stride + 1; }
+        unsigned long output_cols() const noexcept { return ( cols + 2 * col_padding - ( col_dilation * (kernel_cols - 1) + 1 ) ) / col_stride + 1; }
+        unsigned long padded_rows() const noexcept { return rows + 2 * row_padding; }
+        unsigned long padded_cols() const noexcept { return cols + 2 * col_padding; }
+        unsigned long taps() const noexcept { return kernel_rows * kernel_cols; }
+        unsigned long depth() const noexcept { return taps() * channels; }
+        unsigned long pixels() const noexcept { return batch * output_rows() * output_cols(); }
+        bool padded() const noexcept { return row_padding != 0 || col_padding != 0; }
+
+        bool operator == ( conv2d_geometry const& ) const noexcept = default;
+    };
+
+    ///
+    /// @brief Copies the input of a convolution into a zero-padded [BS, R+2*row_padding, C+2*col_padding, CH] buffer.
+    /// @return The padded input, or the input itself if there is no padding.
+    ///
+    template< typename T >
+    T const* pad_conv2d_input( T const* input, conv2d_geometry const& g, std::vector<T>& buffer )
+    {
+        if ( !g.padded() )
+            return input;
+
+        unsigned long const padded_rows = g.padded_rows();
+        unsigned long const padded_cols = g.padded_cols();
+        unsigned long const row_size = padded_cols * g.channels;
+        buffer.resize( g.batch * padded_rows * row_size );
+        T* padded = buffer.data();
+        parallel( [&]( unsigned long task )
+        {
+            unsigned long const b = task / padded_rows;
+            unsigned long const r = task % padded_rows;
+            T* dst = padded + task * row_size;
+            if ( r < g.row_padding || r >= g.row_padding + g.rows )
+            {
+                std::fill_n( dst, row_size, T{0} );
+                return;
+            }
+            std::fill_n( dst, g.col_padding * g.channels, T{0} );
+            std::copy_n( input + ( b * g.rows + r - g.row_padding ) * g.cols * g.channels, g.cols * g.channels, dst + g.col_padding * g.channels );
+            std::fill_n( dst + ( g.col_padding + g.cols ) * g.channels, g.col_padding * g.channels, T{0} );
+        }, 0UL, g.batch * padded_rows );
+        return padded;
+    }
+
+    ///
+    /// @brief Copies a [BS, R, C, CH] source into the [BS, g.rows, g.cols, CH] input of a convolution, the source element (r, c) landing at (r+row_offset, c+col_offset).
+    ///
+    /// The source elements falling outside of the input, or inside its margins, are cropped, and the input elements not covered by the source are zeros.
+    /// The margins are the `row_margin` rows and `col_margin` columns on every side of the input, the zero padding of the convolution.
+    ///
+    /// @return The input of the convolution, in `buffer`.
+    ///
+    template< typename T >
+    T const* shift_conv2d_input( T const* source, unsigned long source_rows, unsigned long source_cols, std::int64_t row_offset, std::int64_t col_offset,
+                                 unsigned long row_margin, unsigned long col_margin, conv2d_geometry const& g, std::vector<T>& buffer )
+    {
+        unsigned long const row_size = g.cols * g.channels;
+        buffer.resize( g.batch * g.rows * row_size );
+        T* input = buffer.data();
+        // the rows and the columns [first, last) of the input covered by the source
+        std::int64_t const row_first = std::max( row_offset, static_cast<std::int64_t>( row_margin ) );
+        std::int64_t const row_last = std::min( row_offset + static_cast<std::int64_t>( source_rows ), static_cast<std::int64_t>( g.rows - row_margin ) );
+        std::int64_t const col_first = std::max( col_offset, static_cast<std::int64_t>( col_margin ) );
+        std::int64_t const col_last = std::min( col_offset + static_cast<std::int64_t>( source_cols ), static_cast<std::int64_t>( g.cols - col_margin ) );
+        parallel( [&]( unsigned long task )
+        {
+            unsigned long const b = task / g.rows;
+            std::int64_t const r = static_cast<std::int64_t>( task % g.rows );
+            T* dst = input + task * row_size;
+            if ( r < row_first || r >= row_last || col_first >= col_last )
+            {
+                std::fill_n( dst, row_size, T{0} );
+                return;
+            }
+            std::fill_n( dst, col_first * g.channels, T{0} );
+            std::copy_n( source + ( ( b * source_rows + r - row_offset ) * source_cols + col_first - col_offset ) * g.channels, ( col_last - col_first ) * g.channels, dst + col_first * g.channels );
+            std::fill_n( dst + col_last * g.channels, ( g.cols - col_last ) * g.channels, T{0} );
+        }, 0UL, g.batch * g.rows );
+        return input;
+    }
+
+    ///
+    /// @brief The gradient of the source of `shift_conv2d_input` from the gradient of the input of the convolution, zeros for the cropped source elements.
+    /// @param accumulate If true, the gradient is added to `source_grad`, otherwise `source_grad` is overwritten.
+    ///
+    template< typename T >
+    void shift_conv2d_input_gradient( T const* input_grad, unsigned long source_rows, unsigned long source_cols, std::int64_t row_offset, std::int64_t col_offset,
+                                      unsigned long row_margin, unsigned long col_margin, conv2d_geometry const& g, T* source_grad, bool accumulate )
+    {
+        unsigned long const channels = g.channels;
+        std::int64_t const row_first = static_cast<std::int64_t>( row_margin );
+        std::int64_t const row_last = static_cast<std::int64_t>( g.rows - row_margin );
+        std::int64_t const col_first = static_cast<std::int64_t>( col_margin );
+        std::int64_t const col_last = static_cast<std::int64_t>( g.cols - col_margin );
+        parallel( [&]( unsigned long task )
+        {
+            unsigned long const b = task / source_rows;
+            std::int64_t const r = static_cast<std::int64_t>( task % source_rows ) + row_offset;
+            T* dst = source_grad + task * source_cols * channels;
+            for ( unsigned long c = 0; c != source_cols; ++c )
+            {
+                std::int64_t const col = static_cast<std::int64_t>( c ) + col_offset;
+                bool const inside = r >= row_first && r < row_last && col >= col_first && col < col_last;
+                T const* src = inside ? input_grad + ( ( b * g.rows + r ) * g.cols + col ) * channels : nullptr;
+                for ( unsigned long ch = 0; ch != channels; ++ch )
+                {
+                    T const value = inside ? src[ch] : T{0};
+                    dst[c*channels+ch] = accumulate ? T{dst[c*channels+ch] + value} : value;
+                }
+            }
+        }, 0UL, g.batch * source_rows );
+    }
+
+}//namespace ceras::backend
+
+#endif//CONVGEOMETRYHPPXKQZWMVRNTYJLOBUEADCFIHSPGXKQZWMVRNTYJLOBUEADCFIHSPGXKQZWMV
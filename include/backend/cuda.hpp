@@ -384,19 +384,16 @@ namespace ceras
         }
     };//cublas_handle_delegate
 
-    // C <= A * B
+    // C <= alpha * A * B + beta * C
     // where A or A' is [m x n], B or B' is [n x k] and C is [m x k]
     template< typename T > requires std::floating_point<T>
-    void cuda_gemm( T const* A, bool a_transposed, T const* B, bool b_transposed, std::size_t m, std::size_t n, std::size_t k, T* C )
+    void cuda_gemm( T const* A, bool a_transposed, T const* B, bool b_transposed, std::size_t m, std::size_t n, std::size_t k, T* C, T alpha = T{1}, T beta = T{0} )
     {
         if constexpr( cuda_mode )
         {
             cublas_handle& handle = singleton<cublas_handle>::instance();
             cublasHandle_t hd = handle.handle_;
 
-            T alpha = 1.0;
-            T beta = 0.0;
-
             cuda_memory_cache& cache = singleton<cuda_memory_cache>::instance();
             cache.reserve<T>( m*n + n*k + m*k ); // total memory
             T* a = cache.data<T>();
@@ -404,6 +401,8 @@ namespace ceras
             T* b = a + m*n;
             host_to_device_n( B, n*k, b );
             T* c = b + n*k;
+            if ( beta != T{0} ) // C is read only when accumulating
+                host_to_device_n( C, m*k, c );
 
             T* result_ptr = c;
             T* first_ptr = b;
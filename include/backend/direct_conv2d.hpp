@@ -0,0 +1,283 @@
+#ifndef DIRECTCONVHPPQZXKWMVRNTYJLOBUEADCFIHSPGQZXKWMVRNTYJLOBUEADCFIHSPGQZXKWMVRN
+#define DIRECTCONVHPPQZXKWMVRNTYJLOBUEADCFIHSPGQZXKWMVRNTYJLOBUEADCFIHSPGQZXKWMVRN
+
+#include "../includes.hpp"
+#include "../config.hpp"
+#include "../utils/parallel.hpp"
+#include "./packed_gemm.hpp"
+#include "./conv2d_geometry.hpp"
+
+//
+// Direct convolution of NHWC tensors for small kernels, without the img2col matrix.
+//
+// The kernels are packed once per call into NR-wide panels of [taps x CH x NR]. A MR x NR register tile of the output covers MR consecutive pixels of one
+// output row and NR output channels, and is accumulated over all the taps and input channels, the input pixels being broadcast straight from the
+// (zero-padded) input with the stride of the convolution. The tile is the one of the packed GEMM, see `packed_gemm.hpp`.
+//
+// The backward passes are sums of GEMMs over shifted views of the input and of the gradient, one per output row and tap, accumulated with beta = 1:
+//
+//  - the input gradient is partitioned by input row, so that no two tasks write the same element
+//  - the kernel gradient is partitioned by tap and block of output channels, and sums the rows in a fixed order
+//
+// The results do not depend on the number of threads.
+//
+
+namespace ceras::backend
+{
+
+    namespace direct_conv2d_private
+    {
+        // out[r][0:cols] = sum_{t, ch} in[row_offsets[r]+tap_offsets[t]+ch] * panel[(t*channels+ch)*nr:(t*channels+ch+1)*nr], for r in [0, rows)
+        template< typename T >
+        void micro_kernel( T const* in, unsigned long const* row_offsets, unsigned long const* tap_offsets, unsigned long taps, unsigned long channels,
+                           T const* panel, T* out, unsigned long ldo, unsigned long rows, unsigned long cols ) noexcept
+        {
+            using namespace packed_gemm_private;
+            constexpr unsigned long mr = kernel_traits<T>::mr;
+            constexpr unsigned long nr = kernel_traits<T>::nr;
+            constexpr unsigned long lanes = simd<T>::lanes;
+            constexpr unsigned long vr = nr / lanes;
+            typedef typename simd<T>::type vector_type;
+
+            vector_type acc[mr][vr];
+            for ( unsigned long r = 0; r != mr; ++r )
+                for ( unsigned long v = 0; v != vr; ++v )
+                    acc[r][v] = simd<T>::broadcast( T{0} );
+
+            for ( unsigned long t = 0; t != taps; ++t )
+            {
+                T const* base = in + tap_offsets[t];
+                for ( unsigned long ch = 0; ch != channels; ++ch )
+                {
+                    vector_type b[vr];
+                    for ( unsigned long v = 0; v != vr; ++v )
+                        b[v] = simd<T>::load( panel + v * lanes );
+
+                    for ( unsigned long r = 0; r != mr; ++r )
+                    {
+                        vector_type const a = simd<T>::broadcast( base[row_offsets[r]+ch] );
+                        for ( unsigned long v = 0; v != vr; ++v )
+                            acc[r][v] += a * b[v];
+                    }
+                    panel += nr;
+                }
+            }
+
+            if ( rows == mr && cols == nr )
+            {
+                for ( unsigned long r = 0; r != mr; ++r )
+                    for ( unsigned long v = 0; v != vr; ++v )
+                        simd<T>::store( out + r * ldo + v * lanes, acc[r][v] );
+                return;
+            }
+
+            T tile[mr*nr];
+            for ( unsigned long r = 0; r != mr; ++r )
+                for ( unsigned long v = 0; v != vr; ++v )
+                    simd<T>::store( tile + r * nr + v * lanes, acc[r][v] );
+            for ( unsigned long r = 0; r != rows; ++r )
+                std::copy_n( tile + r * nr, cols, out + r * ldo );
+        }
+    }//namespace direct_conv2d_private
+
+    ///
+    /// @brief Buffers of the direct convolution, kept between calls.
+    ///
+    template< typename T >
+    struct direct_conv2d_workspace
+    {
+        std::vector<T> padded_input;    ///< zero-padded input
+        std::vector<T> packed_kernel;   ///< kernel panels of the forward pass
+        std::vector<T> tap_kernel;      ///< kernel as [taps, NC, CH], for the input gradient
+        std::vector<T> padded_gradient; ///< gradient of the padded input
+        std::vector<T> tap_gradient;    ///< kernel gradient as [taps, NC, CH]
+    };
+
+    ///
+    /// @brief Returns true if the direct convolution handles this kernel: 1x1 and 3x3 kernels with a stride of 1 or 2 and no dilation.
+    ///
+    inline bool is_direct_conv2d( conv2d_geometry const& g ) noexcept
+    {
+        bool const small_kernel = ( g.kernel_rows == 1 && g.kernel_cols == 1 ) || ( g.kernel_rows == 3 && g.kernel_cols == 3 );
+        return small_kernel && g.row_stride <= 2 && g.col_stride <= 2 && g.row_dilation == 1 && g.col_dilation == 1 &&
+               g.row_padding < g.kernel_rows && g.col_padding < g.kernel_cols;
+    }
+
+    ///
+    /// @brief Forward pass of the direct convolution.
+    /// @param input NHWC input of [BS, R, C, CH].
+    /// @param kernel Kernels of [NC, CH, r, c], the element (nc, ch, kh, kw) at `kernel[(nc*CH+ch)*r*c+kh*c+kw]`, see `conv2d_geometry`.
+    /// @param output NHWC output of [BS, new_R, new_C, NC], overwritten.
+    ///
+    template< typename T > requires std::floating_point<T>
+    void direct_conv2d( T const* input, T const* kernel, conv2d_geometry const& g, T* output, direct_conv2d_workspace<T>& workspace )
+    {
+        using namespace packed_gemm_private;
+        constexpr unsigned long mr = kernel_traits<T>::mr;
+        constexpr unsigned long nr = kernel_traits<T>::nr;
+
+        unsigned long const taps = g.taps();
+        unsigned long const channels = g.channels;
+        unsigned long const new_channels = g.new_channels;
+        unsigned long const panels = ( new_channels + nr - 1 ) / nr;
+        unsigned long const output_rows = g.output_rows();
+        unsigned long const output_cols = g.output_cols();
+        unsigned long const padded_rows = g.padded_rows();
+        unsigned long const padded_cols = g.padded_cols();
+
+        // panel p holds [taps, CH, NR] of the kernels p*NR to p*NR+NR, zero-padded
+        workspace.packed_kernel.assign( panels * taps * channels * nr, T{0} );
+        T* packed = workspace.packed_kernel.data();
+        for ( unsigned long nc = 0; nc != new_channels; ++nc )
+            for ( unsigned long ch = 0; ch != channels; ++ch )
+                for ( unsigned long t = 0; t != taps; ++t )
+                    packed[( ( nc / nr * taps + t ) * channels + ch ) * nr + nc % nr] = kernel[( nc * channels + ch ) * taps + t];
+
+        T const* padded = pad_conv2d_input( input, g, workspace.padded_input );
+
+        std::vector<unsigned long> tap_offsets( taps );
+        for ( unsigned long kh = 0; kh != g.kernel_rows; ++kh )
+            for ( unsigned long kw = 0; kw != g.kernel_cols; ++kw )
+                tap_offsets[kh*g.kernel_cols+kw] = ( kh * padded_cols + kw ) * channels;
+
+        parallel( [&]( unsigned long task ) // one output row per task
+        {
+            unsigned long const b = task / output_rows;
+            unsigned long const oh = task % output_rows;
+            T const* in_row = padded + ( b * padded_rows + oh * g.row_stride ) * padded_cols * channels;
+            T* out_row = output + task * output_cols * new_channels;
+            unsigned long row_offsets[mr];
+            for ( unsigned long p = 0; p != panels; ++p )
+                for ( unsigned long ow = 0; ow < output_cols; ow += mr )
+                {
+                    unsigned long const rows = std::min( mr, output_cols - ow );
+                    for ( unsigned long r = 0; r != mr; ++r ) // rows out of the tile read the first pixel again, keeping the reads in the buffer
+                        row_offsets[r] = ( r < rows ) ? r * g.col_stride * channels : 0UL;
+                    direct_conv2d_private::micro_kernel( in_row + ow * g.col_stride * channels, row_offsets, tap_offsets.data(), taps, channels,
+                                                         packed + p * taps * channels * nr, out_row + ow * new_channels + p * nr, new_channels,
+                                                         rows, std::min( nr, new_channels - p * nr ) );
+                }
+        }, 0UL, g.batch * output_rows, 1UL );
+    }
+
+    ///
+    /// @brief Input gradient of the direct convolution.
+    /// @param grad NHWC gradient of the output, [BS, new_R, new_C, NC].
+    /// @param kernel Kernels of [NC, CH, r, c], the element (nc, ch, kh, kw) at `kernel[(nc*CH+ch)*r*c+kh*c+kw]`, see `conv2d_geometry`.
+    /// @param input_grad NHWC gradient of the input, [BS, R, C, CH]. Overwritten, or accumulated onto if `accumulate` is true.
+    ///
+    template< typename T > requires std::floating_point<T>
+    void direct_conv2d_input_gradient( T const* grad, T const* kernel, conv2d_geometry const& g, T* input_grad, bool accumulate, direct_conv2d_workspace<T>& workspace )
+    {
+        unsigned long const taps = g.taps();
+        unsigned long const channels = g.channels;
+        unsigned long const new_channels = g.new_channels;
+        unsigned long const output_rows = g.output_rows();
+        unsigned long const output_cols = g.output_cols();
+        unsigned long const padded_rows = g.padded_rows();
+        unsigned long const padded_cols = g.padded_cols();
+        unsigned long const row_size = padded_cols * channels;
+
+        workspace.tap_kernel.resize( taps * new_channels * channels );
+        T* tap_kernel = workspace.tap_kernel.data();
+        for ( unsigned long nc = 0; nc != new_channels; ++nc )
+            for ( unsigned long ch = 0; ch != channels; ++ch )
+                for ( unsigned long t = 0; t != taps; ++t )
+                    tap_kernel[( t * new_channels + nc ) * channels + ch] = kernel[( nc * channels + ch ) * taps + t];
+
+        bool const direct_output = !g.padded() && !accumulate;
+        if ( !direct_output )
+            workspace.padded_gradient.resize( g.batch * padded_rows * row_size );
+        T* padded_grad = direct_output ? input_grad : workspace.padded_gradient.data();
+
+        parallel( [&]( unsigned long task ) // one padded input row per task, collecting all the taps landing on it
+        {
+            unsigned long const b = task / padded_rows;
+            unsigned long const ih = task % padded_rows;
+            T* dst_row = padded_grad + task * row_size;
+            std::fill_n( dst_row, row_size, T{0} );
+            for ( unsigned long kh = 0; kh != g.kernel_rows; ++kh )
+            {
+                if ( ih < kh || ( ih - kh ) % g.row_stride ) continue;
+                unsigned long const oh = ( ih - kh ) / g.row_stride;
+                if ( oh >= output_rows ) continue;
+                T const* grad_row = grad + ( b * output_rows + oh ) * output_cols * new_channels;
+                for ( unsigned long kw = 0; kw != g.kernel_cols; ++kw )
+                    packed_gemm( grad_row, new_channels, false, tap_kernel + ( kh * g.kernel_cols + kw ) * new_channels * channels, channels, false,
+                                 output_cols, new_channels, channels, dst_row + kw * channels, g.col_stride * channels,
+                                 default_gemm_blocking<T>(), gemm_no_epilogue{}, T{1}, T{1} );
+            }
+        }, 0UL, g.batch * padded_rows, 1UL );
+
+        if ( direct_output )
+            return;
+
+        parallel( [&]( unsigned long task ) // crops the padding
+        {
+            unsigned long const b = task / g.rows;
+            unsigned long const r = task % g.rows;
+            T const* src = padded_grad + ( ( b * padded_rows + r + g.row_padding ) * padded_cols + g.col_padding ) * channels;
+            T* dst = input_grad + task * g.cols * channels;
+            if ( accumulate )
+                for ( unsigned long idx = 0; idx != g.cols * channels; ++idx )
+                    dst[idx] += src[idx];
+            else
+                std::copy_n( src, g.cols * channels, dst );
+        }, 0UL, g.batch * g.rows );
+    }
+
+    ///
+    /// @brief Kernel gradient of the direct convolution.
+    /// @param input NHWC input of [BS, R, C, CH].
+    /// @param grad NHWC gradient of the output, [BS, new_R, new_C, NC].
+    /// @param kernel_grad Gradient of the kernels, [NC, CH, r, c] as `kernel`. Overwritten, or accumulated onto if `accumulate` is true.
+    ///
+    template< typename T > requires std::floating_point<T>
+    void direct_conv2d_kernel_gradient( T const* input, T const* grad, conv2d_geometry const& g, T* kernel_grad, bool accumulate, direct_conv2d_workspace<T>& workspace )
+    {
+        unsigned long const taps = g.taps();
+        unsigned long const channels = g.channels;
+        unsigned long const new_channels = g.new_channels;
+        unsigned long const output_rows = g.output_rows();
+        unsigned long const output_cols = g.output_cols();
+        unsigned long const padded_rows = g.padded_rows();
+        unsigned long const padded_cols = g.padded_cols();
+
+        T const* padded = pad_conv2d_input( input, g, workspace.padded_input );
+
+        workspace.tap_gradient.assign( taps * new_channels * channels, T{0} );
+        T* tap_grad = workspace.tap_gradient.data();
+
+        unsigned long const block = 64; // output channels of a task
+        unsigned long const blocks = ( new_channels + block - 1 ) / block;
+        parallel( [&]( unsigned long task )
+        {
+            unsigned long const t = task / blocks;
+            unsigned long const nc = ( task % blocks ) * block;
+            unsigned long const ncs = std::min( block, new_channels - nc );
+            unsigned long const kh = t / g.kernel_cols;
+            unsigned long const kw = t % g.kernel_cols;
+            T* dst = tap_grad + ( t * new_channels + nc ) * channels;
+            // dK_t[nc, ch] += grad_row[ow, nc]' * input_row_t[ow, ch]
+            for ( unsigned long b = 0; b != g.batch; ++b )
+                for ( unsigned long oh = 0; oh != output_rows; ++oh )
+                    packed_gemm( grad + ( b * output_rows + oh ) * output_cols * new_channels + nc, new_channels, true,
+                                 padded + ( ( b * padded_rows + oh * g.row_stride + kh ) * padded_cols + kw ) * channels, g.col_stride * channels, false,
+                                 ncs, output_cols, channels, dst, channels, default_gemm_blocking<T>(), gemm_no_epilogue{}, T{1}, T{1} );
+        }, 0UL, taps * blocks, 1UL );
+
+        parallel( [&]( unsigned long nc )
+        {
+            for ( unsigned long ch = 0; ch != channels; ++ch )
+                for ( unsigned long t = 0; t != taps; ++t )
+                {
+                    T const v = tap_grad[( t * new_channels + nc ) * channels + ch];
+                    T& dst = kernel_grad[( nc * channels + ch ) * taps + t];
+                    dst = accumulate ? dst + v : v;
+                }
+        }, 0UL, new_channels );
+    }
+
+}//namespace ceras::backend
+
+#endif//DIRECTCONVHPPQZXKWMVRNTYJLOBUEADCFIHSPGQZXKWMVRNTYJLOBUEADCFIHSPGQZXKWMVRN
@@ -0,0 +1,309 @@
+#ifndef WMQTUKZRHXOBEVLAIGNCJDYSPFQTUKZRWHXOBEVLAIGNCJDYSPFMQTUKZRWHXOBEVLAIGNCJD
+#define WMQTUKZRHXOBEVLAIGNCJDYSPFQTUKZRWHXOBEVLAIGNCJDYSPFMQTUKZRWHXOBEVLAIGNCJD
+
+#include "../includes.hpp"
+#include "../config.hpp"
+#include "../utils/debug.hpp"
+#include "../utils/range.hpp"
+#include "../utils/singleton.hpp"
+#include "./cblas.hpp"
+#include "./packed_gemm.hpp"
+
+//
+// Autotuning of the CPU GEMM.
+//
+// GEMMs are grouped into shape classes. The first time a class is met, a representative problem of this class is timed with
+// different cache blockings, thread counts and, if CBLAS is enabled, `cblas_gemm`. The fastest setting is kept for the class and,
+// if a tuning file is given, written to it, so that later processes on the same CPU start with the tuned settings directly.
+//
+// The tuning file is `$CERAS_GEMM_TUNING_FILE`. Without it, the tunings are kept in memory for the lifetime of the process only.
+// Autotuning is disabled by setting `gemm_autotuning = 0` (see `../config.hpp`), or by the environment variable `CERAS_GEMM_AUTOTUNING=0`.
+//
+
+namespace ceras::backend
+{
+
+    ///
+    /// @brief Shape classes of a GEMM producing a [m x k] matrix from a [m x n] and a [n x k] matrix.
+    ///
+    enum class gemm_shape_class : unsigned long
+    {
+        gemv = 0,        ///< one side of the output is tiny, such as a batch-1 dense layer
+        tall_skinny = 1, ///< one side of the output is much longer than the other, such as the products in conv2d
+        square = 2,      ///< everything else
+    };
+
+    inline gemm_shape_class classify_gemm( unsigned long m, [[maybe_unused]] unsigned long n, unsigned long k ) noexcept
+    {
+        unsigned long const short_side = std::min( m, k );
+        unsigned long const long_side = std::max( m, k );
+        if ( short_side <= 8 )
+            return gemm_shape_class::gemv;
+        if ( long_side >= 8 * short_side )
+            return gemm_shape_class::tall_skinny;
+        return gemm_shape_class::square;
+    }
+
+    ///
+    /// @brief Tuned setting of the CPU GEMM for a shape class.
+    ///
+    struct gemm_tuning
+    {
+        bool use_cblas;         ///< dispatch to `cblas_gemm` instead of the built-in kernel
+        gemm_blocking blocking; ///< cache blocking of the built-in kernel
+        unsigned long threads;  ///< threads for the built-in kernel, 0 for all the threads of the pool
+    };
+
+    ///
+    /// @brief The setting of the untuned products: CBLAS if enabled, the built-in kernel with the default blocking on all the threads otherwise.
+    ///
+    template< typename T > requires std::floating_point<T>
+    gemm_tuning default_gemm_tuning()
+    {
+        return gemm_tuning{ cblas_mode != 0, default_gemm_blocking<T>(), 0UL };
+    }
+
+    ///
+    /// @brief The identification of the current CPU, used as the key in the tuning file.
+    ///
+    inline std::string cpu_model()
+    {
+        std::string model{ "unknown" };
+        {
+            std::ifstream ifs{ "/proc/cpuinfo" };
+            std::string line;
+            while ( ifs.good() && std::getline( ifs, line ) )
+                if ( line.starts_with( "model name" ) )
+                {
+                    auto const pos = line.find( ':' );
+                    if ( pos != std::string::npos )
+                        model = line.substr( std::min( pos + 2, line.size() ) );
+                    break;
+                }
+        }
+        return model + " x" + std::to_string( std::thread::hardware_concurrency() ) + " simd" + std::to_string( packed_gemm_private::simd_bytes );
+    }
+
+    inline std::string default_gemm_tuning_file()
+    {
+        if ( char const* path = std::getenv( "CERAS_GEMM_TUNING_FILE" ); path && *path )
+            return std::string{ path };
+        return std::string{}; // no persistence
+    }
+
+    template< typename T > requires std::floating_point<T>
+    struct gemm_autotuner
+    {
+        std::string file_path_; ///< empty for no tuning file
+        std::string cpu_model_;
+        std::map<gemm_shape_class, gemm_tuning> tunings_;
+        std::array<bool, 3> timing_{}; ///< the classes being timed by a thread
+        std::mutex mutex_;
+        bool loaded_ = false;
+
+        gemm_autotuner( std::string const& file_path = default_gemm_tuning_file() ) : file_path_{ file_path }, cpu_model_{ cpu_model() } {}
+
+        ///
+        /// @brief Returns the tuned setting for the class of a [m x n] x [n x k] GEMM, tuning the class first if necessary.
+        ///
+        /// The lock is not held while timing: the products of the other threads, and of the threads of the pool running the timed products,
+        /// go on with the default setting until the tuned one is published.
+        ///
+        gemm_tuning query( unsigned long m, unsigned long n, unsigned long k )
+        {
+            gemm_shape_class const shape_class = classify_gemm( m, n, k );
+            bool& timing = timing_[static_cast<unsigned long>( shape_class )];
+
+            {
+                std::lock_guard<std::mutex> lock{ mutex_ };
+                if ( !loaded_ )
+                {
+                    load();
+                    loaded_ = true;
+                }
+
+                if ( auto itor = tunings_.find( shape_class ); itor != tunings_.end() )
+                    return (*itor).second;
+
+                if ( timing ) // by another thread
+                    return default_gemm_tuning<T>();
+                timing = true;
+            }
+
+            gemm_tuning const ans = tune( shape_class );
+
+            std::lock_guard<std::mutex> lock{ mutex_ };
+            tunings_[shape_class] = ans;
+            timing = false;
+            save();
+            return ans;
+        }
+
+        static std::string type_name()
+        {
+            return std::string{ "float" } + std::to_string( sizeof(T) * 8 );
+        }
+
+        void load()
+        {
+            if ( file_path_.empty() )
+                return;
+
+            std::ifstream ifs{ file_path_ };
+            std::string line;
+            while ( ifs.good() && std::getline( ifs, line ) )
+            {
+                // cpu model \t type \t class \t use_cblas mc kc nc threads
+                std::stringstream ss{ line };
+                std::string model, type;
+                unsigned long shape_class;
+                if ( !std::getline( ss, model, '\t' ) || !std::getline( ss, type, '\t' ) ) continue;
+                if ( model != cpu_model_ || type != type_name() ) continue;
+                if ( !(ss >> shape_class) || shape_class > static_cast<unsigned long>( gemm_shape_class::square ) ) continue;
+
+                gemm_tuning tuning;
+                if ( ss >> tuning.use_cblas >> tuning.blocking.mc >> tuning.blocking.kc >> tuning.blocking.nc >> tuning.threads )
+                {
+                    if constexpr( cblas_mode == 0 )
+                        if ( tuning.use_cblas ) continue; // tuned with a CBLAS build, not usable here
+                    tunings_[static_cast<gemm_shape_class>( shape_class )] = tuning;
+                }
+            }
+        }
+
+        void save() const
+        {
+            if ( file_path_.empty() )
+                return;
+
+            // keeps the records of other CPUs and other types
+            std::vector<std::string> lines;
+            {
+                std::ifstream ifs{ file_path_ };
+                std::string line;
+                std::string const& prefix = cpu_model_ + "\t" + type_name() + "\t";
+                while ( ifs.good() && std::getline( ifs, line ) )
+                    if ( !line.empty() && !line.starts_with( prefix ) )
+                        lines.push_back( line );
+            }
+
+            std::error_code ec;
+            auto const& parent = std::filesystem::path{ file_path_ }.parent_path();
+            if ( !parent.empty() )
+                std::filesystem::create_directories( parent, ec );
+
+            std::ofstream ofs{ file_path_ };
+            if ( !ofs.good() )
+            {
+                if constexpr( debug_mode )
+                    debug_log( "gemm_autotuner: failed to write tuning file ", file_path_ );
+                return;
+            }
+            for ( auto const& line : lines )
+                ofs << line << "\n";
+            for ( auto const& [shape_class, tuning] : tunings_ )
+                ofs << cpu_model_ << "\t" << type_name() << "\t" << static_cast<unsigned long>( shape_class ) << " " << tuning.use_cblas << " "
+                    << tuning.blocking.mc << " " << tuning.blocking.kc << " " << tuning.blocking.nc << " " << tuning.threads << "\n";
+        }
+
+        // best wall time of a few runs, in seconds
+        template< typename Function >
+        static double measure( Function const& func )
+        {
+            func(); // warm-up
+            double ans = std::numeric_limits<double>::max();
+            for ( [[maybe_unused]] auto _ : range( 3 ) )
+            {
+                auto const start = std::chrono::steady_clock::now();
+                func();
+                auto const stop = std::chrono::steady_clock::now();
+                ans = std::min( ans, std::chrono::duration<double>( stop - start ).count() );
+            }
+            return ans;
+        }
+
+        static gemm_tuning tune( gemm_shape_class shape_class )
+        {
+            // representative problems, a few milliseconds each
+            auto const [m, n, k] = ( shape_class == gemm_shape_class::gemv ) ? std::make_tuple( 4UL, 1024UL, 2048UL ) :
+                                   ( shape_class == gemm_shape_class::tall_skinny ) ? std::make_tuple( 32UL, 288UL, 4096UL ) :
+                                   std::make_tuple( 384UL, 384UL, 384UL );
+
+            std::vector<T> A( m * n ), B( n * k ), C( m * k );
+            std::mt19937 generator{ 42 };
+            std::uniform_real_distribution<T> distribution{ T{-1}, T{1} };
+            std::generate( A.begin(), A.end(), [&](){ return distribution( generator ); } );
+            std::generate( B.begin(), B.end(), [&](){ return distribution( generator ); } );
+
+            unsigned long const total_threads = get_num_threads();
+            gemm_blocking const default_blocking = default_gemm_blocking<T>();
+            constexpr unsigned long mr = packed_gemm_private::kernel_traits<T>::mr;
+
+            auto const& time_builtin = [&]( gemm_blocking const& blocking, unsigned long threads )
+            {
+                return measure( [&](){ parallel_packed_gemm( A.data(), n, false, B.data(), k, false, m, n, k, C.data(), k, threads, blocking ); } );
+            };
+
+            // cache blocking, with all the cores
+            gemm_tuning ans{ false, default_blocking, total_threads };
+            double best_time = time_builtin( default_blocking, total_threads );
+            for ( unsigned long mc : { 8*mr, 16*mr, 32*mr } )
+                for ( unsigned long kc : { 128UL, 256UL, 512UL } )
+                {
+                    gemm_blocking const blocking{ mc, kc, default_blocking.nc };
+                    if ( double const t = time_builtin( blocking, total_threads ); t < best_time )
+                    {
+                        best_time = t;
+                        ans.blocking = blocking;
+                    }
+                }
+
+            // thread count, fewer threads can be faster for small or memory-bound problems
+            for ( unsigned long threads : { 1UL, total_threads / 4, total_threads / 2 } )
+            {
+                if ( threads == 0 || threads >= total_threads ) continue;
+                if ( double const t = time_builtin( ans.blocking, threads ); t < best_time )
+                {
+                    best_time = t;
+                    ans.threads = threads;
+                }
+            }
+
+            // built-in kernel or CBLAS
+            if constexpr( cblas_mode )
+            {
+                double const t = measure( [&](){ cblas_gemm( A.data(), false, B.data(), false, m, n, k, C.data() ); } );
+                if ( t < best_time )
+                    ans.use_cblas = true;
+            }
+
+            if constexpr( debug_mode )
+                debug_log( "gemm_autotuner: class ", static_cast<unsigned long>( shape_class ), " tuned to mc=", ans.blocking.mc, ", kc=", ans.blocking.kc,
+                           ", nc=", ans.blocking.nc, ", threads=", ans.threads, ", cblas=", ans.use_cblas );
+            return ans;
+        }
+    };
+
+    ///
+    /// @brief Returns the CPU GEMM setting for a [m x n] x [n x k] product. Small products and disabled autotuning get the default setting.
+    ///
+    template< typename T > requires std::floating_point<T>
+    gemm_tuning query_gemm_tuning( unsigned long m, unsigned long n, unsigned long k )
+    {
+        if ( m * n * k < (1UL << 20) ) // timing noise exceeds any gain
+            return default_gemm_tuning<T>();
+
+        static bool const enabled_by_environment = []()
+        {
+            char const* flag = std::getenv( "CERAS_GEMM_AUTOTUNING" );
+            return !( flag && std::string{ flag } == std::string{ "0" } );
+        }();
+        if ( !gemm_autotuning || !enabled_by_environment )
+            return default_gemm_tuning<T>();
+
+        return singleton<gemm_autotuner<T>>::instance().query( m, n, k );
+    }
+
+}//namespace ceras::backend
+
+#endif//WMQTUKZRHXOBEVLAIGNCJDYSPFQTUKZRWHXOBEVLAIGNCJDYSPFMQTUKZRWHXOBEVLAIGNCJD
@@ -0,0 +1,393 @@
+#ifndef GROUPEDCONVHPPWMTQZKXVRNYJLOBUEADCFIHSPGWMTQZKXVRNYJLOBUEADCFIHSPGWMTQZKXV
+#define GROUPEDCONVHPPWMTQZKXVRNYJLOBUEADCFIHSPGWMTQZKXVRNYJLOBUEADCFIHSPGWMTQZKXV
+
+#include "../includes.hpp"
+#include "../config.hpp"
+#include "../utils/parallel.hpp"
+#include "./conv2d_geometry.hpp"
+#include "./implicit_gemm_conv2d.hpp"
+
+//
+// Grouped and depthwise convolutions of NHWC tensors.
+//
+// The CH input channels and the NC output channels are split into G groups, the output channel nc of the group nc/(NC/G) reading only the CH/G input
+// channels of its group. The kernels are [NC, r, c, CH/G], the element (nc, cg, kh, kw) being `kernel[(nc*CH/G+cg)*taps+kh*kernel_cols+kw]` as in
+// `conv2d_geometry`. The depthwise convolution is the case G = CH, NC = CH * depth_multiplier.
+//
+// The geometry passed to the functions below is the one of the whole convolution: `channels` is CH and `new_channels` is NC.
+//
+// Narrow groups run as a direct convolution whose inner loops go along the output channels of one pixel, which are contiguous in NHWC:
+// the kernels are repacked to [taps, CH/G, NC], and the output channel nc of a pixel accumulates input[grp*CH/G+cg] * packed[(tap*CH/G+cg)*NC+nc].
+// With one output channel per group, as in the depthwise convolution, the loop over the groups is a plain multiply-add of two contiguous vectors.
+//
+// Wide groups, whose GEMMs are large enough, run one implicit-GEMM convolution per group on the gathered channels of the group, see `implicit_gemm_conv2d.hpp`.
+//
+// The input gradient is partitioned by (sample, block of groups) and the kernel gradient by (tap, block of groups), so that no two tasks write the same element,
+// and the results do not depend on the number of threads.
+//
+
+namespace ceras::backend
+{
+
+    namespace grouped_conv2d_private
+    {
+        inline constexpr unsigned long group_block = 64;
+
+        // dst[0:n] += a[0:n] * b[0:n], the pointers not aliasing so that the loop vectorizes
+        template< typename T >
+        void multiply_add( T* __restrict__ dst, T const* __restrict__ a, T const* __restrict__ b, unsigned long n ) noexcept
+        {
+            for ( unsigned long idx = 0; idx != n; ++idx )
+                dst[idx] += a[idx] * b[idx];
+        }
+
+        // dst[0:n] += a[0:n*stride:stride] * b[0:n]
+        template< typename T >
+        void strided_multiply_add( T* __restrict__ dst, T const* __restrict__ a, unsigned long stride, T const* __restrict__ b, unsigned long n ) noexcept
+        {
+            for ( unsigned long idx = 0; idx != n; ++idx )
+                dst[idx] += a[idx*stride] * b[idx];
+        }
+
+        // [taps, CH/G, NC] <= kernel [NC, CH/G, taps]
+        template< typename T >
+        void pack_kernel( T const* kernel, unsigned long taps, unsigned long group_channels, unsigned long new_channels, std::vector<T>& packed )
+        {
+            packed.resize( taps * group_channels * new_channels );
+            for ( unsigned long nc = 0; nc != new_channels; ++nc )
+                for ( unsigned long cg = 0; cg != group_channels; ++cg )
+                    for ( unsigned long tap = 0; tap != taps; ++tap )
+                        packed[(tap*group_channels+cg)*new_channels+nc] = kernel[(nc*group_channels+cg)*taps+tap];
+        }
+
+        // kernel [NC, CH/G, taps] <= [taps, CH/G, NC], overwritten or accumulated onto
+        template< typename T >
+        void unpack_kernel( T const* packed, unsigned long taps, unsigned long group_channels, unsigned long new_channels, T* kernel, bool accumulate ) noexcept
+        {
+            for ( unsigned long nc = 0; nc != new_channels; ++nc )
+                for ( unsigned long cg = 0; cg != group_channels; ++cg )
+                    for ( unsigned long tap = 0; tap != taps; ++tap )
+                    {
+                        T const value = packed[(tap*group_channels+cg)*new_channels+nc];
+                        T& dst = kernel[(nc*group_channels+cg)*taps+tap];
+                        dst = accumulate ? dst + value : value;
+                    }
+        }
+
+        // offset of the padded input pixel under the tap (kh, kw) of the output pixel (b, oh, ow)
+        inline unsigned long input_offset( conv2d_geometry const& g, unsigned long b, unsigned long oh, unsigned long ow, unsigned long kh, unsigned long kw ) noexcept
+        {
+            return ( ( b * g.padded_rows() + oh * g.row_stride + kh * g.row_dilation ) * g.padded_cols() + ow * g.col_stride + kw * g.col_dilation ) * g.channels;
+        }
+
+        // dst[b, r, c, first:first+count] <= src[b, r, c, first:first+count], for the NHWC tensors of `pixels` pixels with `src_channels` and `dst_channels` channels
+        template< typename T >
+        void copy_channels( T const* src, unsigned long src_channels, T* dst, unsigned long dst_channels, unsigned long pixels, unsigned long count, bool accumulate ) noexcept
+        {
+            parallel( [=]( unsigned long p )
+            {
+                T const* s = src + p * src_channels;
+                T* d = dst + p * dst_channels;
+                if ( accumulate )
+                    for ( unsigned long ch = 0; ch != count; ++ch )
+                        d[ch] += s[ch];
+                else
+                    std::copy_n( s, count, d );
+            }, 0UL, pixels, 1024UL );
+        }
+    }//namespace grouped_conv2d_private
+
+    ///
+    /// @brief Buffers of the grouped convolution, kept between calls.
+    ///
+    template< typename T >
+    struct grouped_conv2d_workspace
+    {
+        std::vector<T> padded_input;
+        std::vector<T> padded_gradient;
+        std::vector<T> packed_kernel;
+        std::vector<T> packed_kernel_gradient;
+        std::vector<T> group_input;     // the channels of one group, for the wide groups
+        std::vector<T> group_output;
+        implicit_gemm_conv2d_workspace<T> implicit_gemm;
+    };
+
+    ///
+    /// @brief Whether the groups of the convolution are wide enough to run as one implicit GEMM per group.
+    ///
+    template< typename T >
+    bool is_wide_group_conv2d( conv2d_geometry const& g, unsigned long groups ) noexcept
+    {
+        if constexpr( std::floating_point<T> )
+            return g.channels / groups >= 16 && g.new_channels / groups >= 16;
+        else
+            return false;
+    }
+
+    ///
+    /// @brief Forward pass of the grouped convolution.
+    /// @param input NHWC input of [BS, R, C, CH].
+    /// @param kernel Kernels of [NC, r, c, CH/G].
+    /// @param groups The number of groups G, dividing CH and NC.
+    /// @param output NHWC output of [BS, new_R, new_C, NC], overwritten.
+    ///
+    template< typename T >
+    void grouped_conv2d( T const* input, T const* kernel, conv2d_geometry const& g, unsigned long groups, T* output, grouped_conv2d_workspace<T>& workspace )
+    {
+        using namespace grouped_conv2d_private;
+        unsigned long const group_channels = g.channels / groups;
+        unsigned long const group_new_channels = g.new_channels / groups;
+        unsigned long const new_channels = g.new_channels;
+        unsigned long const output_rows = g.output_rows();
+        unsigned long const output_cols = g.output_cols();
+        unsigned long const output_pixels = g.batch * output_rows * output_cols;
+
+        if ( is_wide_group_conv2d<T>( g, groups ) )
+        {
+            conv2d_geometry group_geometry = g;
+            group_geometry.channels = group_channels;
+            group_geometry.new_channels = group_new_channels;
+            unsigned long const input_pixels = g.batch * g.rows * g.cols;
+            workspace.group_input.resize( input_pixels * group_channels );
+            workspace.group_output.resize( output_pixels * group_new_channels );
+            for ( unsigned long grp = 0; grp != groups; ++grp )
+            {
+                copy_channels( input + grp * group_channels, g.channels, workspace.group_input.data(), group_channels, input_pixels, group_channels, false );
+                implicit_gemm_conv2d( workspace.group_input.data(), kernel + grp * group_new_channels * group_geometry.depth(), group_geometry, workspace.group_output.data(), workspace.implicit_gemm );
+                copy_channels( workspace.group_output.data(), group_new_channels, output + grp * group_new_channels, new_channels, output_pixels, group_new_channels, false );
+            }
+            return;
+        }
+
+        T const* padded = pad_conv2d_input( input, g, workspace.padded_input );
+        pack_kernel( kernel, g.taps(), group_channels, new_channels, workspace.packed_kernel );
+        T const* packed = workspace.packed_kernel.data();
+
+        parallel( [&]( unsigned long row )
+        {
+            unsigned long const b = row / output_rows;
+            unsigned long const oh = row % output_rows;
+            for ( unsigned long ow = 0; ow != output_cols; ++ow )
+            {
+                T* out = output + ( row * output_cols + ow ) * new_channels;
+                std::fill_n( out, new_channels, T{0} );
+                for ( unsigned long kh = 0; kh != g.kernel_rows; ++kh )
+                    for ( unsigned long kw = 0; kw != g.kernel_cols; ++kw )
+                    {
+                        T const* in = padded + input_offset( g, b, oh, ow, kh, kw );
+                        for ( unsigned long cg = 0; cg != group_channels; ++cg )
+                        {
+                            T const* k = packed + ( ( kh * g.kernel_cols + kw ) * group_channels + cg ) * new_channels;
+                            if ( group_new_channels == 1 && group_channels == 1 )
+                                multiply_add( out, in, k, groups );
+                            else if ( group_new_channels == 1 )
+                                strided_multiply_add( out, in + cg, group_channels, k, groups );
+                            else
+                            {
+                                for ( unsigned long grp = 0; grp != groups; ++grp )
+                                {
+                                    T const value = in[grp*group_channels+cg];
+                                    for ( unsigned long nc = grp * group_new_channels; nc != ( grp + 1 ) * group_new_channels; ++nc )
+                                        out[nc] += value * k[nc];
+                                }
+                            }
+                        }
+                    }
+            }
+        }, 0UL, g.batch * output_rows );
+    }
+
+    ///
+    /// @brief Input gradient of the grouped convolution.
+    /// @param grad NHWC gradient of the output, [BS, new_R, new_C, NC].
+    /// @param kernel Kernels of [NC, r, c, CH/G].
+    /// @param input_grad NHWC gradient of the input, [BS, R, C, CH]. Overwritten, or accumulated onto if `accumulate` is true.
+    ///
+    template< typename T >
+    void grouped_conv2d_input_gradient( T const* grad, T const* kernel, conv2d_geometry const& g, unsigned long groups, T* input_grad, bool accumulate, grouped_conv2d_workspace<T>& workspace )
+    {
+        using namespace grouped_conv2d_private;
+        unsigned long const group_channels = g.channels / groups;
+        unsigned long const group_new_channels = g.new_channels / groups;
+        unsigned long const new_channels = g.new_channels;
+        unsigned long const output_rows = g.output_rows();
+        unsigned long const output_cols = g.output_cols();
+        unsigned long const output_pixels = g.batch * output_rows * output_cols;
+        unsigned long const input_pixels = g.batch * g.rows * g.cols;
+
+        if ( is_wide_group_conv2d<T>( g, groups ) )
+        {
+            conv2d_geometry group_geometry = g;
+            group_geometry.channels = group_channels;
+            group_geometry.new_channels = group_new_channels;
+            workspace.group_output.resize( output_pixels * group_new_channels );
+            workspace.group_input.resize( input_pixels * group_channels );
+            for ( unsigned long grp = 0; grp != groups; ++grp )
+            {
+                copy_channels( grad + grp * group_new_channels, new_channels, workspace.group_output.data(), group_new_channels, output_pixels, group_new_channels, false );
+                implicit_gemm_conv2d_input_gradient( workspace.group_output.data(), kernel + grp * group_new_channels * group_geometry.depth(), group_geometry,
+                                                     workspace.group_input.data(), false, workspace.implicit_gemm );
+                copy_channels( workspace.group_input.data(), group_channels, input_grad + grp * group_channels, g.channels, input_pixels, group_channels, accumulate );
+            }
+            return;
+        }
+
+        pack_kernel( kernel, g.taps(), group_channels, new_channels, workspace.packed_kernel );
+        T const* packed = workspace.packed_kernel.data();
+
+        // the gradient of the padded input, which is the input gradient itself without padding
+        T* padded_grad = input_grad;
+        if ( g.padded() )
+        {
+            workspace.padded_gradient.resize( g.batch * g.padded_rows() * g.padded_cols() * g.channels );
+            padded_grad = workspace.padded_gradient.data();
+        }
+        if ( g.padded() || !accumulate )
+            std::fill_n( padded_grad, g.batch * g.padded_rows() * g.padded_cols() * g.channels, T{0} );
+
+        unsigned long const blocks = ( groups + group_block - 1 ) / group_block;
+        parallel( [&]( unsigned long task )
+        {
+            unsigned long const b = task / blocks;
+            unsigned long const first_group = ( task % blocks ) * group_block;
+            unsigned long const last_group = std::min( groups, first_group + group_block );
+            for ( unsigned long oh = 0; oh != output_rows; ++oh )
+                for ( unsigned long ow = 0; ow != output_cols; ++ow )
+                {
+                    T const* go = grad + ( ( b * output_rows + oh ) * output_cols + ow ) * new_channels;
+                    for ( unsigned long kh = 0; kh != g.kernel_rows; ++kh )
+                        for ( unsigned long kw = 0; kw != g.kernel_cols; ++kw )
+                        {
+                            T* gi = padded_grad + input_offset( g, b, oh, ow, kh, kw );
+                            for ( unsigned long cg = 0; cg != group_channels; ++cg )
+                            {
+                                T const* k = packed + ( ( kh * g.kernel_cols + kw ) * group_channels + cg ) * new_channels;
+                                if ( group_new_channels == 1 && group_channels == 1 )
+                                {
+                                    multiply_add( gi + first_group, go + first_group, k + first_group, last_group - first_group );
+                                }
+                                else if ( group_new_channels == 1 )
+                                {
+                                    for ( unsigned long grp = first_group; grp != last_group; ++grp )
+                                        gi[grp*group_channels+cg] += go[grp] * k[grp];
+                                }
+                                else
+                                {
+                                    for ( unsigned long grp = first_group; grp != last_group; ++grp )
+                                    {
+                                        T sum{0};
+                                        for ( unsigned long nc = grp * group_new_channels; nc != ( grp + 1 ) * group_new_channels; ++nc )
+                                            sum += go[nc] * k[nc];
+                                        gi[grp*group_channels+cg] += sum;
+                                    }
+                                }
+                            }
+                        }
+                }
+        }, 0UL, g.batch * blocks, 1UL );
+
+        if ( !g.padded() )
+            return;
+
+        // crops the padding away
+        unsigned long const row_size = g.cols * g.channels;
+        parallel( [&]( unsigned long row )
+        {
+            unsigned long const b = row / g.rows;
+            unsigned long const r = row % g.rows;
+            T const* src = padded_grad + ( ( b * g.padded_rows() + r + g.row_padding ) * g.padded_cols() + g.col_padding ) * g.channels;
+            T* dst = input_grad + row * row_size;
+            if ( accumulate )
+                for ( unsigned long idx = 0; idx != row_size; ++idx )
+                    dst[idx] += src[idx];
+            else
+                std::copy_n( src, row_size, dst );
+        }, 0UL, g.batch * g.rows );
+    }
+
+    ///
+    /// @brief Kernel gradient of the grouped convolution.
+    /// @param input NHWC input of [BS, R, C, CH].
+    /// @param grad NHWC gradient of the output, [BS, new_R, new_C, NC].
+    /// @param kernel_grad Gradient of the kernels, [NC, r, c, CH/G]. Overwritten, or accumulated onto if `accumulate` is true.
+    ///
+    template< typename T >
+    void grouped_conv2d_kernel_gradient( T const* input, T const* grad, conv2d_geometry const& g, unsigned long groups, T* kernel_grad, bool accumulate, grouped_conv2d_workspace<T>& workspace )
+    {
+        using namespace grouped_conv2d_private;
+        unsigned long const group_channels = g.channels / groups;
+        unsigned long const group_new_channels = g.new_channels / groups;
+        unsigned long const new_channels = g.new_channels;
+        unsigned long const output_rows = g.output_rows();
+        unsigned long const output_cols = g.output_cols();
+        unsigned long const output_pixels = g.batch * output_rows * output_cols;
+        unsigned long const taps = g.taps();
+
+        if ( is_wide_group_conv2d<T>( g, groups ) )
+        {
+            conv2d_geometry group_geometry = g;
+            group_geometry.channels = group_channels;
+            group_geometry.new_channels = group_new_channels;
+            unsigned long const input_pixels = g.batch * g.rows * g.cols;
+            workspace.group_input.resize( input_pixels * group_channels );
+            workspace.group_output.resize( output_pixels * group_new_channels );
+            for ( unsigned long grp = 0; grp != groups; ++grp )
+            {
+                copy_channels( input + grp * group_channels, g.channels, workspace.group_input.data(), group_channels, input_pixels, group_channels, false );
+                copy_channels( grad + grp * group_new_channels, new_channels, workspace.group_output.data(), group_new_channels, output_pixels, group_new_channels, false );
+                implicit_gemm_conv2d_kernel_gradient( workspace.group_input.data(), workspace.group_output.data(), group_geometry,
+                                                      kernel_grad + grp * group_new_channels * group_geometry.depth(), accumulate, workspace.implicit_gemm );
+            }
+            return;
+        }
+
+        T const* padded = pad_conv2d_input( input, g, workspace.padded_input );
+        workspace.packed_kernel_gradient.assign( taps * group_channels * new_channels, T{0} );
+        T* packed_grad = workspace.packed_kernel_gradient.data();
+
+        // the rows of the packed gradient of one tap are only written by the tasks of that tap
+        unsigned long const blocks = ( groups + group_block - 1 ) / group_block;
+        parallel( [&]( unsigned long task )
+        {
+            unsigned long const tap = task / blocks;
+            unsigned long const kh = tap / g.kernel_cols;
+            unsigned long const kw = tap % g.kernel_cols;
+            unsigned long const first_group = ( task % blocks ) * group_block;
+            unsigned long const last_group = std::min( groups, first_group + group_block );
+            for ( unsigned long b = 0; b != g.batch; ++b )
+                for ( unsigned long oh = 0; oh != output_rows; ++oh )
+                    for ( unsigned long ow = 0; ow != output_cols; ++ow )
+                    {
+                        T const* go = grad + ( ( b * output_rows + oh ) * output_cols + ow ) * new_channels;
+                        T const* in = padded + input_offset( g, b, oh, ow, kh, kw );
+                        for ( unsigned long cg = 0; cg != group_channels; ++cg )
+                        {
+                            T* dk = packed_grad + ( tap * group_channels + cg ) * new_channels;
+                            if ( group_new_channels == 1 && group_channels == 1 )
+                            {
+                                multiply_add( dk + first_group, in + first_group, go + first_group, last_group - first_group );
+                            }
+                            else if ( group_new_channels == 1 )
+                            {
+                                for ( unsigned long grp = first_group; grp != last_group; ++grp )
+                                    dk[grp] += in[grp*group_channels+cg] * go[grp];
+                            }
+                            else
+                            {
+                                for ( unsigned long grp = first_group; grp != last_group; ++grp )
+                                {
+                                    T const value = in[grp*group_channels+cg];
+                                    for ( unsigned long nc = grp * group_new_channels; nc != ( grp + 1 ) * group_new_channels; ++nc )
+                                        dk[nc] += value * go[nc];
+                                }
+                            }
+                        }
+                    }
+        }, 0UL, taps * blocks, 1UL );
+
+        unpack_kernel( packed_grad, taps, group_channels, new_channels, kernel_grad, accumulate );
+    }
+
+}//namespace ceras::backend
+
+#endif//GROUPEDCONVHPPWMTQZKXVRNYJLOBUEADCFIHSPGWMTQZKXVRNYJLOBUEADCFIHSPGWMTQZKXV
@@ -0,0 +1,317 @@
+#ifndef IMPLICITGEMMCONVHPPRNTYJLWOBQZXKMVUEADCFIHSPGRNTYJLWOBQZXKMVUEADCFIHSPGRNTY
+#define IMPLICITGEMMCONVHPPRNTYJLWOBQZXKMVUEADCFIHSPGRNTYJLWOBQZXKMVUEADCFIHSPGRNTY
+
+#include "../includes.hpp"
+#include "../config.hpp"
+#include "../utils/parallel.hpp"
+#include "./packed_gemm.hpp"
+#include "./conv2d_geometry.hpp"
+
+//
+// Implicit-GEMM convolution of NHWC tensors, for any kernel, stride and dilation.
+//
+// The convolution is the product of the [BS*new_R*new_C, r*c*CH] patches of the input with the [NC, r*c*CH] kernels, but the patch matrix is never
+// stored: the patches are gathered from the input straight into the packed panels of the GEMM, one cache block at a time, and the micro-kernel
+// of the packed GEMM runs on them. Neither the input nor its gradient is padded: the elements of a patch falling into the padding are zeros when
+// gathered, and are skipped when scattered. Scratch memory is a few packed blocks per thread.
+//
+// The element (p, d) of the patch matrix, with p the output pixel (b, oh, ow) and d the kernel element (ch, kh, kw), is
+//
+//      input[origin(p) + tap(d)] if the row oh*row_stride - row_padding + kh*row_dilation and the column ow*col_stride - col_padding + kw*col_dilation
+//      are in the input, 0 otherwise
+//
+// where origin(p) = ((b*R + oh*row_stride - row_padding)*C + ow*col_stride - col_padding)*CH and tap(d) = (kh*row_dilation*C + kw*col_dilation)*CH + ch.
+// The bounds are only checked for the pixels whose receptive field crosses the border of the input.
+//
+// The input gradient is computed one output row at a time, and its patches are summed into the input gradient in phases of output rows whose
+// receptive fields do not overlap. The kernel gradient is partitioned by output blocks. The results do not depend on the number of threads.
+//
+
+namespace ceras::backend
+{
+
+    namespace implicit_gemm_private
+    {
+        // the top left corner of the receptive field of an output pixel, negative in the padding
+        struct patch_origin
+        {
+            long offset; // origin(p), see above
+            long row;
+            long col;
+            bool inside; // the receptive field lies in the input, no bound to check
+        };
+
+        // a kernel element, relative to the origin of a patch
+        struct patch_tap
+        {
+            long offset; // tap(d), see above
+            unsigned long row;
+            unsigned long col;
+        };
+
+        inline patch_origin make_patch_origin( conv2d_geometry const& g, unsigned long p ) noexcept
+        {
+            unsigned long const output_cols = g.output_cols();
+            unsigned long const output_rows = g.output_rows();
+            unsigned long const ow = p % output_cols;
+            unsigned long const oh = ( p / output_cols ) % output_rows;
+            unsigned long const b = p / ( output_cols * output_rows );
+            long const row = static_cast<long>( oh * g.row_stride ) - static_cast<long>( g.row_padding );
+            long const col = static_cast<long>( ow * g.col_stride ) - static_cast<long>( g.col_padding );
+            long const span_rows = static_cast<long>( ( g.kernel_rows - 1 ) * g.row_dilation + 1 );
+            long const span_cols = static_cast<long>( ( g.kernel_cols - 1 ) * g.col_dilation + 1 );
+            bool const inside = row >= 0 && col >= 0 && row + span_rows <= static_cast<long>( g.rows ) && col + span_cols <= static_cast<long>( g.cols );
+            return patch_origin{ ( ( static_cast<long>( b * g.rows ) + row ) * static_cast<long>( g.cols ) + col ) * static_cast<long>( g.channels ), row, col, inside };
+        }
+
+        inline void make_patch_taps( conv2d_geometry const& g, std::vector<patch_tap>& taps )
+        {
+            taps.resize( g.depth() );
+            for ( unsigned long ch = 0; ch != g.channels; ++ch )
+                for ( unsigned long kh = 0; kh != g.kernel_rows; ++kh )
+                    for ( unsigned long kw = 0; kw != g.kernel_cols; ++kw )
+                    {
+                        unsigned long const row = kh * g.row_dilation;
+                        unsigned long const col = kw * g.col_dilation;
+                        taps[( ch * g.kernel_rows + kh ) * g.kernel_cols + kw] = patch_tap{ static_cast<long>( ( row * g.cols + col ) * g.channels + ch ), row, col };
+                    }
+        }
+
+        // the index in the input of a kernel element of a patch, -1 in the padding
+        inline long patch_index( conv2d_geometry const& g, patch_origin const& origin, patch_tap const& tap ) noexcept
+        {
+            if ( !origin.inside )
+            {
+                // the negative rows and columns wrap around to values larger than any bound
+                unsigned long const row = static_cast<unsigned long>( origin.row + static_cast<long>( tap.row ) );
+                unsigned long const col = static_cast<unsigned long>( origin.col + static_cast<long>( tap.col ) );
+                if ( row >= g.rows || col >= g.cols )
+                    return -1;
+            }
+            return origin.offset + tap.offset;
+        }
+
+        // packs the patches of `rows` output pixels over `depth` kernel elements into mr-tall panels, as `pack_a` of the packed GEMM
+        template< typename T >
+        void pack_patches_a( T const* input, conv2d_geometry const& g, patch_origin const* origins, patch_tap const* taps, unsigned long rows, unsigned long depth, T* buffer ) noexcept
+        {
+            constexpr unsigned long mr = packed_gemm_private::kernel_traits<T>::mr;
+            for ( unsigned long r = 0; r < rows; r += mr )
+            {
+                unsigned long const rs = std::min( mr, rows - r );
+                bool const inside = std::all_of( origins + r, origins + r + rs, []( patch_origin const& origin ){ return origin.inside; } );
+                for ( unsigned long l = 0; l != depth; ++l )
+                {
+                    unsigned long idx = 0;
+                    if ( inside )
+                        for ( ; idx != rs; ++idx ) buffer[idx] = input[origins[r+idx].offset + taps[l].offset];
+                    else
+                        for ( ; idx != rs; ++idx )
+                        {
+                            long const index = patch_index( g, origins[r+idx], taps[l] );
+                            buffer[idx] = ( index < 0 ) ? T{0} : input[index];
+                        }
+                    for ( ; idx != mr; ++idx ) buffer[idx] = T{0};
+                    buffer += mr;
+                }
+            }
+        }
+
+        // packs the patches of `depth` output pixels over `cols` kernel elements into nr-wide panels, as `pack_b` of the packed GEMM
+        template< typename T >
+        void pack_patches_b( T const* input, conv2d_geometry const& g, patch_origin const* origins, patch_tap const* taps, unsigned long depth, unsigned long cols, T* buffer ) noexcept
+        {
+            constexpr unsigned long nr = packed_gemm_private::kernel_traits<T>::nr;
+            for ( unsigned long c = 0; c < cols; c += nr )
+            {
+                unsigned long const cs = std::min( nr, cols - c );
+                for ( unsigned long l = 0; l != depth; ++l )
+                {
+                    patch_origin const& origin = origins[l];
+                    unsigned long idx = 0;
+                    if ( origin.inside )
+                        for ( ; idx != cs; ++idx ) buffer[idx] = input[origin.offset + taps[c+idx].offset];
+                    else
+                        for ( ; idx != cs; ++idx )
+                        {
+                            long const index = patch_index( g, origin, taps[c+idx] );
+                            buffer[idx] = ( index < 0 ) ? T{0} : input[index];
+                        }
+                    for ( ; idx != nr; ++idx ) buffer[idx] = T{0};
+                    buffer += nr;
+                }
+            }
+        }
+    }//namespace implicit_gemm_private
+
+    ///
+    /// @brief Buffers of the implicit-GEMM convolution, kept between calls.
+    ///
+    template< typename T >
+    struct implicit_gemm_conv2d_workspace
+    {
+        std::vector<implicit_gemm_private::patch_tap> taps; ///< the kernel elements relative to the origin of a patch, see above
+    };
+
+    ///
+    /// @brief Forward pass of the implicit-GEMM convolution.
+    /// @param input NHWC input of [BS, R, C, CH].
+    /// @param kernel Kernels of [NC, CH, r, c], the element (nc, ch, kh, kw) at `kernel[(nc*CH+ch)*r*c+kh*c+kw]`, see `conv2d_geometry`.
+    /// @param output NHWC output of [BS, new_R, new_C, NC], overwritten.
+    ///
+    template< typename T > requires std::floating_point<T>
+    void implicit_gemm_conv2d( T const* input, T const* kernel, conv2d_geometry const& g, T* output, implicit_gemm_conv2d_workspace<T>& workspace )
+    {
+        using namespace packed_gemm_private;
+        using namespace implicit_gemm_private;
+        constexpr unsigned long mr = kernel_traits<T>::mr;
+        constexpr unsigned long nr = kernel_traits<T>::nr;
+        constexpr unsigned long mc = kernel_traits<T>::mc;
+        constexpr unsigned long kc = kernel_traits<T>::kc;
+        constexpr unsigned long nc = kernel_traits<T>::nc;
+
+        unsigned long const pixels = g.pixels();
+        unsigned long const depth = g.depth();
+        unsigned long const new_channels = g.new_channels;
+
+        make_patch_taps( g, workspace.taps );
+        patch_tap const* taps = workspace.taps.data();
+
+        // output[p, :] = patches[p, :] * kernel', one block of mc output pixels per task
+        parallel( [&]( unsigned long task )
+        {
+            unsigned long const row_begin = task * mc;
+            unsigned long const rows = std::min( mc, pixels - row_begin );
+            patch_origin origins[mc];
+            for ( unsigned long r = 0; r != rows; ++r )
+                origins[r] = make_patch_origin( g, row_begin + r );
+
+            T* a_buffer = packing_buffer<T>( 0, mc * kc ).data();
+            T* b_buffer = packing_buffer<T>( 1, std::min( nc, (new_channels+nr-1)/nr*nr ) * kc ).data();
+            for ( unsigned long jc = 0; jc < new_channels; jc += nc )
+            {
+                unsigned long const cols = std::min( nc, new_channels - jc );
+                for ( unsigned long pc = 0; pc < depth; pc += kc )
+                {
+                    unsigned long const block_depth = std::min( kc, depth - pc );
+                    T const block_beta = ( pc == 0 ) ? T{0} : T{1};
+                    pack_b( kernel + jc * depth + pc, depth, true, block_depth, cols, b_buffer );
+                    pack_patches_a( input, g, origins, taps + pc, rows, block_depth, a_buffer );
+                    for ( unsigned long jr = 0; jr < cols; jr += nr )
+                        for ( unsigned long ir = 0; ir < rows; ir += mr )
+                            micro_kernel( block_depth, a_buffer + ir * block_depth, b_buffer + jr * block_depth, output + ( row_begin + ir ) * new_channels + jc + jr,
+                                          new_channels, std::min( mr, rows - ir ), std::min( nr, cols - jr ), T{1}, block_beta );
+                }
+            }
+        }, 0UL, ( pixels + mc - 1 ) / mc, 1UL );
+    }
+
+    ///
+    /// @brief Input gradient of the implicit-GEMM convolution.
+    /// @param grad NHWC gradient of the output, [BS, new_R, new_C, NC].
+    /// @param kernel Kernels of [NC, CH, r, c], the element (nc, ch, kh, kw) at `kernel[(nc*CH+ch)*r*c+kh*c+kw]`, see `conv2d_geometry`.
+    /// @param input_grad NHWC gradient of the input, [BS, R, C, CH]. Overwritten, or accumulated onto if `accumulate` is true.
+    ///
+    template< typename T > requires std::floating_point<T>
+    void implicit_gemm_conv2d_input_gradient( T const* grad, T const* kernel, conv2d_geometry const& g, T* input_grad, bool accumulate, implicit_gemm_conv2d_workspace<T>& workspace )
+    {
+        using namespace implicit_gemm_private;
+        unsigned long const depth = g.depth();
+        unsigned long const channels = g.channels;
+        unsigned long const new_channels = g.new_channels;
+        unsigned long const output_rows = g.output_rows();
+        unsigned long const output_cols = g.output_cols();
+
+        make_patch_taps( g, workspace.taps );
+        patch_tap const* taps = workspace.taps.data();
+
+        if ( !accumulate )
+            std::fill_n( input_grad, g.batch * g.rows * g.cols * channels, T{0} );
+
+        // the receptive fields of output rows `phases` apart do not overlap
+        unsigned long const span = ( g.kernel_rows - 1 ) * g.row_dilation + 1;
+        unsigned long const phases = ( span + g.row_stride - 1 ) / g.row_stride;
+        unsigned long const rows_per_phase = ( output_rows + phases - 1 ) / phases;
+        for ( unsigned long phase = 0; phase != phases; ++phase )
+            parallel( [&]( unsigned long task )
+            {
+                unsigned long const b = task / rows_per_phase;
+                unsigned long const oh = ( task % rows_per_phase ) * phases + phase;
+                if ( oh >= output_rows ) return;
+
+                // the patch gradients of an output row, [new_C, r*c*CH] = grad_row * kernel
+                thread_local std::vector<T> patch_grad;
+                patch_grad.resize( output_cols * depth );
+                packed_gemm( grad + ( b * output_rows + oh ) * output_cols * new_channels, new_channels, false, kernel, depth, false,
+                             output_cols, new_channels, depth, patch_grad.data(), depth );
+
+                for ( unsigned long ow = 0; ow != output_cols; ++ow )
+                {
+                    patch_origin const& origin = make_patch_origin( g, ( b * output_rows + oh ) * output_cols + ow );
+                    T const* src = patch_grad.data() + ow * depth;
+                    if ( origin.inside )
+                        for ( unsigned long d = 0; d != depth; ++d )
+                            input_grad[origin.offset + taps[d].offset] += src[d];
+                    else
+                        for ( unsigned long d = 0; d != depth; ++d )
+                            if ( long const index = patch_index( g, origin, taps[d] ); index >= 0 )
+                                input_grad[index] += src[d];
+                }
+            }, 0UL, g.batch * rows_per_phase, 1UL );
+    }
+
+    ///
+    /// @brief Kernel gradient of the implicit-GEMM convolution.
+    /// @param input NHWC input of [BS, R, C, CH].
+    /// @param grad NHWC gradient of the output, [BS, new_R, new_C, NC].
+    /// @param kernel_grad Gradient of the kernels, [NC, CH, r, c] as `kernel`. Overwritten, or accumulated onto if `accumulate` is true.
+    ///
+    template< typename T > requires std::floating_point<T>
+    void implicit_gemm_conv2d_kernel_gradient( T const* input, T const* grad, conv2d_geometry const& g, T* kernel_grad, bool accumulate, implicit_gemm_conv2d_workspace<T>& workspace )
+    {
+        using namespace packed_gemm_private;
+        using namespace implicit_gemm_private;
+        constexpr unsigned long mr = kernel_traits<T>::mr;
+        constexpr unsigned long nr = kernel_traits<T>::nr;
+        constexpr unsigned long kc = kernel_traits<T>::kc;
+
+        unsigned long const pixels = g.pixels();
+        unsigned long const depth = g.depth();
+        unsigned long const new_channels = g.new_channels;
+
+        make_patch_taps( g, workspace.taps );
+        patch_tap const* taps = workspace.taps.data();
+
+        // kernel_grad[NC, depth] = grad' * patches, partitioned in blocks of the output, each summing over all the pixels in the same order
+        unsigned long const row_block = 16 * mr;
+        unsigned long const col_block = 16 * nr;
+        unsigned long const row_blocks = ( new_channels + row_block - 1 ) / row_block;
+        unsigned long const col_blocks = ( depth + col_block - 1 ) / col_block;
+        parallel( [&]( unsigned long task )
+        {
+            unsigned long const ic = ( task / col_blocks ) * row_block;
+            unsigned long const jc = ( task % col_blocks ) * col_block;
+            unsigned long const rows = std::min( row_block, new_channels - ic );
+            unsigned long const cols = std::min( col_block, depth - jc );
+            T* a_buffer = packing_buffer<T>( 0, row_block * kc ).data();
+            T* b_buffer = packing_buffer<T>( 1, col_block * kc ).data();
+            patch_origin origins[kc];
+            for ( unsigned long pc = 0; pc < pixels; pc += kc )
+            {
+                unsigned long const block_depth = std::min( kc, pixels - pc );
+                T const block_beta = ( pc == 0 && !accumulate ) ? T{0} : T{1};
+                for ( unsigned long l = 0; l != block_depth; ++l )
+                    origins[l] = make_patch_origin( g, pc + l );
+                pack_a( grad + pc * new_channels + ic, new_channels, true, rows, block_depth, a_buffer );
+                pack_patches_b( input, g, origins, taps + jc, block_depth, cols, b_buffer );
+                for ( unsigned long jr = 0; jr < cols; jr += nr )
+                    for ( unsigned long ir = 0; ir < rows; ir += mr )
+                        micro_kernel( block_depth, a_buffer + ir * block_depth, b_buffer + jr * block_depth, kernel_grad + ( ic + ir ) * depth + jc + jr,
+                                      depth, std::min( mr, rows - ir ), std::min( nr, cols - jr ), T{1}, block_beta );
+            }
+        }, 0UL, row_blocks * col_blocks, 1UL );
+    }
+
+}//namespace ceras::backend
+
+#endif//IMPLICITGEMMCONVHPPRNTYJLWOBQZXKMVUEADCFIHSPGRNTYJLWOBQZXKMVUEADCFIHSPGRNTY
@@ -0,0 +1,208 @@
+#ifndef QINTGEMMZKXWVRTYHNDLAOBUECMFSJPGIQZKXWVRTYHNDLAOBUECMFSJPGIQZKXWVRTYHNDLAO
+#define QINTGEMMZKXWVRTYHNDLAOBUECMFSJPGIQZKXWVRTYHNDLAOBUECMFSJPGIQZKXWVRTYHNDLAO
+
+#include "../includes.hpp"
+#include "../config.hpp"
+#include "../utils/parallel.hpp"
+
+#if defined(__AVX512VNNI__) && defined(__AVX512BW__)
+#include <immintrin.h>
+#endif
+
+//
+// An int8 x int8 -> int32 GEMM for quantized inference.
+//
+// The activations are stored as unsigned bytes biased by 128, row-major with the depth padded to a multiple of 4.
+// The weights are packed once into NR-wide panels, with 4 consecutive depth values of a column stored together,
+// which is the operand layout of the AVX-512 VNNI instruction `vpdpbusd` (u8 x s8, 4 products summed into one int32 lane).
+// The bias of the activations is removed with a per-column correction `128 * sum(weights of the column)`.
+//
+// Without VNNI, a portable micro-kernel computes the same integers on the same layout.
+//
+
+namespace ceras::backend
+{
+
+    namespace int8_gemm_private
+    {
+        inline constexpr unsigned long mr = 8;  // rows of the register tile
+        inline constexpr unsigned long nr = 32; // columns of the register tile, two zmm registers of int32
+        inline constexpr unsigned long mc = 64; // rows of a task, multiple of mr
+
+        inline constexpr unsigned long padded_depth( unsigned long depth ) noexcept
+        {
+            return ( depth + 3 ) / 4 * 4;
+        }
+
+        // acc[r*nr+c] = sum_p a[r][p] * panel[p][c], for the mr rows of `a`
+        inline void micro_kernel( unsigned long depth, std::uint8_t const* a, unsigned long lda, std::int8_t const* panel, std::int32_t* acc ) noexcept
+        {
+            unsigned long const groups = depth / 4;
+        #if defined(__AVX512VNNI__) && defined(__AVX512BW__)
+            __m512i c[mr][2];
+            for ( unsigned long r = 0; r != mr; ++r )
+                c[r][0] = c[r][1] = _mm512_setzero_si512();
+            for ( unsigned long q = 0; q != groups; ++q )
+            {
+                __m512i const b0 = _mm512_loadu_si512( panel + q * nr * 4 );
+                __m512i const b1 = _mm512_loadu_si512( panel + q * nr * 4 + 64 );
+                for ( unsigned long r = 0; r != mr; ++r )
+                {
+                    std::int32_t v;
+                    std::memcpy( &v, a + r * lda + q * 4, 4 );
+                    __m512i const va = _mm512_set1_epi32( v );
+                    c[r][0] = _mm512_dpbusd_epi32( c[r][0], va, b0 );
+                    c[r][1] = _mm512_dpbusd_epi32( c[r][1], va, b1 );
+                }
+            }
+            for ( unsigned long r = 0; r != mr; ++r )
+            {
+                _mm512_storeu_si512( acc + r * nr, c[r][0] );
+                _mm512_storeu_si512( acc + r * nr + 16, c[r][1] );
+            }
+        #else
+            std::fill_n( acc, mr * nr, std::int32_t{0} );
+            for ( unsigned long q = 0; q != groups; ++q )
+                for ( unsigned long r = 0; r != mr; ++r )
+                {
+                    std::uint8_t const* pa = a + r * lda + q * 4;
+                    std::int8_t const* pb = panel + q * nr * 4;
+                    std::int32_t* pc = acc + r * nr;
+                    for ( unsigned long col = 0; col != nr; ++col )
+                        pc[col] += std::int32_t{pa[0]} * std::int32_t{pb[col*4]} + std::int32_t{pa[1]} * std::int32_t{pb[col*4+1]} +
+                                   std::int32_t{pa[2]} * std::int32_t{pb[col*4+2]} + std::int32_t{pa[3]} * std::int32_t{pb[col*4+3]};
+                }
+        #endif
+        }
+    }//namespace int8_gemm_private
+
+    ///
+    /// @brief Int8 weights packed for `int8_gemm`.
+    ///
+    struct packed_int8_matrix
+    {
+        std::vector<std::int8_t> panels;        ///< NR-wide panels of [padded_depth x NR] bytes, zero padded
+        std::vector<std::int32_t> corrections;  ///< 128 times the sum of each column, removing the bias of the activations
+        unsigned long depth = 0;                ///< the shared dimension
+        unsigned long columns = 0;              ///< the output dimension
+
+        bool empty() const noexcept { return columns == 0; }
+        unsigned long bytes() const noexcept { return panels.size(); }
+    };
+
+    ///
+    /// @brief Packs a [depth x columns] int8 matrix, element (p, c) being `src[p*depth_stride+c*column_stride]`.
+    ///
+    inline packed_int8_matrix pack_int8_matrix( std::int8_t const* src, unsigned long depth, unsigned long columns, unsigned long depth_stride, unsigned long column_stride )
+    {
+        using namespace int8_gemm_private;
+        packed_int8_matrix ans;
+        ans.depth = depth;
+        ans.columns = columns;
+        unsigned long const d = padded_depth( depth );
+        unsigned long const panels = ( columns + nr - 1 ) / nr;
+        ans.panels.assign( panels * d * nr, std::int8_t{0} );
+        ans.corrections.assign( panels * nr, std::int32_t{0} );
+        for ( unsigned long c = 0; c != columns; ++c )
+        {
+            std::int8_t* panel = ans.panels.data() + ( c / nr ) * d * nr;
+            std::int32_t sum = 0;
+            for ( unsigned long p = 0; p != depth; ++p )
+            {
+                std::int8_t const v = src[p*depth_stride+c*column_stride];
+                panel[( p / 4 ) * nr * 4 + ( c % nr ) * 4 + p % 4] = v;
+                sum += v;
+            }
+            ans.corrections[c] = 128 * sum;
+        }
+        return ans;
+    }
+
+    ///
+    /// @brief Quantizes a [rows x depth] matrix to biased unsigned bytes, `round(x/scale)` clamped to [-127, 127] plus 128.
+    ///
+    /// Element (r, p) is `src[r*row_stride+p*depth_stride]`; the output is row-major with `padded_depth(depth)` bytes per row,
+    /// and the rows are padded to a multiple of the register tile.
+    ///
+    template< typename T >
+    void quantize_int8_activations( T const* src, unsigned long rows, unsigned long depth, unsigned long row_stride, unsigned long depth_stride,
+                                    T scale, std::vector<std::uint8_t>& dst )
+    {
+        using namespace int8_gemm_private;
+        unsigned long const d = padded_depth( depth );
+        dst.resize( ( rows + mr - 1 ) / mr * mr * d );
+        std::fill( dst.begin() + rows * d, dst.end(), std::uint8_t{128} );
+        T const inverse_scale = T{1} / scale;
+        auto const& quantize = [inverse_scale]( T x ) noexcept
+        {
+            T const v = std::min( std::max( std::nearbyint( x * inverse_scale ), T{-127} ), T{127} );
+            return static_cast<std::uint8_t>( static_cast<int>( v ) + 128 );
+        };
+
+        unsigned long const block = 64; // blocks of rows, keeping the strided reads in cache for transposed sources
+        parallel( [&]( unsigned long task )
+        {
+            unsigned long const row_begin = task * block;
+            unsigned long const row_end = std::min( rows, row_begin + block );
+            if ( depth_stride == 1 )
+            {
+                for ( unsigned long r = row_begin; r != row_end; ++r )
+                    for ( unsigned long p = 0; p != depth; ++p )
+                        dst[r*d+p] = quantize( src[r*row_stride+p] );
+            }
+            else
+            {
+                for ( unsigned long p = 0; p != depth; ++p )
+                    for ( unsigned long r = row_begin; r != row_end; ++r )
+                        dst[r*d+p] = quantize( src[r*row_stride+p*depth_stride] );
+            }
+            for ( unsigned long r = row_begin; r != row_end; ++r )
+                std::fill( dst.begin() + r*d + depth, dst.begin() + (r+1)*d, std::uint8_t{128} );
+        }, 0UL, ( rows + block - 1 ) / block, 1UL );
+    }
+
+    ///
+    /// @brief Int8 GEMM, `acc[r][c] = sum_p A[r][p] * B[p][c]` in int32, handing every row of every output tile to the epilogue.
+    ///
+    /// @param A Activations from `quantize_int8_activations`, [rows x padded_depth] biased bytes, rows padded to the register tile.
+    /// @param rows The rows of A.
+    /// @param B Weights from `pack_int8_matrix`.
+    /// @param epilogue Called as `epilogue( acc, row, col, cols )`, `acc` pointing to the `cols` int32 results from `(row, col)`.
+    ///                 Different tiles are passed from different threads, the epilogue writes the results where it wants.
+    ///
+    template< typename Epilogue >
+    void int8_gemm( std::uint8_t const* A, unsigned long rows, packed_int8_matrix const& B, Epilogue const& epilogue )
+    {
+        using namespace int8_gemm_private;
+        unsigned long const d = padded_depth( B.depth );
+        unsigned long const row_tasks = ( rows + mc - 1 ) / mc;
+        unsigned long const col_tasks = ( B.columns + nr - 1 ) / nr;
+
+        parallel( [&]( unsigned long task )
+        {
+            unsigned long const row_begin = ( task / col_tasks ) * mc;
+            unsigned long const row_end = std::min( rows, row_begin + mc );
+            unsigned long const col = ( task % col_tasks ) * nr;
+            unsigned long const cols = std::min( nr, B.columns - col );
+            std::int8_t const* panel = B.panels.data() + ( col / nr ) * d * nr;
+            std::int32_t const* corrections = B.corrections.data() + col;
+
+            alignas(64) std::int32_t acc[mr*nr];
+            for ( unsigned long row = row_begin; row < row_end; row += mr )
+            {
+                unsigned long const tile_rows = std::min( mr, row_end - row );
+                micro_kernel( d, A + row * d, d, panel, acc );
+                for ( unsigned long r = 0; r != tile_rows; ++r )
+                {
+                    std::int32_t* ptr = acc + r * nr;
+                    for ( unsigned long c = 0; c != cols; ++c )
+                        ptr[c] -= corrections[c];
+                    epilogue( static_cast<std::int32_t const*>( ptr ), row + r, col, cols );
+                }
+            }
+        }, 0UL, row_tasks * col_tasks, ( rows * B.columns * d < (1UL << 18) ) ? row_tasks * col_tasks : 1UL ); // small products in the calling thread
+    }
+
+}//namespace ceras::backend
+
+#endif//QINTGEMMZKXWVRTYHNDLAOBUECMFSJPGIQZKXWVRTYHNDLAOBUECMFSJPGIQZKXWVRTYHNDLAO
@@ -0,0 +1,310 @@
+#ifndef NCHWCCONVHPPTWQZKXRMVNJYLOBUEADCFIHSPGTWQZKXRMVNJYLOBUEADCFIHSPGTWQZKXRMVN
+#define NCHWCCONVHPPTWQZKXRMVNJYLOBUEADCFIHSPGTWQZKXRMVNJYLOBUEADCFIHSPGTWQZKXRMVN
+
+#include "../includes.hpp"
+#include "../config.hpp"
+#include "../utils/parallel.hpp"
+#include "../utils/better_assert.hpp"
+#include "./conv2d_geometry.hpp"
+
+//
+// The channel-blocked NCHWc layout, and the convolution of NCHWc tensors.
+//
+// A [BS, R, C, CH] tensor in NHWC is held in NCHWc as [BS, CB, R, C, b]: the channels are split into CB = ceil(CH/b) blocks of b channels, and
+// the channel ch of the pixel (r, c) is the element (ch/b, r, c, ch%b). The channels past CH in the last block are the tail: the converters
+// write zeros there, and the operators on NCHWc tensors never read them into real channels.
+//
+// The convolution keeps the kernels packed to [NCB, CB, r, c, b, b], so that the innermost loop is a b-wide multiply-add of an input
+// channel with a block of output channels. With b the SIMD width, the blocks of the input, of the output and of the kernels are contiguous
+// vectors, and the channel loops vectorize without any transpose.
+//
+// The tasks are the output rows in the forward pass, the input planes of a block in the backward pass for the input, and the pairs of
+// kernel blocks for the kernels, so that no two tasks write the same element and the results do not depend on the number of threads.
+//
+
+namespace ceras::backend
+{
+
+    ///
+    /// @brief The block sizes of the NCHWc layout, the SIMD widths of the float kernels.
+    ///
+    inline bool is_nchwc_block( unsigned long block ) noexcept
+    {
+        return block == 4 || block == 8 || block == 16;
+    }
+
+    ///
+    /// @brief Copies a [BS, R, C, CH] NHWC tensor to the [BS, CB, R, C, block] NCHWc layout, the tail being zeros.
+    ///
+    template< typename T >
+    void nhwc_to_nchwc( T const* input, unsigned long batch, unsigned long rows, unsigned long cols, unsigned long channels, unsigned long block, T* output )
+    {
+        unsigned long const blocks = ( channels + block - 1 ) / block;
+        unsigned long const pixels = rows * cols;
+        parallel( [&]( unsigned long task )
+        {
+            unsigned long const b = task / blocks;
+            unsigned long const cb = task % blocks;
+            unsigned long const first = cb * block;
+            unsigned long const width = std::min( block, channels - first );
+            T const* src = input + b * pixels * channels + first;
+            T* dst = output + task * pixels * block;
+            for ( unsigned long p = 0; p != pixels; ++p, src += channels, dst += block )
+            {
+                std::copy_n( src, width, dst );
+                std::fill( dst + width, dst + block, T{0} );
+            }
+        }, 0UL, batch * blocks );
+    }
+
+    ///
+    /// @brief Copies a [BS, CB, R, C, block] NCHWc tensor back to the [BS, R, C, CH] NHWC layout, the tail being dropped.
+    ///
+    template< typename T >
+    void nchwc_to_nhwc( T const* input, unsigned long batch, unsigned long rows, unsigned long cols, unsigned long channels, unsigned long block, T* output )
+    {
+        unsigned long const blocks = ( channels + block - 1 ) / block;
+        unsigned long const pixels = rows * cols;
+        parallel( [&]( unsigned long task )
+        {
+            unsigned long const b = task / pixels;
+            unsigned long const p = task % pixels;
+            T* dst = output + task * channels;
+            for ( unsigned long cb = 0; cb != blocks; ++cb )
+            {
+                unsigned long const first = cb * block;
+                std::copy_n( input + ( ( b * blocks + cb ) * pixels + p ) * block, std::min( block, channels - first ), dst + first );
+            }
+        }, 0UL, batch * pixels );
+    }
+
+    template< typename T >
+    struct nchwc_conv2d_workspace
+    {
+        std::vector<T> kernel;              ///< the kernels packed to [NCB, CB, r, c, b_in, b_out]
+        std::vector<T> transposed_kernel;   ///< the kernels packed to [NCB, CB, r, c, b_out, b_in], for the gradient of the input
+        std::vector<T> kernel_gradient;     ///< gradient of the packed kernels
+    };
+
+    namespace nchwc_conv2d_private
+    {
+        // the element (ncb, cb, tap, i, o) of the packed kernels is the weight of the input channel cb*b+i for the output channel ncb*b+o, zero in the tails
+        template< typename T >
+        void pack_kernel( T const* kernel, conv2d_geometry const& g, unsigned long block, bool transposed, std::vector<T>& packed )
+        {
+            unsigned long const taps = g.taps();
+            unsigned long const blocks = ( g.channels + block - 1 ) / block;
+            unsigned long const new_blocks = ( g.new_channels + block - 1 ) / block;
+            packed.assign( new_blocks * blocks * taps * block * block, T{0} );
+            for ( unsigned long nc = 0; nc != g.new_channels; ++nc )
+                for ( unsigned long ch = 0; ch != g.channels; ++ch )
+                    for ( unsigned long tap = 0; tap != taps; ++tap )
+                    {
+                        unsigned long const o = nc % block;
+                        unsigned long const i = ch % block;
+                        unsigned long const offset = ( ( nc / block * blocks + ch / block ) * taps + tap ) * block * block;
+                        packed[offset + ( transposed ? o * block + i : i * block + o )] = kernel[(nc*g.channels+ch)*taps+tap];
+                    }
+        }
+
+        // the input rows (or columns) of the tap u of the output row (or column) o, or -1 in the padding
+        inline std::int64_t source( unsigned long o, unsigned long u, unsigned long stride, unsigned long dilation, unsigned long padding, unsigned long inputs ) noexcept
+        {
+            std::int64_t const i = static_cast<std::int64_t>( o * stride + u * dilation ) - static_cast<std::int64_t>( padding );
+            return ( i < 0 || i >= static_cast<std::int64_t>( inputs ) ) ? -1 : i;
+        }
+
+        template< unsigned long B, typename T >
+        void forward( T const* input, T const* packed, conv2d_geometry const& g, T* output )
+        {
+            unsigned long const taps = g.taps();
+            unsigned long const blocks = ( g.channels + B - 1 ) / B;
+            unsigned long const new_blocks = ( g.new_channels + B - 1 ) / B;
+            unsigned long const new_rows = g.output_rows();
+            unsigned long const new_cols = g.output_cols();
+            parallel( [&]( unsigned long task )
+            {
+                unsigned long const oy = task % new_rows;
+                unsigned long const ncb = ( task / new_rows ) % new_blocks;
+                unsigned long const b = task / ( new_rows * new_blocks );
+                for ( unsigned long ox = 0; ox != new_cols; ++ox )
+                {
+                    std::array<T, B> acc;
+                    acc.fill( T{0} );
+                    for ( unsigned long cb = 0; cb != blocks; ++cb )
+                    {
+                        T const* plane = input + ( b * blocks + cb ) * g.rows * g.cols * B;
+                        T const* weights = packed + ( ncb * blocks + cb ) * taps * B * B;
+                        for ( unsigned long u = 0; u != g.kernel_rows; ++u )
+                        {
+                            std::int64_t const iy = source( oy, u, g.row_stride, g.row_dilation, g.row_padding, g.rows );
+                            if ( iy < 0 ) continue;
+                            for ( unsigned long v = 0; v != g.kernel_cols; ++v )
+                            {
+                                std::int64_t const ix = source( ox, v, g.col_stride, g.col_dilation, g.col_padding, g.cols );
+                                if ( ix < 0 ) continue;
+                                T const* __restrict__ in = plane + ( iy * g.cols + ix ) * B;
+                                T const* __restrict__ w = weights + ( u * g.kernel_cols + v ) * B * B;
+                                for ( unsigned long i = 0; i != B; ++i )
+                                    for ( unsigned long o = 0; o != B; ++o )
+                                        acc[o] += in[i] * w[i*B+o];
+                            }
+                        }
+                    }
+                    std::copy( acc.begin(), acc.end(), output + ( task * new_cols + ox ) * B );
+                }
+            }, 0UL, g.batch * new_blocks * new_rows );
+        }
+
+        template< unsigned long B, typename T >
+        void input_gradient( T const* grad, T const* transposed, conv2d_geometry const& g, T* input_grad, bool accumulate )
+        {
+            unsigned long const taps = g.taps();
+            unsigned long const blocks = ( g.channels + B - 1 ) / B;
+            unsigned long const new_blocks = ( g.new_channels + B - 1 ) / B;
+            unsigned long const new_rows = g.output_rows();
+            unsigned long const new_cols = g.output_cols();
+            unsigned long const plane_size = g.rows * g.cols * B;
+            parallel( [&]( unsigned long task )
+            {
+                unsigned long const b = task / blocks;
+                unsigned long const cb = task % blocks;
+                T* plane = input_grad + task * plane_size;
+                if ( !accumulate )
+                    std::fill_n( plane, plane_size, T{0} );
+                for ( unsigned long ncb = 0; ncb != new_blocks; ++ncb )
+                {
+                    T const* weights = transposed + ( ncb * blocks + cb ) * taps * B * B;
+                    T const* grad_plane = grad + ( b * new_blocks + ncb ) * new_rows * new_cols * B;
+                    for ( unsigned long oy = 0; oy != new_rows; ++oy )
+                        for ( unsigned long u = 0; u != g.kernel_rows; ++u )
+                        {
+                            std::int64_t const iy = source( oy, u, g.row_stride, g.row_dilation, g.row_padding, g.rows );
+                            if ( iy < 0 ) continue;
+                            for ( unsigned long ox = 0; ox != new_cols; ++ox )
+                            {
+                                T const* __restrict__ gr = grad_plane + ( oy * new_cols + ox ) * B;
+                                for ( unsigned long v = 0; v != g.kernel_cols; ++v )
+                                {
+                                    std::int64_t const ix = source( ox, v, g.col_stride, g.col_dilation, g.col_padding, g.cols );
+                                    if ( ix < 0 ) continue;
+                                    T* __restrict__ dst = plane + ( iy * g.cols + ix ) * B;
+                                    T const* __restrict__ w = weights + ( u * g.kernel_cols + v ) * B * B;
+                                    for ( unsigned long o = 0; o != B; ++o )
+                                        for ( unsigned long i = 0; i != B; ++i )
+                                            dst[i] += gr[o] * w[o*B+i];
+                                }
+                            }
+                        }
+                }
+            }, 0UL, g.batch * blocks, 1UL );
+        }
+
+        template< unsigned long B, typename T >
+        void kernel_gradient( T const* input, T const* grad, conv2d_geometry const& g, std::vector<T>& packed_gradient )
+        {
+            unsigned long const taps = g.taps();
+            unsigned long const blocks = ( g.channels + B - 1 ) / B;
+            unsigned long const new_blocks = ( g.new_channels + B - 1 ) / B;
+            unsigned long const new_rows = g.output_rows();
+            unsigned long const new_cols = g.output_cols();
+            packed_gradient.resize( new_blocks * blocks * taps * B * B );
+            parallel( [&]( unsigned long task )
+            {
+                unsigned long const ncb = task / blocks;
+                unsigned long const cb = task % blocks;
+                T* weights = packed_gradient.data() + task * taps * B * B;
+                std::fill_n( weights, taps * B * B, T{0} );
+                for ( unsigned long b = 0; b != g.batch; ++b )
+                {
+                    T const* plane = input + ( b * blocks + cb ) * g.rows * g.cols * B;
+                    T const* grad_plane = grad + ( b * new_blocks + ncb ) * new_rows * new_cols * B;
+                    for ( unsigned long oy = 0; oy != new_rows; ++oy )
+                        for ( unsigned long u = 0; u != g.kernel_rows; ++u )
+                        {
+                            std::int64_t const iy = source( oy, u, g.row_stride, g.row_dilation, g.row_padding, g.rows );
+                            if ( iy < 0 ) continue;
+                            for ( unsigned long ox = 0; ox != new_cols; ++ox )
+                            {
+                                T const* __restrict__ gr = grad_plane + ( oy * new_cols + ox ) * B;
+                                for ( unsigned long v = 0; v != g.kernel_cols; ++v )
+                                {
+                                    std::int64_t const ix = source( ox, v, g.col_stride, g.col_dilation, g.col_padding, g.cols );
+                                    if ( ix < 0 ) continue;
+                                    T const* __restrict__ in = plane + ( iy * g.cols + ix ) * B;
+                                    T* __restrict__ w = weights + ( u * g.kernel_cols + v ) * B * B;
+                                    for ( unsigned long i = 0; i != B; ++i )
+                                        for ( unsigned long o = 0; o != B; ++o )
+                                            w[i*B+o] += in[i] * gr[o];
+                                }
+                            }
+                        }
+                }
+            }, 0UL, new_blocks * blocks, 1UL );
+        }
+
+        // calls func with the block size as a compile-time constant
+        template< typename Function >
+        void dispatch_block( unsigned long block, Function const& func )
+        {
+            better_assert( is_nchwc_block( block ), "nchwc: expecting blocks of 4, 8 or 16 channels, but got ", block );
+            if ( block == 4 )
+                func( std::integral_constant<unsigned long, 4>{} );
+            else if ( block == 8 )
+                func( std::integral_constant<unsigned long, 8>{} );
+            else
+                func( std::integral_constant<unsigned long, 16>{} );
+        }
+    }//namespace nchwc_conv2d_private
+
+    ///
+    /// @brief Convolution of a NCHWc input with NC kernels of [r, c, CH].
+    /// @param input The [BS, CB, R, C, block] input, g being the geometry of the same convolution in NHWC.
+    /// @param kernel The kernels of [NC, CH, r, c], the element (nc, ch, kh, kw) at `kernel[(nc*CH+ch)*r*c+kh*c+kw]`, see `conv2d_geometry`.
+    /// @param output The [BS, NCB, new_R, new_C, block] output, overwritten, the tail being zeros.
+    ///
+    template< typename T >
+    void nchwc_conv2d( T const* input, T const* kernel, conv2d_geometry const& g, unsigned long block, T* output, nchwc_conv2d_workspace<T>& workspace )
+    {
+        using namespace nchwc_conv2d_private;
+        pack_kernel( kernel, g, block, false, workspace.kernel );
+        dispatch_block( block, [&]( auto B ){ forward<decltype(B)::value>( input, workspace.kernel.data(), g, output ); } );
+    }
+
+    ///
+    /// @brief Gradient of the NCHWc input of `nchwc_conv2d`, the tail being zeros.
+    /// @param accumulate If true, the gradient is added to `input_grad`, otherwise `input_grad` is overwritten.
+    ///
+    template< typename T >
+    void nchwc_conv2d_input_gradient( T const* grad, T const* kernel, conv2d_geometry const& g, unsigned long block, T* input_grad, bool accumulate, nchwc_conv2d_workspace<T>& workspace )
+    {
+        using namespace nchwc_conv2d_private;
+        pack_kernel( kernel, g, block, true, workspace.transposed_kernel );
+        dispatch_block( block, [&]( auto B ){ input_gradient<decltype(B)::value>( grad, workspace.transposed_kernel.data(), g, input_grad, accumulate ); } );
+    }
+
+    ///
+    /// @brief Gradient of the [NC, CH, r, c] kernels of `nchwc_conv2d`.
+    /// @param accumulate If true, the gradient is added to `kernel_grad`, otherwise `kernel_grad` is overwritten.
+    ///
+    template< typename T >
+    void nchwc_conv2d_kernel_gradient( T const* input, T const* grad, conv2d_geometry const& g, unsigned long block, T* kernel_grad, bool accumulate, nchwc_conv2d_workspace<T>& workspace )
+    {
+        using namespace nchwc_conv2d_private;
+        dispatch_block( block, [&]( auto B ){ kernel_gradient<decltype(B)::value>( input, grad, g, workspace.kernel_gradient ); } );
+
+        unsigned long const taps = g.taps();
+        unsigned long const blocks = ( g.channels + block - 1 ) / block;
+        for ( unsigned long nc = 0; nc != g.new_channels; ++nc )
+            for ( unsigned long ch = 0; ch != g.channels; ++ch )
+                for ( unsigned long tap = 0; tap != taps; ++tap )
+                {
+                    T const value = workspace.kernel_gradient[( ( nc / block * blocks + ch / block ) * taps + tap ) * block * block + ( ch % block ) * block + nc % block];
+                    T& dst = kernel_grad[(nc*g.channels+ch)*taps+tap];
+                    dst = accumulate ? T{dst + value} : value;
+                }
+    }
+
+}//namespace ceras::backend
+
+#endif//NCHWCCONVHPPTWQZKXRMVNJYLOBUEADCFIHSPGTWQZKXRMVNJYLOBUEADCFIHSPGTWQZKXRMVN
@@ -0,0 +1,490 @@
+#ifndef PKGEMMXQJZRVNWTKYHAUDLBOEMCFSIPGQXTRVLZNKWYHJAUEODMBFCSIPGXTQRLVNZWKYHJAUE
+#define PKGEMMXQJZRVNWTKYHAUDLBOEMCFSIPGQXTRVLZNKWYHJAUEODMBFCSIPGXTQRLVNZWKYHJAUE
+
+#include "../includes.hpp"
+#include "../config.hpp"
+#include "../utils/parallel.hpp"
+
+//
+// A cache-blocked, register-tiled GEMM for the CPU, in the spirit of GotoBLAS/BLIS:
+//
+//  - the k dimension is split into blocks of `kc`, the n dimension into blocks of `nc`, and a `kc x nc` block of B is packed into NR-wide panels (L3/L2 resident)
+//  - the m dimension is split into blocks of `mc`, and a `mc x kc` block of A is packed into MR-tall panels (L2 resident)
+//  - a MR x NR micro-kernel keeps the whole C tile in vector registers, streaming one packed column of A and one packed row of B per step (L1 resident)
+//
+// Transposition is resolved while packing, so the micro-kernel always reads contiguous memory.
+//
+
+namespace ceras::backend
+{
+
+    namespace packed_gemm_private
+    {
+
+    #if defined(__AVX512F__)
+        inline constexpr unsigned long simd_bytes = 64;
+    #elif defined(__AVX__)
+        inline constexpr unsigned long simd_bytes = 32;
+    #else
+        inline constexpr unsigned long simd_bytes = 16;
+    #endif
+
+        ///
+        /// Register tile and default cache blocking for the micro-kernel of type T.
+        ///
+        /// With AVX2, the float tile is 6x16 and the double tile 6x8, i.e. 12 accumulators out of 16 ymm registers.
+        /// With AVX-512, the tiles double in width and use 12 out of 32 zmm registers.
+        ///
+        template< typename T >
+        struct kernel_traits
+        {
+            static constexpr unsigned long lanes = simd_bytes / sizeof(T);  // elements per vector register
+            static constexpr unsigned long mr = 6;                          // rows of the register tile
+            static constexpr unsigned long nr = 2 * lanes;                  // columns of the register tile
+            static constexpr unsigned long mc = 96;                         // rows of a packed A block, multiple of mr
+            static constexpr unsigned long kc = 256;                        // depth of the packed blocks
+            static constexpr unsigned long nc = (sizeof(T) == 4) ? 4096 : 2048; // columns of a packed B block, multiple of nr
+        };
+
+    #if defined(__GNUC__) || defined(__clang__)
+        template< typename T >
+        struct simd
+        {
+            static constexpr unsigned long lanes = kernel_traits<T>::lanes;
+            typedef T type __attribute__((vector_size(simd_bytes)));
+
+            static type load( T const* ptr ) noexcept
+            {
+                type ans;
+                std::memcpy( &ans, ptr, sizeof(type) );
+                return ans;
+            }
+
+            static void store( T* ptr, type const& v ) noexcept
+            {
+                std::memcpy( ptr, &v, sizeof(type) );
+            }
+
+            static type broadcast( T x ) noexcept
+            {
+                return type{} + x;
+            }
+        };
+    #else
+        // plain arrays for compilers without vector extensions, relying on the auto-vectorizer
+        template< typename T >
+        struct simd
+        {
+            static constexpr unsigned long lanes = kernel_traits<T>::lanes;
+            struct type
+            {
+                T data_[lanes];
+                type& operator += ( type const& other ) noexcept
+                {
+                    for ( unsigned long idx = 0; idx != lanes; ++idx ) data_[idx] += other.data_[idx];
+                    return *this;
+                }
+                type operator + ( type const& other ) const noexcept
+                {
+                    type ans = *this;
+                    ans += other;
+                    return ans;
+                }
+                type operator * ( type const& other ) const noexcept
+                {
+                    type ans;
+                    for ( unsigned long idx = 0; idx != lanes; ++idx ) ans.data_[idx] = data_[idx] * other.data_[idx];
+                    return ans;
+                }
+            };
+
+            static type load( T const* ptr ) noexcept
+            {
+                type ans;
+                std::copy_n( ptr, lanes, ans.data_ );
+                return ans;
+            }
+
+            static void store( T* ptr, type const& v ) noexcept
+            {
+                std::copy_n( v.data_, lanes, ptr );
+            }
+
+            static type broadcast( T x ) noexcept
+            {
+                type ans;
+                std::fill_n( ans.data_, lanes, x );
+                return ans;
+            }
+        };
+    #endif
+
+        // packs rows [0, rows) and depth [0, depth) of op(A) into mr-tall panels, zero-padding the last panel
+        // op(A)[r][l] is A[r*lda+l], or A[l*lda+r] if transposed, converted from the storage type S to the compute type T
+        template< typename T, typename S >
+        void pack_a( S const* A, unsigned long lda, bool a_transposed, unsigned long rows, unsigned long depth, T* buffer ) noexcept
+        {
+            constexpr unsigned long mr = kernel_traits<T>::mr;
+            for ( unsigned long r = 0; r < rows; r += mr )
+            {
+                unsigned long const rs = std::min( mr, rows - r );
+                if ( a_transposed )
+                {
+                    for ( unsigned long l = 0; l != depth; ++l )
+                    {
+                        S const* src = A + l * lda + r;
+                        unsigned long idx = 0;
+                        for ( ; idx != rs; ++idx ) buffer[idx] = static_cast<T>( src[idx] );
+                        for ( ; idx != mr; ++idx ) buffer[idx] = T{0};
+                        buffer += mr;
+                    }
+                }
+                else
+                {
+                    for ( unsigned long l = 0; l != depth; ++l )
+                    {
+                        S const* src = A + r * lda + l;
+                        unsigned long idx = 0;
+                        for ( ; idx != rs; ++idx ) buffer[idx] = static_cast<T>( src[idx*lda] );
+                        for ( ; idx != mr; ++idx ) buffer[idx] = T{0};
+                        buffer += mr;
+                    }
+                }
+            }
+        }
+
+        // packs depth [0, depth) and columns [0, cols) of op(B) into nr-wide panels, zero-padding the last panel
+        // op(B)[l][c] is B[l*ldb+c], or B[c*ldb+l] if transposed, converted from the storage type S to the compute type T
+        template< typename T, typename S >
+        void pack_b( S const* B, unsigned long ldb, bool b_transposed, unsigned long depth, unsigned long cols, T* buffer ) noexcept
+        {
+            constexpr unsigned long nr = kernel_traits<T>::nr;
+            for ( unsigned long c = 0; c < cols; c += nr )
+            {
+                unsigned long const cs = std::min( nr, cols - c );
+                if ( b_transposed )
+                {
+                    for ( unsigned long l = 0; l != depth; ++l )
+                    {
+                        S const* src = B + c * ldb + l;
+                        unsigned long idx = 0;
+                        for ( ; idx != cs; ++idx ) buffer[idx] = static_cast<T>( src[idx*ldb] );
+                        for ( ; idx != nr; ++idx ) buffer[idx] = T{0};
+                        buffer += nr;
+                    }
+                }
+                else
+                {
+                    for ( unsigned long l = 0; l != depth; ++l )
+                    {
+                        S const* src = B + l * ldb + c;
+                        unsigned long idx = 0;
+                        for ( ; idx != cs; ++idx ) buffer[idx] = static_cast<T>( src[idx] );
+                        for ( ; idx != nr; ++idx ) buffer[idx] = T{0};
+                        buffer += nr;
+                    }
+                }
+            }
+        }
+
+        // C[0:rows, 0:cols] <= alpha * a_panel * b_panel + beta * C[0:rows, 0:cols], where the panels are packed by `pack_a` and `pack_b`
+        // C is not read if `beta` is 0, so that it may hold garbage
+        template< typename T >
+        void micro_kernel( unsigned long depth, T const* a_panel, T const* b_panel, T* C, unsigned long ldc, unsigned long rows, unsigned long cols, T alpha, T beta ) noexcept
+        {
+            constexpr unsigned long mr = kernel_traits<T>::mr;
+            constexpr unsigned long nr = kernel_traits<T>::nr;
+            constexpr unsigned long lanes = simd<T>::lanes;
+            constexpr unsigned long vr = nr / lanes;
+            typedef typename simd<T>::type vector_type;
+
+            vector_type acc[mr][vr];
+            for ( unsigned long r = 0; r != mr; ++r )
+                for ( unsigned long v = 0; v != vr; ++v )
+                    acc[r][v] = simd<T>::broadcast( T{0} );
+
+            for ( unsigned long l = 0; l != depth; ++l )
+            {
+                vector_type b[vr];
+                for ( unsigned long v = 0; v != vr; ++v )
+                    b[v] = simd<T>::load( b_panel + v * lanes );
+
+                for ( unsigned long r = 0; r != mr; ++r )
+                {
+                    vector_type const a = simd<T>::broadcast( a_panel[r] );
+                    for ( unsigned long v = 0; v != vr; ++v )
+                        acc[r][v] += a * b[v];
+                }
+
+                a_panel += mr;
+                b_panel += nr;
+            }
+
+            if ( alpha != T{1} )
+            {
+                vector_type const va = simd<T>::broadcast( alpha );
+                for ( unsigned long r = 0; r != mr; ++r )
+                    for ( unsigned long v = 0; v != vr; ++v )
+                        acc[r][v] = va * acc[r][v];
+            }
+
+            if ( rows == mr && cols == nr ) // full tile, write back directly
+            {
+                for ( unsigned long r = 0; r != mr; ++r )
+                    for ( unsigned long v = 0; v != vr; ++v )
+                    {
+                        T* dst = C + r * ldc + v * lanes;
+                        if ( beta == T{0} )
+                            simd<T>::store( dst, acc[r][v] );
+                        else if ( beta == T{1} )
+                            simd<T>::store( dst, simd<T>::load( dst ) + acc[r][v] );
+                        else
+                            simd<T>::store( dst, simd<T>::broadcast( beta ) * simd<T>::load( dst ) + acc[r][v] );
+                    }
+                return;
+            }
+
+            // edge tile, spill the registers and copy the valid part only
+            T tile[mr*nr];
+            for ( unsigned long r = 0; r != mr; ++r )
+                for ( unsigned long v = 0; v != vr; ++v )
+                    simd<T>::store( tile + r * nr + v * lanes, acc[r][v] );
+
+            for ( unsigned long r = 0; r != rows; ++r )
+                for ( unsigned long c = 0; c != cols; ++c )
+                {
+                    if ( beta == T{0} )
+                        C[r*ldc+c] = tile[r*nr+c];
+                    else if ( beta == T{1} )
+                        C[r*ldc+c] += tile[r*nr+c];
+                    else
+                        C[r*ldc+c] = beta * C[r*ldc+c] + tile[r*nr+c];
+                }
+        }
+
+        // packing buffers are reused across calls to avoid an allocation per product
+        template< typename T >
+        std::vector<T>& packing_buffer( unsigned long which, unsigned long size )
+        {
+            thread_local std::vector<T> buffers[2];
+            std::vector<T>& ans = buffers[which];
+            if ( ans.size() < size )
+                ans.resize( size );
+            return ans;
+        }
+
+    }//namespace packed_gemm_private
+
+    ///
+    /// @brief Cache blocking of the packed GEMM, in elements. `mc` should be a multiple of `kernel_traits<T>::mr`, and `nc` of `kernel_traits<T>::nr`.
+    ///
+    struct gemm_blocking
+    {
+        unsigned long mc;
+        unsigned long kc;
+        unsigned long nc;
+    };
+
+    template< typename T >
+    constexpr gemm_blocking default_gemm_blocking() noexcept
+    {
+        typedef packed_gemm_private::kernel_traits<T> traits;
+        return gemm_blocking{ traits::mc, traits::kc, traits::nc };
+    }
+
+    ///
+    /// @brief The default epilogue of `packed_gemm`, doing nothing.
+    ///
+    struct gemm_no_epilogue
+    {
+        template< typename T >
+        void operator()( T*, unsigned long, unsigned long, unsigned long ) const noexcept {}
+    };
+
+    ///
+    /// @brief C <= alpha * op(A) * op(B) + beta * C, in which op(A) is [m x n], op(B) is [n x k] and C is [m x k].
+    ///
+    /// @param A Row-major matrix with leading dimension `lda`. op(A) is A if `a_transposed` is false, else A'.
+    /// @param B Row-major matrix with leading dimension `ldb`. op(B) is B if `b_transposed` is false, else B'.
+    /// @param C Row-major matrix with leading dimension `ldc`. Previous values are overwritten if `beta` is 0, and are not read in this case.
+    ///          A and B may be stored in a narrower type S, such as `bfloat16`, and are widened to the type T of C while packed.
+    /// @param blocking Cache blocking parameters.
+    /// @param epilogue Invoked as `epilogue( ptr, row, col, cols )` on every finished segment `C[row][col:col+cols]` while it is still in cache, `ptr` pointing to `C[row][col]`.
+    /// @param alpha Scaling factor of the product. Defaults to 1.
+    /// @param beta Scaling factor of the previous C. Defaults to 0. With 1, the product is accumulated into C without any temporary.
+    ///
+    /// Example code:
+    /// \code{.cpp}
+    /// std::vector<float> a( 3*4 ), b( 4*5 ), c( 3*5 );
+    /// ceras::backend::packed_gemm( a.data(), 4, false, b.data(), 5, false, 3, 4, 5, c.data(), 5 );
+    /// \endcode
+    ///
+    template< typename T, typename Epilogue = gemm_no_epilogue, typename S = T > requires std::floating_point<T>
+    void packed_gemm( S const* A, unsigned long lda, bool a_transposed, S const* B, unsigned long ldb, bool b_transposed,
+                      unsigned long m, unsigned long n, unsigned long k, T* C, unsigned long ldc, gemm_blocking const& blocking = default_gemm_blocking<T>(),
+                      Epilogue const& epilogue = Epilogue{}, T alpha = T{1}, T beta = T{0} )
+    {
+        using namespace packed_gemm_private;
+        constexpr unsigned long mr = kernel_traits<T>::mr;
+        constexpr unsigned long nr = kernel_traits<T>::nr;
+
+        if ( m == 0 || k == 0 ) return;
+        if ( n == 0 )
+        {
+            for ( unsigned long r = 0; r != m; ++r )
+            {
+                T* row = C + r * ldc;
+                if ( beta == T{0} )
+                    std::fill_n( row, k, T{0} );
+                else
+                    std::for_each( row, row + k, [beta]( T& x ){ x *= beta; } );
+                epilogue( row, r, 0UL, k );
+            }
+            return;
+        }
+
+        unsigned long const mc = std::max( mr, blocking.mc / mr * mr );
+        unsigned long const kc = std::max( 1UL, blocking.kc );
+        unsigned long const nc = std::max( nr, blocking.nc / nr * nr );
+
+        T* a_buffer = packing_buffer<T>( 0, mc * kc ).data();
+        T* b_buffer = packing_buffer<T>( 1, std::min( nc, (k+nr-1)/nr*nr ) * kc ).data();
+
+        for ( unsigned long jc = 0; jc < k; jc += nc )
+        {
+            unsigned long const cols = std::min( nc, k - jc );
+            for ( unsigned long pc = 0; pc < n; pc += kc )
+            {
+                unsigned long const depth = std::min( kc, n - pc );
+                T const block_beta = ( pc == 0 ) ? beta : T{1}; // later blocks accumulate onto the first one
+                bool const last_block = pc + depth == n;
+                S const* b_block = b_transposed ? B + jc * ldb + pc : B + pc * ldb + jc;
+                pack_b( b_block, ldb, b_transposed, depth, cols, b_buffer );
+
+                for ( unsigned long ic = 0; ic < m; ic += mc )
+                {
+                    unsigned long const rows = std::min( mc, m - ic );
+                    S const* a_block = a_transposed ? A + pc * lda + ic : A + ic * lda + pc;
+                    pack_a( a_block, lda, a_transposed, rows, depth, a_buffer );
+
+                    for ( unsigned long jr = 0; jr < cols; jr += nr )
+                        for ( unsigned long ir = 0; ir < rows; ir += mr )
+                        {
+                            unsigned long const tile_rows = std::min( mr, rows - ir );
+                            unsigned long const tile_cols = std::min( nr, cols - jr );
+                            T* c_tile = C + (ic + ir) * ldc + jc + jr;
+                            micro_kernel( depth, a_buffer + ir * depth, b_buffer + jr * depth, c_tile, ldc, tile_rows, tile_cols, alpha, block_beta );
+
+                            if constexpr( !std::is_same_v<Epilogue, gemm_no_epilogue> )
+                                if ( last_block )
+                                    for ( unsigned long r = 0; r != tile_rows; ++r )
+                                        epilogue( c_tile + r * ldc, ic + ir + r, jc + jr, tile_cols );
+                        }
+                }
+            }
+        }
+    }
+
+    ///
+    /// @brief Splitting of the [m x k] output of a GEMM into `row_tiles x col_tiles` independent tiles.
+    ///
+    struct gemm_partition
+    {
+        unsigned long row_tiles;
+        unsigned long col_tiles;
+    };
+
+    ///
+    /// @brief Partitions a [m x k] output with depth n for at most `threads` threads.
+    ///
+    /// Tiles are aligned to the register tile, each of them carries at least `min_work` multiply-adds, and the grid is chosen so that the tiles are as close
+    /// to square as possible. Skinny outputs such as [32 x 100352] in conv2d are therefore split along their long side only.
+    ///
+    template< typename T >
+    gemm_partition make_gemm_partition( unsigned long m, unsigned long n, unsigned long k, unsigned long threads, unsigned long min_work = 1UL << 17 ) noexcept
+    {
+        constexpr unsigned long mr = packed_gemm_private::kernel_traits<T>::mr;
+        constexpr unsigned long nr = packed_gemm_private::kernel_traits<T>::nr;
+
+        unsigned long const work = m * n * k;
+        threads = std::min( threads, std::max( 1UL, work / std::max( 1UL, min_work ) ) );
+
+        unsigned long const max_row_tiles = (m + mr - 1) / mr;
+        unsigned long const max_col_tiles = (k + nr - 1) / nr;
+
+        gemm_partition ans{ 1, 1 };
+        double best_score = std::numeric_limits<double>::max();
+        for ( unsigned long row_tiles = 1; row_tiles <= std::min( threads, max_row_tiles ); ++row_tiles )
+        {
+            unsigned long const col_tiles = std::min( threads / row_tiles, max_col_tiles );
+            double const tile_rows = static_cast<double>( m ) / row_tiles;
+            double const tile_cols = static_cast<double>( k ) / col_tiles;
+            // prefer using more threads, then squarer tiles
+            double const score = static_cast<double>( threads - row_tiles * col_tiles ) + std::abs( std::log( tile_rows / tile_cols ) ) * 1.0e-3;
+            if ( score < best_score )
+            {
+                best_score = score;
+                ans = gemm_partition{ row_tiles, col_tiles };
+            }
+        }
+        return ans;
+    }
+
+    ///
+    /// @brief Multi-threaded version of `packed_gemm`, distributing tiles of C over threads. Each thread packs its own panels, and no two threads write the same element.
+    ///
+    /// @param threads Number of threads to use. 0 for all the threads of the pool, see `get_num_threads`. Ignored if `parallel_mode` is off.
+    /// @param epilogue Same as the one in `packed_gemm`, row and column indices are relative to the whole C. Should be safe to call from different threads on different segments.
+    /// @param alpha Same as the one in `packed_gemm`.
+    /// @param beta Same as the one in `packed_gemm`.
+    ///
+    template< typename T, typename Epilogue = gemm_no_epilogue, typename S = T > requires std::floating_point<T>
+    void parallel_packed_gemm( S const* A, unsigned long lda, bool a_transposed, S const* B, unsigned long ldb, bool b_transposed,
+                               unsigned long m, unsigned long n, unsigned long k, T* C, unsigned long ldc, unsigned long threads = 0,
+                               gemm_blocking const& blocking = default_gemm_blocking<T>(), Epilogue const& epilogue = Epilogue{}, T alpha = T{1}, T beta = T{0} )
+    {
+        constexpr unsigned long mr = packed_gemm_private::kernel_traits<T>::mr;
+        constexpr unsigned long nr = packed_gemm_private::kernel_traits<T>::nr;
+
+        if constexpr( parallel_mode == 0 )
+            threads = 1;
+        else if ( threads == 0 )
+            threads = get_num_threads();
+
+        auto const [row_tiles, col_tiles] = make_gemm_partition<T>( m, n, k, threads );
+        if ( row_tiles * col_tiles <= 1 )
+        {
+            packed_gemm( A, lda, a_transposed, B, ldb, b_transposed, m, n, k, C, ldc, blocking, epilogue, alpha, beta );
+            return;
+        }
+
+        // tile boundaries are multiples of the register tile, only the last tile of each direction can be partial
+        unsigned long const rows_per_tile = ( (m + row_tiles - 1) / row_tiles + mr - 1 ) / mr * mr;
+        unsigned long const cols_per_tile = ( (k + col_tiles - 1) / col_tiles + nr - 1 ) / nr * nr;
+
+        auto const& tile_task = [&]( unsigned long tile )
+        {
+            unsigned long const row_begin = (tile / col_tiles) * rows_per_tile;
+            unsigned long const col_begin = (tile % col_tiles) * cols_per_tile;
+            if ( row_begin >= m || col_begin >= k ) return;
+            unsigned long const rows = std::min( rows_per_tile, m - row_begin );
+            unsigned long const cols = std::min( cols_per_tile, k - col_begin );
+
+            S const* a = a_transposed ? A + row_begin : A + row_begin * lda;
+            S const* b = b_transposed ? B + col_begin * ldb : B + col_begin;
+            if constexpr( std::is_same_v<Epilogue, gemm_no_epilogue> )
+                packed_gemm( a, lda, a_transposed, b, ldb, b_transposed, rows, n, cols, C + row_begin * ldc + col_begin, ldc, blocking, gemm_no_epilogue{}, alpha, beta );
+            else
+                packed_gemm( a, lda, a_transposed, b, ldb, b_transposed, rows, n, cols, C + row_begin * ldc + col_begin, ldc, blocking,
+                             [&epilogue, row_begin, col_begin]( T* ptr, unsigned long row, unsigned long col, unsigned long segment )
+                             {
+                                 epilogue( ptr, row + row_begin, col + col_begin, segment );
+                             }, alpha, beta );
+        };
+
+        parallel( tile_task, 0UL, row_tiles * col_tiles, 1UL );
+    }
+
+}//namespace ceras::backend
+
+#endif//PKGEMMXQJZRVNWTKYHAUDLBOEMCFSIPGQXTRVLZNKWYHJAUEODMBFCSIPGXTQRLVNZWKYHJAUE
@@ -0,0 +1,229 @@
+#ifndef POOLINGHPPVQZKXWMRNTJYLOBUEADCFIHSPGVQZKXWMRNTJYLOBUEADCFIHSPGVQZKXWMRNTJYL
+#define POOLINGHPPVQZKXWMRNTJYLOBUEADCFIHSPGVQZKXWMRNTJYLOBUEADCFIHSPGVQZKXWMRNTJYL
+
+#include "../includes.hpp"
+#include "../config.hpp"
+#include "../utils/parallel.hpp"
+#include "../utils/better_assert.hpp"
+
+//
+// Max and average pooling of NHWC tensors, with any window, stride and padding.
+//
+// An output pixel reduces the input pixels of its window, the padded ones being skipped. The loops go along the channels of a pixel, which are
+// contiguous in NHWC, and the tasks are the rows of the output, so that the kernels vectorize over the channels and run in parallel over batch x rows.
+//
+// The max pooling keeps, for every output element, the offset in its input sample of the maximum as an uint32 index, the first maximum of the window
+// in row-major order winning the ties. The backward passes scatter the gradient of the output, in O(output) for the max pooling.
+// Overlapping windows may scatter to the same element, in which case a task covers a whole sample and the results do not depend on the number of threads.
+//
+
+namespace ceras::backend
+{
+
+    ///
+    /// @brief Shape of a pooling of a [BS, R, C, CH] input, producing a [BS, new_R, new_C, CH] output.
+    ///
+    struct pooling_2d_geometry
+    {
+        unsigned long batch;
+        unsigned long rows;
+        unsigned long cols;
+        unsigned long channels;
+        unsigned long kernel_rows;
+        unsigned long kernel_cols;
+        unsigned long row_stride;
+        unsigned long col_stride;
+        unsigned long row_padding = 0;  ///< padded rows on the top, the bottom getting the rest
+        unsigned long col_padding = 0;  ///< padded columns on the left, the right getting the rest
+        unsigned long new_rows = 0;
+        unsigned long new_cols = 0;
+
+        unsigned long sample_size() const noexcept { return rows * cols * channels; }
+        unsigned long output_size() const noexcept { return batch * new_rows * new_cols * channels; }
+
+        // true if no input element belongs to two windows
+        bool disjoint() const noexcept { return kernel_rows <= row_stride && kernel_cols <= col_stride; }
+
+        bool operator == ( pooling_2d_geometry const& ) const noexcept = default;
+    };
+
+    ///
+    /// @brief The geometry of a pooling with `valid` or `same` padding.
+    ///
+    /// With `valid`, the output is [(R-r)/row_stride+1, (C-c)/col_stride+1]. With `same`, it is [ceil(R/row_stride), ceil(C/col_stride)],
+    /// the padding being split between both sides, the top and the left getting the smaller half.
+    ///
+    inline pooling_2d_geometry make_pooling_2d_geometry( std::vector<unsigned long> const& x, unsigned long kernel_rows, unsigned long kernel_cols,
+                                                         unsigned long row_stride, unsigned long col_stride, std::string const& padding )
+    {
+        pooling_2d_geometry g{ x[0], x[1], x[2], x[3], kernel_rows, kernel_cols, row_stride, col_stride, 0, 0, 0, 0 };
+        if ( padding == "same" )
+        {
+            g.new_rows = ( g.rows + row_stride - 1 ) / row_stride;
+            g.new_cols = ( g.cols + col_stride - 1 ) / col_stride;
+            g.row_padding = ( std::max( ( g.new_rows - 1 ) * row_stride + kernel_rows, g.rows ) - g.rows ) / 2;
+            g.col_padding = ( std::max( ( g.new_cols - 1 ) * col_stride + kernel_cols, g.cols ) - g.cols ) / 2;
+        }
+        else
+        {
+            g.new_rows = g.rows < kernel_rows ? 0 : ( g.rows - kernel_rows ) / row_stride + 1;
+            g.new_cols = g.cols < kernel_cols ? 0 : ( g.cols - kernel_cols ) / col_stride + 1;
+        }
+        return g;
+    }
+
+    namespace pooling_2d_private
+    {
+        // the input rows (or columns) [first, last) of the window of the output row (or column) o
+        inline std::pair<unsigned long, unsigned long> window( unsigned long o, unsigned long stride, unsigned long kernel, unsigned long padding, unsigned long inputs ) noexcept
+        {
+            std::int64_t const first = static_cast<std::int64_t>( o * stride ) - static_cast<std::int64_t>( padding );
+            std::int64_t const last = first + static_cast<std::int64_t>( kernel );
+            return { static_cast<unsigned long>( std::max( first, std::int64_t{0} ) ), static_cast<unsigned long>( std::clamp( last, std::int64_t{0}, static_cast<std::int64_t>( inputs ) ) ) };
+        }
+
+        // runs `task( b, oy )` for every output row, in tasks that never scatter to the same input element
+        template< typename Task >
+        void for_each_output_row( pooling_2d_geometry const& g, bool scatter, Task const& task )
+        {
+            if ( !scatter || g.disjoint() )
+            {
+                parallel( [&]( unsigned long t ){ task( t / g.new_rows, t % g.new_rows ); }, 0UL, g.batch * g.new_rows );
+                return;
+            }
+            parallel( [&]( unsigned long b ){ for ( unsigned long oy = 0; oy != g.new_rows; ++oy ) task( b, oy ); }, 0UL, g.batch, 1UL );
+        }
+    }//namespace pooling_2d_private
+
+    ///
+    /// @brief Max pooling.
+    /// @param input NHWC input of [BS, R, C, CH].
+    /// @param output NHWC output of [BS, new_R, new_C, CH], overwritten.
+    /// @param argmax The offsets of the maxima in their input samples, of the size of the output, overwritten.
+    ///
+    template< typename T >
+    void max_pooling_2d( T const* input, pooling_2d_geometry const& g, T* output, std::uint32_t* argmax )
+    {
+        using namespace pooling_2d_private;
+        better_assert( g.sample_size() <= 0xffffffffUL, "max_pooling_2d: the input samples are too large for 32-bit indices." );
+        unsigned long const channels = g.channels;
+        for_each_output_row( g, false, [&]( unsigned long b, unsigned long oy )
+        {
+            T const* sample = input + b * g.sample_size();
+            auto const [row_first, row_last] = window( oy, g.row_stride, g.kernel_rows, g.row_padding, g.rows );
+            for ( unsigned long ox = 0; ox != g.new_cols; ++ox )
+            {
+                unsigned long const offset = ( ( b * g.new_rows + oy ) * g.new_cols + ox ) * channels;
+                T* __restrict__ out = output + offset;
+                std::uint32_t* __restrict__ index = argmax + offset;
+                auto const [col_first, col_last] = window( ox, g.col_stride, g.kernel_cols, g.col_padding, g.cols );
+                bool first = true;
+                for ( unsigned long r = row_first; r != row_last; ++r )
+                    for ( unsigned long c = col_first; c != col_last; ++c )
+                    {
+                        std::uint32_t const pixel = static_cast<std::uint32_t>( ( r * g.cols + c ) * channels );
+                        T const* __restrict__ in = sample + pixel;
+                        if ( first )
+                        {
+                            for ( unsigned long ch = 0; ch != channels; ++ch )
+                            {
+                                out[ch] = in[ch];
+                                index[ch] = pixel + static_cast<std::uint32_t>( ch );
+                            }
+                            first = false;
+                            continue;
+                        }
+                        for ( unsigned long ch = 0; ch != channels; ++ch )
+                        {
+                            bool const greater = in[ch] > out[ch];
+                            out[ch] = greater ? in[ch] : out[ch];
+                            index[ch] = greater ? pixel + static_cast<std::uint32_t>( ch ) : index[ch];
+                        }
+                    }
+            }
+        } );
+    }
+
+    ///
+    /// @brief Backward pass of the max pooling, scattering the gradient of the output to the maxima.
+    /// @param input_grad Gradient of the input, of [BS, R, C, CH], overwritten.
+    ///
+    template< typename T >
+    void max_pooling_2d_backward( T const* grad, std::uint32_t const* argmax, pooling_2d_geometry const& g, T* input_grad )
+    {
+        using namespace pooling_2d_private;
+        std::fill_n( input_grad, g.batch * g.sample_size(), T{0} );
+        unsigned long const row_size = g.new_cols * g.channels;
+        for_each_output_row( g, true, [&]( unsigned long b, unsigned long oy )
+        {
+            T* sample = input_grad + b * g.sample_size();
+            unsigned long const offset = ( b * g.new_rows + oy ) * row_size;
+            for ( unsigned long idx = 0; idx != row_size; ++idx )
+                sample[argmax[offset+idx]] += grad[offset+idx];
+        } );
+    }
+
+    ///
+    /// @brief Average pooling, the padded elements being left out of the averages.
+    /// @param input NHWC input of [BS, R, C, CH].
+    /// @param output NHWC output of [BS, new_R, new_C, CH], overwritten.
+    ///
+    template< typename T >
+    void average_pooling_2d( T const* input, pooling_2d_geometry const& g, T* output )
+    {
+        using namespace pooling_2d_private;
+        unsigned long const channels = g.channels;
+        for_each_output_row( g, false, [&]( unsigned long b, unsigned long oy )
+        {
+            T const* sample = input + b * g.sample_size();
+            auto const [row_first, row_last] = window( oy, g.row_stride, g.kernel_rows, g.row_padding, g.rows );
+            for ( unsigned long ox = 0; ox != g.new_cols; ++ox )
+            {
+                T* __restrict__ out = output + ( ( b * g.new_rows + oy ) * g.new_cols + ox ) * channels;
+                auto const [col_first, col_last] = window( ox, g.col_stride, g.kernel_cols, g.col_padding, g.cols );
+                T const factor = T{1} / static_cast<T>( ( row_last - row_first ) * ( col_last - col_first ) );
+                std::fill_n( out, channels, T{0} );
+                for ( unsigned long r = row_first; r != row_last; ++r )
+                    for ( unsigned long c = col_first; c != col_last; ++c )
+                    {
+                        T const* __restrict__ in = sample + ( r * g.cols + c ) * channels;
+                        for ( unsigned long ch = 0; ch != channels; ++ch )
+                            out[ch] += in[ch] * factor;
+                    }
+            }
+        } );
+    }
+
+    ///
+    /// @brief Backward pass of the average pooling.
+    /// @param input_grad Gradient of the input, of [BS, R, C, CH], overwritten.
+    ///
+    template< typename T >
+    void average_pooling_2d_backward( T const* grad, pooling_2d_geometry const& g, T* input_grad )
+    {
+        using namespace pooling_2d_private;
+        std::fill_n( input_grad, g.batch * g.sample_size(), T{0} );
+        unsigned long const channels = g.channels;
+        for_each_output_row( g, true, [&]( unsigned long b, unsigned long oy )
+        {
+            T* sample = input_grad + b * g.sample_size();
+            auto const [row_first, row_last] = window( oy, g.row_stride, g.kernel_rows, g.row_padding, g.rows );
+            for ( unsigned long ox = 0; ox != g.new_cols; ++ox )
+            {
+                T const* __restrict__ gr = grad + ( ( b * g.new_rows + oy ) * g.new_cols + ox ) * channels;
+                auto const [col_first, col_last] = window( ox, g.col_stride, g.kernel_cols, g.col_padding, g.cols );
+                T const factor = T{1} / static_cast<T>( ( row_last - row_first ) * ( col_last - col_first ) );
+                for ( unsigned long r = row_first; r != row_last; ++r )
+                    for ( unsigned long c = col_first; c != col_last; ++c )
+                    {
+                        T* __restrict__ in = sample + ( r * g.cols + c ) * channels;
+                        for ( unsigned long ch = 0; ch != channels; ++ch )
+                            in[ch] += factor * gr[ch];
+                    }
+            }
+        } );
+    }
+
+}//namespace ceras::backend
+
+#endif//POOLINGHPPVQZKXWMRNTJYLOBUEADCFIHSPGVQZKXWMRNTJYLOBUEADCFIHSPGVQZKXWMRNTJYL
@@ -0,0 +1,168 @@
+#ifndef REDUCTIONHPPQMZLWXKTRNVBEYJOGHADFUCISPQMZLWXKTRNVBEYJOGHADFUCISPQMZLWXKTRN
+#define REDUCTIONHPPQMZLWXKTRNVBEYJOGHADFUCISPQMZLWXKTRNVBEYJOGHADFUCISPQMZLWXKTRN
+
+#include "../includes.hpp"
+#include "../utils/better_assert.hpp"
+#include "../utils/parallel.hpp"
+#include "./vector_math.hpp"
+
+//
+// Reductions of arrays, over all their elements or along an axis, for the sums, means, norms, maxima and minima of the tensors and of the operators.
+//
+// An array reduced along an axis is viewed as of shape (pres, n, post), n being the length of the axis: the output element (i, j) combines the n
+// values (i, k, j). The values are combined pairwise: they are cut into blocks of `leaf` values combined in sequence, and the results of the blocks
+// are combined as the leaves of a balanced binary tree, so that the rounding error of a sum grows as log(n) rather than as n. In a block,
+//
+//  - the contiguous values (post is 1) are spread over independent accumulators, two SIMD registers of them, combined at the end of the block,
+//  - the strided values (post above 1) are combined row by row into the accumulators of a block of contiguous columns, one SIMD lane per column.
+//
+// The rows, the blocks of columns, and the two halves of the trees of the long axes are reduced in parallel. The trees depending on n only, the
+// results do not depend on the number of threads.
+//
+
+namespace ceras::backend
+{
+
+    namespace reduction_private
+    {
+        inline constexpr unsigned long leaf = 128; // the values of a block, combined in sequence
+        inline constexpr unsigned long column_block = 256; // the columns reduced by a task
+        inline constexpr unsigned long parallel_size = 1UL << 15; // the values of a tree above which its halves are reduced in parallel
+
+        // the accumulators of a block of contiguous values
+        template< typename A >
+        constexpr unsigned long accumulators() noexcept
+        {
+            if constexpr( std::floating_point<A> )
+                return 2 * vector_math::lanes<A>;
+            else
+                return 8;
+        }
+
+        // the values of the left half of a tree, whole blocks
+        inline unsigned long split( unsigned long n ) noexcept
+        {
+            unsigned long const leaves = ( n + leaf - 1 ) / leaf;
+            return ( ( leaves + 1 ) / 2 ) * leaf;
+        }
+
+        template< typename A, typename T, typename Map, typename Combine >
+        A reduce_contiguous( T const* in, unsigned long n, Map const& map, Combine const& combine )
+        {
+            if ( n > leaf )
+            {
+                unsigned long const half = split( n );
+                A left, right;
+                auto const& reduce_left = [&](){ left = reduce_contiguous<A>( in, half, map, combine ); };
+                auto const& reduce_right = [&](){ right = reduce_contiguous<A>( in + half, n - half, map, combine ); };
+                if ( n >= parallel_size )
+                    parallel_invoke( reduce_left, reduce_right );
+                else
+                {
+                    reduce_left();
+                    reduce_right();
+                }
+                return combine( left, right );
+            }
+
+            constexpr unsigned long width = accumulators<A>();
+            if ( n < width )
+            {
+                A ans = map( in[0] );
+                for ( unsigned long k = 1; k != n; ++k )
+                    ans = combine( ans, map( in[k] ) );
+                return ans;
+            }
+
+            std::array<A, width> acc;
+            for ( unsigned long w = 0; w != width; ++w )
+                acc[w] = map( in[w] );
+            unsigned long k = width;
+            for ( ; k + width <= n; k += width )
+                for ( unsigned long w = 0; w != width; ++w )
+                    acc[w] = combine( acc[w], map( in[k+w] ) );
+            for ( unsigned long w = 0; k + w != n; ++w )
+                acc[w] = combine( acc[w], map( in[k+w] ) );
+            for ( unsigned long half = width / 2; half != 0; half /= 2 )
+                for ( unsigned long w = 0; w != half; ++w )
+                    acc[w] = combine( acc[w], acc[w+half] );
+            return acc[0];
+        }
+
+        // reduces the n rows of `cols` columns starting at `in`, the rows being `post` values apart, into acc
+        template< typename A, typename T, typename Map, typename Combine >
+        void reduce_strided( T const* in, unsigned long n, unsigned long post, unsigned long cols, Map const& map, Combine const& combine, A* acc )
+        {
+            if ( n > leaf )
+            {
+                unsigned long const half = split( n );
+                std::array<A, column_block> right;
+                auto const& reduce_left = [&](){ reduce_strided( in, half, post, cols, map, combine, acc ); };
+                auto const& reduce_right = [&](){ reduce_strided( in + half * post, n - half, post, cols, map, combine, right.data() ); };
+                if ( n * cols >= parallel_size )
+                    parallel_invoke( reduce_left, reduce_right );
+                else
+                {
+                    reduce_left();
+                    reduce_right();
+                }
+                for ( unsigned long j = 0; j != cols; ++j )
+                    acc[j] = combine( acc[j], right[j] );
+                return;
+            }
+
+            for ( unsigned long j = 0; j != cols; ++j )
+                acc[j] = map( in[j] );
+            for ( unsigned long k = 1; k != n; ++k )
+            {
+                T const* row = in + k * post;
+                for ( unsigned long j = 0; j != cols; ++j )
+                    acc[j] = combine( acc[j], map( row[j] ) );
+            }
+        }
+    }//namespace reduction_private
+
+    ///
+    /// @brief Reduces the n values of `in`, returning the accumulator of type A.
+    /// @param map Converts a value to an accumulator, such as `[]( float x ){ return x*x; }`.
+    /// @param combine An associative and commutative operator on the accumulators, such as `std::plus<float>{}`.
+    ///
+    template< typename A, typename T, typename Map, typename Combine >
+    A reduce_all( T const* in, unsigned long n, Map const& map, Combine const& combine )
+    {
+        better_assert( n != 0, "reduce_all: expecting at least one value." );
+        return reduction_private::reduce_contiguous<A>( in, n, map, combine );
+    }
+
+    ///
+    /// @brief Reduces `in`, of shape (pres, n, post), along its second axis into `out`, of shape (pres, post).
+    /// @param map Converts a value to an accumulator of type A.
+    /// @param combine An associative and commutative operator on the accumulators.
+    ///
+    template< typename A, typename T, typename Out, typename Map, typename Combine >
+    void reduce_axis( T const* in, unsigned long pres, unsigned long n, unsigned long post, Map const& map, Combine const& combine, Out* out )
+    {
+        using namespace reduction_private;
+        better_assert( n != 0, "reduce_axis: expecting at least one value to reduce." );
+        if ( post == 1 )
+        {
+            parallel( [&]( unsigned long i ){ out[i] = static_cast<Out>( reduce_contiguous<A>( in + i * n, n, map, combine ) ); }, 0UL, pres );
+            return;
+        }
+
+        unsigned long const blocks = ( post + column_block - 1 ) / column_block;
+        parallel( [&]( unsigned long task )
+        {
+            unsigned long const i = task / blocks;
+            unsigned long const first = ( task % blocks ) * column_block;
+            unsigned long const cols = std::min( column_block, post - first );
+            std::array<A, column_block> acc;
+            reduce_strided( in + i * n * post + first, n, post, cols, map, combine, acc.data() );
+            for ( unsigned long j = 0; j != cols; ++j )
+                out[i * post + first + j] = static_cast<Out>( acc[j] );
+        }, 0UL, pres * blocks );
+    }
+
+}//namespace ceras::backend
+
+#endif//REDUCTIONHPPQMZLWXKTRNVBEYJOGHADFUCISPQMZLWXKTRNVBEYJOGHADFUCISPQMZLWXKTRN
@@ -0,0 +1,230 @@
+#ifndef TRANSPOSEDCONVHPPJRKQWZXVMNTYLOBUEADCFIHSPGJRKQWZXVMNTYLOBUEADCFIHSPGJRKQWZ
+#define TRANSPOSEDCONVHPPJRKQWZXVMNTYLOBUEADCFIHSPGJRKQWZXVMNTYLOBUEADCFIHSPGJRKQWZ
+
+#include "../includes.hpp"
+#include "../config.hpp"
+#include "../utils/parallel.hpp"
+
+//
+// Transposed convolution of NHWC tensors, as a GEMM followed by a col2im gather.
+//
+// The input pixel (iy, ix) and the kernel tap (u, v) contribute to the output pixel (iy*row_stride+u*row_dilation-row_padding, ix*col_stride+v*col_dilation-col_padding),
+// the contributions falling outside of the output being dropped. The kernels are [NC, r, c, CH], the element (nc, ch, tap) being `kernel[(nc*CH+ch)*taps+tap]`
+// as in `conv2d_geometry`, with NC the output channels and CH the input channels.
+//
+// The kernels are repacked to a [CH, taps*NC] matrix, so that a single GEMM of the [BS*R*C, CH] input gives the contributions of every input pixel,
+// [BS*R*C, taps*NC], each tap being a contiguous vector of NC output channels. An output pixel then sums the contributing vectors in a fixed order.
+// No multiplication is spent on the zeros an upsample-then-convolve implementation would insert between the input pixels.
+//
+// The backward pass gathers the gradient of the output into the same [BS*R*C, taps*NC] layout, from which two GEMMs give the gradients of the input and of the kernels.
+// The results do not depend on the number of threads.
+//
+
+namespace ceras::backend
+{
+
+    ///
+    /// @brief Shape of a transposed convolution of a [BS, R, C, CH] input with NC kernels of [r, c, CH], producing a [BS, new_R, new_C, NC] output.
+    ///
+    struct conv2d_transpose_geometry
+    {
+        unsigned long batch;
+        unsigned long rows;
+        unsigned long cols;
+        unsigned long channels;
+        unsigned long new_channels;
+        unsigned long kernel_rows;
+        unsigned long kernel_cols;
+        unsigned long row_stride = 1;
+        unsigned long col_stride = 1;
+        unsigned long row_padding = 0;  ///< rows cropped from the top of the full output
+        unsigned long col_padding = 0;  ///< columns cropped from the left of the full output
+        unsigned long row_dilation = 1;
+        unsigned long col_dilation = 1;
+        unsigned long new_rows = 0;
+        unsigned long new_cols = 0;
+
+        unsigned long taps() const noexcept { return kernel_rows * kernel_cols; }
+        unsigned long width() const noexcept { return taps() * new_channels; }
+        unsigned long pixels() const noexcept { return batch * rows * cols; }
+
+        bool operator == ( conv2d_transpose_geometry const& ) const noexcept = default;
+    };
+
+    ///
+    /// @brief The geometry of a transposed convolution with `valid` or `same` padding.
+    ///
+    /// With `valid`, the output is the full [(R-1)*row_stride+row_dilation*(r-1)+1, ...] one. With `same`, it is [R*row_stride, C*col_stride], the cropped rows
+    /// and columns being split between both sides, the top and the left getting the smaller half.
+    ///
+    inline conv2d_transpose_geometry make_conv2d_transpose_geometry( std::vector<unsigned long> const& x, std::vector<unsigned long> const& kernel,
+                                                                      unsigned long row_stride, unsigned long col_stride, unsigned long row_dilation, unsigned long col_dilation,
+                                                                      std::string const& padding )
+    {
+        conv2d_transpose_geometry g{ x[0], x[1], x[2], x[3], kernel[0], kernel[1], kernel[2], row_stride, col_stride, 0, 0, row_dilation, col_dilation, 0, 0 };
+        unsigned long const dilated_rows = row_dilation * ( g.kernel_rows - 1 ) + 1;
+        unsigned long const dilated_cols = col_dilation * ( g.kernel_cols - 1 ) + 1;
+        if ( padding == "same" )
+        {
+            g.row_padding = ( std::max( dilated_rows, row_stride ) - row_stride ) / 2;
+            g.col_padding = ( std::max( dilated_cols, col_stride ) - col_stride ) / 2;
+            g.new_rows = g.rows * row_stride;
+            g.new_cols = g.cols * col_stride;
+        }
+        else
+        {
+            g.new_rows = ( g.rows - 1 ) * row_stride + dilated_rows;
+            g.new_cols = ( g.cols - 1 ) * col_stride + dilated_cols;
+        }
+        return g;
+    }
+
+    namespace transposed_conv2d_private
+    {
+        // the (tap, input) pairs contributing to every output row (or column): pairs[offsets[o]:offsets[o+1]]
+        struct contributions
+        {
+            std::vector<unsigned long> offsets;
+            std::vector<std::pair<unsigned long, unsigned long>> pairs;
+
+            contributions( unsigned long inputs, unsigned long outputs, unsigned long taps, unsigned long stride, unsigned long dilation, unsigned long padding )
+            {
+                offsets.reserve( outputs + 1 );
+                offsets.push_back( 0 );
+                for ( unsigned long o = 0; o != outputs; ++o )
+                {
+                    for ( unsigned long tap = 0; tap != taps; ++tap )
+                    {
+                        std::int64_t const position = static_cast<std::int64_t>( o + padding ) - static_cast<std::int64_t>( tap * dilation );
+                        if ( position < 0 || position % static_cast<std::int64_t>( stride ) != 0 )
+                            continue;
+                        unsigned long const input = static_cast<unsigned long>( position ) / stride;
+                        if ( input < inputs )
+                            pairs.emplace_back( tap, input );
+                    }
+                    offsets.push_back( pairs.size() );
+                }
+            }
+        };
+
+        // the output row (or column) the tap of the input row (or column) contributes to, or -1 when cropped
+        inline std::int64_t target( unsigned long input, unsigned long tap, unsigned long stride, unsigned long dilation, unsigned long padding, unsigned long outputs ) noexcept
+        {
+            std::int64_t const o = static_cast<std::int64_t>( input * stride + tap * dilation ) - static_cast<std::int64_t>( padding );
+            return ( o < 0 || o >= static_cast<std::int64_t>( outputs ) ) ? -1 : o;
+        }
+    }//namespace transposed_conv2d_private
+
+    template< typename T >
+    struct conv2d_transpose_workspace
+    {
+        std::vector<T> kernel;          ///< the kernels packed to [CH, taps*NC]
+        std::vector<T> columns;         ///< contributions of the input pixels, or gathered gradient, [BS*R*C, taps*NC]
+        std::vector<T> kernel_gradient; ///< gradient of the packed kernels
+    };
+
+    ///
+    /// @brief Packs the [NC, r, c, CH] kernels into the [CH, taps*NC] matrix of the GEMM.
+    ///
+    template< typename T >
+    void pack_conv2d_transpose_kernel( T const* kernel, conv2d_transpose_geometry const& g, std::vector<T>& packed )
+    {
+        unsigned long const taps = g.taps();
+        unsigned long const width = g.width();
+        packed.resize( g.channels * width );
+        for ( unsigned long nc = 0; nc != g.new_channels; ++nc )
+            for ( unsigned long ch = 0; ch != g.channels; ++ch )
+                for ( unsigned long tap = 0; tap != taps; ++tap )
+                    packed[ch*width+tap*g.new_channels+nc] = kernel[(nc*g.channels+ch)*taps+tap];
+    }
+
+    ///
+    /// @brief Adds (or writes, if `accumulate` is false) the gradient of the packed kernels to the gradient of the [NC, r, c, CH] kernels.
+    ///
+    template< typename T >
+    void unpack_conv2d_transpose_kernel_gradient( T const* packed, conv2d_transpose_geometry const& g, T* kernel_gradient, bool accumulate )
+    {
+        unsigned long const taps = g.taps();
+        unsigned long const width = g.width();
+        for ( unsigned long nc = 0; nc != g.new_channels; ++nc )
+            for ( unsigned long ch = 0; ch != g.channels; ++ch )
+                for ( unsigned long tap = 0; tap != taps; ++tap )
+                {
+                    T& dst = kernel_gradient[(nc*g.channels+ch)*taps+tap];
+                    dst = accumulate ? T{dst + packed[ch*width+tap*g.new_channels+nc]} : packed[ch*width+tap*g.new_channels+nc];
+                }
+    }
+
+    ///
+    /// @brief Sums the contributions of the input pixels into the output of the transposed convolution.
+    /// @param columns The [BS*R*C, taps*NC] contributions, the product of the input and the packed kernels.
+    /// @param output NHWC output of [BS, new_R, new_C, NC], overwritten.
+    ///
+    template< typename T >
+    void conv2d_transpose_col2im( T const* columns, conv2d_transpose_geometry const& g, T* output )
+    {
+        using namespace transposed_conv2d_private;
+        contributions const row_contributions{ g.rows, g.new_rows, g.kernel_rows, g.row_stride, g.row_dilation, g.row_padding };
+        contributions const col_contributions{ g.cols, g.new_cols, g.kernel_cols, g.col_stride, g.col_dilation, g.col_padding };
+        unsigned long const new_channels = g.new_channels;
+        unsigned long const width = g.width();
+
+        parallel( [&]( unsigned long task )
+        {
+            unsigned long const b = task / g.new_rows;
+            unsigned long const oy = task % g.new_rows;
+            for ( unsigned long ox = 0; ox != g.new_cols; ++ox )
+            {
+                T* dst = output + ( task * g.new_cols + ox ) * new_channels;
+                std::fill_n( dst, new_channels, T{0} );
+                for ( unsigned long r = row_contributions.offsets[oy]; r != row_contributions.offsets[oy+1]; ++r )
+                {
+                    auto const [u, iy] = row_contributions.pairs[r];
+                    for ( unsigned long c = col_contributions.offsets[ox]; c != col_contributions.offsets[ox+1]; ++c )
+                    {
+                        auto const [v, ix] = col_contributions.pairs[c];
+                        T const* src = columns + ( ( b * g.rows + iy ) * g.cols + ix ) * width + ( u * g.kernel_cols + v ) * new_channels;
+                        for ( unsigned long nc = 0; nc != new_channels; ++nc )
+                            dst[nc] += src[nc];
+                    }
+                }
+            }
+        }, 0UL, g.batch * g.new_rows );
+    }
+
+    ///
+    /// @brief Gathers the gradient of the output of the transposed convolution into the [BS*R*C, taps*NC] layout of the contributions, zeros for the cropped ones.
+    ///
+    template< typename T >
+    void conv2d_transpose_im2col( T const* grad, conv2d_transpose_geometry const& g, T* columns )
+    {
+        using namespace transposed_conv2d_private;
+        unsigned long const new_channels = g.new_channels;
+        unsigned long const width = g.width();
+
+        parallel( [&]( unsigned long task )
+        {
+            unsigned long const b = task / g.rows;
+            unsigned long const iy = task % g.rows;
+            for ( unsigned long ix = 0; ix != g.cols; ++ix )
+            {
+                T* dst = columns + ( task * g.cols + ix ) * width;
+                for ( unsigned long u = 0; u != g.kernel_rows; ++u )
+                {
+                    std::int64_t const oy = target( iy, u, g.row_stride, g.row_dilation, g.row_padding, g.new_rows );
+                    for ( unsigned long v = 0; v != g.kernel_cols; ++v, dst += new_channels )
+                    {
+                        std::int64_t const ox = target( ix, v, g.col_stride, g.col_dilation, g.col_padding, g.new_cols );
+                        if ( oy < 0 || ox < 0 )
+                            std::fill_n( dst, new_channels, T{0} );
+                        else
+                            std::copy_n( grad + ( ( b * g.new_rows + oy ) * g.new_cols + ox ) * new_channels, new_channels, dst );
+                    }
+                }
+            }
+        }, 0UL, g.batch * g.rows );
+    }
+
+}//namespace ceras::backend
+
+#endif//TRANSPOSEDCONVHPPJRKQWZXVMNTYLOBUEADCFIHSPGJRKQWZXVMNTYLOBUEADCFIHSPGJRKQWZ
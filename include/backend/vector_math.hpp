@@ -0,0 +1,571 @@
+#ifndef VECMATHHPPJWQZRKXMVNTYLOBUEADCFIHSPGJWQZRKXMVNTYLOBUEADCFIHSPGJWQZRKXMVNT
+#define VECMATHHPPJWQZRKXMVNTYLOBUEADCFIHSPGJWQZRKXMVNTYLOBUEADCFIHSPGJWQZRKXMVNT
+
+#include "../includes.hpp"
+#include "../config.hpp"
+#include "../utils/parallel.hpp"
+
+//
+// Vectorized transcendental functions, for the elementwise operators.
+//
+// The functions of `vector_math` take and return packs of floats or doubles, filling a SSE, AVX2 or AVX-512 register depending on the target,
+// and evaluate polynomial approximations with the vector extensions of GCC and Clang, so that the compiler emits the instructions of the target:
+//
+//  - exp:      x = n ln2 + r with |r| <= ln2/2, the Taylor polynomial of degree 7 (float) or 13 (double) of exp(r), scaled by 2^n
+//  - expm1:    the Taylor polynomial of degree 8 (float) or 15 (double) for |x| <= ln2/2, exp(x) - 1 otherwise
+//  - log:      x = 2^e m with m in [sqrt(1/2), sqrt(2)), log(m) = 2 atanh( (m-1)/(m+1) ) by its odd series
+//  - log1p:    log(1+x) corrected by the rounding of 1+x
+//  - tanh:     expm1(2|x|) / (expm1(2|x|)+2), with the sign of x
+//  - sigmoid:  1 / (1+exp(-x))
+//  - softplus: max(x, 0) + log1p( exp(-|x|) )
+//  - erf:      its Taylor series around 0 for |x| < 1.5 and around 2.25 for |x| < 3, 1 - erfc(|x|) otherwise, erfc by its continued fraction
+//
+// Over the range of normal results, the errors measured against the C library (see `test/vector_math.cc`) are at most 2 ulp for exp and log, 3 ulp
+// for expm1, log1p, tanh, sigmoid and softplus, and 4 ulp for erf. Infinities and NaNs propagate as in the C library; the subnormal results of exp lose their last bits.
+//
+// The strict mode evaluates every lane with the C library instead, for results identical to those of the scalar code: it is enabled by setting
+// `strict_math = 1` (see `../config.hpp`), or by the environment variable `CERAS_STRICT_MATH=1`.
+//
+
+namespace ceras::backend
+{
+
+    namespace vector_math_private
+    {
+    #if defined(__AVX512F__)
+        inline constexpr unsigned long simd_bytes = 64;
+    #elif defined(__AVX__)
+        inline constexpr unsigned long simd_bytes = 32;
+    #else
+        inline constexpr unsigned long simd_bytes = 16;
+    #endif
+
+        // the layout of the IEEE 754 type T
+        template< typename T >
+        struct float_traits;
+
+        template<>
+        struct float_traits<float>
+        {
+            static constexpr int mantissa_bits = 23;
+            static constexpr int exponent_bias = 127;
+            static constexpr unsigned long exp_degree = 7;
+            static constexpr unsigned long expm1_degree = 8;
+            static constexpr unsigned long log_terms = 5;
+            static constexpr unsigned long erf_terms = 16;
+            static constexpr unsigned long erf_center_terms = 18;
+            static constexpr unsigned long erfc_depth = 8;
+            static constexpr float exp_lower = -104.0f;   // exp of less underflows
+            static constexpr float exp_upper = 89.0f;     // exp of more overflows
+            static constexpr float tanh_saturation = 9.1f;
+            static constexpr float erf_saturation = 4.0f;
+            static constexpr float ln2_hi = 0.693359375f;
+            static constexpr float ln2_lo = -2.12194440e-4f;
+        };
+
+        template<>
+        struct float_traits<double>
+        {
+            static constexpr int mantissa_bits = 52;
+            static constexpr int exponent_bias = 1023;
+            static constexpr unsigned long exp_degree = 13;
+            static constexpr unsigned long expm1_degree = 15;
+            static constexpr unsigned long log_terms = 11;
+            static constexpr unsigned long erf_terms = 25;
+            static constexpr unsigned long erf_center_terms = 34;
+            static constexpr unsigned long erfc_depth = 20;
+            static constexpr double exp_lower = -746.0;
+            static constexpr double exp_upper = 710.0;
+            static constexpr double tanh_saturation = 19.1;
+            static constexpr double erf_saturation = 6.0;
+            static constexpr double ln2_hi = 6.93147180369123816490e-01;
+            static constexpr double ln2_lo = 1.90821492927058770002e-10;
+        };
+
+        // the coefficients 1/k! for k in [0, N)
+        template< typename T, unsigned long N >
+        constexpr std::array<T, N> inverse_factorials() noexcept
+        {
+            std::array<T, N> ans{};
+            double factorial = 1.0;
+            for ( unsigned long k = 0; k != N; ++k )
+            {
+                factorial *= ( k == 0 ) ? 1.0 : static_cast<double>( k );
+                ans[k] = static_cast<T>( 1.0 / factorial );
+            }
+            return ans;
+        }
+
+        // the coefficients 2/(2k+3) of the series of 2 atanh(s) = 2s + s^3 (2/3 + s^2 (2/5 + ...))
+        template< typename T, unsigned long N >
+        constexpr std::array<T, N> atanh_coefficients() noexcept
+        {
+            std::array<T, N> ans{};
+            for ( unsigned long k = 0; k != N; ++k )
+                ans[k] = static_cast<T>( 2.0 / static_cast<double>( 2*k+3 ) );
+            return ans;
+        }
+
+        // the coefficients 2/sqrt(pi) (-1)^n / ( n! (2n+1) ) of the series of erf(x) / x in x^2
+        template< typename T, unsigned long N >
+        constexpr std::array<T, N> erf_coefficients() noexcept
+        {
+            std::array<T, N> ans{};
+            double term = 1.12837916709551257390;
+            for ( unsigned long n = 0; n != N; ++n )
+            {
+                if ( n != 0 )
+                    term = -term / static_cast<double>( n );
+                ans[n] = static_cast<T>( term / static_cast<double>( 2*n+1 ) );
+            }
+            return ans;
+        }
+
+        // erf is evaluated by its Taylor series around 0 below `erf_lower`, around `erf_center` up to `erf_upper`, and from erfc above
+        inline constexpr double erf_lower = 1.5;
+        inline constexpr double erf_center = 2.25;
+        inline constexpr double erf_upper = 3.0;
+
+        // the coefficients of the Taylor series around `erf_center`, the derivatives of erf being 2/sqrt(pi) (-1)^(n-1) H_{n-1}(x) exp(-x^2), H the Hermite polynomials
+        template< typename T, unsigned long N >
+        std::array<T, N> const& erf_center_coefficients()
+        {
+            static std::array<T, N> const ans = []()
+            {
+                long double const c = erf_center;
+                long double const scale = 1.128379167095512573896158903121545172L * std::exp( -c * c );
+                std::array<T, N> coefficients{};
+                coefficients[0] = static_cast<T>( std::erf( c ) );
+                long double hermite_2 = 0.0L; // H_{n-2}
+                long double hermite_1 = 1.0L; // H_{n-1}
+                long double factorial = 1.0L;
+                for ( unsigned long n = 1; n != N; ++n )
+                {
+                    factorial *= static_cast<long double>( n );
+                    coefficients[n] = static_cast<T>( ( ( n % 2 == 1 ) ? scale : -scale ) * hermite_1 / factorial );
+                    long double const hermite = 2.0L * c * hermite_1 - 2.0L * static_cast<long double>( n-1 ) * hermite_2;
+                    hermite_2 = hermite_1;
+                    hermite_1 = hermite;
+                }
+                return coefficients;
+            }();
+            return ans;
+        }
+
+        inline bool strict_math_enabled()
+        {
+            static bool const enabled_by_environment = []()
+            {
+                char const* flag = std::getenv( "CERAS_STRICT_MATH" );
+                return flag && std::string{ flag } == std::string{ "1" };
+            }();
+            return strict_math || enabled_by_environment;
+        }
+
+    #if defined(__GNUC__) || defined(__clang__)
+        template< typename T >
+        struct pack_traits
+        {
+            static constexpr unsigned long lanes = simd_bytes / sizeof(T);
+            typedef T type __attribute__((vector_size(simd_bytes)));
+        };
+    #else
+        // a single lane for compilers without vector extensions, always evaluated with the C library
+        template< typename T >
+        struct pack_traits
+        {
+            static constexpr unsigned long lanes = 1;
+            typedef T type;
+        };
+    #endif
+    }//namespace vector_math_private
+
+    // The kernels rely on the order of their operations, such as the two steps of the reduction of exp or the correction of log1p, and on the
+    // comparisons with infinities and NaNs, which `-ffast-math` would reassociate or fold away. The strict mode calls the scalar functions of the
+    // C library, not their vector variants.
+    #if defined(__GNUC__) && !defined(__clang__)
+    #pragma GCC push_options
+    #pragma GCC optimize ("no-associative-math", "no-reciprocal-math", "no-finite-math-only", "no-tree-loop-vectorize")
+    #endif
+
+    namespace vector_math
+    {
+        ///
+        /// @brief A vector register of T.
+        ///
+        template< std::floating_point T >
+        using pack = typename vector_math_private::pack_traits<T>::type;
+
+        ///
+        /// @brief The number of elements of a `pack<T>`.
+        ///
+        template< std::floating_point T >
+        inline constexpr unsigned long lanes = vector_math_private::pack_traits<T>::lanes;
+
+        template< typename P >
+        concept Pack = std::same_as<P, pack<float>> || std::same_as<P, pack<double>>;
+
+        template< Pack P >
+        using element_type = std::conditional_t<std::is_same_v<P, pack<float>>, float, double>;
+
+        template< std::floating_point T >
+        pack<T> load( T const* ptr ) noexcept
+        {
+            pack<T> ans;
+            std::memcpy( &ans, ptr, sizeof(pack<T>) );
+            return ans;
+        }
+
+        template< std::floating_point T >
+        void store( T* ptr, pack<T> const& p ) noexcept
+        {
+            std::memcpy( ptr, &p, sizeof(pack<T>) );
+        }
+
+        template< Pack P >
+        P broadcast( element_type<P> x ) noexcept
+        {
+            return P{} + x;
+        }
+
+        // calls func on every lane
+        template< Pack P, typename Function >
+        P map_lanes( P x, Function const& func ) noexcept
+        {
+            if constexpr( std::is_floating_point_v<P> )
+                return func( x );
+            else
+            {
+                for ( unsigned long idx = 0; idx != lanes<element_type<P>>; ++idx )
+                    x[idx] = func( x[idx] );
+                return x;
+            }
+        }
+    }//namespace vector_math
+
+    namespace vector_math_private
+    {
+        using vector_math::Pack;
+        using vector_math::element_type;
+        using vector_math::broadcast;
+
+    #if defined(__GNUC__) || defined(__clang__)
+        // the integers of the width of T, as given by the comparisons of packs
+        template< Pack P >
+        using mask_type = decltype( std::declval<P>() < std::declval<P>() );
+
+        template< Pack P >
+        mask_type<P> as_integer( P x ) noexcept { return std::bit_cast<mask_type<P>>( x ); }
+
+        template< Pack P >
+        P as_float( mask_type<P> i ) noexcept { return std::bit_cast<P>( i ); }
+
+        // a where the mask is set, b elsewhere
+        template< Pack P >
+        P select( mask_type<P> mask, P a, P b ) noexcept
+        {
+            return as_float<P>( ( mask & as_integer( a ) ) | ( ~mask & as_integer( b ) ) );
+        }
+
+        template< Pack P, unsigned long N >
+        P horner( P x, std::array<element_type<P>, N> const& coefficients ) noexcept
+        {
+            P ans = broadcast<P>( coefficients[N-1] );
+            for ( unsigned long k = N-1; k != 0; --k )
+                ans = ans * x + coefficients[k-1];
+            return ans;
+        }
+
+        // the sign bits, -1 and 1 differing by their sign only
+        template< Pack P >
+        mask_type<P> sign_mask() noexcept
+        {
+            typedef element_type<P> T;
+            return as_integer( broadcast<P>( T{-1} ) ) & ~as_integer( broadcast<P>( T{1} ) );
+        }
+
+        template< Pack P >
+        P abs( P x ) noexcept
+        {
+            return as_float<P>( as_integer( x ) & ~sign_mask<P>() );
+        }
+
+        // x with the sign of y
+        template< Pack P >
+        P copysign( P x, P y ) noexcept
+        {
+            auto const sign = sign_mask<P>();
+            return as_float<P>( ( as_integer( x ) & ~sign ) | ( as_integer( y ) & sign ) );
+        }
+
+        // the 32-bit integers of the lanes of P
+        template< Pack P >
+        struct int32_pack_traits
+        {
+            typedef std::int32_t type __attribute__((vector_size(vector_math::lanes<element_type<P>> * sizeof(std::int32_t))));
+        };
+
+        // the integers nearest to x, halves away from zero, by a conversion the reassociations of `-funsafe-math-optimizations` cannot fold away
+        template< Pack P >
+        typename int32_pack_traits<P>::type round_to_int32( P x ) noexcept
+        {
+            typedef element_type<P> T;
+            return __builtin_convertvector( x + copysign( broadcast<P>( T{0.5} ), x ), typename int32_pack_traits<P>::type );
+        }
+
+        // 2^k for integers k with |k| <= 2 x exponent_bias
+        template< Pack P >
+        P scale( P x, mask_type<P> k ) noexcept
+        {
+            typedef element_type<P> T;
+            typedef float_traits<T> traits;
+            auto const half = k >> 1;
+            P const lhs = as_float<P>( ( half + traits::exponent_bias ) << traits::mantissa_bits );
+            P const rhs = as_float<P>( ( k - half + traits::exponent_bias ) << traits::mantissa_bits );
+            return x * lhs * rhs;
+        }
+
+        template< Pack P >
+        P exp( P x ) noexcept
+        {
+            typedef element_type<P> T;
+            typedef float_traits<T> traits;
+            static constexpr auto coefficients = inverse_factorials<T, traits::exp_degree+1>();
+
+            P const clamped = select( x < traits::exp_lower, broadcast<P>( traits::exp_lower ), select( x > traits::exp_upper, broadcast<P>( traits::exp_upper ), x ) );
+            auto const k = round_to_int32( clamped * static_cast<T>( 1.44269504088896340736 ) );
+            P const n = __builtin_convertvector( k, P );
+            P const r = ( clamped - n * traits::ln2_hi ) - n * traits::ln2_lo;
+            P const ans = scale( horner( r, coefficients ), __builtin_convertvector( k, mask_type<P> ) );
+            return select( x != x, x, ans );
+        }
+
+        template< Pack P >
+        P expm1( P x ) noexcept
+        {
+            typedef element_type<P> T;
+            typedef float_traits<T> traits;
+            static constexpr auto coefficients = inverse_factorials<T, traits::expm1_degree+1>();
+            static constexpr auto tail = [](){ std::array<T, traits::expm1_degree-1> ans{}; for ( unsigned long k = 0; k != ans.size(); ++k ) ans[k] = coefficients[k+2]; return ans; }();
+
+            P const small = x + x * x * horner( x, tail ); // x + x^2/2 + ...
+            return select( abs( x ) < static_cast<T>( 0.34657359027997265471 ), small, exp( x ) - T{1} );
+        }
+
+        template< Pack P >
+        P log( P x ) noexcept
+        {
+            typedef element_type<P> T;
+            typedef float_traits<T> traits;
+            typedef mask_type<P> I;
+            static constexpr auto coefficients = atanh_coefficients<T, traits::log_terms>();
+            T const min_normal = std::numeric_limits<T>::min();
+
+            // subnormals scaled to normals
+            I const subnormal = x < min_normal;
+            P const y = select( subnormal, x * static_cast<T>( 1UL << traits::mantissa_bits ), x );
+            I const bits = as_integer( y );
+            I e = ( bits >> traits::mantissa_bits ) - traits::exponent_bias + ( subnormal & (-traits::mantissa_bits) );
+            P m = as_float<P>( ( bits & ( ( ( I{} + 1 ) << traits::mantissa_bits ) - 1 ) ) | ( ( I{} + traits::exponent_bias ) << traits::mantissa_bits ) ); // in [1, 2)
+            I const large = m > static_cast<T>( 1.41421356237309504880 );
+            m = select( large, m * T{0.5}, m );
+            e = e - large;
+
+            P const f = m - T{1};
+            P const s = f / ( f + T{2} );
+            P const z = s * s;
+            P const log_m = s + s + s * z * horner( z, coefficients );
+            P const ef = __builtin_convertvector( e, P );
+            P ans = ef * traits::ln2_hi + ( log_m + ef * traits::ln2_lo );
+
+            ans = select( x == T{0}, broadcast<P>( -std::numeric_limits<T>::infinity() ), ans );
+            ans = select( x == std::numeric_limits<T>::infinity(), x, ans );
+            return select( ( x < T{0} ) | ( x != x ), broadcast<P>( std::numeric_limits<T>::quiet_NaN() ), ans );
+        }
+
+        template< Pack P >
+        P log1p( P x ) noexcept
+        {
+            typedef element_type<P> T;
+            P const u = x + T{1};
+            P const d = u - T{1};
+            P const ans = log( u ) * ( x / d ); // log(u) - ( (u-1) - x ) / u, to the first order
+            return select( ( d == T{0} ) | ( u == std::numeric_limits<T>::infinity() ), select( d == T{0}, x, u ), ans );
+        }
+
+        template< Pack P >
+        P tanh( P x ) noexcept
+        {
+            typedef element_type<P> T;
+            P const a = abs( x );
+            P const e = expm1( a + a );
+            P const ans = select( a > float_traits<T>::tanh_saturation, broadcast<P>( T{1} ), e / ( e + T{2} ) );
+            return copysign( ans, x );
+        }
+
+        template< Pack P >
+        P sigmoid( P x ) noexcept
+        {
+            typedef element_type<P> T;
+            return T{1} / ( T{1} + exp( -x ) );
+        }
+
+        template< Pack P >
+        P softplus( P x ) noexcept
+        {
+            typedef element_type<P> T;
+            return select( x > T{0}, x, P{} ) + log1p( exp( -abs( x ) ) );
+        }
+
+        template< Pack P >
+        P erf( P x ) noexcept
+        {
+            typedef element_type<P> T;
+            typedef float_traits<T> traits;
+            static constexpr auto coefficients = erf_coefficients<T, traits::erf_terms>();
+
+            auto const& center_coefficients = erf_center_coefficients<T, traits::erf_center_terms>();
+
+            P const small = x * horner( x * x, coefficients );
+            P const a = abs( x );
+            P const middle = horner( a - static_cast<T>( erf_center ), center_coefficients );
+
+            // erfc(a) = exp(-a^2) / sqrt(pi) / ( a + 1/2 / ( a + 1 / ( a + 3/2 / ( a + ... ) ) ) )
+            P fraction = a;
+            for ( unsigned long k = traits::erfc_depth; k != 0; --k )
+                fraction = a + static_cast<T>( 0.5 * static_cast<double>( k ) ) / fraction;
+            P large = T{1} - exp( -a * a ) / ( fraction * static_cast<T>( 1.77245385090551602730 ) );
+            large = select( a > traits::erf_saturation, broadcast<P>( T{1} ), large );
+
+            P const ans = select( a < static_cast<T>( erf_upper ), middle, large );
+            return select( a < static_cast<T>( erf_lower ), small, copysign( ans, x ) );
+        }
+    #endif
+    }//namespace vector_math_private
+
+    namespace vector_math
+    {
+        template< Pack P >
+        P exp( P x ) noexcept
+        {
+        #if defined(__GNUC__) || defined(__clang__)
+            if ( !vector_math_private::strict_math_enabled() )
+                return vector_math_private::exp( x );
+        #endif
+            return map_lanes( x, []( auto v ) noexcept { return std::exp( v ); } );
+        }
+
+        template< Pack P >
+        P expm1( P x ) noexcept
+        {
+        #if defined(__GNUC__) || defined(__clang__)
+            if ( !vector_math_private::strict_math_enabled() )
+                return vector_math_private::expm1( x );
+        #endif
+            return map_lanes( x, []( auto v ) noexcept { return std::expm1( v ); } );
+        }
+
+        template< Pack P >
+        P log( P x ) noexcept
+        {
+        #if defined(__GNUC__) || defined(__clang__)
+            if ( !vector_math_private::strict_math_enabled() )
+                return vector_math_private::log( x );
+        #endif
+            return map_lanes( x, []( auto v ) noexcept { return std::log( v ); } );
+        }
+
+        template< Pack P >
+        P log1p( P x ) noexcept
+        {
+        #if defined(__GNUC__) || defined(__clang__)
+            if ( !vector_math_private::strict_math_enabled() )
+                return vector_math_private::log1p( x );
+        #endif
+            return map_lanes( x, []( auto v ) noexcept { return std::log1p( v ); } );
+        }
+
+        template< Pack P >
+        P tanh( P x ) noexcept
+        {
+        #if defined(__GNUC__) || defined(__clang__)
+            if ( !vector_math_private::strict_math_enabled() )
+                return vector_math_private::tanh( x );
+        #endif
+            return map_lanes( x, []( auto v ) noexcept { return std::tanh( v ); } );
+        }
+
+        template< Pack P >
+        P sigmoid( P x ) noexcept
+        {
+        #if defined(__GNUC__) || defined(__clang__)
+            if ( !vector_math_private::strict_math_enabled() )
+                return vector_math_private::sigmoid( x );
+        #endif
+            return map_lanes( x, []( auto v ) noexcept { return decltype(v){1} / ( decltype(v){1} + std::exp( -v ) ); } );
+        }
+
+        template< Pack P >
+        P softplus( P x ) noexcept
+        {
+        #if defined(__GNUC__) || defined(__clang__)
+            if ( !vector_math_private::strict_math_enabled() )
+                return vector_math_private::softplus( x );
+        #endif
+            return map_lanes( x, []( auto v ) noexcept { return std::max( v, decltype(v){0} ) + std::log1p( std::exp( -std::abs( v ) ) ); } );
+        }
+
+        template< Pack P >
+        P erf( P x ) noexcept
+        {
+        #if defined(__GNUC__) || defined(__clang__)
+            if ( !vector_math_private::strict_math_enabled() )
+                return vector_math_private::erf( x );
+        #endif
+            return map_lanes( x, []( auto v ) noexcept { return std::erf( v ); } );
+        }
+
+        ///
+        /// @brief Writes func( in[i]... ) to out[i] for every i in [0, n), a pack of each input at a time, in parallel for the large arrays.
+        /// @param func A function of packs, such as `[]( auto x ){ return vector_math::exp( x ); }`.
+        ///
+        /// The last elements are computed in a pack padded with zeros. The output may be one of the inputs.
+        ///
+        template< std::floating_point T, typename Function, typename... Inputs >
+        void transform( Function const& func, unsigned long n, T* out, Inputs const*... ins )
+        {
+            static_assert( ( std::is_same_v<Inputs, T> && ... ), "vector_math::transform: expecting inputs of the type of the output." );
+            constexpr unsigned long width = lanes<T>;
+            constexpr unsigned long block = 1024; // elements of a task, multiple of the width
+            unsigned long const packs = n / width;
+
+            auto const& run_block = [&]( unsigned long b )
+            {
+                unsigned long const last = std::min( packs, ( b + 1 ) * ( block / width ) );
+                for ( unsigned long p = b * ( block / width ); p < last; ++p )
+                    store( out + p * width, func( load( ins + p * width )... ) );
+            };
+            parallel( run_block, 0UL, ( packs * width + block - 1 ) / block, 4UL );
+
+            if ( unsigned long const rest = n - packs * width; rest != 0 )
+            {
+                auto const& padded = [rest]( T const* ptr )
+                {
+                    std::array<T, width> buffer{};
+                    std::copy_n( ptr, rest, buffer.begin() );
+                    return load( buffer.data() );
+                };
+                std::array<T, width> buffer;
+                store( buffer.data(), func( padded( ins + packs * width )... ) );
+                std::copy_n( buffer.begin(), rest, out + packs * width );
+            }
+        }
+    }//namespace vector_math
+
+    #if defined(__GNUC__) && !defined(__clang__)
+    #pragma GCC pop_options
+    #endif
+
+}//namespace ceras::backend
+
+#endif//VECMATHHPPJWQZRKXMVNTYLOBUEADCFIHSPGJWQZRKXMVNTYLOBUEADCFIHSPGJWQZRKXMVNT
@@ -0,0 +1,431 @@
+#ifndef WINOGRADCONVHPPMVQZXKRNTYJLWOBUEADCFIHSPGMVQZXKRNTYJLWOBUEADCFIHSPGMVQZXKRN
+#define WINOGRADCONVHPPMVQZXKRNTYJLWOBUEADCFIHSPGMVQZXKRNTYJLWOBUEADCFIHSPGMVQZXKRN
+
+#include "../includes.hpp"
+#include "../config.hpp"
+#include "../utils/parallel.hpp"
+#include "./packed_gemm.hpp"
+#include "./conv2d_geometry.hpp"
+
+//
+// Winograd convolution F(m x m, 3 x 3) of NHWC tensors, for 3x3 kernels with unit strides and no dilation.
+//
+// The padded input is cut into overlapping tiles of (m+2) x (m+2) pixels, each of them producing m x m output pixels. With
+//
+//      V = B' d B      (input transform of a tile d)
+//      U = G g G'      (filter transform of a kernel g)
+//      Y = A' M A      (output transform)
+//
+// every one of the (m+2)^2 elements of the transformed domain is an independent GEMM M[xi] = V[xi] * U[xi], of [tiles x CH] by [CH x NC].
+// This takes (m+2)^2 / (9 m^2) of the multiplications of a direct convolution: 4/9 for m = 2 and 1/4 for m = 4.
+//
+// The backward passes are the adjoints of the same transforms:
+//
+//      dM = A dY A'    dV[xi] = dM[xi] * U[xi]'    dd = B dV B'    (input gradient)
+//                      dU[xi] = V[xi]' * dM[xi]    dg = G' dU G    (kernel gradient)
+//
+// Overlapping tiles of the input gradient are summed one row of tiles after the other, so the results do not depend on the number of threads.
+//
+
+namespace ceras::backend
+{
+
+    namespace winograd_private
+    {
+        template< unsigned long M >
+        struct winograd_traits;
+
+        // F(2x2, 3x3)
+        template<>
+        struct winograd_traits<2>
+        {
+            static constexpr unsigned long m = 2;
+            static constexpr unsigned long alpha = 4;
+            static constexpr double BT[4][4] = { { 1.0,  0.0, -1.0,  0.0 },
+                                                 { 0.0,  1.0,  1.0,  0.0 },
+                                                 { 0.0, -1.0,  1.0,  0.0 },
+                                                 { 0.0,  1.0,  0.0, -1.0 } };
+            static constexpr double G[4][3] = { { 1.0,  0.0, 0.0 },
+                                                { 0.5,  0.5, 0.5 },
+                                                { 0.5, -0.5, 0.5 },
+                                                { 0.0,  0.0, 1.0 } };
+            static constexpr double AT[2][4] = { { 1.0, 1.0,  1.0,  0.0 },
+                                                 { 0.0, 1.0, -1.0, -1.0 } };
+        };
+
+        // F(4x4, 3x3)
+        template<>
+        struct winograd_traits<4>
+        {
+            static constexpr unsigned long m = 4;
+            static constexpr unsigned long alpha = 6;
+            static constexpr double BT[6][6] = { { 4.0,  0.0, -5.0,  0.0, 1.0, 0.0 },
+                                                 { 0.0, -4.0, -4.0,  1.0, 1.0, 0.0 },
+                                                 { 0.0,  4.0, -4.0, -1.0, 1.0, 0.0 },
+                                                 { 0.0, -2.0, -1.0,  2.0, 1.0, 0.0 },
+                                                 { 0.0,  2.0, -1.0, -2.0, 1.0, 0.0 },
+                                                 { 0.0,  4.0,  0.0, -5.0, 0.0, 1.0 } };
+            static constexpr double G[6][3] = { {  1.0/4.0,   0.0,       0.0     },
+                                                { -1.0/6.0,  -1.0/6.0,  -1.0/6.0 },
+                                                { -1.0/6.0,   1.0/6.0,  -1.0/6.0 },
+                                                {  1.0/24.0,  1.0/12.0,  1.0/6.0 },
+                                                {  1.0/24.0, -1.0/12.0,  1.0/6.0 },
+                                                {  0.0,       0.0,       1.0     } };
+            static constexpr double AT[4][6] = { { 1.0, 1.0,  1.0, 1.0,  1.0, 0.0 },
+                                                 { 0.0, 1.0, -1.0, 2.0, -2.0, 0.0 },
+                                                 { 0.0, 1.0,  1.0, 4.0,  4.0, 0.0 },
+                                                 { 0.0, 1.0, -1.0, 8.0, -8.0, 1.0 } };
+        };
+
+        constexpr unsigned long channel_block = 64; // channels transformed together, the innermost and vectorized loop of the transforms
+
+        // out[i][j][:] = sum_{k, l} L[i][k] in[k][l][:] R[j][l], for I x J outputs from K x L inputs, each a vector of n <= channel_block elements
+        template< unsigned long I, unsigned long J, unsigned long K, unsigned long L, typename T >
+        void transform( double const (&left)[I][K], T const* in, double const (&right)[J][L], T* out, unsigned long n ) noexcept
+        {
+            T tmp[I][L][channel_block];
+            for ( unsigned long i = 0; i != I; ++i )
+                for ( unsigned long l = 0; l != L; ++l )
+                {
+                    std::fill_n( tmp[i][l], n, T{0} );
+                    for ( unsigned long k = 0; k != K; ++k )
+                    {
+                        if ( left[i][k] == 0.0 ) continue;
+                        T const factor = static_cast<T>( left[i][k] );
+                        T const* src = in + ( k * L + l ) * channel_block;
+                        for ( unsigned long c = 0; c != n; ++c )
+                            tmp[i][l][c] += factor * src[c];
+                    }
+                }
+            for ( unsigned long i = 0; i != I; ++i )
+                for ( unsigned long j = 0; j != J; ++j )
+                {
+                    T* dst = out + ( i * J + j ) * channel_block;
+                    std::fill_n( dst, n, T{0} );
+                    for ( unsigned long l = 0; l != L; ++l )
+                    {
+                        if ( right[j][l] == 0.0 ) continue;
+                        T const factor = static_cast<T>( right[j][l] );
+                        for ( unsigned long c = 0; c != n; ++c )
+                            dst[c] += factor * tmp[i][l][c];
+                    }
+                }
+        }
+
+        // a small matrix, returned by `transpose`
+        template< unsigned long R, unsigned long C >
+        struct matrix
+        {
+            double data[R][C];
+        };
+
+        // the transpose of a small matrix
+        template< unsigned long R, unsigned long C >
+        constexpr matrix<C, R> transpose( double const (&x)[R][C] ) noexcept
+        {
+            matrix<C, R> ans{};
+            for ( unsigned long r = 0; r != R; ++r )
+                for ( unsigned long c = 0; c != C; ++c )
+                    ans.data[c][r] = x[r][c];
+            return ans;
+        }
+
+        // C[xi] <= op(A[xi]) * op(B[xi]) for the `batch` elements of the transformed domain, in tasks of at most `block` rows
+        template< typename T >
+        void batched_product( T const* A, bool a_transposed, unsigned long a_stride, T const* B, bool b_transposed, unsigned long b_stride,
+                              unsigned long batch, unsigned long m, unsigned long n, unsigned long k, T* C, unsigned long block = 256 )
+        {
+            unsigned long const blocks = ( m + block - 1 ) / block;
+            parallel( [&]( unsigned long task )
+            {
+                unsigned long const xi = task / blocks;
+                unsigned long const row = ( task % blocks ) * block;
+                unsigned long const rows = std::min( block, m - row );
+                T const* a = a_transposed ? A + xi * a_stride + row : A + xi * a_stride + row * n;
+                packed_gemm( a, a_transposed ? m : n, a_transposed, B + xi * b_stride, b_transposed ? n : k, b_transposed, rows, n, k, C + xi * m * k + row * k, k );
+            }, 0UL, batch * blocks, 1UL );
+        }
+    }//namespace winograd_private
+
+    ///
+    /// @brief Buffers of the Winograd convolution, kept between calls.
+    ///
+    template< typename T >
+    struct winograd_conv2d_workspace
+    {
+        std::vector<T> padded_input;        ///< zero-padded input
+        std::vector<T> filter_transform;    ///< U, as [(m+2)^2, CH, NC]
+        std::vector<T> input_transform;     ///< V, as [(m+2)^2, tiles, CH], kept for the kernel gradient
+        std::vector<T> product;             ///< M, or dM in the backward pass, as [(m+2)^2, tiles, NC]
+        std::vector<T> input_gradient_transform; ///< dV, as [(m+2)^2, tiles, CH]
+        std::vector<T> filter_gradient_transform; ///< dU, as [(m+2)^2, CH, NC]
+        std::vector<T> padded_gradient;     ///< gradient of the padded input
+    };
+
+    ///
+    /// @brief Returns true if the Winograd convolution handles this kernel: 3x3 kernels with unit strides, no dilation, and a padding of at most 2.
+    ///
+    inline bool is_winograd_conv2d( conv2d_geometry const& g ) noexcept
+    {
+        return g.kernel_rows == 3 && g.kernel_cols == 3 && g.row_stride == 1 && g.col_stride == 1 && g.row_dilation == 1 && g.col_dilation == 1 &&
+               g.row_padding < 3 && g.col_padding < 3;
+    }
+
+    ///
+    /// @brief Filter transform U = G g G' of the Winograd convolution F(M x M, 3 x 3).
+    /// @param kernel Kernels of [NC, CH, 3, 3], the element (nc, ch, kh, kw) at `kernel[(nc*CH+ch)*9+kh*3+kw]`, see `conv2d_geometry`.
+    /// @param filter_transform U, resized to [(M+2)^2, CH, NC].
+    ///
+    template< unsigned long M, typename T > requires std::floating_point<T>
+    void winograd_filter_transform( T const* kernel, conv2d_geometry const& g, std::vector<T>& filter_transform )
+    {
+        using namespace winograd_private;
+        typedef winograd_traits<M> traits;
+        constexpr unsigned long alpha = traits::alpha;
+        unsigned long const channels = g.channels;
+        unsigned long const new_channels = g.new_channels;
+
+        filter_transform.resize( alpha * alpha * channels * new_channels );
+        T* U = filter_transform.data();
+        parallel( [&]( unsigned long nc )
+        {
+            T g_tile[3*3*channel_block];
+            T u_tile[alpha*alpha*channel_block];
+            for ( unsigned long ch = 0; ch < channels; ch += channel_block )
+            {
+                unsigned long const n = std::min( channel_block, channels - ch );
+                for ( unsigned long t = 0; t != 9; ++t )
+                    for ( unsigned long c = 0; c != n; ++c )
+                        g_tile[t*channel_block+c] = kernel[( nc * channels + ch + c ) * 9 + t];
+                transform( traits::G, g_tile, traits::G, u_tile, n );
+                for ( unsigned long xi = 0; xi != alpha * alpha; ++xi )
+                    for ( unsigned long c = 0; c != n; ++c )
+                        U[( xi * channels + ch + c ) * new_channels + nc] = u_tile[xi*channel_block+c];
+            }
+        }, 0UL, new_channels );
+    }
+
+    ///
+    /// @brief Forward pass of the Winograd convolution F(M x M, 3 x 3).
+    /// @param input NHWC input of [BS, R, C, CH].
+    /// @param output NHWC output of [BS, new_R, new_C, NC], overwritten.
+    /// @param workspace Buffers, whose `filter_transform` holds U from `winograd_filter_transform`.
+    ///
+    template< unsigned long M, typename T > requires std::floating_point<T>
+    void winograd_conv2d( T const* input, conv2d_geometry const& g, T* output, winograd_conv2d_workspace<T>& workspace )
+    {
+        using namespace winograd_private;
+        typedef winograd_traits<M> traits;
+        constexpr unsigned long alpha = traits::alpha;
+        constexpr unsigned long xis = alpha * alpha;
+        unsigned long const channels = g.channels;
+        unsigned long const new_channels = g.new_channels;
+        unsigned long const output_rows = g.output_rows();
+        unsigned long const output_cols = g.output_cols();
+        unsigned long const padded_rows = g.padded_rows();
+        unsigned long const padded_cols = g.padded_cols();
+        unsigned long const tile_rows = ( output_rows + M - 1 ) / M;
+        unsigned long const tile_cols = ( output_cols + M - 1 ) / M;
+        unsigned long const tiles = g.batch * tile_rows * tile_cols;
+
+        T const* padded = pad_conv2d_input( input, g, workspace.padded_input );
+
+        // V[xi][tile][ch]
+        workspace.input_transform.resize( xis * tiles * channels );
+        T* V = workspace.input_transform.data();
+        parallel( [&]( unsigned long tile )
+        {
+            unsigned long const b = tile / ( tile_rows * tile_cols );
+            unsigned long const row = ( tile / tile_cols ) % tile_rows * M;
+            unsigned long const col = tile % tile_cols * M;
+            T d_tile[xis*channel_block];
+            T v_tile[xis*channel_block];
+            for ( unsigned long ch = 0; ch < channels; ch += channel_block )
+            {
+                unsigned long const n = std::min( channel_block, channels - ch );
+                for ( unsigned long i = 0; i != alpha; ++i )
+                    for ( unsigned long j = 0; j != alpha; ++j )
+                    {
+                        T* dst = d_tile + ( i * alpha + j ) * channel_block;
+                        if ( row + i < padded_rows && col + j < padded_cols ) // the last tiles may cross the border
+                            std::copy_n( padded + ( ( b * padded_rows + row + i ) * padded_cols + col + j ) * channels + ch, n, dst );
+                        else
+                            std::fill_n( dst, n, T{0} );
+                    }
+                transform( traits::BT, d_tile, traits::BT, v_tile, n );
+                for ( unsigned long xi = 0; xi != xis; ++xi )
+                    std::copy_n( v_tile + xi * channel_block, n, V + ( xi * tiles + tile ) * channels + ch );
+            }
+        }, 0UL, tiles, 1UL );
+
+        // M[xi] = V[xi] * U[xi]
+        workspace.product.resize( xis * tiles * new_channels );
+        T* product = workspace.product.data();
+        batched_product( V, false, tiles * channels, workspace.filter_transform.data(), false, channels * new_channels, xis, tiles, channels, new_channels, product );
+
+        // Y = A' M A
+        parallel( [&]( unsigned long tile )
+        {
+            unsigned long const b = tile / ( tile_rows * tile_cols );
+            unsigned long const row = ( tile / tile_cols ) % tile_rows * M;
+            unsigned long const col = tile % tile_cols * M;
+            T m_tile[xis*channel_block];
+            T y_tile[M*M*channel_block];
+            for ( unsigned long nc = 0; nc < new_channels; nc += channel_block )
+            {
+                unsigned long const n = std::min( channel_block, new_channels - nc );
+                for ( unsigned long xi = 0; xi != xis; ++xi )
+                    std::copy_n( product + ( xi * tiles + tile ) * new_channels + nc, n, m_tile + xi * channel_block );
+                transform( traits::AT, m_tile, traits::AT, y_tile, n );
+                for ( unsigned long i = 0; i != M && row + i != output_rows; ++i )
+                    for ( unsigned long j = 0; j != M && col + j != output_cols; ++j )
+                        std::copy_n( y_tile + ( i * M + j ) * channel_block, n, output + ( ( b * output_rows + row + i ) * output_cols + col + j ) * new_channels + nc );
+            }
+        }, 0UL, tiles, 1UL );
+    }
+
+    ///
+    /// @brief Backward pass of the Winograd convolution F(M x M, 3 x 3), following `winograd_conv2d` on the same input.
+    /// @param grad NHWC gradient of the output, [BS, new_R, new_C, NC].
+    /// @param kernel Kernels of [NC, CH, 3, 3], the element (nc, ch, kh, kw) at `kernel[(nc*CH+ch)*9+kh*3+kw]`, see `conv2d_geometry`.
+    /// @param input_grad NHWC gradient of the input, [BS, R, C, CH]. Overwritten, or accumulated onto if `accumulate_input` is true.
+    /// @param kernel_grad Gradient of the kernels, [NC, CH, 3, 3] as `kernel`. Overwritten, or accumulated onto if `accumulate_kernel` is true.
+    ///
+    template< unsigned long M, typename T > requires std::floating_point<T>
+    void winograd_conv2d_backward( T const* grad, conv2d_geometry const& g, T* input_grad, bool accumulate_input, T* kernel_grad, bool accumulate_kernel,
+                                   winograd_conv2d_workspace<T>& workspace )
+    {
+        using namespace winograd_private;
+        typedef winograd_traits<M> traits;
+        constexpr unsigned long alpha = traits::alpha;
+        constexpr unsigned long xis = alpha * alpha;
+        constexpr matrix<alpha, M> A = transpose( traits::AT );
+        constexpr matrix<alpha, alpha> B = transpose( traits::BT );
+        constexpr matrix<3, alpha> GT = transpose( traits::G );
+        unsigned long const channels = g.channels;
+        unsigned long const new_channels = g.new_channels;
+        unsigned long const output_rows = g.output_rows();
+        unsigned long const output_cols = g.output_cols();
+        unsigned long const padded_rows = g.padded_rows();
+        unsigned long const padded_cols = g.padded_cols();
+        unsigned long const tile_rows = ( output_rows + M - 1 ) / M;
+        unsigned long const tile_cols = ( output_cols + M - 1 ) / M;
+        unsigned long const tiles = g.batch * tile_rows * tile_cols;
+
+        // dM = A dY A'
+        workspace.product.resize( xis * tiles * new_channels );
+        T* product = workspace.product.data();
+        parallel( [&]( unsigned long tile )
+        {
+            unsigned long const b = tile / ( tile_rows * tile_cols );
+            unsigned long const row = ( tile / tile_cols ) % tile_rows * M;
+            unsigned long const col = tile % tile_cols * M;
+            T y_tile[M*M*channel_block];
+            T m_tile[xis*channel_block];
+            for ( unsigned long nc = 0; nc < new_channels; nc += channel_block )
+            {
+                unsigned long const n = std::min( channel_block, new_channels - nc );
+                for ( unsigned long i = 0; i != M; ++i )
+                    for ( unsigned long j = 0; j != M; ++j )
+                    {
+                        T* dst = y_tile + ( i * M + j ) * channel_block;
+                        if ( row + i < output_rows && col + j < output_cols )
+                            std::copy_n( grad + ( ( b * output_rows + row + i ) * output_cols + col + j ) * new_channels + nc, n, dst );
+                        else
+                            std::fill_n( dst, n, T{0} );
+                    }
+                transform( A.data, y_tile, A.data, m_tile, n );
+                for ( unsigned long xi = 0; xi != xis; ++xi )
+                    std::copy_n( m_tile + xi * channel_block, n, product + ( xi * tiles + tile ) * new_channels + nc );
+            }
+        }, 0UL, tiles, 1UL );
+
+        // dU[xi] = V[xi]' * dM[xi], then dg = G' dU G
+        workspace.filter_gradient_transform.resize( xis * channels * new_channels );
+        T* dU = workspace.filter_gradient_transform.data();
+        batched_product( workspace.input_transform.data(), true, tiles * channels, product, false, tiles * new_channels, xis, channels, tiles, new_channels, dU );
+        parallel( [&]( unsigned long nc )
+        {
+            T u_tile[xis*channel_block];
+            T g_tile[3*3*channel_block];
+            for ( unsigned long ch = 0; ch < channels; ch += channel_block )
+            {
+                unsigned long const n = std::min( channel_block, channels - ch );
+                for ( unsigned long xi = 0; xi != xis; ++xi )
+                    for ( unsigned long c = 0; c != n; ++c )
+                        u_tile[xi*channel_block+c] = dU[( xi * channels + ch + c ) * new_channels + nc];
+                transform( GT.data, u_tile, GT.data, g_tile, n );
+                for ( unsigned long t = 0; t != 9; ++t )
+                    for ( unsigned long c = 0; c != n; ++c )
+                    {
+                        T& dst = kernel_grad[( nc * channels + ch + c ) * 9 + t];
+                        dst = accumulate_kernel ? dst + g_tile[t*channel_block+c] : g_tile[t*channel_block+c];
+                    }
+            }
+        }, 0UL, new_channels );
+
+        // dV[xi] = dM[xi] * U[xi]'
+        workspace.input_gradient_transform.resize( xis * tiles * channels );
+        T* dV = workspace.input_gradient_transform.data();
+        batched_product( product, false, tiles * new_channels, workspace.filter_transform.data(), true, channels * new_channels, xis, tiles, new_channels, channels, dV );
+
+        // dd = B dV B', the overlapping tiles summed into the gradient of the padded input
+        bool const direct_output = !g.padded() && !accumulate_input;
+        unsigned long const row_size = padded_cols * channels;
+        if ( !direct_output )
+            workspace.padded_gradient.resize( g.batch * padded_rows * row_size );
+        T* padded_grad = direct_output ? input_grad : workspace.padded_gradient.data();
+        std::fill_n( padded_grad, g.batch * padded_rows * row_size, T{0} );
+
+        // a row of tiles overlaps with its neighbours only: the even rows of tiles go first, then the odd rows
+        for ( unsigned long phase = 0; phase != 2; ++phase )
+            parallel( [&]( unsigned long task )
+            {
+                unsigned long const b = task / ( ( tile_rows + 1 ) / 2 );
+                unsigned long const tile_row = task % ( ( tile_rows + 1 ) / 2 ) * 2 + phase;
+                if ( tile_row >= tile_rows ) return;
+                unsigned long const row = tile_row * M;
+                T v_tile[xis*channel_block];
+                T d_tile[xis*channel_block];
+                for ( unsigned long tile_col = 0; tile_col != tile_cols; ++tile_col )
+                {
+                    unsigned long const tile = ( b * tile_rows + tile_row ) * tile_cols + tile_col;
+                    unsigned long const col = tile_col * M;
+                    for ( unsigned long ch = 0; ch < channels; ch += channel_block )
+                    {
+                        unsigned long const n = std::min( channel_block, channels - ch );
+                        for ( unsigned long xi = 0; xi != xis; ++xi )
+                            std::copy_n( dV + ( xi * tiles + tile ) * channels + ch, n, v_tile + xi * channel_block );
+                        transform( B.data, v_tile, B.data, d_tile, n );
+                        for ( unsigned long i = 0; i != alpha && row + i != padded_rows; ++i )
+                            for ( unsigned long j = 0; j != alpha && col + j != padded_cols; ++j )
+                            {
+                                T* dst = padded_grad + ( ( b * padded_rows + row + i ) * padded_cols + col + j ) * channels + ch;
+                                T const* src = d_tile + ( i * alpha + j ) * channel_block;
+                                for ( unsigned long c = 0; c != n; ++c )
+                                    dst[c] += src[c];
+                            }
+                    }
+                }
+            }, 0UL, g.batch * ( ( tile_rows + 1 ) / 2 ), 1UL );
+
+        if ( direct_output )
+            return;
+
+        parallel( [&]( unsigned long task ) // crops the padding
+        {
+            unsigned long const b = task / g.rows;
+            unsigned long const r = task % g.rows;
+            T const* src = padded_grad + ( ( b * padded_rows + r + g.row_padding ) * padded_cols + g.col_padding ) * channels;
+            T* dst = input_grad + task * g.cols * channels;
+            if ( accumulate_input )
+                for ( unsigned long idx = 0; idx != g.cols * channels; ++idx )
+                    dst[idx] += src[idx];
+            else
+                std::copy_n( src, g.cols * channels, dst );
+        }, 0UL, g.batch * g.rows );
+    }
+
+}//namespace ceras::backend
+
+#endif//WINOGRADCONVHPPMVQZXKRNTYJLWOBUEADCFIHSPGMVQZXKRNTYJLWOBUEADCFIHSPGMVQZXKRN
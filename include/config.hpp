@@ -53,6 +53,9 @@ namespace ceras
 
     inline int visible_device = 0; // using GPU 0 by default
     inline unsigned long cuda_gemm_threshold = 0UL; // will be updated if in CUDA mode, always assume float multiplications as double is rearly used
+    inline int gemm_autotuning = 1; // 1 to tune the CPU GEMM for each shape class on first use, see './backend/gemm_autotuner.hpp'
+    inline int conv2d_autotuning = 1; // 1 to time the algorithms of the convolutions of the compiled models, see './backend/conv2d_autotuner.hpp'
+    inline int strict_math = 0; // 1 to evaluate exp, log, tanh and the other transcendental functions with the C library, see './backend/vector_math.hpp'
 
     inline constexpr double eps = 1.0e-8;
     inline constexpr double epsilon = eps; // alias of `eps`
@@ -0,0 +1,334 @@
+#ifndef FOLDINGHPPKXQWZVRMNTJYLOBUEADCFIHSPGKXQWZVRMNTJYLOBUEADCFIHSPGKXQWZVRMNTJ
+#define FOLDINGHPPKXQWZVRMNTJYLOBUEADCFIHSPGKXQWZVRMNTJYLOBUEADCFIHSPGKXQWZVRMNTJ
+
+#include "./includes.hpp"
+#include "./config.hpp"
+#include "./tensor.hpp"
+#include "./variable.hpp"
+#include "./utils/singleton.hpp"
+#include "./utils/parallel.hpp"
+#include "./utils/range.hpp"
+
+//
+// Inference-time folding of the per-channel operators following a Conv2D or a Dense into its weights.
+//
+// At inference, a chain such as
+//
+//      conv2d -> plus (bias) -> normalization_batch -> elementwise_product (gamma) -> plus (beta) -> relu
+//
+// computes act( conv(x, W) * s + t ), with s and t per output channel. Folded, the convolution runs with the kernel W * s, and adds t and applies the
+// activation in a single pass over its output, while the other operators of the chain pass their input through.
+//
+// A chain starts at a conv2d, or at a dense without activation, and goes on with any number of additions and multiplications by per-channel variables
+// or constants, and of batch normalizations, optionally closed by a relu or a leaky_relu. Every intermediate result must be read by the next operator only.
+//
+// The chains are found by tracing one inference: every operator reports the tensors it reads, and the foldable ones report what they compute.
+// A folded chain is dropped as soon as a variable is modified (see `variable_data_generation`), for example by an optimizer.
+//
+
+namespace ceras
+{
+
+    ///
+    /// @brief The activation closing a folded chain.
+    ///
+    enum class folded_activation
+    {
+        linear,
+        relu,
+        leaky_relu
+    };
+
+    ///
+    /// @brief A Conv2D or a Dense with the per-channel operators and the activation following it folded in.
+    ///
+    struct folded_chain
+    {
+        bool active = false;
+        unsigned long generation = 0;   ///< `variable_data_generation` when folded
+        std::any kernel;                ///< folded weights, a tensor of the shape of the weights
+        std::any bias;                  ///< per-channel shift, a tensor of NC elements
+        folded_activation activation = folded_activation::linear;
+        double factor = 0.0;            ///< for leaky_relu
+    };
+
+    ///
+    /// @brief Folding state of a foldable operator.
+    ///
+    struct folding_state
+    {
+        std::shared_ptr<folded_chain> chain;    ///< set when the operator is part of a folded chain
+        unsigned long operand = 0;              ///< the input an operator inside the chain passes through
+
+        ///
+        /// @brief True for the first operator of an up-to-date chain, at inference. A chain whose variables have been modified since is dropped.
+        ///
+        bool folded_head() const noexcept
+        {
+            if ( learning_phase != 0 || !chain || !chain->active )
+                return false;
+            if ( chain->generation != variable_data_generation )
+                chain->active = false;
+            return chain->active;
+        }
+
+        ///
+        /// @brief True for the other operators of an up-to-date chain, at inference. The first operator runs before them, and drops the chain if out of date.
+        ///
+        bool folded() const noexcept
+        {
+            return learning_phase == 0 && chain && chain->active;
+        }
+    };
+
+    ///
+    /// @brief Foldable operators.
+    ///
+    enum class folding_kind
+    {
+        conv2d,         // tensors: kernel [NC, ...]
+        dense,          // tensors: w [N, NC], b [NC]
+        plus,           // tensors: lhs, rhs
+        multiply,       // tensors: lhs, rhs
+        normalization,  // tensors: average, variance, or none before the first training
+        relu,
+        leaky_relu
+    };
+
+    ///
+    /// @brief A tensor met while tracing, its data and the number of the operators having written to this data in place before.
+    ///
+    typedef std::pair<void const*, unsigned long> traced_tensor;
+
+    struct folding_record
+    {
+        folding_kind kind;
+        std::shared_ptr<folding_state> state;
+        std::array<traced_tensor, 2> inputs;
+        traced_tensor output;
+        std::vector<std::any> tensors;
+        double factor = 0.0;
+    };
+
+    ///
+    /// @brief Operators met while tracing an inference.
+    ///
+    struct folding_trace
+    {
+        bool active = false;
+        std::map<void const*, unsigned long> versions;  ///< number of the recorded operators having written to every data in place, as `add` does
+        std::map<traced_tensor, unsigned long> readers; ///< number of operators reading every tensor
+        std::set<void const*> parameters;               ///< the tensors of the variables, constants and values
+        std::vector<folding_record> records;
+
+        traced_tensor traced( void const* data )
+        {
+            return { data, data ? versions[data] : 0UL };
+        }
+
+        template< Tensor Tsor >
+        void read( Tsor const& tensor, bool parameter )
+        {
+            ++readers[traced( tensor.data() )];
+            if ( parameter )
+                parameters.insert( tensor.data() );
+        }
+
+        template< Tensor Tsor >
+        void record( folding_kind kind, std::shared_ptr<folding_state> const& state, Tsor const& input, Tsor const* other_input, Tsor const& output,
+                     std::vector<std::any> tensors = {}, double factor = 0.0 )
+        {
+            std::array<traced_tensor, 2> const inputs{ traced( input.data() ), traced( other_input ? other_input->data() : nullptr ) };
+            if ( output.data() == inputs[0].first || output.data() == inputs[1].first )
+                ++versions[output.data()];
+            records.push_back( folding_record{ kind, state, inputs, traced( output.data() ), std::move( tensors ), factor } );
+        }
+
+        void clear()
+        {
+            versions.clear();
+            readers.clear();
+            parameters.clear();
+            records.clear();
+        }
+    };
+
+    inline folding_trace& get_folding_trace()
+    {
+        return singleton<folding_trace>::instance();
+    }
+
+    namespace ceras_private
+    {
+        // the next operator of a chain, reading `current` of `channels` channels, or nullptr
+        template< Tensor Tsor >
+        folding_record const* next_folding_record( folding_trace const& trace, traced_tensor const& current, unsigned long channels )
+        {
+            if ( auto itor = trace.readers.find( current ); itor == trace.readers.end() || itor->second != 1 )
+                return nullptr;
+
+            for ( auto const& r : trace.records )
+            {
+                if ( r.kind == folding_kind::conv2d || r.kind == folding_kind::dense || r.state->chain )
+                    continue;
+                if ( r.kind == folding_kind::plus || r.kind == folding_kind::multiply )
+                {
+                    for ( unsigned long operand : { 0UL, 1UL } )
+                    {
+                        Tsor const& parameter = std::any_cast<Tsor const&>( r.tensors[1-operand] );
+                        if ( r.inputs[operand] == current && trace.parameters.contains( r.inputs[1-operand].first ) &&
+                             parameter.size() == channels && *(parameter.shape().rbegin()) == channels && *(std::any_cast<Tsor const&>( r.tensors[operand] ).shape().rbegin()) == channels )
+                        {
+                            r.state->operand = operand;
+                            return &r;
+                        }
+                    }
+                    continue;
+                }
+                if ( r.inputs[0] == current )
+                    return &r;
+            }
+            return nullptr;
+        }
+    }//namespace ceras_private
+
+    ///
+    /// @brief Starts tracing an inference.
+    ///
+    inline void begin_folding_trace()
+    {
+        auto& trace = get_folding_trace();
+        trace.clear();
+        trace.active = true;
+    }
+
+    ///
+    /// @brief Stops tracing, and folds the chains met in the traced inference.
+    /// @return The states of the folded operators.
+    ///
+    template< Tensor Tsor >
+    std::vector<std::shared_ptr<folding_state>> end_folding_trace()
+    {
+        typedef typename Tsor::value_type value_type;
+        auto& trace = get_folding_trace();
+        trace.active = false;
+
+        std::vector<std::shared_ptr<folding_state>> states;
+        for ( auto const& head : trace.records )
+        {
+            if ( head.kind != folding_kind::conv2d && head.kind != folding_kind::dense )
+                continue;
+
+            Tsor const& kernel = std::any_cast<Tsor const&>( head.tensors[0] );
+            bool const dense = head.kind == folding_kind::dense;
+            unsigned long const channels = dense ? *(kernel.shape().rbegin()) : *(kernel.shape().begin());
+
+            // act( y * scale + shift )
+            std::vector<double> scale( channels, 1.0 );
+            std::vector<double> shift( channels, 0.0 );
+            if ( dense )
+            {
+                Tsor const& bias = std::any_cast<Tsor const&>( head.tensors[1] );
+                std::copy( bias.begin(), bias.end(), shift.begin() );
+            }
+            auto chain = std::make_shared<folded_chain>();
+            std::vector<std::shared_ptr<folding_state>> members;
+            traced_tensor current = head.output;
+            while ( auto r = ceras_private::next_folding_record<Tsor>( trace, current, channels ) )
+            {
+                if ( r->kind == folding_kind::plus || r->kind == folding_kind::multiply )
+                {
+                    Tsor const& parameter = std::any_cast<Tsor const&>( r->tensors[1-r->state->operand] );
+                    for ( auto c : range( channels ) )
+                    {
+                        if ( r->kind == folding_kind::plus )
+                            shift[c] += parameter[c];
+                        else
+                        {
+                            scale[c] *= parameter[c];
+                            shift[c] *= parameter[c];
+                        }
+                    }
+                }
+                else if ( r->kind == folding_kind::normalization && !r->tensors.empty() )
+                {
+                    Tsor const& average = std::any_cast<Tsor const&>( r->tensors[0] );
+                    Tsor const& variance = std::any_cast<Tsor const&>( r->tensors[1] );
+                    for ( auto c : range( channels ) )
+                    {
+                        double const deviation = std::sqrt( variance[c] + eps );
+                        scale[c] /= deviation;
+                        shift[c] = ( shift[c] - average[c] ) / deviation;
+                    }
+                }
+                else if ( r->kind == folding_kind::relu || r->kind == folding_kind::leaky_relu )
+                {
+                    chain->activation = r->kind == folding_kind::relu ? folded_activation::relu : folded_activation::leaky_relu;
+                    chain->factor = r->factor;
+                }
+
+                r->state->chain = chain;
+                members.push_back( r->state );
+                current = r->output;
+                if ( chain->activation != folded_activation::linear )
+                    break;
+            }
+
+            if ( members.empty() )
+                continue;
+
+            Tsor folded_kernel = kernel.deep_copy();
+            unsigned long const depth = kernel.size() / channels;
+            for ( auto idx : range( kernel.size() ) )
+                folded_kernel[idx] = static_cast<value_type>( kernel[idx] * scale[dense ? idx % channels : idx / depth] );
+            Tsor folded_bias{ {channels,} };
+            std::copy( shift.begin(), shift.end(), folded_bias.begin() );
+            chain->kernel = folded_kernel;
+            chain->bias = folded_bias;
+            chain->generation = variable_data_generation;
+            chain->active = true;
+
+            head.state->chain = chain;
+            states.push_back( head.state );
+            states.insert( states.end(), members.begin(), members.end() );
+        }
+
+        trace.clear();
+        return states;
+    }
+
+    ///
+    /// @brief Applies the shift and the activation of a folded chain to the [..., NC] output of its first operator, in place.
+    ///
+    template< Tensor Tsor >
+    void apply_folded_epilogue( folded_chain const& chain, Tsor& output )
+    {
+        typedef typename Tsor::value_type value_type;
+        Tsor const& bias = std::any_cast<Tsor const&>( chain.bias );
+        unsigned long const channels = bias.size();
+        unsigned long const pixels = output.size() / channels;
+        value_type const* b = bias.data();
+        value_type* o = output.data();
+        value_type const factor = static_cast<value_type>( chain.factor );
+        folded_activation const activation = chain.activation;
+        parallel( [=]( unsigned long p )
+        {
+            value_type* row = o + p * channels;
+            switch ( activation )
+            {
+                case folded_activation::linear:
+                    for ( unsigned long c = 0; c != channels; ++c ) row[c] += b[c];
+                    break;
+                case folded_activation::relu:
+                    for ( unsigned long c = 0; c != channels; ++c ) row[c] = std::max( value_type{row[c] + b[c]}, value_type{0} );
+                    break;
+                case folded_activation::leaky_relu:
+                    for ( unsigned long c = 0; c != channels; ++c ) { value_type const x = row[c] + b[c]; row[c] = std::max( x, value_type{factor*x} ); }
+                    break;
+            }
+        }, 0UL, pixels, 256UL );
+    }
+
+}//namespace ceras
+
+#endif//FOLDINGHPPKXQWZVRMNTJYLOBUEADCFIHSPGKXQWZVRMNTJYLOBUEADCFIHSPGKXQWZVRMNTJ
@@ -0,0 +1,317 @@
+#ifndef FUSIONHPPMVQZKXWRJNTYLOBUEADCFIHSPGMVQZKXWRJNTYLOBUEADCFIHSPGMVQZKXWRJNTY
+#define FUSIONHPPMVQZKXWRJNTYLOBUEADCFIHSPGMVQZKXWRJNTYLOBUEADCFIHSPGMVQZKXWRJNTY
+
+#include "./includes.hpp"
+#include "./operation.hpp"
+#include "./tensor.hpp"
+#include "./utils/for_each.hpp"
+#include "./utils/context_cast.hpp"
+#include "./utils/better_assert.hpp"
+
+//
+// Fusion of the chains of elementwise operators.
+//
+// An activation such as `exp( negative( square( x ) ) )` is three operators: each allocates its output, streams the whole tensor through the memory,
+// and keeps its input for the backward pass. Fused, the chain is a single operator computing the composite value in one loop, and the composite
+// derivative in one loop of the backward pass, from the input of the chain alone.
+//
+// The chain is written once, as a generic function of the elements, and evaluated on dual numbers: a `dual<T, N>` carries a value and its derivatives
+// with respect to the N inputs of the chain. The forward pass evaluates it on `dual<T, 0>`, the value only, and the backward pass on `dual<T, 1>` or
+// `dual<T, 2>`, the value and the local derivatives, which are multiplied by the incoming gradient. No intermediate tensor is stored.
+//
+// \code{.cpp}
+// auto y = fuse( []( auto x ){ return exp( -square( x ) ); } )( ex );                      // gaussian
+// auto z = fuse( []( auto a, auto b ){ return square( log( a ) - log( b ) ); } )( ea, eb ); // binary, broadcasting as `plus`
+// \endcode
+//
+
+namespace ceras
+{
+
+    namespace fusion
+    {
+
+        ///
+        /// @brief A value, and its derivatives with respect to the N inputs of a fused chain.
+        ///
+        template< std::floating_point T, unsigned long N >
+        struct dual
+        {
+            T primal;
+            std::array<T, N> derivative;
+        };
+
+        template< typename S >
+        concept Scalar = std::is_arithmetic_v<S>;
+
+        // f(x) of value `f` and of derivative `df` with respect to x, the derivatives of x following by the chain rule
+        template< std::floating_point T, unsigned long N >
+        constexpr dual<T, N> chain( dual<T, N> const& x, T f, T df ) noexcept
+        {
+            dual<T, N> ans{ f, {} };
+            for ( unsigned long idx = 0; idx != N; ++idx )
+                ans.derivative[idx] = df * x.derivative[idx];
+            return ans;
+        }
+
+        // f(x, y) of value `f` and of partial derivatives `dfx` and `dfy`
+        template< std::floating_point T, unsigned long N >
+        constexpr dual<T, N> chain( dual<T, N> const& x, dual<T, N> const& y, T f, T dfx, T dfy ) noexcept
+        {
+            dual<T, N> ans{ f, {} };
+            for ( unsigned long idx = 0; idx != N; ++idx )
+                ans.derivative[idx] = dfx * x.derivative[idx] + dfy * y.derivative[idx];
+            return ans;
+        }
+
+        template< std::floating_point T, unsigned long N >
+        constexpr dual<T, N> operator + ( dual<T, N> const& x, dual<T, N> const& y ) noexcept { return chain( x, y, x.primal+y.primal, T{1}, T{1} ); }
+
+        template< std::floating_point T, unsigned long N, Scalar S >
+        constexpr dual<T, N> operator + ( dual<T, N> const& x, S s ) noexcept { return chain( x, x.primal+static_cast<T>(s), T{1} ); }
+
+        template< std::floating_point T, unsigned long N, Scalar S >
+        constexpr dual<T, N> operator + ( S s, dual<T, N> const& x ) noexcept { return x + s; }
+
+        template< std::floating_point T, unsigned long N >
+        constexpr dual<T, N> operator - ( dual<T, N> const& x ) noexcept { return chain( x, -x.primal, T{-1} ); }
+
+        template< std::floating_point T, unsigned long N >
+        constexpr dual<T, N> operator - ( dual<T, N> const& x, dual<T, N> const& y ) noexcept { return chain( x, y, x.primal-y.primal, T{1}, T{-1} ); }
+
+        template< std::floating_point T, unsigned long N, Scalar S >
+        constexpr dual<T, N> operator - ( dual<T, N> const& x, S s ) noexcept { return chain( x, x.primal-static_cast<T>(s), T{1} ); }
+
+        template< std::floating_point T, unsigned long N, Scalar S >
+        constexpr dual<T, N> operator - ( S s, dual<T, N> const& x ) noexcept { return chain( x, static_cast<T>(s)-x.primal, T{-1} ); }
+
+        template< std::floating_point T, unsigned long N >
+        constexpr dual<T, N> operator * ( dual<T, N> const& x, dual<T, N> const& y ) noexcept { return chain( x, y, x.primal*y.primal, y.primal, x.primal ); }
+
+        template< std::floating_point T, unsigned long N, Scalar S >
+        constexpr dual<T, N> operator * ( dual<T, N> const& x, S s ) noexcept { return chain( x, x.primal*static_cast<T>(s), static_cast<T>(s) ); }
+
+        template< std::floating_point T, unsigned long N, Scalar S >
+        constexpr dual<T, N> operator * ( S s, dual<T, N> const& x ) noexcept { return x * s; }
+
+        template< std::floating_point T, unsigned long N >
+        constexpr dual<T, N> operator / ( dual<T, N> const& x, dual<T, N> const& y ) noexcept
+        {
+            T const q = x.primal / y.primal;
+            return chain( x, y, q, T{1}/y.primal, -q/y.primal );
+        }
+
+        template< std::floating_point T, unsigned long N, Scalar S >
+        constexpr dual<T, N> operator / ( dual<T, N> const& x, S s ) noexcept { return chain( x, x.primal/static_cast<T>(s), T{1}/static_cast<T>(s) ); }
+
+        template< std::floating_point T, unsigned long N, Scalar S >
+        constexpr dual<T, N> operator / ( S s, dual<T, N> const& x ) noexcept
+        {
+            T const q = static_cast<T>(s) / x.primal;
+            return chain( x, q, -q/x.primal );
+        }
+
+        template< std::floating_point T, unsigned long N >
+        dual<T, N> exp( dual<T, N> const& x ) noexcept
+        {
+            T const e = std::exp( x.primal );
+            return chain( x, e, e );
+        }
+
+        template< std::floating_point T, unsigned long N >
+        dual<T, N> log( dual<T, N> const& x ) noexcept { return chain( x, std::log( x.primal ), T{1}/x.primal ); }
+
+        template< std::floating_point T, unsigned long N >
+        dual<T, N> sqrt( dual<T, N> const& x ) noexcept
+        {
+            T const r = std::sqrt( x.primal );
+            return chain( x, r, T{1}/(r+r) );
+        }
+
+        template< std::floating_point T, unsigned long N >
+        constexpr dual<T, N> square( dual<T, N> const& x ) noexcept { return chain( x, x.primal*x.primal, x.primal+x.primal ); }
+
+        template< std::floating_point T, unsigned long N >
+        constexpr dual<T, N> abs( dual<T, N> const& x ) noexcept
+        {
+            return chain( x, x.primal < T{0} ? -x.primal : x.primal, (x.primal > T{0}) ? T{1} : ((x.primal < T{0}) ? T{-1} : T{0}) );
+        }
+
+        template< std::floating_point T, unsigned long N >
+        dual<T, N> sin( dual<T, N> const& x ) noexcept { return chain( x, std::sin( x.primal ), std::cos( x.primal ) ); }
+
+        template< std::floating_point T, unsigned long N >
+        dual<T, N> cos( dual<T, N> const& x ) noexcept { return chain( x, std::cos( x.primal ), -std::sin( x.primal ) ); }
+
+        template< std::floating_point T, unsigned long N >
+        dual<T, N> tanh( dual<T, N> const& x ) noexcept
+        {
+            T const t = std::tanh( x.primal );
+            return chain( x, t, T{1} - t*t );
+        }
+
+        template< std::floating_point T, unsigned long N >
+        dual<T, N> sigmoid( dual<T, N> const& x ) noexcept
+        {
+            T const s = T{1} / ( T{1} + std::exp( -x.primal ) );
+            return chain( x, s, s * (T{1} - s) );
+        }
+
+        ///
+        /// @brief The larger of x and s, the derivative following x when they are equal, as `maximum` does for its right operand.
+        ///
+        template< std::floating_point T, unsigned long N, Scalar S >
+        constexpr dual<T, N> max( S s, dual<T, N> const& x ) noexcept
+        {
+            return static_cast<T>(s) > x.primal ? chain( x, static_cast<T>(s), T{0} ) : x;
+        }
+
+        template< std::floating_point T, unsigned long N, Scalar S >
+        constexpr dual<T, N> min( S s, dual<T, N> const& x ) noexcept
+        {
+            return static_cast<T>(s) < x.primal ? chain( x, static_cast<T>(s), T{0} ) : x;
+        }
+
+        ///
+        /// @brief x clamped to [lower, upper], of a null derivative out of the range, as the operator `clip`.
+        ///
+        template< std::floating_point T, unsigned long N, Scalar S >
+        constexpr dual<T, N> clip( dual<T, N> const& x, S lower, S upper=std::numeric_limits<S>::max() ) noexcept
+        {
+            if ( x.primal < static_cast<T>(lower) )
+                return chain( x, static_cast<T>(lower), T{0} );
+            if ( x.primal > static_cast<T>(upper) )
+                return chain( x, static_cast<T>(upper), T{0} );
+            return x;
+        }
+
+    }//namespace fusion
+
+    namespace fusion_private
+    {
+        // func(x) for every element of input, or its derivative times grad if Order is 1
+        template< unsigned long Order, Tensor Tsor, typename Function >
+        void unary_loop( Function const& func, Tsor const& input, Tsor const& grad, Tsor& ans ) noexcept
+        {
+            typedef typename Tsor::value_type value_type;
+            ans.resize( input.shape() );
+            if constexpr( Order == 0 )
+                for_each( input.begin(), input.end(), ans.begin(), [&func]( auto x, auto& v ) noexcept { v = func( fusion::dual<value_type, 0>{ x, {} } ).primal; } );
+            else
+                for_each( input.begin(), input.end(), grad.begin(), ans.begin(), [&func]( auto x, auto g, auto& v ) noexcept
+                {
+                    v = g * func( fusion::dual<value_type, 1>{ x, { value_type{1} } } ).derivative[0];
+                } );
+        }
+
+        // sums a gradient over the axes its operand was broadcast along
+        template< Tensor Tsor >
+        Tsor reduce_to_shape( Tsor ans, std::vector<unsigned long> const& shape )
+        {
+            while( shape.size() < ans.ndim() )
+                ans = sum( ans, 0 );
+            for ( auto axis : range( shape.size() ) )
+                if ( shape[axis] == 1 && ans.shape()[axis] != 1 )
+                    ans = sum( ans, axis, true );
+            return ans;
+        }
+
+        template< typename Function, Expression Ex >
+        auto make_unary( Function const& func, std::string const& name, Ex const& ex ) noexcept
+        {
+            std::shared_ptr<std::any> forward_cache = std::make_shared<std::any>();
+            std::shared_ptr<std::any> backward_cache = std::make_shared<std::any>();
+            return make_unary_operator( [func, forward_cache]<Tensor Tsor>( Tsor const& input ) noexcept
+                                        {
+                                            Tsor& ans = context_cast<Tsor>( forward_cache );
+                                            unary_loop<0>( func, input, input, ans );
+                                            return ans;
+                                        },
+                                        [func, backward_cache]<Tensor Tsor>( Tsor const& input, Tsor const&, Tsor const& grad ) noexcept
+                                        {
+                                            Tsor& ans = context_cast<Tsor>( backward_cache );
+                                            unary_loop<1>( func, input, grad, ans );
+                                            return ans;
+                                        },
+                                        name
+                    )( ex );
+        }
+
+        template< typename Function, Expression Lhs_Expression, Expression Rhs_Expression >
+        auto make_binary( Function const& func, std::string const& name, Lhs_Expression const& lhs_ex, Rhs_Expression const& rhs_ex ) noexcept
+        {
+            std::shared_ptr<std::any> forward_cache = std::make_shared<std::any>();
+            std::shared_ptr<std::any> backward_cache_lhs = std::make_shared<std::any>();
+            std::shared_ptr<std::any> backward_cache_rhs = std::make_shared<std::any>();
+            auto const& shape_calculator = []( std::vector<unsigned long> const& l, std::vector<unsigned long> const& r ) noexcept
+            {
+                return broadcast_shape( l, r );
+            };
+            return make_binary_operator( [func, forward_cache]<Tensor Tsor>( Tsor const& lhs_input, Tsor const& rhs_input ) noexcept
+                                         {
+                                             typedef typename Tsor::value_type value_type;
+                                             auto const& shape = broadcast_shape( lhs_input.shape(), rhs_input.shape() );
+                                             Tsor const& lhs = broadcast_tensor( lhs_input, shape );
+                                             Tsor const& rhs = broadcast_tensor( rhs_input, shape );
+                                             Tsor& ans = context_cast<Tsor>( forward_cache );
+                                             ans.resize( shape );
+                                             for_each( lhs.begin(), lhs.end(), rhs.begin(), ans.begin(), [&func]( auto l, auto r, auto& v ) noexcept
+                                             {
+                                                 v = func( fusion::dual<value_type, 0>{ l, {} }, fusion::dual<value_type, 0>{ r, {} } ).primal;
+                                             } );
+                                             return ans;
+                                         },
+                                         [func, backward_cache_lhs, backward_cache_rhs]<Tensor Tsor>( Tsor const& lhs_input, Tsor const& rhs_input, Tsor const&, Tsor const& grad ) noexcept
+                                         {
+                                             typedef typename Tsor::value_type value_type;
+                                             auto const& shape = grad.shape();
+                                             Tsor const& lhs = broadcast_tensor( lhs_input, shape );
+                                             Tsor const& rhs = broadcast_tensor( rhs_input, shape );
+                                             Tsor& lhs_ans = context_cast<Tsor>( backward_cache_lhs );
+                                             lhs_ans.resize( shape );
+                                             Tsor& rhs_ans = context_cast<Tsor>( backward_cache_rhs );
+                                             rhs_ans.resize( shape );
+                                             for_each( lhs.begin(), lhs.end(), rhs.begin(), grad.begin(), lhs_ans.begin(), rhs_ans.begin(), [&func]( auto l, auto r, auto g, auto& lv, auto& rv ) noexcept
+                                             {
+                                                 auto const& d = func( fusion::dual<value_type, 2>{ l, { value_type{1}, value_type{0} } }, fusion::dual<value_type, 2>{ r, { value_type{0}, value_type{1} } } ).derivative;
+                                                 lv = g * d[0];
+                                                 rv = g * d[1];
+                                             } );
+                                             return std::make_tuple( reduce_to_shape( lhs_ans, lhs_input.shape() ), reduce_to_shape( rhs_ans, rhs_input.shape() ) );
+                                         },
+                                         name,
+                                         shape_calculator
+                    )( lhs_ex, rhs_ex );
+        }
+    }//namespace fusion_private
+
+    ///
+    /// @brief Fuses a chain of elementwise operations into a single operator, of one or two operands.
+    ///
+    /// @param func A generic function of one or two elements, written with the arithmetic operators and the functions of namespace `fusion`
+    ///             (`exp`, `log`, `sqrt`, `square`, `abs`, `sin`, `cos`, `tanh`, `sigmoid`, `max`, `min` and `clip`), found by argument-dependent lookup.
+    /// @param name The name of the operator in the computation graph.
+    ///
+    /// Example code:
+    ///
+    /// \code{.cpp}
+    /// auto x = variable{ random<float>( {3, 4} ) };
+    /// auto y = fuse( []( auto v ){ return exp( -square( v ) ); }, "Gaussian" )( x ); // exp( negative( square( x ) ) ) in one operator
+    /// \endcode
+    ///
+    template< typename Function >
+    auto fuse( Function const& func, std::string const& name = "Fused" ) noexcept
+    {
+        return [=]<Expression... Expressions>( Expressions const&... exs ) noexcept
+        {
+            static_assert( sizeof...(Expressions) == 1 || sizeof...(Expressions) == 2, "fuse: expecting one or two operands." );
+            if constexpr( sizeof...(Expressions) == 1 )
+                return fusion_private::make_unary( func, name, exs... );
+            else
+                return fusion_private::make_binary( func, name, exs... );
+        };
+    }
+
+}//namespace ceras
+
+#endif//FUSIONHPPMVQZKXWRJNTYLOBUEADCFIHSPGMVQZKXWRJNTYLOBUEADCFIHSPGMVQZKXWRJNTY
@@ -120,6 +120,96 @@ namespace ceras
         };
     }
 
+    ///
+    /// @brief Grouped 2D convolution layer, the input channels and the output channels being split into `groups` groups, each group of output channels seeing only its group of input channels.
+    /// @param output_channels Dimensionality of the output space.
+    /// @param kernel_size The height and width of the convolutional window.
+    /// @param groups The number of groups, dividing both the input channels and `output_channels`.
+    /// @param padding `valid` or `same`. `valid` suggests no padding. `same` suggests zero padding. Defaults to `valid`.
+    /// @param strides The strides along the height and width direction. Defaults to `(1, 1)`.
+    /// @param dilations The dialation along the height and width direction. Defaults to `(1, 1)`.
+    /// @param use_bias Wether or not use a bias vector. Defaults to `true`.
+    /// @param kernel_regularizer_l1 L1 regularizer for the kernel. Defaults to `0.0f`.
+    /// @param kernel_regularizer_l2 L2 regularizer for the kernel. Defaults to `0.0f`.
+    /// @param bias_regularizer_l1 L1 regularizer for the bias vector. Defaults to `0.0f`.
+    /// @param bias_regularizer_l2 L2 regularizer for the bias vector. Defaults to `0.0f`.
+    ///
+    /// Example code:
+    ///
+    /// \code{.cpp}
+    /// auto x = Input{ {56, 56, 64} };
+    /// auto y = GroupedConv2D( 64, {3, 3}, 8, "same" )( x ); // 8 groups of 8 channels
+    /// \endcode
+    ///
+    inline auto GroupedConv2D( unsigned long output_channels, std::vector<unsigned long> const& kernel_size, unsigned long groups, std::string const& padding="valid",
+                               std::vector<unsigned long> const& strides={1,1}, std::vector<unsigned long> const& dilations={1, 1}, bool use_bias=true,
+                               float kernel_regularizer_l1=0.0f, float kernel_regularizer_l2=0.0f, float bias_regularizer_l1=0.0f, float bias_regularizer_l2=0.0f
+           ) noexcept
+    {
+        better_assert( output_channels > 0, "Expecting output_channels larger than 0." );
+        better_assert( kernel_size.size() > 0, "Expecting kernel_size at least has 1 elements." );
+        better_assert( strides.size() > 0, "Expecting strides at least has 1 elements." );
+        better_assert( groups > 0 && output_channels % groups == 0, "Expecting output_channels divisible by groups." );
+        return [=]<Expression Ex>( Ex const& ex ) noexcept
+        {
+            unsigned long const kernel_size_x = kernel_size[0];
+            unsigned long const kernel_size_y = kernel_size.size() == 2 ? kernel_size[1] : kernel_size[0];
+            unsigned long const input_channels = *(ex.shape().rbegin());
+            better_assert( input_channels % groups == 0, "Expecting input channels divisible by groups." );
+            unsigned long const stride_x = strides[0];
+            unsigned long const stride_y = strides.size() == 2 ? strides[1] : strides[0];
+            unsigned long const dilation_row = dilations[0];
+            unsigned long const dilation_col = dilations.size() == 2 ? dilations[1] : dilations[0];
+            auto w = variable<tensor<float>>{ glorot_uniform<float>({output_channels, kernel_size_x, kernel_size_y, input_channels/groups}), kernel_regularizer_l1, kernel_regularizer_l2 };
+            auto b = variable<tensor<float>>{ zeros<float>({1, 1, output_channels}), bias_regularizer_l1, bias_regularizer_l2, use_bias };
+            return grouped_conv2d( groups, stride_x, stride_y, dilation_row, dilation_col, padding )( ex, w ) + b;
+        };
+    }
+
+    ///
+    /// @brief Depthwise 2D convolution layer, convolving every input channel with its own `depth_multiplier` kernels.
+    /// @param kernel_size The height and width of the convolutional window.
+    /// @param padding `valid` or `same`. `valid` suggests no padding. `same` suggests zero padding. Defaults to `valid`.
+    /// @param strides The strides along the height and width direction. Defaults to `(1, 1)`.
+    /// @param dilations The dialation along the height and width direction. Defaults to `(1, 1)`.
+    /// @param depth_multiplier The number of output channels of every input channel. Defaults to `1`.
+    /// @param use_bias Wether or not use a bias vector. Defaults to `true`.
+    /// @param kernel_regularizer_l1 L1 regularizer for the kernel. Defaults to `0.0f`.
+    /// @param kernel_regularizer_l2 L2 regularizer for the kernel. Defaults to `0.0f`.
+    /// @param bias_regularizer_l1 L1 regularizer for the bias vector. Defaults to `0.0f`.
+    /// @param bias_regularizer_l2 L2 regularizer for the bias vector. Defaults to `0.0f`.
+    ///
+    /// Example code:
+    ///
+    /// \code{.cpp}
+    /// auto x = Input{ {112, 112, 32} };
+    /// auto y = DepthwiseConv2D( {3, 3}, "same" )( x ); // a separable convolution: depthwise, then pointwise
+    /// auto z = Conv2D( 64, {1, 1} )( y );
+    /// \endcode
+    ///
+    inline auto DepthwiseConv2D( std::vector<unsigned long> const& kernel_size, std::string const& padding="valid",
+                                 std::vector<unsigned long> const& strides={1,1}, std::vector<unsigned long> const& dilations={1, 1}, unsigned long depth_multiplier=1, bool use_bias=true,
+                                 float kernel_regularizer_l1=0.0f, float kernel_regularizer_l2=0.0f, float bias_regularizer_l1=0.0f, float bias_regularizer_l2=0.0f
+           ) noexcept
+    {
+        better_assert( kernel_size.size() > 0, "Expecting kernel_size at least has 1 elements." );
+        better_assert( strides.size() > 0, "Expecting strides at least has 1 elements." );
+        better_assert( depth_multiplier > 0, "Expecting depth_multiplier larger than 0." );
+        return [=]<Expression Ex>( Ex const& ex ) noexcept
+        {
+            unsigned long const kernel_size_x = kernel_size[0];
+            unsigned long const kernel_size_y = kernel_size.size() == 2 ? kernel_size[1] : kernel_size[0];
+            unsigned long const output_channels = *(ex.shape().rbegin()) * depth_multiplier;
+            unsigned long const stride_x = strides[0];
+            unsigned long const stride_y = strides.size() == 2 ? strides[1] : strides[0];
+            unsigned long const dilation_row = dilations[0];
+            unsigned long const dilation_col = dilations.size() == 2 ? dilations[1] : dilations[0];
+            auto w = variable<tensor<float>>{ glorot_uniform<float>({output_channels, kernel_size_x, kernel_size_y, 1}), kernel_regularizer_l1, kernel_regularizer_l2 };
+            auto b = variable<tensor<float>>{ zeros<float>({1, 1, output_channels}), bias_regularizer_l1, bias_regularizer_l2, use_bias };
+            return depthwise_conv2d( stride_x, stride_y, dilation_row, dilation_col, padding )( ex, w ) + b;
+        };
+    }
+
 
     ///
     /// @brief Transposed convolution layer.
@@ -210,23 +300,26 @@ namespace ceras
     /// @param kernel_regularizer_l2 L2 regularizer for the kernel. Defaults to `0.0f`.
     /// @param bias_regularizer_l1 L1 regularizer for the bias vector. Defaults to `0.0f`.
     /// @param bias_regularizer_l2 L2 regularizer for the bias vector. Defaults to `0.0f`.
+    /// @param activation Activation fused into the layer, one of `linear`, `relu`, `leaky_relu`, `sigmoid` and `tanh`. Defaults to `linear`.
     ///
     /// Example code:
     ///
     /// \code{.cpp}
     /// auto x = Input{ {28*28,} };
     /// auto y = Dense( 10, )( x );
-    /// auto m = model{ x, y };
+    /// auto z = Dense( 10, true, 0.0f, 0.0f, 0.0f, 0.0f, "relu" )( y ); // same as `relu( Dense( 10 )( y ) )`, but faster
+    /// auto m = model{ x, z };
     /// \endcode
     ///
-    inline auto Dense( unsigned long output_size, bool use_bias=true, float kernel_regularizer_l1=0.0f, float kernel_regularizer_l2=0.0f, float bias_regularizer_l1=0.0f, float bias_regularizer_l2=0.0f )
+    inline auto Dense( unsigned long output_size, bool use_bias=true, float kernel_regularizer_l1=0.0f, float kernel_regularizer_l2=0.0f, float bias_regularizer_l1=0.0f, float bias_regularizer_l2=0.0f,
+                       std::string const& activation="linear" )
     {
         return [=]<Expression Ex>( Ex const& ex )
         {
             unsigned long const input_size = *(ex.shape().rbegin());
             auto w = variable<tensor<float>>{ glorot_uniform<float>({input_size, output_size}), kernel_regularizer_l1, kernel_regularizer_l2 };
             auto b = variable<tensor<float>>{ zeros<float>({1, output_size}), bias_regularizer_l1, bias_regularizer_l2, use_bias }; // if use_baias, then b is trainable; otherwise, non-trainable.
-            return ex * w + b;
+            return dense( activation )( ex, w, b ); // activation( ex * w + b )
         };
     }
 
@@ -448,6 +541,19 @@ namespace ceras
         return max_pooling_2d( stride );
     }
 
+    ///
+    /// Max pooling operation for 2D spatial data, with a window of `pool_size`.
+    /// @param pool_size The height and width of the window.
+    /// @param strides The strides along the height and width direction. Defaults to `pool_size`.
+    /// @param padding `valid` or `same`. Defaults to `valid`.
+    ///
+    inline auto MaxPooling2D( std::vector<unsigned long> const& pool_size, std::vector<unsigned long> const& strides={}, std::string const& padding="valid" ) noexcept
+    {
+        better_assert( pool_size.size() > 0, "Expecting pool_size at least has 1 elements." );
+        std::vector<unsigned long> const& s = strides.empty() ? pool_size : strides;
+        return max_pooling_2d( pool_size[0], *(pool_size.rbegin()), s[0], *(s.rbegin()), padding );
+    }
+
     ///
     /// Upsampling layer for 2D inputs.
     ///
@@ -473,6 +579,19 @@ namespace ceras
         return average_pooling_2d( stride );
     }
 
+    ///
+    /// Average pooling operation for spatial data, with a window of `pool_size`.
+    /// @param pool_size The height and width of the window.
+    /// @param strides The strides along the height and width direction. Defaults to `pool_size`.
+    /// @param padding `valid` or `same`. Defaults to `valid`.
+    ///
+    inline auto AveragePooling2D( std::vector<unsigned long> const& pool_size, std::vector<unsigned long> const& strides={}, std::string const& padding="valid" ) noexcept
+    {
+        better_assert( pool_size.size() > 0, "Expecting pool_size at least has 1 elements." );
+        std::vector<unsigned long> const& s = strides.empty() ? pool_size : strides;
+        return average_pooling_2d( pool_size[0], *(pool_size.rbegin()), s[0], *(s.rbegin()), padding );
+    }
+
     //
     // TODO: wrap more operations from 'operation.hpp'
     //
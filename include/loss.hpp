@@ -2,6 +2,7 @@
 #define APWVIJWMXHAVXUGYGVNDSEFKTMBKLBMGLSHWUPRPGLFCHUBDRAHGSTDSEDNKOGTIBNQVNLXCD
 
 #include "./operation.hpp"
+#include "./fusion.hpp"
 #include "./tensor.hpp"
 #include "./utils/debug.hpp"
 
@@ -11,19 +12,19 @@ namespace ceras
     template < Expression Lhs_Expression, Expression Rhs_Expression >
     auto constexpr mean_squared_logarithmic_error( Lhs_Expression const& lhs_ex, Rhs_Expression const& rhs_ex ) noexcept
     {
-        return sum_reduce( square( minus(log( value{1.0} + clip(eps)(lhs_ex) ), log( value{1.0} + clip(eps)(rhs_ex) ))) );
+        return sum_reduce( fuse( []( auto a, auto b ){ return square( log( 1.0 + clip( a, eps ) ) - log( 1.0 + clip( b, eps ) ) ); }, "SquaredLogarithmicError" )( lhs_ex, rhs_ex ) );
     }
 
     template < Expression Lhs_Expression, Expression Rhs_Expression >
     auto constexpr squared_loss( Lhs_Expression const& lhs_ex, Rhs_Expression const& rhs_ex ) noexcept
     {
-        return sum_reduce( square( minus(lhs_ex, rhs_ex)) );
+        return sum_reduce( fuse( []( auto a, auto b ){ return square( a - b ); }, "SquaredError" )( lhs_ex, rhs_ex ) );
     }
 
     template < Expression Lhs_Expression, Expression Rhs_Expression >
     auto constexpr mean_squared_error( Lhs_Expression const& lhs_ex, Rhs_Expression const& rhs_ex ) noexcept
     {
-        return mean_reduce( square( minus(lhs_ex, rhs_ex)) );
+        return mean_reduce( fuse( []( auto a, auto b ){ return square( a - b ); }, "SquaredError" )( lhs_ex, rhs_ex ) );
     }
 
     template < Expression Lhs_Expression, Expression Rhs_Expression >
@@ -35,13 +36,13 @@ namespace ceras
     template < Expression Lhs_Expression, Expression Rhs_Expression >
     auto constexpr abs_loss( Lhs_Expression const& lhs_ex, Rhs_Expression const& rhs_ex ) noexcept
     {
-        return sum_reduce( abs( minus(lhs_ex, rhs_ex)) );
+        return sum_reduce( fuse( []( auto a, auto b ){ return abs( a - b ); }, "AbsoluteError" )( lhs_ex, rhs_ex ) );
     }
 
     template < Expression Lhs_Expression, Expression Rhs_Expression >
     auto constexpr mean_absolute_error( Lhs_Expression const& lhs_ex, Rhs_Expression const& rhs_ex ) noexcept
     {
-        return mean_reduce( abs( minus(lhs_ex, rhs_ex)) );
+        return mean_reduce( fuse( []( auto a, auto b ){ return abs( a - b ); }, "AbsoluteError" )( lhs_ex, rhs_ex ) );
     };
 
     template < Expression Lhs_Expression, Expression Rhs_Expression >
@@ -119,8 +120,7 @@ namespace ceras
     template < Expression Lhs_Expression, Expression Rhs_Expression >
     auto constexpr binary_cross_entropy_loss( Lhs_Expression const& ground_truth, Rhs_Expression const& prediction ) noexcept
     {
-        auto ones = ones_like( ground_truth );
-        auto error = negative( hadamard_product( ground_truth, log(prediction) ) + hadamard_product( (ones - ground_truth), log(ones - prediction) ) );
+        auto error = fuse( []( auto gt, auto p ){ return -( gt * log( p ) + (1.0 - gt) * log( 1.0 - p ) ); }, "BinaryCrossEntropy" )( ground_truth, prediction );
         return mean_reduce( error );
     }
 
@@ -135,7 +135,7 @@ namespace ceras
     template < Expression Lhs_Expression, Expression Rhs_Expression >
     auto constexpr hinge_loss( Lhs_Expression const& lhs_ex, Rhs_Expression const& rhs_ex ) noexcept
     {
-        return mean_reduce( maximum( value{0.0f}, value{1.0f} - hadamard_product(lhs_ex, rhs_ex) ) );
+        return mean_reduce( fuse( []( auto a, auto b ){ return max( 0.0, 1.0 - a * b ); }, "Hinge" )( lhs_ex, rhs_ex ) );
     }
 
     // loss interfaces
@@ -5,6 +5,8 @@
 #include "./operation.hpp"
 #include "./place_holder.hpp"
 #include "./tensor.hpp"
+#include "./quantization.hpp"
+#include "./folding.hpp"
 #include "./utils/better_assert.hpp"
 #include "./utils/context_cast.hpp"
 #include "./utils/tqdm.hpp"
@@ -120,6 +122,7 @@ namespace ceras
             value_type validation_error = 0;
 
             learning_phase = 0; // for different behaviours in normalization and drop-out layers
+            backend::conv2d_autotuning_scope const autotuning; // the convolutions run with their fastest algorithms, see `backend/conv2d_autotuner.hpp`
 
             for ( auto l : tq::trange( loops ) )
             {
@@ -193,6 +196,7 @@ namespace ceras
             std::vector<value_type> validation_errors;
 
             learning_phase = 1; // for different behaviours in normalization and drop-out layers
+            backend::conv2d_autotuning_scope const autotuning;
 
             for ( auto e : range( epoch ) )
             {
@@ -247,6 +251,7 @@ namespace ceras
         auto train_on_batch( Tsor const& input, Tsor const& output )
         {
             learning_phase = 1; // for different behaviours in normalization and drop-out layers
+            backend::conv2d_autotuning_scope const autotuning;
             auto& s = get_default_session<Tsor>();//.get();
             s.bind( input_place_holder_, input );
             s.bind( ground_truth_place_holder_, output );
@@ -260,6 +265,7 @@ namespace ceras
         template< Tensor Tsor>
         auto predict( Tsor const& input_tensor )
         {
+            backend::conv2d_autotuning_scope const autotuning;
             auto m = model_;
             return m.predict( input_tensor );
         }
@@ -276,6 +282,12 @@ namespace ceras
         }
     };
 
+    ///
+    /// Compiles a model with a loss and an optimizer.
+    ///
+    /// The training and the inference of the compiled model run in a `backend::conv2d_autotuning_scope`: every convolution times its algorithms
+    /// on the first input shape it meets, and keeps the fastest one, see `backend/conv2d_autotuner.hpp`.
+    ///
     template< typename Model, typename Optimizer, typename Loss >
     inline auto make_compiled_model( Model const& m, Loss const& l, Optimizer const& o )
     {
@@ -300,6 +312,10 @@ namespace ceras
 
         output_layer_type expression_;   ///< output layer of the model.
         input_layer_type place_holder_;//< input layer of the model.
+        std::vector<std::shared_ptr<quantization_state>> quantized_operators_; ///< Dense and Conv2D operators running in int8 for `predict`.
+        std::vector<std::shared_ptr<folding_state>> folded_operators_; ///< operators folded into the preceding Dense or Conv2D for `predict`.
+        bool freezing_ = false; ///< `predict` folds the model, see `freeze`.
+        std::optional<unsigned long> folding_generation_; ///< `variable_data_generation` when the model was last folded.
 
 
         ///
@@ -347,10 +363,24 @@ namespace ceras
         {
             learning_phase = 0; // for different behaviours in normalization and drop-out layers
 
+            if ( std::any_of( quantized_operators_.begin(), quantized_operators_.end(), []( auto const& state ){ return state->generation != variable_data_generation; } ) )
+                dequantize(); // the int8 weights are stale after training, running in float until quantized again
+
             //session<Tsor> s;
             auto& s = get_default_session<Tsor>();//.get();
             s.bind( place_holder_, input_tensor );
 
+            if ( freezing_ && ( !folding_generation_ || *folding_generation_ != variable_data_generation ) ) // (re)folding along a traced inference
+            {
+                reset_folding();
+                begin_folding_trace();
+                auto ans = s.run( expression_ );
+                folded_operators_ = end_folding_trace<Tsor>();
+                folding_generation_ = variable_data_generation;
+                learning_phase = 1;
+                return ans;
+            }
+
             auto ans = s.run( expression_ );
 
             learning_phase = 1; // restore learning phase
@@ -358,6 +388,86 @@ namespace ceras
             return ans;
         }
 
+        ///
+        /// Switches the Dense and Conv2D layers of the model to int8 for `predict`, using the ranges of the inputs seen in a sample batch.
+        /// @param calibration_batch The sample batch for the calibration.
+        /// @param evaluation_batch The samples to measure the accuracy on. Defaults to the calibration batch.
+        /// @return The accuracy and the memory of the int8 model against the float model.
+        ///
+        /// Example code:
+        /// @code
+        /// auto m = model{ input, output };
+        /// // ... train the model
+        /// auto report = m.quantize( calibration_data );
+        /// std::cout << report << std::endl; // accuracy delta to float
+        /// auto result = m.predict( test_data ); // running in int8
+        /// @endcode
+        ///
+        /// Note: The weights are quantized when calling this method. Once they are modified, for example by training the model again, `predict` runs
+        /// in float until this method is called again.
+        ///
+        template< Tensor Tsor >
+        quantization_report quantize( Tsor const& calibration_batch, std::optional<Tsor> const& evaluation_batch = std::nullopt )
+        {
+            unfreeze();
+            dequantize();
+            auto const& [states, report] = ceras::quantize( *this, calibration_batch, evaluation_batch ? (*evaluation_batch) : calibration_batch );
+            quantized_operators_ = states;
+            return report;
+        }
+
+        ///
+        /// Switches the quantized layers back to float.
+        ///
+        void dequantize() noexcept
+        {
+            for ( auto& state : quantized_operators_ )
+                state->enabled = false;
+            quantized_operators_.clear();
+        }
+
+        ///
+        /// Folds, for `predict`, the batch normalizations, the per-channel scales and shifts and the activations following the Conv2D and Dense layers into them.
+        /// The folding happens along the next prediction, and again whenever the weights have changed.
+        ///
+        /// Example code:
+        /// @code
+        /// auto x = Input();
+        /// auto y = relu( BatchNormalization()( Conv2D( 32, {3, 3}, "same" )( x ) ) );
+        /// auto m = model{ x, y };
+        /// // ... train the model
+        /// m.freeze();
+        /// auto result = m.predict( test_data ); // a single convolution with the normalization and the relu in its epilogue
+        /// @endcode
+        ///
+        /// Note: The folding and the int8 quantization are exclusive, `freeze` dequantizes the model and `quantize` unfreezes it.
+        ///
+        void freeze() noexcept
+        {
+            dequantize();
+            freezing_ = true;
+        }
+
+        ///
+        /// Runs `predict` layer by layer again.
+        ///
+        void unfreeze() noexcept
+        {
+            reset_folding();
+            freezing_ = false;
+        }
+
+        ///
+        /// Drops the folded chains.
+        ///
+        void reset_folding() noexcept
+        {
+            for ( auto& state : folded_operators_ )
+                state->chain.reset();
+            folded_operators_.clear();
+            folding_generation_.reset();
+        }
+
         ///
         /// Generating a new expression by using the current model.
         /// @param ex An expression that represents the input to the model.
@@ -7,6 +7,17 @@
 #include "./constant.hpp"
 #include "./value.hpp"
 #include "./session.hpp"
+#include "./quantization.hpp"
+#include "./folding.hpp"
+#include "./backend/direct_conv2d.hpp"
+#include "./backend/winograd_conv2d.hpp"
+#include "./backend/implicit_gemm_conv2d.hpp"
+#include "./backend/grouped_conv2d.hpp"
+#include "./backend/transposed_conv2d.hpp"
+#include "./backend/pooling_2d.hpp"
+#include "./backend/conv2d_autotuner.hpp"
+#include "./backend/nchwc_conv2d.hpp"
+#include "./backend/vector_math.hpp"
 #include "./utils/range.hpp"
 #include "./utils/debug.hpp"
 #include "./config.hpp"
@@ -68,6 +79,8 @@ namespace ceras
             if ( output_data_.empty() )
             {
                 input_data_ = op_.forward();
+                if ( auto& trace = get_folding_trace(); trace.active )
+                    trace.read( input_data_, is_variable_v<Operator> || is_constant_v<Operator> );
                 output_data_ = forward_action_( input_data_ );
                 sess.update_forward_cache( (*this).id(), output_data_ );
             }
@@ -109,6 +122,34 @@ namespace ceras
     }
 
 
+    namespace ceras_private
+    {
+        // the gradient buffer of an operand, for a backward action to accumulate into, nullptr unless the operand is a trainable variable
+        template< Tensor Tsor, typename Operator >
+        Tsor* gradient_accumulator( Operator& op ) noexcept
+        {
+            if constexpr( is_variable_v<Operator> )
+                return op.gradient_accumulator();
+            else
+                return nullptr;
+        }
+
+        // back-propagates grad to an operand, or only finishes the backward pass of the operand if its gradient has been accumulated into `target` already
+        template< typename Operator, Tensor Tsor >
+        void backward_or_accumulated( Operator& op, Tsor const* target, Tsor const& grad )
+        {
+            if constexpr( is_variable_v<Operator> )
+            {
+                if ( target )
+                {
+                    op.backward_accumulated();
+                    return;
+                }
+            }
+            op.backward( grad );
+        }
+    }//namespace ceras_private
+
     ///
     /// @brief A binary operator is composed of a.) a left-side input expression, b.) a right-side input expression, c.)  a forward action and d.) a backward action.
     ///
@@ -156,6 +197,12 @@ namespace ceras
                 rhs_input_data_ = rhs_op_.forward();
             }
 
+            if ( auto& trace = get_folding_trace(); trace.active )
+            {
+                trace.read( lhs_input_data_, is_value_v<Lhs_Operator> || is_variable_v<Lhs_Operator> || is_constant_v<Lhs_Operator> );
+                trace.read( rhs_input_data_, is_value_v<Rhs_Operator> || is_variable_v<Rhs_Operator> || is_constant_v<Rhs_Operator> );
+            }
+
             output_data_ = forward_action_( lhs_input_data_, rhs_input_data_ );
             sess.update_forward_cache( (*this).id(), output_data_ );
             return output_data_;
@@ -164,11 +211,25 @@ namespace ceras
         ///
         /// @brief Backward action, grad back-propagated.
         ///
+        /// A backward action taking two more arguments, `( lhs_input, rhs_input, output, grad, lhs_target, rhs_target )`, receives the gradient buffers of the
+        /// trainable variables among the operands, and accumulates the corresponding gradient into them directly. A null target is computed and returned as usual.
+        ///
         void backward( tensor_type const& grad )
         {
-            auto const& [current_gradient_lhs, current_gradient_rhs] = backward_action_( lhs_input_data_, rhs_input_data_, output_data_, grad );
-            lhs_op_.backward( current_gradient_lhs );
-            rhs_op_.backward( current_gradient_rhs );
+            if constexpr( std::is_invocable_v<Backward_Action, tensor_type const&, tensor_type const&, tensor_type const&, tensor_type const&, tensor_type*, tensor_type*> )
+            {
+                tensor_type* lhs_target = ceras_private::gradient_accumulator<tensor_type>( lhs_op_ );
+                tensor_type* rhs_target = ceras_private::gradient_accumulator<tensor_type>( rhs_op_ );
+                auto const& [current_gradient_lhs, current_gradient_rhs] = backward_action_( lhs_input_data_, rhs_input_data_, output_data_, grad, lhs_target, rhs_target );
+                ceras_private::backward_or_accumulated( lhs_op_, lhs_target, current_gradient_lhs );
+                ceras_private::backward_or_accumulated( rhs_op_, rhs_target, current_gradient_rhs );
+            }
+            else
+            {
+                auto const& [current_gradient_lhs, current_gradient_rhs] = backward_action_( lhs_input_data_, rhs_input_data_, output_data_, grad );
+                lhs_op_.backward( current_gradient_lhs );
+                rhs_op_.backward( current_gradient_rhs );
+            }
         }
 
         ///
@@ -404,11 +465,19 @@ namespace ceras
         {
             auto make_forward() const noexcept
             {
-                return []<Tensor Tsor>( Tsor const& lhs_tensor, Tsor const& rhs_tensor ) noexcept
+                return []( std::shared_ptr<folding_state> folding ) noexcept
                 {
-                    better_assert( !has_nan( lhs_tensor ), "forward propagation for operator plus: lhs_tensor contains Nan!" );
-                    better_assert( !has_nan( rhs_tensor ), "forward propagation for operator plus: rhs_tensor contains Nan!" );
-                    return add( lhs_tensor, rhs_tensor );
+                    return [folding]<Tensor Tsor>( Tsor const& lhs_tensor, Tsor const& rhs_tensor ) noexcept
+                    {
+                        if ( folding->folded() ) // a bias folded into the preceding Conv2D or Dense, see `folding.hpp`
+                            return folding->operand ? rhs_tensor : lhs_tensor;
+                        better_assert( !has_nan( lhs_tensor ), "forward propagation for operator plus: lhs_tensor contains Nan!" );
+                        better_assert( !has_nan( rhs_tensor ), "forward propagation for operator plus: rhs_tensor contains Nan!" );
+                        Tsor ans = add( lhs_tensor, rhs_tensor );
+                        if ( auto& trace = get_folding_trace(); trace.active )
+                            trace.record( folding_kind::plus, folding, lhs_tensor, &rhs_tensor, ans, { lhs_tensor, rhs_tensor } );
+                        return ans;
+                    };
                 };
             }
 
@@ -444,7 +513,8 @@ namespace ceras
         };
 
 
-        return make_binary_operator( plus_context{}.make_forward(), plus_context{}.make_backward(), "Plus", shape_calculator )( lhs_ex, rhs_ex );
+        std::shared_ptr<folding_state> folding = std::make_shared<folding_state>();
+        return make_binary_operator( plus_context{}.make_forward()( folding ), plus_context{}.make_backward(), "Plus", shape_calculator )( lhs_ex, rhs_ex );
     }
 
     template< Expression Lhs_Expression, Expression Rhs_Expression >
@@ -479,22 +549,26 @@ namespace ceras
             {
                 return []( std::shared_ptr<std::any> backward_cache_lhs, std::shared_ptr<std::any> backward_cache_rhs ) noexcept
                 {
-                    return [backward_cache_lhs, backward_cache_rhs]<Tensor Tsor>( Tsor const& lhs_input, Tsor const& rhs_input, Tsor const&, Tsor const& grad ) noexcept
+                    // the gradient of a trainable variable is accumulated into its gradient buffer directly, with beta = 1
+                    return [backward_cache_lhs, backward_cache_rhs]<Tensor Tsor>( Tsor const& lhs_input, Tsor const& rhs_input, Tsor const&, Tsor const& grad,
+                                                                                  Tsor* lhs_target = nullptr, Tsor* rhs_target = nullptr ) noexcept
                     {
+                       typedef typename Tsor::value_type value_type;
                        // left branch <-- grad * rhs^T
                        auto const& g_shape = grad.shape();
                        auto const[m, n] = std::make_tuple( g_shape[0], g_shape[1] ); // 4, 1
                        auto const k = *(lhs_input.shape().rbegin()); // 13
 
                        Tsor& lhs_grad = context_cast<Tsor>( backward_cache_lhs );
-                       lhs_grad.resize( lhs_input.shape() );
-
-                       gemm( grad.data(), false, rhs_input.data(), true, m, n, k, lhs_grad.data() );
+                       if ( !lhs_target )
+                           lhs_grad.resize( lhs_input.shape() );
+                       gemm( grad.data(), false, rhs_input.data(), true, m, n, k, lhs_target ? lhs_target->data() : lhs_grad.data(), value_type{1}, lhs_target ? value_type{1} : value_type{0} );
 
                        // right branch <-- lhs^T * grad
                        Tsor& rhs_grad = context_cast<Tsor>( backward_cache_rhs );
-                       rhs_grad.resize( rhs_input.shape() );
-                       gemm( lhs_input.data(), true, grad.data(), false, k, m, n, rhs_grad.data() );
+                       if ( !rhs_target )
+                           rhs_grad.resize( rhs_input.shape() );
+                       gemm( lhs_input.data(), true, grad.data(), false, k, m, n, rhs_target ? rhs_target->data() : rhs_grad.data(), value_type{1}, rhs_target ? value_type{1} : value_type{0} );
 
                        return std::make_tuple( lhs_grad, rhs_grad );
                     };
@@ -529,6 +603,363 @@ namespace ceras
         }
     }
 
+    namespace
+    {
+        struct batched_multiplication_context
+        {
+            auto make_forward() const noexcept
+            {
+                return []( std::shared_ptr<std::any> forward_cache ) noexcept
+                {
+                    return [forward_cache]<Tensor Tsor>( Tsor const& lhs_tensor, Tsor const& rhs_tensor ) noexcept
+                    {
+                        Tsor& ans = context_cast<Tsor>( forward_cache );
+                        batched_multiply( lhs_tensor, rhs_tensor, ans );
+                        return ans;
+                    };
+                };
+            }
+            auto make_backward() const noexcept
+            {
+                return []( std::shared_ptr<std::any> backward_cache_lhs, std::shared_ptr<std::any> backward_cache_rhs ) noexcept
+                {
+                    // as in `multiplication_context`, the gradients of trainable variables are accumulated into their gradient buffers directly
+                    return [backward_cache_lhs, backward_cache_rhs]<Tensor Tsor>( Tsor const& lhs_input, Tsor const& rhs_input, Tsor const&, Tsor const& grad,
+                                                                                  Tsor* lhs_target = nullptr, Tsor* rhs_target = nullptr ) noexcept
+                    {
+                        typedef typename Tsor::value_type value_type;
+                        auto const& l_shape = lhs_input.shape();
+                        auto const [batch, m, k] = std::make_tuple( l_shape[0], l_shape[1], l_shape[2] ); // lhs is [batch, m, k]
+                        unsigned long const n = *(grad.shape().rbegin()); // grad is [batch, m, n]
+                        bool const rhs_shared = rhs_input.ndim() == 2; // rhs is [k, n] or [batch, k, n]
+
+                        // left branch <-- grad[b] * rhs[b]^T
+                        Tsor& lhs_grad = context_cast<Tsor>( backward_cache_lhs );
+                        if ( !lhs_target )
+                            lhs_grad.resize( l_shape );
+                        gemm_batched( grad.data(), false, m*n, rhs_input.data(), true, rhs_shared ? 0UL : k*n, batch, m, n, k, lhs_target ? lhs_target->data() : lhs_grad.data(),
+                                      value_type{1}, lhs_target ? value_type{1} : value_type{0} );
+
+                        // right branch <-- lhs[b]^T * grad[b], summed over the batches in case of a shared rhs
+                        Tsor& rhs_grad = context_cast<Tsor>( backward_cache_rhs );
+                        if ( !rhs_target )
+                            rhs_grad.resize( rhs_input.shape() );
+                        value_type* const rhs_ptr = rhs_target ? rhs_target->data() : rhs_grad.data();
+                        value_type const rhs_beta = rhs_target ? value_type{1} : value_type{0};
+                        if ( rhs_shared )
+                            gemm( lhs_input.data(), true, grad.data(), false, k, batch*m, n, rhs_ptr, value_type{1}, rhs_beta );
+                        else
+                            gemm_batched( lhs_input.data(), true, m*k, grad.data(), false, m*n, batch, k, m, n, rhs_ptr, value_type{1}, rhs_beta );
+
+                        return std::make_tuple( lhs_grad, rhs_grad );
+                    };
+                };
+            }
+        };//batched_multiplication_context
+    }//anonymous namespace
+
+    ///
+    /// @brief Batched matrix multiplication.
+    ///
+    /// @param lhs_ex An expression of shape [B, M, K].
+    /// @param rhs_ex An expression of shape [B, K, N], or [K, N] to multiply every batch of @p lhs_ex with.
+    /// @return An expression of shape [B, M, N].
+    ///
+    /// Example code:
+    /// \code{.cpp}
+    /// auto a = variable{ random<float>( {8, 3, 5} ) };
+    /// auto b = variable{ random<float>( {8, 5, 7} ) };
+    /// auto c = variable{ random<float>( {5, 7} ) };
+    /// auto ab = batched_matmul( a, b ); // of shape (8, 3, 7)
+    /// auto ac = batched_matmul( a, c ); // of shape (8, 3, 7)
+    /// \endcode
+    ///
+    template< Expression Lhs_Expression, Expression Rhs_Expression >
+    auto batched_matmul( Lhs_Expression const& lhs_ex, Rhs_Expression const& rhs_ex ) noexcept
+    {
+        auto const& shape_calculator = []( std::vector<unsigned long> const& l, std::vector<unsigned long> const& r ) noexcept
+        {
+            better_assert( l.size() == 3, fmt::format( "expecting l size of 3, but got {}", l.size() ) );
+            better_assert( r.size() == 2 || r.size() == 3, fmt::format( "expecting r size of 2 or 3, but got {}", r.size() ) );
+            better_assert( l[2] == *(r.rbegin()+1), fmt::format( "expecting l[2] == r[-2], but l[2]={}, r[-2]={}", l[2], *(r.rbegin()+1) ) );
+            return std::vector<unsigned long>{ {l[0], l[1], *(r.rbegin())} };
+        };
+        std::shared_ptr<std::any> forward_cache = std::make_shared<std::any>();
+        std::shared_ptr<std::any> backward_cache_lhs = std::make_shared<std::any>();
+        std::shared_ptr<std::any> backward_cache_rhs = std::make_shared<std::any>();
+        return make_binary_operator( batched_multiplication_context{}.make_forward()(forward_cache), batched_multiplication_context{}.make_backward()(backward_cache_lhs, backward_cache_rhs), "BatchedMatmul", shape_calculator )( lhs_ex, rhs_ex );
+    }
+
+    namespace ceras_private
+    {
+        // activations fused into a dense operator, their derivatives can all be computed from the output
+        enum class dense_activation { linear, relu, leaky_relu, sigmoid, tanh };
+
+        inline dense_activation make_dense_activation( std::string const& activation )
+        {
+            if ( activation == "linear" || activation.empty() ) return dense_activation::linear;
+            if ( activation == "relu" ) return dense_activation::relu;
+            if ( activation == "leaky_relu" ) return dense_activation::leaky_relu;
+            if ( activation == "sigmoid" ) return dense_activation::sigmoid;
+            if ( activation == "tanh" ) return dense_activation::tanh;
+            better_assert( false, "Unknown activation for dense: ", activation );
+            return dense_activation::linear;
+        }
+
+        inline dense_activation make_folded_dense_activation( folded_activation activation ) noexcept
+        {
+            if ( activation == folded_activation::relu ) return dense_activation::relu;
+            if ( activation == folded_activation::leaky_relu ) return dense_activation::leaky_relu;
+            return dense_activation::linear;
+        }
+
+        //
+        // A dense layer is two nodes in the graph, `Dense( DenseInput( x, b ), w )`.
+        // `DenseInput` forwards the input `x` and keeps the bias `b` in a shared context,
+        // then `Dense` runs the GEMM with the bias and the activation applied in the GEMM epilogue.
+        // In the backward pass, `Dense` computes the gradient of the activation in one pass over the output, reduces it along the batch into the
+        // gradient of the bias with the engine of `backend/reduction.hpp`,
+        // accumulates the gradient of `w` into the gradient buffer of `w` directly when `w` is a trainable variable,
+        // and `DenseInput` dispatches the gradients to `x` and `b`.
+        //
+        // The arithmetic, including the order of the bias-gradient summation, is the same as the one of `activation( x * w + b )`.
+        //
+        struct dense_context
+        {
+            dense_activation activation_;
+            double factor_; // for leaky_relu
+
+            template< typename T >
+            void activate( T* ptr, T const* bias, unsigned long cols ) const noexcept
+            {
+                T const factor = static_cast<T>( factor_ );
+                switch ( activation_ )
+                {
+                    case dense_activation::linear:
+                        for ( unsigned long c = 0; c != cols; ++c ) ptr[c] = ptr[c] + bias[c];
+                        break;
+                    case dense_activation::relu:
+                        for ( unsigned long c = 0; c != cols; ++c ) ptr[c] = std::max( T{ptr[c] + bias[c]}, T{0} );
+                        break;
+                    case dense_activation::leaky_relu:
+                        for ( unsigned long c = 0; c != cols; ++c ) { T const x = ptr[c] + bias[c]; ptr[c] = std::max( x, T{factor*x} ); }
+                        break;
+                    case dense_activation::sigmoid:
+                        backend::vector_math::transform( []( auto x, auto b ){ return backend::vector_math::sigmoid( x + b ); }, cols, ptr, ptr, bias );
+                        break;
+                    case dense_activation::tanh:
+                        backend::vector_math::transform( []( auto x, auto b ){ return backend::vector_math::tanh( x + b ); }, cols, ptr, ptr, bias );
+                        break;
+                }
+            }
+
+            // gradient w.r.t. the pre-activation, from the gradient `g` w.r.t. the output `o`
+            template< typename T >
+            T derivative( T o, T g ) const noexcept
+            {
+                switch ( activation_ )
+                {
+                    case dense_activation::relu:
+                        return g * ( o > T{0} );
+                    case dense_activation::leaky_relu:
+                        return ( o > T{0} ) ? g : static_cast<T>( factor_ ) * g;
+                    case dense_activation::sigmoid:
+                        return g * o * ( T{1} - o );
+                    case dense_activation::tanh:
+                        return g * (1.0-o*o);
+                    default:
+                        return g;
+                }
+            }
+
+            auto make_input_forward() const noexcept
+            {
+                return []( std::shared_ptr<std::any> bias_cache ) noexcept
+                {
+                    return [bias_cache]<Tensor Tsor>( Tsor const& x, Tsor const& b ) noexcept
+                    {
+                        context_cast<Tsor>( bias_cache ) = b; // shallow copy
+                        return x;
+                    };
+                };
+            }
+
+            auto make_input_backward() const noexcept
+            {
+                return []( std::shared_ptr<std::any> bias_gradient_cache ) noexcept
+                {
+                    return [bias_gradient_cache]<Tensor Tsor>( Tsor const&, Tsor const&, Tsor const&, Tsor const& grad ) noexcept
+                    {
+                        return std::make_tuple( grad, context_extract<Tsor>( bias_gradient_cache ) );
+                    };
+                };
+            }
+
+            auto make_forward() const noexcept
+            {
+                return [*this]( std::shared_ptr<std::any> forward_cache, std::shared_ptr<std::any> bias_cache, std::shared_ptr<quantization_state> quantization,
+                                std::shared_ptr<folding_state> folding ) noexcept
+                {
+                    return [=, *this]<Tensor Tsor>( Tsor const& x, Tsor const& w ) noexcept
+                    {
+                        typedef typename Tsor::value_type value_type;
+                        if ( folding->folded_head() ) // the per-channel operators and the activation following are folded in, see `folding.hpp`
+                        {
+                            folded_chain const& chain = *(folding->chain);
+                            dense_context const folded_context{ make_folded_dense_activation( chain.activation ), chain.factor };
+                            Tsor& ans = context_cast<Tsor>( forward_cache );
+                            Tsor const& folded_w = std::any_cast<Tsor const&>( chain.kernel );
+                            unsigned long const k = *(folded_w.shape().rbegin());
+                            ans.resize( {*(x.shape().begin()), k} );
+                            value_type const* bias = std::any_cast<Tsor const&>( chain.bias ).data();
+                            gemm( x.data(), false, folded_w.data(), false, *(x.shape().begin()), *(x.shape().rbegin()), k, ans.data(),
+                                  [&folded_context, bias]( value_type* ptr, unsigned long, unsigned long col, unsigned long cols )
+                            {
+                                folded_context.activate( ptr, bias + col, cols );
+                            } );
+                            return ans;
+                        }
+
+                        Tsor const& b = context_extract<Tsor>( bias_cache );
+                        unsigned long const m = *(x.shape().begin());
+                        unsigned long const n = *(x.shape().rbegin());
+                        unsigned long const k = *(w.shape().rbegin());
+                        better_assert( n == *(w.shape().begin()), fmt::format( "dense: expecting x.shape[-1] == w.shape[0], but got {} and {}", n, *(w.shape().begin()) ) );
+                        better_assert( k == b.size(), fmt::format( "dense: expecting bias of size {}, but got {}", k, b.size() ) );
+
+                        Tsor& ans = context_cast<Tsor>( forward_cache );
+                        ans.resize( {m, k} );
+                        value_type const* bias = b.data();
+
+                        if constexpr( std::is_same_v<value_type, float> )
+                        {
+                            if ( auto& calibration = get_quantization_calibration(); calibration.active )
+                            {
+                                calibration.record( quantization );
+                                quantization->calibrate( x.data(), m, n, n, 1, w.data(), k, k, 1 );
+                            }
+                            else if ( learning_phase == 0 && quantization->enabled )
+                            {
+                                value_type* output = ans.data();
+                                quantization->run( x.data(), m, n, 1, [this, bias, output, k]( float const* values, unsigned long row, unsigned long col, unsigned long cols )
+                                {
+                                    value_type* ptr = output + row * k + col;
+                                    std::copy_n( values, cols, ptr );
+                                    activate( ptr, bias + col, cols );
+                                } );
+                                return ans;
+                            }
+                        }
+
+                        gemm( x.data(), false, w.data(), false, m, n, k, ans.data(), [this, bias]( value_type* ptr, unsigned long, unsigned long col, unsigned long cols )
+                        {
+                            activate( ptr, bias + col, cols );
+                        } );
+                        if ( auto& trace = get_folding_trace(); trace.active && activation_ == dense_activation::linear )
+                            trace.record( folding_kind::dense, folding, x, &w, ans, { w, b } );
+                        return ans;
+                    };
+                };
+            }
+
+            auto make_backward() const noexcept
+            {
+                return [*this]( std::shared_ptr<std::any> backward_cache_lhs, std::shared_ptr<std::any> backward_cache_rhs,
+                                std::shared_ptr<std::any> backward_cache_z, std::shared_ptr<std::any> bias_cache, std::shared_ptr<std::any> bias_gradient_cache ) noexcept
+                {
+                    return [=, *this]<Tensor Tsor>( Tsor const& x, Tsor const& w, Tsor const& output, Tsor const& grad, Tsor* = nullptr, Tsor* w_target = nullptr ) noexcept
+                    {
+                        typedef typename Tsor::value_type value_type;
+                        unsigned long const m = *(x.shape().begin());
+                        unsigned long const n = *(x.shape().rbegin());
+                        unsigned long const k = *(w.shape().rbegin());
+
+                        // gradient of the pre-activation, then of the bias, reduced as `sum( z_grad, 0 )`, see `backend/reduction.hpp`
+                        Tsor& z_grad = context_cast<Tsor>( backward_cache_z );
+                        if ( activation_ == dense_activation::linear )
+                            z_grad = grad; // shallow copy
+                        else
+                        {
+                            z_grad.resize( grad.shape() );
+                            for_each( z_grad.begin(), z_grad.end(), output.begin(), grad.begin(), [this]( value_type& dz, value_type o, value_type g ){ dz = derivative( o, g ); } );
+                        }
+
+                        Tsor& b_grad = context_cast<Tsor>( bias_gradient_cache );
+                        b_grad.resize( context_extract<Tsor>( bias_cache ).shape() );
+                        typedef accumulator_t<value_type> accumulator_type;
+                        backend::reduce_axis<accumulator_type>( z_grad.data(), 1UL, m, k, []( value_type x ){ return static_cast<accumulator_type>( x ); }, std::plus<accumulator_type>{}, b_grad.data() );
+
+                        // left branch <-- z_grad * w^T
+                        Tsor& x_grad = context_cast<Tsor>( backward_cache_lhs );
+                        x_grad.resize( x.shape() );
+                        gemm( z_grad.data(), false, w.data(), true, m, k, n, x_grad.data() );
+
+                        // right branch <-- x^T * z_grad, into the gradient of w if possible
+                        Tsor& w_grad = context_cast<Tsor>( backward_cache_rhs );
+                        if ( !w_target )
+                            w_grad.resize( w.shape() );
+                        gemm( x.data(), true, z_grad.data(), false, n, m, k, w_target ? w_target->data() : w_grad.data(), value_type{1}, w_target ? value_type{1} : value_type{0} );
+
+                        return std::make_tuple( x_grad, w_grad );
+                    };
+                };
+            }
+        };//dense_context
+    }//namespace ceras_private
+
+    ///
+    /// @brief Densely-connected operator with a fused bias and activation, computing `activation( x * w + b )`.
+    ///
+    /// The bias and the activation are applied while the GEMM result is still in cache. In the backward pass, the activation gradient is computed in one pass,
+    /// then reduced along the batch into the bias gradient by the pairwise reduction of `sum( z_grad, 0 )`.
+    /// The result is numerically identical to `activation( x * w + b )`.
+    /// After `model::quantize`, the inference runs on int8 inputs and weights, see `quantization.hpp`.
+    ///
+    /// @param activation The activation, one of `linear`, `relu`, `leaky_relu`, `sigmoid` and `tanh`. Defaults to `linear`.
+    /// @param factor The negative slope of `leaky_relu`. Defaults to 0.2.
+    /// @return A function taking the input `x` of shape [BS, N], the kernel `w` of shape [N, K] and the bias `b` of K elements.
+    ///
+    /// Example code:
+    /// \code{.cpp}
+    /// auto x = place_holder<tensor<float>>{};
+    /// auto w = variable{ random<float>( {784, 10} ) };
+    /// auto b = variable{ zeros<float>( {1, 10} ) };
+    /// auto y = dense( "relu" )( x, w, b ); // same as `relu( x * w + b )`
+    /// \endcode
+    ///
+    inline auto dense( std::string const& activation = "linear", double factor = 0.2 )
+    {
+        ceras_private::dense_context const context{ ceras_private::make_dense_activation( activation ), factor };
+        return [context]<Expression Ex, Expression Ew, Expression Eb>( Ex const& ex, Ew const& ew, Eb const& eb ) noexcept
+        {
+            std::shared_ptr<std::any> forward_cache = std::make_shared<std::any>();
+            std::shared_ptr<std::any> backward_cache_lhs = std::make_shared<std::any>();
+            std::shared_ptr<std::any> backward_cache_rhs = std::make_shared<std::any>();
+            std::shared_ptr<std::any> backward_cache_z = std::make_shared<std::any>();
+            std::shared_ptr<std::any> bias_cache = std::make_shared<std::any>();
+            std::shared_ptr<std::any> bias_gradient_cache = std::make_shared<std::any>();
+            std::shared_ptr<quantization_state> quantization = std::make_shared<quantization_state>();
+
+            auto const& input_shape_calculator = []( std::vector<unsigned long> const& x, std::vector<unsigned long> const& ) noexcept
+            {
+                return x;
+            };
+            auto const& input = make_binary_operator( context.make_input_forward()( bias_cache ), context.make_input_backward()( bias_gradient_cache ),
+                                                      "DenseInput", input_shape_calculator )( ex, eb );
+
+            auto const& shape_calculator = []( std::vector<unsigned long> const& x, std::vector<unsigned long> const& w ) noexcept
+            {
+                better_assert( x.size() == 2, fmt::format( "expecting x size of 2, but got {}", x.size() ) );
+                better_assert( w.size() == 2, fmt::format( "expecting w size of 2, but got {}", w.size() ) );
+                return std::vector<unsigned long>{ {x[0], w[1]} };
+            };
+            std::shared_ptr<folding_state> folding = std::make_shared<folding_state>();
+            return make_binary_operator( context.make_forward()( forward_cache, bias_cache, quantization, folding ),
+                                         context.make_backward()( backward_cache_lhs, backward_cache_rhs, backward_cache_z, bias_cache, bias_gradient_cache ),
+                                         "Dense", shape_calculator )( input, ew );
+        };
+    }
+
 
     ///
     /// @brief Negative operator, elementwise.
@@ -607,9 +1038,15 @@ namespace ceras
     template< Expression Lhs_Expression, Expression Rhs_Expression >
     auto constexpr elementwise_product( Lhs_Expression const& lhs_ex, Rhs_Expression const& rhs_ex ) noexcept
     {
-        return make_binary_operator( []<Tensor Tsor>( Tsor const& lhs_tensor, Tsor const& rhs_tensor ) noexcept
+        std::shared_ptr<folding_state> folding = std::make_shared<folding_state>();
+        return make_binary_operator( [folding]<Tensor Tsor>( Tsor const& lhs_tensor, Tsor const& rhs_tensor ) noexcept
                                      {
-                                        return elementwise_product( lhs_tensor, rhs_tensor );
+                                        if ( folding->folded() ) // a scale folded into the preceding Conv2D or Dense, see `folding.hpp`
+                                            return folding->operand ? rhs_tensor : lhs_tensor;
+                                        Tsor ans = elementwise_product( lhs_tensor, rhs_tensor );
+                                        if ( auto& trace = get_folding_trace(); trace.active )
+                                            trace.record( folding_kind::multiply, folding, lhs_tensor, &rhs_tensor, ans, { lhs_tensor, rhs_tensor } );
+                                        return ans;
                                      },
                                      []<Tensor Tsor>( Tsor const& lhs_input, Tsor const& rhs_input, Tsor const&, Tsor const grad ) noexcept
                                      {
@@ -1209,103 +1646,149 @@ namespace ceras
         )( ex );
     }
 
-    auto inline img2col( unsigned long const row_kernel, unsigned long col_kernel=-1,
-                         unsigned long const row_padding=0, unsigned long col_padding=0,
-                         unsigned long const row_stride=1, unsigned long const col_stride=1,
-                         unsigned long const row_dilation=1, unsigned long const col_dilation=1 ) noexcept
+    namespace ceras_private
     {
-        if ( col_kernel == (unsigned long)-1 ) col_kernel = row_kernel;
-
-        std::shared_ptr<std::vector<std::uint32_t>> s_index_record = std::make_shared<std::vector<std::uint32_t>>(); // col_img[idx] = img[index_record[idx]]  -- (-1) for zero padding
-
-        auto img2col_forward = [s_index_record]<Tensor Tsor>
-        (
-            Tsor const& input_img, Tsor& output_col_mat,
-            unsigned long kernel_row, unsigned long kernel_col,
-            unsigned long padding_row, unsigned long padding_col,
-            unsigned long stride_row, unsigned long stride_col,
-            unsigned long dilation_row, unsigned long dilation_col
-        ) noexcept
+        // index_record[c*new_R*new_C+h*new_C+w] is the offset in one input sample of the element at row c and column (h, w) of the img2col matrix of that sample, 0xffffffff for the zero padding
+        inline void make_img2col_index( backend::conv2d_geometry const& g, std::vector<std::uint32_t>& index_record )
         {
-            typedef typename Tsor::value_type value_type;
-            std::vector<std::uint32_t>& index_record = *s_index_record; //32 bit should be enough for memory address offeset
-
-            std::vector<unsigned long> input_shape = input_img.shape();
-            better_assert( input_shape.size() == 4, "Expecting a 4D tensor." );
-            auto const [BS, R, C, CH] = std::make_tuple( input_shape[0], input_shape[1], input_shape[2], input_shape[3] );
-
-            unsigned long const output_row = ( R + 2 * padding_row - ( dilation_row * (kernel_row - 1) + 1 ) ) / stride_row + 1;
-            unsigned long const output_col = ( C + 2 * padding_col - ( dilation_col * (kernel_col - 1) + 1 ) ) / stride_col + 1;
-            unsigned long const output_column_matrix_row = kernel_row * kernel_col * CH;
-            unsigned long const output_column_matrix_col = BS * output_row * output_col;
+            unsigned long const output_row = g.output_rows();
+            unsigned long const output_col = g.output_cols();
+            unsigned long const sample_pixels = output_row * output_col;
+            index_record.resize( g.depth() * sample_pixels ); //32 bit should be enough for memory address offeset
 
-            output_col_mat.resize( {output_column_matrix_row, output_column_matrix_col} );
-
-            if ( index_record.size() != output_column_matrix_row * output_column_matrix_col ) // first-run?
+            parallel( [&]( unsigned long c )
             {
-                index_record.resize( output_column_matrix_row * output_column_matrix_col );
-
-                for ( auto bs : range( BS ) )
+                std::int64_t const w_offset = c % g.kernel_cols;
+                std::int64_t const h_offset = ( c / g.kernel_cols ) % g.kernel_rows;
+                std::int64_t const c_im = c / g.taps();
+                std::int64_t const R = g.rows;
+                std::int64_t const C = g.cols;
+                std::uint32_t* record = index_record.data() + c * sample_pixels;
+                for ( auto h : range( output_row ) )
                 {
-                    std::int64_t const col_offset = bs * output_row * output_col * kernel_row * kernel_col * CH;
-                    std::int64_t const im_offset = bs * R * C * CH;
-                    for ( auto c : range( CH * kernel_row * kernel_col ) )
+                    std::int64_t const im_row_idx = static_cast<std::int64_t>( h * g.row_stride + h_offset * g.row_dilation ) - static_cast<std::int64_t>( g.row_padding );
+                    for ( auto w : range( output_col ) )
                     {
-                        std::int64_t const w_offset = c % kernel_col;
-                        std::int64_t const h_offset = ( c / kernel_col ) % kernel_row;
-                        std::int64_t const c_im = c / ( kernel_col * kernel_row );
-
-                        for ( auto h : range( output_row ) )
-                        {
-                            std::int64_t const im_row_idx = h * stride_row - padding_row + h_offset * dilation_row;
-                            for ( auto w : range( output_col ) )
-                            {
-                                std::int64_t const im_col_idx = w * stride_col - padding_col + w_offset * dilation_col;
-                                std::int64_t const im_idx = im_offset+( im_row_idx * C + im_col_idx ) * CH + c_im;
-                                std::int64_t const col_idx = col_offset+( c * output_row + h ) * output_col + w;
-                                index_record[col_idx] = static_cast<std::uint32_t>((im_row_idx<0 || im_row_idx>=static_cast<std::int64_t>(R) || im_col_idx<0 || im_col_idx>=static_cast<std::int64_t>(C)) ? 0xffffffff : im_idx);
-                            }
-                        }
+                        std::int64_t const im_col_idx = static_cast<std::int64_t>( w * g.col_stride + w_offset * g.col_dilation ) - static_cast<std::int64_t>( g.col_padding );
+                        std::int64_t const im_idx = ( im_row_idx * C + im_col_idx ) * static_cast<std::int64_t>( g.channels ) + c_im;
+                        *record++ = ( im_row_idx<0 || im_row_idx>=R || im_col_idx<0 || im_col_idx>=C ) ? 0xffffffff : static_cast<std::uint32_t>( im_idx );
                     }
                 }
-                // re-arrange [bs, new_R, new_C] --> [new_R, new_c*bs]
+            }, 0UL, g.depth() );
+        }
+
+        //
+        // Per-layer cache of the img2col index records, keyed by the geometry of a single sample.
+        //
+        // As the index is built per sample, changing the batch size (training, the shorter last batch, then serving one sample at a time) reuses the same record;
+        // a few other spatial shapes are kept in a small least-recently-used list.
+        //
+        struct img2col_index_cache
+        {
+            static constexpr unsigned long capacity = 4;
+            std::vector<std::pair<backend::conv2d_geometry, std::vector<std::uint32_t>>> entries; // most recently used first
+
+            std::vector<std::uint32_t> const& operator()( backend::conv2d_geometry g )
+            {
+                g.batch = 1;
+                g.new_channels = 0;
+                auto itor = std::find_if( entries.begin(), entries.end(), [&g]( auto const& entry ){ return entry.first == g; } );
+                if ( itor == entries.end() )
                 {
-                    std::vector<std::uint32_t> re_arranged_index;
-                    re_arranged_index.resize( index_record.size() );
-
-                    view_3d<std::uint32_t> re_arranged_mat{ re_arranged_index.data(), output_column_matrix_row, BS, output_row*output_col };
-                    view_3d<std::uint32_t> index_record_mat{ index_record.data(), BS, output_column_matrix_row, output_row*output_col };
-
-                    for ( auto bs : range( BS ) )
-                        for ( auto r : range( output_column_matrix_row ) )
-                            for ( auto c : range( output_row*output_col ) )
-                                re_arranged_mat[r][bs][c] = index_record_mat[bs][r][c];
-                    // overwrite index record
-                    std::copy( re_arranged_index.begin(), re_arranged_index.end(), index_record.begin() );
+                    if ( entries.size() == capacity )
+                        entries.pop_back();
+                    entries.emplace_back( g, std::vector<std::uint32_t>{} );
+                    itor = entries.end() - 1;
+                    make_img2col_index( g, itor->second );
                 }
+                std::rotate( entries.begin(), itor, itor+1 );
+                return entries.front().second;
             }
+        };
 
-            // fill-in
-            for ( auto idx : range( output_col_mat.size() ) )
+        // columns[(c*BS+bs)*new_R*new_C+hw] <= input[bs*R*C*CH+index_record[c*new_R*new_C+hw]], or 0 for the zero padding
+        template< typename T >
+        void img2col_fill( T const* input, std::vector<std::uint32_t> const& index_record, backend::conv2d_geometry const& g, T* columns ) noexcept
+        {
+            unsigned long const sample_pixels = g.output_rows() * g.output_cols();
+            unsigned long const sample_size = g.rows * g.cols * g.channels;
+            unsigned long const batch = g.batch;
+            parallel( [=, &index_record]( unsigned long row )
             {
-                auto const index = index_record[idx];
-                output_col_mat[idx] = (index == 0xffffffff) ? value_type{0} : input_img[index];
-            }
+                unsigned long const c = row / batch;
+                T const* sample = input + ( row % batch ) * sample_size;
+                std::uint32_t const* record = index_record.data() + c * sample_pixels;
+                T* column = columns + row * sample_pixels;
+                for ( auto hw : range( sample_pixels ) )
+                {
+                    auto const index = record[hw];
+                    column[hw] = (index == 0xffffffff) ? T{0} : sample[index];
+                }
+            }, 0UL, g.depth() * batch );
+        }
+
+        // input_grad[bs*R*C*CH+index_record[c*new_R*new_C+hw]] += column_grad[(c*BS+bs)*new_R*new_C+hw], except for the zero padding
+        //
+        // The rows c of the img2col matrix with c/(r*c) == ch only scatter to the input channel ch, so the tasks (bs, ch) never write to the same element;
+        // inside a task the rows are summed in a fixed order, which keeps the result independent of the number of threads.
+        template< typename T >
+        void col2im_accumulate( T const* column_grad, std::vector<std::uint32_t> const& index_record, backend::conv2d_geometry const& g, T* input_grad ) noexcept
+        {
+            unsigned long const sample_pixels = g.output_rows() * g.output_cols();
+            unsigned long const sample_size = g.rows * g.cols * g.channels;
+            unsigned long const batch = g.batch;
+            unsigned long const taps = g.taps();
+            parallel( [=, &index_record]( unsigned long task )
+            {
+                unsigned long const bs = task % batch;
+                unsigned long const ch = task / batch;
+                T* sample = input_grad + bs * sample_size;
+                for ( auto c : range( ch * taps, ( ch + 1 ) * taps ) )
+                {
+                    std::uint32_t const* record = index_record.data() + c * sample_pixels;
+                    T const* column = column_grad + ( c * batch + bs ) * sample_pixels;
+                    for ( auto hw : range( sample_pixels ) )
+                    {
+                        auto const index = record[hw];
+                        if ( index != 0xffffffff )
+                            sample[index] += column[hw];
+                    }
+                }
+            }, 0UL, g.channels * batch, 1UL );
+        }
+    }//namespace ceras_private
+
+    auto inline img2col( unsigned long const row_kernel, unsigned long col_kernel=-1,
+                         unsigned long const row_padding=0, unsigned long col_padding=0,
+                         unsigned long const row_stride=1, unsigned long const col_stride=1,
+                         unsigned long const row_dilation=1, unsigned long const col_dilation=1 ) noexcept
+    {
+        if ( col_kernel == (unsigned long)-1 ) col_kernel = row_kernel;
+
+        std::shared_ptr<ceras_private::img2col_index_cache> s_index_cache = std::make_shared<ceras_private::img2col_index_cache>();
+
+        auto make_geometry = [=]( std::vector<unsigned long> const& input_shape ) noexcept
+        {
+            better_assert( input_shape.size() == 4, "Expecting a 4D tensor." );
+            return backend::conv2d_geometry{ input_shape[0], input_shape[1], input_shape[2], input_shape[3], 0UL, row_kernel, col_kernel,
+                                             row_stride, col_stride, row_padding, col_padding, row_dilation, col_dilation };
+        };
+
+        auto img2col_forward = [s_index_cache, make_geometry]<Tensor Tsor>( Tsor const& input_img, Tsor& output_col_mat ) noexcept
+        {
+            backend::conv2d_geometry const g = make_geometry( input_img.shape() );
+            output_col_mat.resize( {g.depth(), g.pixels()} );
+            ceras_private::img2col_fill( input_img.data(), (*s_index_cache)( g ), g, output_col_mat.data() );
         };
 
-        auto img2col_backward = [s_index_record]<Tensor Tsor>( Tsor const& input, Tsor const&, Tsor const& grad, Tsor& ans ) noexcept
+        auto img2col_backward = [s_index_cache, make_geometry]<Tensor Tsor>( Tsor const& input, Tsor const&, Tsor const& grad, Tsor& ans ) noexcept
         {
             typedef typename Tsor::value_type value_type;
             ans.resize( input.shape() );
             std::fill( ans.begin(), ans.end(), value_type{0} );
 
-            std::vector<std::uint32_t>& index_record = *s_index_record; //32 bit should be enough for memory address offeset
-            for ( auto idx : range( grad.size() ) )
-            {
-                auto const index = index_record[idx];
-                if ( index != 0xffffffff )
-                    ans[index] += grad[idx];
-            }
+            backend::conv2d_geometry const g = make_geometry( input.shape() );
+            ceras_private::col2im_accumulate( grad.data(), (*s_index_cache)( g ), g, ans.data() );
         };
 
         std::shared_ptr<std::any> output_cache = std::make_shared<std::any>();
@@ -1318,7 +1801,7 @@ namespace ceras
                 [=]<Tensor Tsor>( Tsor const & tsor ) noexcept
                 {
                     Tsor& output = context_cast<Tsor>( output_cache );
-                    img2col_forward( tsor, output, row_kernel, col_kernel, row_padding, col_padding, row_stride, col_stride, row_dilation, col_dilation );
+                    img2col_forward( tsor, output );
                     return Tsor{output};
                 },
                 [=]<Tensor Tsor>( Tsor const& input, Tsor const& output, Tsor const& grad ) noexcept
@@ -1343,62 +1826,535 @@ namespace ceras
         };
     }
 
-    auto inline conv2d
-    (
-        unsigned long row_input, unsigned long col_input,
-        unsigned long const row_stride=1, unsigned long const col_stride=1,
-        unsigned long const row_dilation=1, unsigned long const col_dilation=1,
-        std::string const& padding="valid"
-    ) noexcept
+    namespace ceras_private
     {
-        // lhs_ex is for one 4D tensor of [BS, R, C, CH]
-        // rhs_ex is for NC 4D filter of [1, r, c, CH], thus the shape is [NC, r, c, CH]
-        // the output tensor is of shape [BS, .., .., NC]
-        //
-        // Note: the rhs expression is fixed as a variable, as we need to extract the kernel shape from it
-        //
-        //return [row_input, col_input, row_stride, col_stride, row_dilation, col_dilation, padding ]<Expression Ex, Variable Va>( Ex const& lhs_ex, Va const& rhs_ex ) noexcept
-        return [row_input, col_input, row_stride, col_stride, row_dilation, col_dilation, padding ]<Expression Ex, Expression Ey>( Ex const& lhs_ex, Ey const& rhs_ex ) noexcept
+        ///
+        /// @brief The rows and columns a `zero_padding_2d` adds (positive) or a `cropping_2d` removes (negative) on every side of a [BS, R, C, CH] tensor.
+        ///
+        /// It is the output shape calculator of both operators, so that a convolution can recognize them and read their input through the window instead.
+        ///
+        struct window_2d
         {
-            std::vector<unsigned long> const& shape = rhs_ex.shape();
-            better_assert( shape.size() == 4 );
-            auto const[new_channel, row_kernel, col_kernel, channel] = std::make_tuple( shape[0], shape[1], shape[2], shape[3] );
-            //TODO: optimization in case of small kernels of (1, 1), (3, 3)
-            unsigned long row_padding = 0;
-            unsigned long col_padding = 0;
-            if ( padding == "same" )
+            long top = 0;
+            long bottom = 0;
+            long left = 0;
+            long right = 0;
+
+            bool empty() const noexcept { return top == 0 && bottom == 0 && left == 0 && right == 0; }
+
+            // a zero padding of the same size on the opposite sides, which the convolutions add to their own padding
+            bool symmetric() const noexcept { return top == bottom && left == right && top >= 0 && left >= 0; }
+
+            std::vector<unsigned long> operator()( std::vector<unsigned long> const& shape ) const noexcept
             {
-                unsigned long const row_padding_total = (row_kernel + (row_kernel - 1) * (row_dilation - 1) - row_stride);
-                better_assert( !(row_padding_total & 0x1), "Expecting total row padding to be even, but got ", row_padding_total, " With row input ", row_input, " and row_stride ", row_stride );
-                unsigned long const col_padding_total = (col_kernel + (col_kernel - 1) * (col_dilation - 1) - col_stride);
-                better_assert( !(col_padding_total & 0x1), "Expecting total col padding to be even, but got ", col_padding_total );
-                row_padding = ((row_kernel&1)+row_padding_total) >> 1;
-                col_padding = ((col_kernel&1)+col_padding_total) >> 1;
+                return std::vector<unsigned long>{ {shape[0], static_cast<unsigned long>( static_cast<long>( shape[1] ) + top + bottom ),
+                                                    static_cast<unsigned long>( static_cast<long>( shape[2] ) + left + right ), shape[3]} };
             }
+        };
 
-            unsigned long const row_output = ( row_input + 2 * row_padding - ( row_dilation * (row_kernel - 1) + 1 ) ) / row_stride + 1;
-            unsigned long const col_output = ( col_input + 2 * row_padding - ( col_dilation * (col_kernel - 1) + 1 ) ) / col_stride + 1;
-
-            auto lhs_ex_as_col = img2col(row_kernel, col_kernel, row_padding, col_padding, row_stride, col_stride, row_dilation, col_dilation)( lhs_ex ); // [BS, R, C, CH] ==> [r*c*CH, BS*new_row*new_col]
+        template< typename T >
+        struct is_window_2d_operator : std::false_type {};
 
-            auto rhs_ex_flatten = reshape({row_kernel*col_kernel*channel,})( rhs_ex ); // [NC, r, c, CH] ==> [NC, r*c*CH]
+        template< typename Operator, typename Forward_Action, typename Backward_Action >
+        struct is_window_2d_operator< unary_operator<Operator, Forward_Action, Backward_Action, window_2d> > : std::true_type {};
 
-            auto flatten_output = rhs_ex_flatten * lhs_ex_as_col; // [NC, BS * new_row * new_col]
+        template< typename T >
+        inline constexpr bool is_window_2d_operator_v = is_window_2d_operator<T>::value;
 
-            auto tr_output = transpose( flatten_output ); // [BS*new_row*new_col, NC]
+        enum class conv2d_algorithm
+        {
+            pointwise,  // 1x1 kernel, unit strides and no padding: a GEMM on the input itself
+            direct,     // 1x1 and 3x3 kernels, see `backend/direct_conv2d.hpp`
+            winograd_2x2, // 3x3 kernels with unit strides and many channels, see `backend/winograd_conv2d.hpp`
+            winograd_4x4, // as `winograd_2x2`, with larger output tiles
+            implicit_gemm, // any other kernel, see `backend/implicit_gemm_conv2d.hpp`
+            img2col,    // any kernel, as the img2col matrix of the input and a GEMM, the only choice besides `pointwise` for the types without the other kernels
+            grouped     // grouped and depthwise convolutions, see `backend/grouped_conv2d.hpp`
+        };
 
-            auto ans = reshape({row_output, col_output, new_channel})( tr_output );
+        inline std::string conv2d_algorithm_name( conv2d_algorithm algorithm )
+        {
+            switch ( algorithm )
+            {
+                case conv2d_algorithm::pointwise: return "pointwise";
+                case conv2d_algorithm::direct: return "direct";
+                case conv2d_algorithm::winograd_2x2: return "winograd_2x2";
+                case conv2d_algorithm::winograd_4x4: return "winograd_4x4";
+                case conv2d_algorithm::implicit_gemm: return "implicit_gemm";
+                case conv2d_algorithm::img2col: return "img2col";
+                case conv2d_algorithm::grouped: return "grouped";
+            }
+            return "unknown";
+        }
 
-            return ans;
+        template< typename T >
+        struct conv2d_workspace
+        {
+            backend::direct_conv2d_workspace<T> direct;
+            backend::winograd_conv2d_workspace<T> winograd;
+            backend::implicit_gemm_conv2d_workspace<T> implicit_gemm;
+            backend::grouped_conv2d_workspace<T> grouped;
+            T const* filter_source = nullptr;           // kernel of `winograd.filter_transform`
+            unsigned long filter_generation = 0;        // `variable_data_generation` when `winograd.filter_transform` was computed
+            conv2d_algorithm filter_algorithm = conv2d_algorithm::implicit_gemm;
+            backend::conv2d_geometry filter_geometry{};
+            img2col_index_cache index_cache;
+            std::vector<T> columns;                     // img2col matrix of the int8 inference, and of the types without a packed GEMM kernel
+            std::vector<T> window_input;                // input seen through an asymmetric or cropping window, see `conv2d_context::window_`
+            std::vector<T> window_gradient;             // gradient of `window_input`
+            bool tuned = false;                         // `tuned_algorithm` was timed the fastest for `tuned_geometry` in the learning phase `tuned_training`
+            bool tuned_training = false;
+            backend::conv2d_geometry tuned_geometry{};
+            conv2d_algorithm tuned_algorithm = conv2d_algorithm::implicit_gemm;
         };
-    }
 
+        struct conv2d_context
+        {
+            unsigned long row_stride_;
+            unsigned long col_stride_;
+            unsigned long row_padding_;
+            unsigned long col_padding_;
+            unsigned long row_dilation_;
+            unsigned long col_dilation_;
+            unsigned long groups_ = 1;  // the input channels and the kernels are split into `groups_` groups, the kernels being [NC, r, c, CH/groups_]
+            window_2d window_{};        // a zero padding or a cropping of the input folded into the convolution
+            bool variable_kernel_ = false; // the kernel is a variable, or folded from variables, any change of which bumps `variable_data_generation`
+
+            // the geometry of the convolution of the input x seen through the window: a symmetric padding is added to the padding of the convolution,
+            // otherwise the convolution runs unpadded on `window_input`, which holds both paddings
+            backend::conv2d_geometry geometry( std::vector<unsigned long> const& x, std::vector<unsigned long> const& kernel ) const noexcept
+            {
+                better_assert( x.size() == 4, fmt::format( "conv2d: expecting a 4D input, but got {} dimensions", x.size() ) );
+                better_assert( kernel.size() == 4, fmt::format( "conv2d: expecting a 4D kernel, but got {} dimensions", kernel.size() ) );
+                better_assert( x[3] == kernel[3] * groups_, fmt::format( "conv2d: expecting x.shape[3] == kernel.shape[3] * {}, but got {} and {}", groups_, x[3], kernel[3] ) );
+                better_assert( kernel[0] % groups_ == 0, fmt::format( "conv2d: expecting the {} kernels to be divisible into {} groups", kernel[0], groups_ ) );
+                backend::conv2d_geometry g{ x[0], x[1], x[2], x[3], kernel[0], kernel[1], kernel[2],
+                                            row_stride_, col_stride_, row_padding_, col_padding_, row_dilation_, col_dilation_ };
+                if ( window_.symmetric() )
+                {
+                    g.row_padding += window_.top;
+                    g.col_padding += window_.left;
+                    return g;
+                }
+                std::vector<unsigned long> const& windowed = window_( x );
+                g.rows = windowed[1] + 2 * row_padding_;
+                g.cols = windowed[2] + 2 * col_padding_;
+                g.row_padding = 0;
+                g.col_padding = 0;
+                return g;
+            }
+
+            // the input of the convolution of geometry g, the input x being copied to `window_input` when not read through the geometry itself
+            template< typename T >
+            T const* window_input( T const* x, std::vector<unsigned long> const& x_shape, backend::conv2d_geometry const& g, conv2d_workspace<T>& workspace ) const
+            {
+                if ( window_.symmetric() )
+                    return x;
+                return backend::shift_conv2d_input( x, x_shape[1], x_shape[2], window_.top + static_cast<long>( row_padding_ ), window_.left + static_cast<long>( col_padding_ ),
+                                                    row_padding_, col_padding_, g, workspace.window_input );
+            }
+
+            template< typename T >
+            conv2d_algorithm select_algorithm( backend::conv2d_geometry const& g ) const noexcept
+            {
+                if ( groups_ != 1 )
+                    return conv2d_algorithm::grouped;
+                if ( g.kernel_rows == 1 && g.kernel_cols == 1 && g.row_stride == 1 && g.col_stride == 1 && !g.padded() )
+                    return conv2d_algorithm::pointwise;
+                if constexpr( std::floating_point<T> )
+                {
+                    // the transforms pay off with enough channels to feed the GEMMs of the transformed domain
+                    if ( backend::is_winograd_conv2d( g ) && g.channels >= 32 && g.new_channels >= 32 )
+                        return ( g.output_rows() >= 8 && g.output_cols() >= 8 ) ? conv2d_algorithm::winograd_4x4 : conv2d_algorithm::winograd_2x2;
+                    if ( backend::is_direct_conv2d( g ) )
+                        return conv2d_algorithm::direct;
+                    return conv2d_algorithm::implicit_gemm;
+                }
+                return conv2d_algorithm::img2col;
+            }
+
+            // the algorithms able to run a convolution of the geometry g
+            template< typename T >
+            std::vector<conv2d_algorithm> candidate_algorithms( backend::conv2d_geometry const& g ) const
+            {
+                if ( groups_ != 1 )
+                    return { conv2d_algorithm::grouped };
+                std::vector<conv2d_algorithm> ans;
+                if ( g.kernel_rows == 1 && g.kernel_cols == 1 && g.row_stride == 1 && g.col_stride == 1 && !g.padded() )
+                    ans.push_back( conv2d_algorithm::pointwise );
+                if constexpr( std::floating_point<T> )
+                {
+                    if ( backend::is_winograd_conv2d( g ) )
+                    {
+                        ans.push_back( conv2d_algorithm::winograd_2x2 );
+                        ans.push_back( conv2d_algorithm::winograd_4x4 );
+                    }
+                    if ( backend::is_direct_conv2d( g ) )
+                        ans.push_back( conv2d_algorithm::direct );
+                    ans.push_back( conv2d_algorithm::implicit_gemm );
+                }
+                ans.push_back( conv2d_algorithm::img2col );
+                return ans;
+            }
+
+            // the algorithm of the geometry g: the fastest one if timed in a `backend::conv2d_autotuning_scope`, the choice of `select_algorithm` otherwise
+            template< typename T >
+            conv2d_algorithm choose_algorithm( backend::conv2d_geometry const& g, conv2d_workspace<T>& workspace ) const
+            {
+                if constexpr( std::floating_point<T> )
+                {
+                    bool const training = learning_phase != 0;
+                    if ( workspace.tuned && workspace.tuned_training == training && workspace.tuned_geometry == g )
+                        return workspace.tuned_algorithm;
+                    if ( groups_ == 1 && backend::conv2d_autotuning_enabled() )
+                    {
+                        workspace.tuned_algorithm = tune_algorithm<T>( g, training );
+                        workspace.tuned_training = training;
+                        workspace.tuned_geometry = g;
+                        workspace.tuned = true;
+                        return workspace.tuned_algorithm;
+                    }
+                }
+                return select_algorithm<T>( g );
+            }
+
+            // times the candidate algorithms on random data of the geometry g, in a workspace of their own, see `backend/conv2d_autotuner.hpp`
+            template< typename T >
+            conv2d_algorithm tune_algorithm( backend::conv2d_geometry const& g, bool training ) const
+            {
+                std::vector<conv2d_algorithm> const& candidates = candidate_algorithms<T>( g );
+                std::vector<std::string> names;
+                std::transform( candidates.begin(), candidates.end(), std::back_inserter( names ), conv2d_algorithm_name );
+
+                auto const& time = [&]( unsigned long idx )
+                {
+                    std::mt19937 generator{ 42 };
+                    std::uniform_real_distribution<T> distribution{ T{-1}, T{1} };
+                    auto const& make_data = [&]( unsigned long size )
+                    {
+                        std::vector<T> ans( size );
+                        std::generate( ans.begin(), ans.end(), [&](){ return distribution( generator ); } );
+                        return ans;
+                    };
+                    std::vector<T> const& input = make_data( g.batch * g.rows * g.cols * g.channels );
+                    std::vector<T> const& kernel = make_data( g.new_channels * g.depth() );
+                    std::vector<T> const& grad = make_data( g.pixels() * g.new_channels );
+                    std::vector<T> output( grad.size() );
+                    std::vector<T> input_grad( input.size() );
+                    std::vector<T> kernel_grad( kernel.size() );
+                    conv2d_workspace<T> workspace;
+                    conv2d_algorithm const algorithm = candidates[idx];
+                    return backend::gemm_autotuner<T>::measure( [&]()
+                    {
+                        run_forward( algorithm, input.data(), kernel.data(), g, output.data(), workspace );
+                        if ( training )
+                            run_backward( algorithm, grad.data(), input.data(), kernel.data(), g, input_grad.data(), false, kernel_grad.data(), false, workspace );
+                    } );
+                };
+                auto& tuner = singleton<backend::conv2d_autotuner<T>>::instance();
+                return candidates[tuner.query( backend::conv2d_tuning_key( g, training ), names, time )];
+            }
+
+            // the Winograd filter transform of the kernel, recomputed in training, and during the inference only when the weights have changed;
+            // the kernels which are not variables, such as the output of another operator, may change without any trace, and are always transformed again
+            template< typename T >
+            void update_filter_transform( T const* kernel, backend::conv2d_geometry const& g, conv2d_algorithm algorithm, conv2d_workspace<T>& workspace ) const
+            {
+                bool const cached = variable_kernel_ && learning_phase == 0 && workspace.filter_source == kernel && workspace.filter_generation == variable_data_generation &&
+                                    workspace.filter_algorithm == algorithm && workspace.filter_geometry == g;
+                if ( cached )
+                    return;
+                if ( algorithm == conv2d_algorithm::winograd_4x4 )
+                    backend::winograd_filter_transform<4>( kernel, g, workspace.winograd.filter_transform );
+                else
+                    backend::winograd_filter_transform<2>( kernel, g, workspace.winograd.filter_transform );
+                workspace.filter_source = kernel;
+                workspace.filter_generation = variable_data_generation;
+                workspace.filter_algorithm = algorithm;
+                workspace.filter_geometry = g;
+            }
+
+            // fills the img2col matrix of the input, the index being built once per sample geometry
+            template< typename T >
+            static T const* make_columns( T const* input, backend::conv2d_geometry const& g, conv2d_workspace<T>& workspace )
+            {
+                workspace.columns.resize( g.depth() * g.pixels() );
+                img2col_fill( input, workspace.index_cache( g ), g, workspace.columns.data() );
+                return workspace.columns.data();
+            }
+
+            // the [BS, new_R, new_C, NC] output of the convolution of the [BS, g.rows, g.cols, CH] input with the kernels by the algorithm
+            template< typename T >
+            void run_forward( conv2d_algorithm algorithm, T const* input, T const* kernel, backend::conv2d_geometry const& g, T* output, conv2d_workspace<T>& workspace ) const
+            {
+                unsigned long const pixels = g.pixels();
+                unsigned long const depth = g.depth();
+                unsigned long const new_channels = g.new_channels;
+
+                if ( algorithm == conv2d_algorithm::grouped )
+                {
+                    backend::grouped_conv2d( input, kernel, g, groups_, output, workspace.grouped );
+                    return;
+                }
+
+                if ( algorithm == conv2d_algorithm::pointwise ) // [BS*R*C, CH] x [NC, CH]^T
+                {
+                    gemm( input, false, kernel, true, pixels, depth, new_channels, output );
+                    return;
+                }
+
+                if constexpr( std::floating_point<T> )
+                {
+                    if ( algorithm == conv2d_algorithm::direct )
+                    {
+                        backend::direct_conv2d( input, kernel, g, output, workspace.direct );
+                        return;
+                    }
+                    if ( algorithm == conv2d_algorithm::winograd_2x2 || algorithm == conv2d_algorithm::winograd_4x4 )
+                    {
+                        update_filter_transform( kernel, g, algorithm, workspace );
+                        if ( algorithm == conv2d_algorithm::winograd_4x4 )
+                            backend::winograd_conv2d<4>( input, g, output, workspace.winograd );
+                        else
+                            backend::winograd_conv2d<2>( input, g, output, workspace.winograd );
+                        return;
+                    }
+                    if ( algorithm == conv2d_algorithm::implicit_gemm )
+                    {
+                        backend::implicit_gemm_conv2d( input, kernel, g, output, workspace.implicit_gemm );
+                        return;
+                    }
+                }
+
+                // [r*c*CH, BS*new_R*new_C]^T x [NC, r*c*CH]^T
+                T const* columns = make_columns( input, g, workspace );
+                gemm( columns, true, kernel, true, pixels, depth, new_channels, output );
+            }
+
+            // the gradients of the input and of the kernels of `run_forward`, written to input_grad and kernel_grad, or added to them if accumulating
+            template< typename T >
+            void run_backward( conv2d_algorithm algorithm, T const* grad, T const* input, T const* kernel, backend::conv2d_geometry const& g,
+                               T* input_grad, bool input_accumulate, T* kernel_grad, bool kernel_accumulate, conv2d_workspace<T>& workspace ) const
+            {
+                unsigned long const pixels = g.pixels();
+                unsigned long const depth = g.depth();
+                unsigned long const new_channels = g.new_channels;
+                T const input_beta = input_accumulate ? T{1} : T{0};
+                T const kernel_beta = kernel_accumulate ? T{1} : T{0};
+
+                if ( algorithm == conv2d_algorithm::grouped )
+                {
+                    backend::grouped_conv2d_input_gradient( grad, kernel, g, groups_, input_grad, input_accumulate, workspace.grouped );
+                    backend::grouped_conv2d_kernel_gradient( input, grad, g, groups_, kernel_grad, kernel_accumulate, workspace.grouped );
+                    return;
+                }
+
+                if ( algorithm == conv2d_algorithm::pointwise )
+                {
+                    gemm( grad, false, kernel, false, pixels, new_channels, depth, input_grad, T{1}, input_beta );
+                    gemm( grad, true, input, false, new_channels, pixels, depth, kernel_grad, T{1}, kernel_beta );
+                    return;
+                }
+
+                if constexpr( std::floating_point<T> )
+                {
+                    if ( algorithm == conv2d_algorithm::direct )
+                    {
+                        backend::direct_conv2d_input_gradient( grad, kernel, g, input_grad, input_accumulate, workspace.direct );
+                        backend::direct_conv2d_kernel_gradient( input, grad, g, kernel_grad, kernel_accumulate, workspace.direct );
+                        return;
+                    }
+                    if ( algorithm == conv2d_algorithm::winograd_2x2 || algorithm == conv2d_algorithm::winograd_4x4 ) // the transforms of the forward pass are reused
+                    {
+                        if ( algorithm == conv2d_algorithm::winograd_4x4 )
+                            backend::winograd_conv2d_backward<4>( grad, g, input_grad, input_accumulate, kernel_grad, kernel_accumulate, workspace.winograd );
+                        else
+                            backend::winograd_conv2d_backward<2>( grad, g, input_grad, input_accumulate, kernel_grad, kernel_accumulate, workspace.winograd );
+                        return;
+                    }
+                    if ( algorithm == conv2d_algorithm::implicit_gemm )
+                    {
+                        backend::implicit_gemm_conv2d_input_gradient( grad, kernel, g, input_grad, input_accumulate, workspace.implicit_gemm );
+                        backend::implicit_gemm_conv2d_kernel_gradient( input, grad, g, kernel_grad, kernel_accumulate, workspace.implicit_gemm );
+                        return;
+                    }
+                }
+
+                // input gradient <-- col2im( kernel^T * grad^T ), the img2col matrix being kept by the forward pass
+                std::vector<T> column_gradient( depth * pixels );
+                gemm( kernel, true, grad, true, depth, new_channels, pixels, column_gradient.data() );
+                if ( !input_accumulate )
+                    std::fill_n( input_grad, g.batch * g.rows * g.cols * g.channels, T{0} );
+                col2im_accumulate( column_gradient.data(), workspace.index_cache( g ), g, input_grad );
+
+                // kernel gradient <-- grad^T * columns^T
+                gemm( grad, true, workspace.columns.data(), true, new_channels, pixels, depth, kernel_grad, T{1}, kernel_beta );
+            }
+
+            auto make_forward() const noexcept
+            {
+                return [*this]( std::shared_ptr<std::any> forward_cache, std::shared_ptr<std::any> workspace_cache, std::shared_ptr<quantization_state> quantization,
+                                std::shared_ptr<folding_state> folding ) noexcept
+                {
+                    return [=, *this]<Tensor Tsor>( Tsor const& x, Tsor const& weights ) noexcept
+                    {
+                        auto const& convolve = [&]( Tsor const& kernel ) -> Tsor&
+                        {
+                            typedef typename Tsor::value_type value_type;
+                            backend::conv2d_geometry const& g = geometry( x.shape(), kernel.shape() );
+                            conv2d_workspace<value_type>& workspace = context_cast<conv2d_workspace<value_type>>( workspace_cache );
+                            conv2d_algorithm const algorithm = choose_algorithm( g, workspace );
+                            unsigned long const pixels = g.pixels();
+                            unsigned long const depth = g.depth();
+                            unsigned long const new_channels = g.new_channels;
+                            value_type const* input = window_input( x.data(), x.shape(), g, workspace );
+
+                            Tsor& ans = context_cast<Tsor>( forward_cache );
+                            ans.resize( {g.batch, g.output_rows(), g.output_cols(), new_channels} );
+
+                            if constexpr( std::is_same_v<value_type, float> )
+                            {
+                                auto& calibration = get_quantization_calibration();
+                                bool const quantized = !calibration.active && learning_phase == 0 && quantization->enabled;
+                                if ( algorithm != conv2d_algorithm::grouped && ( calibration.active || quantized ) )
+                                {
+                                    // the int8 product reads the pixels [BS*new_R*new_C, r*c*CH] from the input itself for a pointwise kernel, from the img2col matrix otherwise
+                                    bool const pointwise = algorithm == conv2d_algorithm::pointwise;
+                                    float const* pixel_data = pointwise ? input : make_columns( input, g, workspace );
+                                    unsigned long const row_stride = pointwise ? depth : 1UL;
+                                    unsigned long const depth_stride = pointwise ? 1UL : pixels;
+                                    if ( calibration.active )
+                                    {
+                                        calibration.record( quantization );
+                                        quantization->calibrate( pixel_data, pixels, depth, row_stride, depth_stride, kernel.data(), new_channels, 1, depth );
+                                    }
+                                    else
+                                    {
+                                        float* output = ans.data();
+                                        quantization->run( pixel_data, pixels, row_stride, depth_stride, [output, new_channels]( float const* values, unsigned long row, unsigned long col, unsigned long cols )
+                                        {
+                                            std::copy_n( values, cols, output + row * new_channels + col );
+                                        } );
+                                        return ans;
+                                    }
+                                }
+                            }
+
+                            run_forward( algorithm, input, kernel.data(), g, ans.data(), workspace );
+                            return ans;
+                        };
+
+                        if ( folding->folded_head() ) // the per-channel operators and the activation following are folded in, see `folding.hpp`
+                        {
+                            Tsor& ans = convolve( std::any_cast<Tsor const&>( folding->chain->kernel ) );
+                            apply_folded_epilogue( *(folding->chain), ans );
+                            return ans;
+                        }
+
+                        Tsor& ans = convolve( weights );
+                        if ( auto& trace = get_folding_trace(); trace.active )
+                            trace.record( folding_kind::conv2d, folding, x, &weights, ans, { weights } );
+                        return ans;
+                    };
+                };
+            }
+
+            auto make_backward() const noexcept
+            {
+                // as in `multiplication_context`, the gradients of trainable variables are accumulated into their gradient buffers directly
+                return [*this]( std::shared_ptr<std::any> backward_cache_lhs, std::shared_ptr<std::any> backward_cache_rhs, std::shared_ptr<std::any> workspace_cache ) noexcept
+                {
+                    return [=, *this]<Tensor Tsor>( Tsor const& x, Tsor const& kernel, Tsor const&, Tsor const& grad, Tsor* x_target = nullptr, Tsor* kernel_target = nullptr ) noexcept
+                    {
+                        typedef typename Tsor::value_type value_type;
+                        backend::conv2d_geometry const& g = geometry( x.shape(), kernel.shape() );
+                        conv2d_workspace<value_type>& workspace = context_cast<conv2d_workspace<value_type>>( workspace_cache );
+                        conv2d_algorithm const algorithm = choose_algorithm( g, workspace );
+
+                        Tsor& x_grad = context_cast<Tsor>( backward_cache_lhs );
+                        if ( !x_target )
+                            x_grad.resize( x.shape() );
+
+                        // through an asymmetric or cropping window, the gradient of `window_input` is computed first, and then read back through the window
+                        bool const windowed = !window_.symmetric();
+                        if ( windowed )
+                            workspace.window_gradient.resize( g.batch * g.rows * g.cols * g.channels );
+                        value_type const* const input = windowed ? workspace.window_input.data() : x.data();
+                        value_type* const dx = windowed ? workspace.window_gradient.data() : ( x_target ? x_target->data() : x_grad.data() );
+
+                        Tsor& kernel_grad = context_cast<Tsor>( backward_cache_rhs );
+                        if ( !kernel_target )
+                            kernel_grad.resize( kernel.shape() );
+                        value_type* const dk = kernel_target ? kernel_target->data() : kernel_grad.data();
+
+                        run_backward( algorithm, grad.data(), input, kernel.data(), g, dx, !windowed && x_target != nullptr, dk, kernel_target != nullptr, workspace );
+                        if ( windowed )
+                            backend::shift_conv2d_input_gradient( dx, x.shape()[1], x.shape()[2], window_.top + static_cast<long>( row_padding_ ),
+                                                                  window_.left + static_cast<long>( col_padding_ ), row_padding_, col_padding_, g,
+                                                                  x_target ? x_target->data() : x_grad.data(), x_target != nullptr );
+                        return std::make_tuple( x_grad, kernel_grad );
+                    };
+                };
+            }
+        };//conv2d_context
+
+        // the [BS, new_R, new_C, NC] convolution of lhs_ex [BS, R, C, CH] seen through the window of the context, with the kernels rhs_ex [NC, r, c, CH], as a single operator
+        template< Expression Ex, Expression Ey >
+        auto make_windowed_conv2d( conv2d_context const& context, unsigned long row_input, unsigned long col_input, Ex const& lhs_ex, Ey const& rhs_ex ) noexcept
+        {
+            std::shared_ptr<std::any> forward_cache = std::make_shared<std::any>();
+            std::shared_ptr<std::any> backward_cache_lhs = std::make_shared<std::any>();
+            std::shared_ptr<std::any> backward_cache_rhs = std::make_shared<std::any>();
+            std::shared_ptr<std::any> workspace_cache = std::make_shared<std::any>();
+            std::shared_ptr<quantization_state> quantization = std::make_shared<quantization_state>();
+
+            auto const& shape_calculator = [context, row_input, col_input]( std::vector<unsigned long> const& x, std::vector<unsigned long> const& kernel ) noexcept
+            {
+                std::vector<unsigned long> input = x;
+                input[1] = row_input;
+                input[2] = col_input;
+                backend::conv2d_geometry const& g = context.geometry( input, kernel );
+                return std::vector<unsigned long>{ {x[0], g.output_rows(), g.output_cols(), kernel[0]} };
+            };
+            std::shared_ptr<folding_state> folding = std::make_shared<folding_state>();
+            conv2d_context kernel_context = context;
+            kernel_context.variable_kernel_ = is_variable_v<Ey>;
+            return make_binary_operator( kernel_context.make_forward()( forward_cache, workspace_cache, quantization, folding ),
+                                         kernel_context.make_backward()( backward_cache_lhs, backward_cache_rhs, workspace_cache ),
+                                         "Conv2D", shape_calculator )( lhs_ex, rhs_ex );
+        }
+
+        // the [BS, new_R, new_C, NC] convolution of lhs_ex [BS, R, C, CH] with the kernels rhs_ex [NC, r, c, CH], as a single operator;
+        // a `zero_padding_2d` or a `cropping_2d` producing lhs_ex is folded in, the convolution reading the input of the padding or of the cropping directly
+        template< Expression Ex, Expression Ey >
+        auto make_conv2d( conv2d_context const& context, unsigned long row_input, unsigned long col_input, Ex const& lhs_ex, Ey const& rhs_ex ) noexcept
+        {
+            if constexpr( is_window_2d_operator_v<Ex> )
+            {
+                window_2d const& window = lhs_ex.output_shape_calculator_;
+                conv2d_context windowed_context = context;
+                windowed_context.window_ = window;
+                return make_windowed_conv2d( windowed_context, static_cast<unsigned long>( static_cast<long>( row_input ) - window.top - window.bottom ),
+                                             static_cast<unsigned long>( static_cast<long>( col_input ) - window.left - window.right ), lhs_ex.op_, rhs_ex );
+            }
+            else
+            {
+                return make_windowed_conv2d( context, row_input, col_input, lhs_ex, rhs_ex );
+            }
+        }
+    }//namespace ceras_private
 
     ///
-    /// @brief Conv2D not constrained by the input shape.
+    /// @brief 2D convolution of a [BS, R, C, CH] input with NC kernels of [r, c, CH], producing a [BS, new_R, new_C, NC] output.
     ///
-    auto inline general_conv2d
+    /// 1x1 kernels run as a GEMM on the input, 1x1 kernels with strides and 3x3 kernels run as direct convolutions, and other kernels as implicit GEMMs,
+    /// gathering the patches of the input into the GEMM panels without the img2col matrix.
+    /// 3x3 kernels with unit strides and at least 32 input and output channels run as Winograd convolutions, whose filter transforms are kept during the inference.
+    /// After `model::quantize`, the inference runs on int8 inputs and weights, see `quantization.hpp`.
+    ///
+    auto inline conv2d
     (
+        unsigned long row_input, unsigned long col_input,
         unsigned long const row_stride=1, unsigned long const col_stride=1,
         unsigned long const row_dilation=1, unsigned long const col_dilation=1,
         std::string const& padding="valid"
@@ -1410,12 +2366,9 @@ namespace ceras
         //
         // Note: the rhs expression is fixed as a variable, as we need to extract the kernel shape from it
         //
-        return [ row_stride, col_stride, row_dilation, col_dilation, padding ]<Expression Ex, Expression Ey>( Ex const& lhs_ex, Ey const& rhs_ex ) noexcept
+        //return [row_input, col_input, row_stride, col_stride, row_dilation, col_dilation, padding ]<Expression Ex, Variable Va>( Ex const& lhs_ex, Va const& rhs_ex ) noexcept
+        return [row_input, col_input, row_stride, col_stride, row_dilation, col_dilation, padding ]<Expression Ex, Expression Ey>( Ex const& lhs_ex, Ey const& rhs_ex ) noexcept
         {
-            auto const& lhs_shape = lhs_ex.shape();
-            better_assert( lhs_shape.size() == 4, fmt::format( "expecting lhs_shape size of 4, but got {}", lhs_shape.size() ) );
-            auto [_bs, row_input, col_input, _ch] = std::make_tuple( lhs_shape[0], lhs_shape[1], lhs_shape[2], lhs_shape[3] );
-
             std::vector<unsigned long> const& shape = rhs_ex.shape();
             better_assert( shape.size() == 4 );
             auto const[new_channel, row_kernel, col_kernel, channel] = std::make_tuple( shape[0], shape[1], shape[2], shape[3] );
@@ -1424,25 +2377,100 @@ namespace ceras
             if ( padding == "same" )
             {
                 unsigned long const row_padding_total = (row_kernel + (row_kernel - 1) * (row_dilation - 1) - row_stride);
+                better_assert( !(row_padding_total & 0x1), "Expecting total row padding to be even, but got ", row_padding_total, " With row input ", row_input, " and row_stride ", row_stride );
                 unsigned long const col_padding_total = (col_kernel + (col_kernel - 1) * (col_dilation - 1) - col_stride);
+                better_assert( !(col_padding_total & 0x1), "Expecting total col padding to be even, but got ", col_padding_total );
                 row_padding = ((row_kernel&1)+row_padding_total) >> 1;
                 col_padding = ((col_kernel&1)+col_padding_total) >> 1;
             }
 
-            unsigned long const row_output = ( row_input + 2 * row_padding - ( row_dilation * (row_kernel - 1) + 1 ) ) / row_stride + 1;
-            unsigned long const col_output = ( col_input + 2 * row_padding - ( col_dilation * (col_kernel - 1) + 1 ) ) / col_stride + 1;
+            ceras_private::conv2d_context const context{ row_stride, col_stride, row_padding, col_padding, row_dilation, col_dilation };
+            return ceras_private::make_conv2d( context, row_input, col_input, lhs_ex, rhs_ex );
+        };
+    }
 
-            auto lhs_ex_as_col = img2col(row_kernel, col_kernel, row_padding, col_padding, row_stride, col_stride, row_dilation, col_dilation)( lhs_ex ); // [BS, R, C, CH] ==> [r*c*CH, BS*new_row*new_col]
 
-            auto rhs_ex_flatten = reshape({row_kernel*col_kernel*channel,})( rhs_ex ); // [NC, r, c, CH] ==> [NC, r*c*CH]
+    ///
+    /// @brief Grouped 2D convolution of a [BS, R, C, CH] input with NC kernels of [r, c, CH/groups], producing a [BS, new_R, new_C, NC] output.
+    ///
+    /// The input channels and the kernels are split into `groups` groups, the kernels of a group only seeing the input channels of their group.
+    /// With `groups` equal to 1, this is `general_conv2d`.
+    ///
+    /// Example code:
+    ///
+    /// \code{.cpp}
+    /// auto x = variable{ random<float>( {16, 28, 28, 32} ) };
+    /// auto w = variable{ random<float>( {64, 3, 3, 8} ) };
+    /// auto y = grouped_conv2d( 4, 1, 1, 1, 1, "same" )( x, w ); // 4 groups of 8 input channels and 16 output channels
+    /// \endcode
+    ///
+    auto inline grouped_conv2d
+    (
+        unsigned long const groups,
+        unsigned long const row_stride=1, unsigned long const col_stride=1,
+        unsigned long const row_dilation=1, unsigned long const col_dilation=1,
+        std::string const& padding="valid"
+    ) noexcept
+    {
+        better_assert( groups > 0, "Expecting groups larger than 0." );
+        return [ groups, row_stride, col_stride, row_dilation, col_dilation, padding ]<Expression Ex, Expression Ey>( Ex const& lhs_ex, Ey const& rhs_ex ) noexcept
+        {
+            auto const& lhs_shape = lhs_ex.shape();
+            better_assert( lhs_shape.size() == 4, fmt::format( "expecting lhs_shape size of 4, but got {}", lhs_shape.size() ) );
+            auto [_bs, row_input, col_input, _ch] = std::make_tuple( lhs_shape[0], lhs_shape[1], lhs_shape[2], lhs_shape[3] );
 
-            auto flatten_output = rhs_ex_flatten * lhs_ex_as_col; // [NC, BS * new_row * new_col]
+            std::vector<unsigned long> const& shape = rhs_ex.shape();
+            better_assert( shape.size() == 4 );
+            auto const[new_channel, row_kernel, col_kernel, channel] = std::make_tuple( shape[0], shape[1], shape[2], shape[3] );
+            unsigned long row_padding = 0;
+            unsigned long col_padding = 0;
+            if ( padding == "same" )
+            {
+                unsigned long const row_padding_total = (row_kernel + (row_kernel - 1) * (row_dilation - 1) - row_stride);
+                unsigned long const col_padding_total = (col_kernel + (col_kernel - 1) * (col_dilation - 1) - col_stride);
+                row_padding = ((row_kernel&1)+row_padding_total) >> 1;
+                col_padding = ((col_kernel&1)+col_padding_total) >> 1;
+            }
 
-            auto tr_output = transpose( flatten_output ); // [BS*new_row*new_col, NC]
+            ceras_private::conv2d_context const context{ row_stride, col_stride, row_padding, col_padding, row_dilation, col_dilation, groups };
+            return ceras_private::make_conv2d( context, row_input, col_input, lhs_ex, rhs_ex );
+        };
+    }
 
-            auto ans = reshape({row_output, col_output, new_channel})( tr_output );
+    ///
+    /// @brief Conv2D not constrained by the input shape.
+    ///
+    auto inline general_conv2d
+    (
+        unsigned long const row_stride=1, unsigned long const col_stride=1,
+        unsigned long const row_dilation=1, unsigned long const col_dilation=1,
+        std::string const& padding="valid"
+    ) noexcept
+    {
+        // lhs_ex is for one 4D tensor of [BS, R, C, CH]
+        // rhs_ex is for NC 4D filter of [1, r, c, CH], thus the shape is [NC, r, c, CH]
+        // the output tensor is of shape [BS, .., .., NC]
+        return grouped_conv2d( 1, row_stride, col_stride, row_dilation, col_dilation, padding );
+    }
 
-            return ans;
+    ///
+    /// @brief Depthwise 2D convolution of a [BS, R, C, CH] input with CH*depth_multiplier kernels of [r, c, 1], producing a [BS, new_R, new_C, CH*depth_multiplier] output.
+    ///
+    /// The output channel nc is the convolution of the input channel nc/depth_multiplier with the kernel nc. This is `grouped_conv2d` with one group per input channel.
+    ///
+    auto inline depthwise_conv2d
+    (
+        unsigned long const row_stride=1, unsigned long const col_stride=1,
+        unsigned long const row_dilation=1, unsigned long const col_dilation=1,
+        std::string const& padding="valid"
+    ) noexcept
+    {
+        return [ row_stride, col_stride, row_dilation, col_dilation, padding ]<Expression Ex, Expression Ey>( Ex const& lhs_ex, Ey const& rhs_ex ) noexcept
+        {
+            auto const& lhs_shape = lhs_ex.shape();
+            better_assert( lhs_shape.size() == 4, fmt::format( "expecting lhs_shape size of 4, but got {}", lhs_shape.size() ) );
+            better_assert( rhs_ex.shape().size() == 4 && rhs_ex.shape()[3] == 1, "Expecting depthwise kernels of [NC, r, c, 1]." );
+            return grouped_conv2d( lhs_shape[3], row_stride, col_stride, row_dilation, col_dilation, padding )( lhs_ex, rhs_ex );
         };
     }
 
@@ -1535,38 +2563,138 @@ namespace ceras
     }
 
 
-    ///
-    /// @brief Conv2D Transpose
-    ///
-    auto inline conv2d_transpose
-    (
-        unsigned long const row_kernel, unsigned long const col_kernel,
-        unsigned long const row_stride=1, unsigned long const col_stride=1,
-        unsigned long const row_dilation=1, unsigned long const col_dilation=1,
-        std::string const& padding="valid"
-    ) noexcept
+    namespace ceras_private
     {
-        // lhs_ex is for one 4D tensor of [BS, R, C, CH]
-        // rhs_ex is for NC 4D filter of [1, r, c, CH], thus the shape is [NC, r, c, CH]
-        // NOTE: here rhs_ex serves as the transposed convolution kernel, its row and column are inversed. Be careful when importing weights from other places.
-        // the output tensor is of shape [BS, .., .., NC]
-        //
-        // Note: the rhs expression is fixed as a variable, as we need to extract the kernel shape from it
-        //
-        return [ row_kernel, col_kernel, row_stride, col_stride, row_dilation, col_dilation, padding ]<Expression Ex, Expression Ey>( Ex const& lhs_ex, Ey const& rhs_ex ) noexcept
+        // the [BS, new_R, new_C, NC] transposed convolution of lhs_ex [BS, R, C, CH] with the kernels rhs_ex [NC, r, c, CH], see `transposed_conv2d.hpp`
+        struct conv2d_transpose_context
         {
-            //auto new_lhs_ex = conv2d_tranpose_intermediate( row_kernel, col_kernel, row_stride, col_stride, padding )( lhs_ex );
-            auto new_lhs_ex = conv2d_tranpose_intermediate( row_kernel, col_kernel, row_stride, col_stride, padding )( lhs_ex );
-            return general_conv2d( row_stride, col_stride, row_dilation, col_dilation, padding )( new_lhs_ex, flip(1)(flip(2)(rhs_ex)) );
-        };
-    }
+            unsigned long row_stride_;
+            unsigned long col_stride_;
+            unsigned long row_dilation_;
+            unsigned long col_dilation_;
+            std::string padding_;
 
+            backend::conv2d_transpose_geometry geometry( std::vector<unsigned long> const& x, std::vector<unsigned long> const& kernel ) const noexcept
+            {
+                better_assert( x.size() == 4, fmt::format( "conv2d_transpose: expecting a 4D input, but got {} dimensions", x.size() ) );
+                better_assert( kernel.size() == 4, fmt::format( "conv2d_transpose: expecting a 4D kernel, but got {} dimensions", kernel.size() ) );
+                better_assert( x[3] == kernel[3], fmt::format( "conv2d_transpose: expecting x.shape[3] == kernel.shape[3], but got {} and {}", x[3], kernel[3] ) );
+                return backend::make_conv2d_transpose_geometry( x, kernel, row_stride_, col_stride_, row_dilation_, col_dilation_, padding_ );
+            }
 
+            auto make_forward() const noexcept
+            {
+                return [*this]( std::shared_ptr<std::any> forward_cache, std::shared_ptr<std::any> workspace_cache ) noexcept
+                {
+                    return [=, *this]<Tensor Tsor>( Tsor const& x, Tsor const& kernel ) noexcept
+                    {
+                        typedef typename Tsor::value_type value_type;
+                        backend::conv2d_transpose_geometry const& g = geometry( x.shape(), kernel.shape() );
+                        auto& workspace = context_cast<backend::conv2d_transpose_workspace<value_type>>( workspace_cache );
 
+                        // contributions of the input pixels [BS*R*C, taps*NC] <= x [BS*R*C, CH] * packed kernels [CH, taps*NC]
+                        backend::pack_conv2d_transpose_kernel( kernel.data(), g, workspace.kernel );
+                        workspace.columns.resize( g.pixels() * g.width() );
+                        gemm( x.data(), false, workspace.kernel.data(), false, g.pixels(), g.channels, g.width(), workspace.columns.data() );
 
+                        Tsor& ans = context_cast<Tsor>( forward_cache );
+                        ans.resize( {g.batch, g.new_rows, g.new_cols, g.new_channels} );
+                        backend::conv2d_transpose_col2im( workspace.columns.data(), g, ans.data() );
+                        return ans;
+                    };
+                };
+            }
 
-    template< typename T > requires std::floating_point<T>
-    inline auto drop_out( T const factor ) noexcept
+            auto make_backward() const noexcept
+            {
+                // as in `conv2d_context`, the gradients of trainable variables are accumulated into their gradient buffers directly
+                return [*this]( std::shared_ptr<std::any> backward_cache_lhs, std::shared_ptr<std::any> backward_cache_rhs, std::shared_ptr<std::any> workspace_cache ) noexcept
+                {
+                    return [=, *this]<Tensor Tsor>( Tsor const& x, Tsor const& kernel, Tsor const&, Tsor const& grad, Tsor* x_target = nullptr, Tsor* kernel_target = nullptr ) noexcept
+                    {
+                        typedef typename Tsor::value_type value_type;
+                        backend::conv2d_transpose_geometry const& g = geometry( x.shape(), kernel.shape() );
+                        auto& workspace = context_cast<backend::conv2d_transpose_workspace<value_type>>( workspace_cache );
+
+                        Tsor& x_grad = context_cast<Tsor>( backward_cache_lhs );
+                        if ( !x_target )
+                            x_grad.resize( x.shape() );
+                        value_type* const dx = x_target ? x_target->data() : x_grad.data();
+
+                        Tsor& kernel_grad = context_cast<Tsor>( backward_cache_rhs );
+                        if ( !kernel_target )
+                            kernel_grad.resize( kernel.shape() );
+                        value_type* const dk = kernel_target ? kernel_target->data() : kernel_grad.data();
+
+                        // the gradient of the contributions, [BS*R*C, taps*NC]
+                        backend::pack_conv2d_transpose_kernel( kernel.data(), g, workspace.kernel );
+                        workspace.columns.resize( g.pixels() * g.width() );
+                        backend::conv2d_transpose_im2col( grad.data(), g, workspace.columns.data() );
+
+                        // left branch <-- columns * packed kernels^T
+                        gemm( workspace.columns.data(), false, workspace.kernel.data(), true, g.pixels(), g.width(), g.channels, dx, value_type{1}, x_target ? value_type{1} : value_type{0} );
+
+                        // right branch <-- x^T * columns, unpacked
+                        workspace.kernel_gradient.resize( g.channels * g.width() );
+                        gemm( x.data(), true, workspace.columns.data(), false, g.channels, g.pixels(), g.width(), workspace.kernel_gradient.data() );
+                        backend::unpack_conv2d_transpose_kernel_gradient( workspace.kernel_gradient.data(), g, dk, kernel_target != nullptr );
+
+                        return std::make_tuple( x_grad, kernel_grad );
+                    };
+                };
+            }
+        };//conv2d_transpose_context
+    }//namespace ceras_private
+
+    ///
+    /// @brief Transposed 2D convolution of a [BS, R, C, CH] input with the kernels [NC, r, c, CH], producing a [BS, new_R, new_C, NC] output.
+    ///
+    /// The tap (u, v) of the input pixel (iy, ix) contributes to the output pixel (iy*row_stride+u*row_dilation, ix*col_stride+v*col_dilation), this is the gradient of
+    /// a `conv2d` with respect to its input. The output is [(R-1)*row_stride+row_dilation*(r-1)+1, (C-1)*col_stride+col_dilation*(c-1)+1] with `valid` padding,
+    /// and [R*row_stride, C*col_stride] with `same` padding, cropped evenly from both sides.
+    ///
+    /// It runs as a GEMM of the input and the kernels followed by a col2im gather, without multiplying the zeros an upsampled input would contain, see `transposed_conv2d.hpp`.
+    ///
+    /// Example code:
+    /// \code{.cpp}
+    /// auto x = variable{ random<float>( {16, 7, 7, 128} ) };
+    /// auto w = variable{ random<float>( {64, 3, 3, 128} ) };
+    /// auto y = conv2d_transpose( 3, 3, 2, 2, 1, 1, "same" )( x, w ); // [16, 14, 14, 64]
+    /// \endcode
+    ///
+    auto inline conv2d_transpose
+    (
+        unsigned long const row_kernel, unsigned long const col_kernel,
+        unsigned long const row_stride=1, unsigned long const col_stride=1,
+        unsigned long const row_dilation=1, unsigned long const col_dilation=1,
+        std::string const& padding="valid"
+    ) noexcept
+    {
+        return [ row_kernel, col_kernel, row_stride, col_stride, row_dilation, col_dilation, padding ]<Expression Ex, Expression Ey>( Ex const& lhs_ex, Ey const& rhs_ex ) noexcept
+        {
+            better_assert( rhs_ex.shape().size() == 4 && rhs_ex.shape()[1] == row_kernel && rhs_ex.shape()[2] == col_kernel, "conv2d_transpose: the kernel does not match the kernel size." );
+            ceras_private::conv2d_transpose_context const context{ row_stride, col_stride, row_dilation, col_dilation, padding };
+
+            std::shared_ptr<std::any> forward_cache = std::make_shared<std::any>();
+            std::shared_ptr<std::any> backward_cache_lhs = std::make_shared<std::any>();
+            std::shared_ptr<std::any> backward_cache_rhs = std::make_shared<std::any>();
+            std::shared_ptr<std::any> workspace_cache = std::make_shared<std::any>();
+
+            auto const& shape_calculator = [context]( std::vector<unsigned long> const& x, std::vector<unsigned long> const& kernel ) noexcept
+            {
+                backend::conv2d_transpose_geometry const& g = context.geometry( x, kernel );
+                return std::vector<unsigned long>{ {x[0], g.new_rows, g.new_cols, g.new_channels} };
+            };
+            return make_binary_operator( context.make_forward()( forward_cache, workspace_cache ),
+                                         context.make_backward()( backward_cache_lhs, backward_cache_rhs, workspace_cache ),
+                                         "Conv2DTranspose", shape_calculator )( lhs_ex, rhs_ex );
+        };
+    }
+
+
+
+    template< typename T > requires std::floating_point<T>
+    inline auto drop_out( T const factor ) noexcept
     {
         better_assert( factor < T{1}, "Expecting drop out rate less than 1, but got factor = ", factor );
         better_assert( factor > T{0}, "Expecting drop out rate greater than 0, but got factor = ", factor );
@@ -1636,55 +2764,180 @@ namespace ceras
     }
 
 
-    namespace
+    namespace ceras_private
     {
+        // max and average pooling of [BS, R, C, CH] inputs, or of [BS, CB, R, C, b] inputs in the NCHWc layout, see `backend/pooling_2d.hpp`
+        struct pooling_2d_context
+        {
+            unsigned long row_kernel_;
+            unsigned long col_kernel_;
+            unsigned long row_stride_;
+            unsigned long col_stride_;
+            std::string padding_;
+            bool average_;
+
+            // a [BS, CB, R, C, b] input in the NCHWc layout is pooled as BS*CB samples of b channels
+            backend::pooling_2d_geometry geometry( std::vector<unsigned long> const& shape ) const noexcept
+            {
+                better_assert( shape.size() == 4 || shape.size() == 5, fmt::format( "pooling_2d: expecting a 4D or a NCHWc input, but got {} dimensions", shape.size() ) );
+                if ( shape.size() == 5 )
+                    return backend::make_pooling_2d_geometry( {shape[0]*shape[1], shape[2], shape[3], shape[4]}, row_kernel_, col_kernel_, row_stride_, col_stride_, padding_ );
+                return backend::make_pooling_2d_geometry( shape, row_kernel_, col_kernel_, row_stride_, col_stride_, padding_ );
+            }
 
-        struct max_pooling_2d_context
+            std::vector<unsigned long> output_shape( std::vector<unsigned long> const& shape ) const noexcept
+            {
+                backend::pooling_2d_geometry const& g = geometry( shape );
+                std::vector<unsigned long> ans = shape;
+                ans[ans.size()-3] = g.new_rows;
+                ans[ans.size()-2] = g.new_cols;
+                return ans;
+            }
+
+            auto make_forward() const noexcept
+            {
+                return [*this]( std::shared_ptr<std::any> mask, std::shared_ptr<std::any> forward_cache ) noexcept
+                {
+                    return [=, *this]<Tensor Tsor>( Tsor const& input ) noexcept
+                    {
+                        backend::pooling_2d_geometry const& g = geometry( input.shape() );
+                        Tsor& ans = context_cast<Tsor>( forward_cache );
+                        ans.resize( output_shape( input.shape() ) );
+                        if ( average_ )
+                        {
+                            backend::average_pooling_2d( input.data(), g, ans.data() );
+                            return ans;
+                        }
+                        std::vector<std::uint32_t>& argmax = context_cast<std::vector<std::uint32_t>>( mask );
+                        argmax.resize( ans.size() );
+                        backend::max_pooling_2d( input.data(), g, ans.data(), argmax.data() );
+                        return ans;
+                    };
+                };
+            }
+
+            auto make_backward() const noexcept
+            {
+                return [*this]( std::shared_ptr<std::any> mask, std::shared_ptr<std::any> backward_cache ) noexcept
+                {
+                    return [=, *this]<Tensor Tsor>( Tsor const& input, Tsor const&, Tsor const& grad ) noexcept
+                    {
+                        backend::pooling_2d_geometry const& g = geometry( input.shape() );
+                        Tsor& ans = context_cast<Tsor>( backward_cache );
+                        ans.resize( input.shape() );
+                        if ( average_ )
+                            backend::average_pooling_2d_backward( grad.data(), g, ans.data() );
+                        else
+                            backend::max_pooling_2d_backward( grad.data(), context_cast<std::vector<std::uint32_t>>( mask ).data(), g, ans.data() );
+                        return ans;
+                    };
+                };
+            }
+        }; // pooling_2d_context
+
+        inline auto make_pooling_2d( pooling_2d_context const& context, char const* name ) noexcept
         {
+            better_assert( context.row_kernel_ > 0 && context.col_kernel_ > 0, "Expecting a pooling window of at least 1x1." );
+            better_assert( context.row_stride_ > 0 && context.col_stride_ > 0, "Expecting pooling strides greater than 0." );
+            better_assert( context.padding_ == "valid" || context.padding_ == "same", "Expecting `valid` or `same` padding, but got ", context.padding_ );
+
+            std::shared_ptr<std::any> mask = std::make_shared<std::any>(); // the argmax indices of the max pooling
+            std::shared_ptr<std::any> forward_cache = std::make_shared<std::any>();
+            std::shared_ptr<std::any> backward_cache = std::make_shared<std::any>();
+
+            return [=]<Expression Ex>( Ex const& ex ) noexcept
+            {
+                return make_unary_operator
+                (
+                    context.make_forward()( mask, forward_cache ),
+                    context.make_backward()( mask, backward_cache ),
+                    name,
+                    [context]( std::vector<unsigned long> const& shape ) noexcept
+                    {
+                        return context.output_shape( shape );
+                    }
+                )( ex );
+            };
+        }
+    }//namespace ceras_private
+
+    ///
+    /// @brief Max pooling of a [BS, R, C, CH] input with a window of [row_kernel, col_kernel].
+    ///
+    /// The output is [BS, (R-row_kernel)/row_stride+1, (C-col_kernel)/col_stride+1, CH] with `valid` padding, and [BS, ceil(R/row_stride), ceil(C/col_stride), CH] with `same` padding,
+    /// the padded elements never being the maximum. The backward pass scatters the gradient to the maxima, whose indices are kept as uint32.
+    /// A [BS, CB, R, C, b] input in the NCHWc layout (see `to_nchwc`) is pooled in the same layout, to a [BS, CB, new_R, new_C, b] output.
+    ///
+    /// Example code:
+    /// \code{.cpp}
+    /// auto x = variable{ random<float>( {16, 13, 13, 32} ) };
+    /// auto y = max_pooling_2d( 3, 3, 2, 2, "same" )( x ); // [16, 7, 7, 32]
+    /// \endcode
+    ///
+    inline auto max_pooling_2d( unsigned long row_kernel, unsigned long col_kernel, unsigned long row_stride, unsigned long col_stride, std::string const& padding="valid" ) noexcept
+    {
+        return ceras_private::make_pooling_2d( ceras_private::pooling_2d_context{ row_kernel, col_kernel, row_stride, col_stride, padding, false }, "MaxPooling2D" );
+    }
+
+    ///
+    /// @brief Max pooling of a [BS, R, C, CH] input with non-overlapping windows of [stride, stride], producing a [BS, R/stride, C/stride, CH] output.
+    ///
+    inline auto max_pooling_2d( unsigned long stride ) noexcept
+    {
+        better_assert( stride > 1, "Expecting max_pooling_2d stride greater than 1, but got ", stride );
+        return max_pooling_2d( stride, stride, stride, stride );
+    }
+
+    ///
+    /// @brief Average pooling of a [BS, R, C, CH] input with a window of [row_kernel, col_kernel].
+    ///
+    /// The output shape is the one of `max_pooling_2d`, NCHWc inputs included. With `same` padding, the padded elements are left out of the averages.
+    ///
+    inline auto average_pooling_2d( unsigned long row_kernel, unsigned long col_kernel, unsigned long row_stride, unsigned long col_stride, std::string const& padding="valid" ) noexcept
+    {
+        return ceras_private::make_pooling_2d( ceras_private::pooling_2d_context{ row_kernel, col_kernel, row_stride, col_stride, padding, true }, "AveragePooling2D" );
+    }
+
+    ///
+    /// @brief Average pooling of a [BS, R, C, CH] input with non-overlapping windows of [stride, stride], producing a [BS, R/stride, C/stride, CH] output.
+    ///
+    inline auto average_pooling_2d( unsigned long stride ) noexcept
+    {
+        better_assert( stride > 1, "Expecting average_pooling_2d stride greater than 1, but got ", stride );
+        return average_pooling_2d( stride, stride, stride, stride );
+    }
 
+    namespace
+    {
+        struct up_sampling_2d_context
+        {
             auto make_forward() const noexcept
             {
-                return  []( unsigned long stride, std::shared_ptr<std::any> mask, std::shared_ptr<std::any> forward_cache ) noexcept
+                return []( unsigned long stride, std::shared_ptr<std::any> forward_cache ) noexcept
                 {
                     return [=]<Tensor Tsor>( Tsor const& input ) noexcept
                     {
                         typedef typename Tsor::value_type value_type;
                         better_assert( input.ndim() == 4, "Expecting a 4D tensor, but got ", input.ndim() );
 
-                        Tsor& mask__ = context_cast<Tsor>( mask );
-                        mask__.resize( input.shape() );
-
-
                         std::vector<unsigned long> shape = input.shape();
                         auto const[batch_size, row, col, channel] = std::make_tuple(shape[0], shape[1], shape[2], shape[3]);
                         Tsor input_ = input;
                         view_4d<value_type> ts{ input_.data(), batch_size, row, col, channel };
-                        view_4d<value_type> tm{ mask__.data(), batch_size, row, col, channel };
 
                         Tsor& ans = context_cast<Tsor>( forward_cache );
-                        ans.resize( {batch_size, row/stride, col/stride, channel} );
+                        ans.resize( {batch_size, row*stride, col*stride, channel} );
+                        std::fill( ans.begin(), ans.end(), value_type{0} );
 
-                        view_4d<value_type> t1{ ans.data(), batch_size, row/stride, col/stride, channel };
+                        view_4d<value_type> t1{ ans.data(), batch_size, row*stride, col*stride, channel };
 
                         for ( auto bs : range(batch_size) )
-                            for ( auto r : range(row/stride) ) // row for t1
-                                for ( auto c : range(col/stride) ) // col for t1
+                            for ( auto r : range(row) ) // row for ts
+                                for ( auto c : range(col) ) // col for ts
                                     for ( auto ch : range(channel) )
-                                    {
-                                        unsigned long current_row_max = r * stride;
-                                        unsigned long current_col_max = c * stride;
-                                        for ( auto _r : range( (r*stride), ((r*stride)+stride) ) ) // row for ts
-                                            for ( auto _c : range( (c*stride), ((c*stride)+stride) ) ) // col for ts
-                                            {
-                                                if ( ts[bs][_r][_c][ch] > ts[bs][current_row_max][current_col_max][ch] )
-                                                {
-                                                    current_row_max = _r;
-                                                    current_col_max = _c;
-                                                }
-                                            }
-                                        tm[bs][current_row_max][current_col_max][ch] = 1.0; //mark as max
-                                        t1[bs][r][c][ch] = ts[bs][current_row_max][current_col_max][ch]; // update value
-                                    }
+                                        for ( auto _r : range( (r*stride), ((r*stride)+stride) ) ) // row for t1
+                                            for ( auto _c : range( (c*stride), ((c*stride)+stride) ) ) // col for t1
+                                                t1[bs][_r][_c][ch] = ts[bs][r][c][ch];
                         return ans;
                     };
                 };
@@ -1692,7 +2945,7 @@ namespace ceras
 
             auto make_backward() const noexcept
             {
-                return []( unsigned long stride, std::shared_ptr<std::any> mask, std::shared_ptr<std::any> backward_cache ) noexcept
+                return []( unsigned long stride, std::shared_ptr<std::any> backward_cache ) noexcept
                 {
                     return [=]<Tensor Tsor>( Tsor const& input, Tsor const&, Tsor const& grad ) noexcept
                     {
@@ -1700,230 +2953,572 @@ namespace ceras
                         std::vector<unsigned long> const& shape = input.shape();
                         auto const[batch_size, row, col, channel] = std::make_tuple(shape[0], shape[1], shape[2], shape[3]);
 
-                        Tsor& mask__ = std::any_cast<Tsor&>( *mask );
-                        view_4d<value_type> tm{ mask__.data(), batch_size, row, col, channel };
-
                         Tsor& ans = context_cast<Tsor>( backward_cache );
                         ans.resize( input.shape() );
+                        std::fill( ans.begin(), ans.end(), value_type{0} );
 
                         view_4d<value_type> ta{ ans.data(), batch_size, row, col, channel };
 
                         Tsor grad_ = grad;
-                        view_4d<value_type> tg{ grad_.data(), batch_size, row/stride, col/stride, channel };
+                        view_4d<value_type> tg{ grad_.data(), batch_size, row*stride, col*stride, channel };
 
                         for ( auto bs : range( batch_size ) )
                             for ( auto r : range( row ) )
                                 for ( auto c : range( col ) )
                                     for ( auto ch : range( channel ) )
-                                        if ( std::abs(tm[bs][r][c][ch] - 1.0) < 1.0e-5 )
-                                            ta[bs][r][c][ch] = tg[bs][r/stride][c/stride][ch];
+                                        for ( auto _r : range( (r*stride), ((r*stride)+stride) ) ) // row for tg
+                                            for ( auto _c : range( (c*stride), ((c*stride)+stride) ) ) // col for tg
+                                                ta[bs][r][c][ch] += tg[bs][_r][_c][ch];
                         return ans;
                     };
                 };
             }
-
-        }; // max_pooling_2d_context
+        }; // up_sampling_2d_context
 
     } // anonymous namespace
 
-
-    // comment: maybe using function 'reduce' to reduce the cod complexity? at a price of performance?
-    inline auto max_pooling_2d( unsigned long stride ) noexcept
+    inline auto up_sampling_2d( unsigned long stride ) noexcept
     {
-        better_assert( stride > 1, "Expecting max_pooling_2d stride greater than 1, but got ", stride );
+        better_assert( stride > 1, "Expecting up_sampling_pooling_2d stride greater than 1, but got ", stride );
 
-        std::shared_ptr<std::any> mask = std::make_shared<std::any>();
         std::shared_ptr<std::any> forward_cache = std::make_shared<std::any>();
         std::shared_ptr<std::any> backward_cache = std::make_shared<std::any>();
 
-        return [stride, mask, forward_cache, backward_cache]<Expression Ex>( Ex const& ex ) noexcept
+        return [stride, forward_cache, backward_cache]<Expression Ex>( Ex const& ex ) noexcept
         {
             return make_unary_operator
             (
-                max_pooling_2d_context{}.make_forward()( stride, mask, forward_cache ),
-                max_pooling_2d_context{}.make_backward()( stride, mask, backward_cache ),
-                "MaxPooling2D",
+                up_sampling_2d_context{}.make_forward()( stride, forward_cache ),
+                up_sampling_2d_context{}.make_backward()( stride, backward_cache ),
+                "UpSampling2D",
                 [=]( std::vector<unsigned long> const& shape ) noexcept
                 {
                     better_assert( shape.size()==4, fmt::format( "expecting shape size of 4, but got {}", shape.size() ) );
-                    return std::vector<unsigned long>{ {shape[0], shape[1]/stride, shape[2]/stride, shape[3]} };
+                    return std::vector<unsigned long>{ {shape[0], shape[1]*stride, shape[2]*stride, shape[3]} };
                 }
             )( ex );
         };
     }
 
-    inline auto average_pooling_2d( unsigned long stride ) noexcept
+    // an alias name
+    inline auto upsampling_2d( unsigned long stride ) noexcept
     {
-        better_assert( stride > 1, "Expecting average_pooling_2d stride greater than 1, but got ", stride );
+        return up_sampling_2d( stride );
+    }
+
+
 
+    template< typename T=double > requires std::floating_point<T>
+    inline auto normalization_batch( T const momentum=0.98 ) noexcept
+    {
+        std::shared_ptr<std::any> global_average_cache = std::make_shared<std::any>();
+        std::shared_ptr<std::any> global_variance_cache = std::make_shared<std::any>();
+        std::shared_ptr<std::any> average_cache = std::make_shared<std::any>();
+        std::shared_ptr<std::any> variance_cache = std::make_shared<std::any>();
         std::shared_ptr<std::any> forward_cache = std::make_shared<std::any>();
         std::shared_ptr<std::any> backward_cache = std::make_shared<std::any>();
+        std::shared_ptr<folding_state> folding = std::make_shared<folding_state>();
 
-        return [stride, forward_cache, backward_cache]<Expression Ex>( Ex const& ex ) noexcept
+        return [=]<Expression Ex>( Ex const& ex ) noexcept
         {
             return make_unary_operator
             (
-                [stride, forward_cache]<Tensor Tsor>( Tsor const& input ) noexcept // [BS, R, C, CH] --> [BS, R/s, C/s, CH]
+                [=]<Tensor Tsor>( Tsor const& input ) noexcept
                 {
+                    better_assert( input.ndim() > 1, "normalization_batch requires input dimension at least 2, got ", input.ndim() );
+
+                    if ( folding->folded() ) // folded into the preceding Conv2D or Dense, see `folding.hpp`
+                        return input;
+
                     typedef typename Tsor::value_type value_type;
-                    better_assert( input.ndim() == 4, "Expecting a 4D tensor, but got ", input.ndim() );
+                    //typedef typename Tsor::allocator allocator;
+
+                    std::vector<unsigned long> const& shape = input.shape();
+                    unsigned long const channels = *(shape.rbegin());
+                    unsigned long const rest_dims = input.size() / channels;
+
+                    view_2d<value_type> input_{ input.data(), rest_dims, channels };
+
+                    // case of prediction phase, in this phase, the batch size could be 1, and it is not possible to calculate the variance
+                    if ( learning_phase == 0 ) // defined in 'config.hpp'
+                    {
+                        // fix for the special case when prediction is executed before the training, typically in a GAN
+                        Tsor& global_average_test = context_cast<Tsor>( global_average_cache );
+                        if ( global_average_test.empty() )
+                        {
+                            if ( auto& trace = get_folding_trace(); trace.active )
+                                trace.record( folding_kind::normalization, folding, input, static_cast<Tsor const*>( nullptr ), input );
+                            return input;
+                        }
+
+                        // normal case. i.e., the global_average_cache and global_variance_cache are not empty
+                        Tsor& global_average = context_extract<Tsor>( global_average_cache );
+                        Tsor& global_variance = context_extract<Tsor>( global_variance_cache );
+
+                        Tsor& ans = context_cast<Tsor>( forward_cache, zeros_like( input ) );
+                        ans.resize( input.shape() ); // well, the batch sizes for training and for prediction are not necessarily same
+
+                        view_2d<value_type> ans_{ ans.data(), rest_dims, channels };
+                        {
+                            for ( auto r : range( rest_dims ) )
+                                for ( auto c : range( channels ) )
+                                    ans_[r][c] = (input_[r][c] - global_average[c]) / std::sqrt( global_variance[c] + eps );
+                        }
+                        if ( auto& trace = get_folding_trace(); trace.active )
+                            trace.record( folding_kind::normalization, folding, input, static_cast<Tsor const*>( nullptr ), ans, { global_average.deep_copy(), global_variance.deep_copy() } );
+                        return ans;
+                    }
+
+                    //calculate average along the last channel
+                    Tsor& average = context_cast<Tsor>( average_cache );
+                    {
+                        average.resize( {channels, } );
+                        std::fill( average.begin(), average.end(), value_type{0} );
+
+                        for ( auto idx : range( rest_dims ) )
+                            for ( auto jdx : range( channels ) )
+                                average[jdx] += input_[idx][jdx];
+
+                        average /= static_cast<value_type>(rest_dims);
+                    }
+
+                    //calculate Variance along the last channel
+                    Tsor& variance = context_cast<Tsor>( variance_cache );
+                    {
+                        variance.resize( {channels,} );
+                        std::fill( variance.begin(), variance.end(), value_type{0} );
+                        for ( auto idx : range( rest_dims ) )
+                            for ( auto jdx : range( channels ) )
+                                variance[jdx] += std::pow( input_[idx][jdx] - average[jdx], 2 );
+
+                        variance /= static_cast<value_type>( rest_dims );
+                    }
 
-                    std::vector<unsigned long> shape = input.shape();
-                    auto const[batch_size, row, col, channel] = std::make_tuple(shape[0], shape[1], shape[2], shape[3]);
-                    Tsor input_ = input;
-                    view_4d<value_type> ts{ input_.data(), batch_size, row, col, channel };
 
                     Tsor& ans = context_cast<Tsor>( forward_cache );
-                    ans.resize( {batch_size, row/stride, col/stride, channel} );
-                    std::fill( ans.begin(), ans.end(), value_type{0} );
-
-                    view_4d<value_type> t1{ ans.data(), batch_size, row/stride, col/stride, channel };
-
-                    value_type const factor = value_type{1} / static_cast<value_type>(stride*stride);
-                    for ( auto bs : range(batch_size) )
-                        for ( auto r : range(row/stride) ) // row for t1
-                            for ( auto c : range(col/stride) ) // col for t1
-                                for ( auto ch : range(channel) )
-                                    for ( auto _r : range( (r*stride), ((r*stride)+stride) ) ) // row for ts
-                                        for ( auto _c : range( (c*stride), ((c*stride)+stride) ) ) // col for ts
-                                            t1[bs][r][c][ch] += ts[bs][_r][_c][ch] * factor;
+                    ans.resize( input.shape() ); // the batch sizes for training and for prediction are not necessarily same
+                    view_2d<value_type> ans_{ ans.data(), rest_dims, channels };
+                    {
+                        for ( auto idx : range( rest_dims ) )
+                            for ( auto jdx : range( channels ) )
+                                ans_[idx][jdx] = ( input_[idx][jdx] - average[jdx] ) / std::sqrt( variance[jdx] + eps );
+                    }
+
+                    // update global average and global variance
+                    {
+                        Tsor& global_average = context_cast<Tsor>( global_average_cache, zeros_like( average ) );
+                        // Note: No obvious different is observed between initializing global_variance to zeros and to ones with MNIST example:
+                        //       initializing global_variance to zeros, after 10 epochs mnist gives an error of 0.026
+                        //       initializing global_variance to ones, after 10 epochs mnist gives an error of 0.028
+                        Tsor& global_variance = context_cast<Tsor>( global_variance_cache, zeros_like( variance ) );
+                        //Tsor& global_variance = context_cast<Tsor>( global_variance_cache, ones_like( variance ) );
+                        for ( auto idx : range( global_average.size() ) )
+                        {
+                            global_average[idx] = global_average[idx] * momentum + average[idx] * ( 1.0 - momentum );
+                            global_variance[idx] = global_variance[idx] * momentum + variance[idx] * ( 1.0 - momentum );
+                        }
+                        ++variable_data_generation; // the statistics folded into the preceding layer have changed, see `folding.hpp`
+                    }
+
                     return ans;
                 },
-                [stride, backward_cache]<Tensor Tsor>( Tsor const& input, Tsor const&, Tsor const& grad ) noexcept
+
+                [=]<Tensor Tsor>( Tsor const& input, Tsor const&, Tsor const& grad ) noexcept
                 {
                     typedef typename Tsor::value_type value_type;
-                    std::vector<unsigned long> const& shape = input.shape();
-                    auto const[batch_size, row, col, channel] = std::make_tuple(shape[0], shape[1], shape[2], shape[3]);
-
-                    Tsor& ans = context_cast<Tsor>( backward_cache );
-                    ans.resize( input.shape() );
-
-                    view_4d<value_type> ta{ ans.data(), batch_size, row, col, channel };
+                    Tsor& variance = context_extract<Tsor>( variance_cache );
 
-                    Tsor grad_ = grad;
-                    view_4d<value_type> tg{ grad_.data(), batch_size, row/stride, col/stride, channel };
+                    std::vector<unsigned long> const& shape = input.shape();
+                    unsigned long const channels = *(shape.rbegin());
+                    unsigned long const rest_dims = input.size() / channels;
 
-                    value_type const factor = value_type{1} / static_cast<value_type>(stride*stride);
-                    for ( auto bs : range( batch_size ) )
-                        for ( auto r : range( row ) )
-                            for ( auto c : range( col ) )
-                                for ( auto ch : range( channel ) )
-                                    ta[bs][r][c][ch] = factor * tg[bs][r/stride][c/stride][ch];
+                    Tsor& ans = context_cast<Tsor>( backward_cache, zeros_like( input ) );
+                    view_2d<value_type> ans_{ans.data(), rest_dims, channels };
+                    view_2d<value_type> grad_{grad.data(), rest_dims, channels };
+                    for ( auto r : range( rest_dims ) )
+                        for ( auto c : range( channels ) )
+                            ans_[r][c] = grad_[r][c] / std::sqrt( variance[c] + eps );
                     return ans;
                 },
-                "AveragePooling2D",
-                [=]( std::vector<unsigned long> const& shape ) noexcept
-                {
-                    better_assert( shape.size()==4, fmt::format( "expecting shape size of 4, but got {}", shape.size() ) );
-                    return std::vector<unsigned long>{ {shape[0], shape[1]/stride, shape[2]/stride, shape[3]} };
-                }
+                "Normalization"
             )( ex );
         };
     }
 
-    namespace
+
+
+    template< typename T > requires std::floating_point<T>
+    inline auto batch_normalization( T const momentum=0.98 ) noexcept
     {
-        struct up_sampling_2d_context
+        return [=]<Expression Ex, Variable Va>( Ex const& ex, Va const& gamma, Va const& beta ) noexcept
         {
+            return elementwise_product( normalization_batch(momentum)(ex), gamma ) + beta; // multiply and sum along the batch: normalization is of shape [BS, R, C, CH], gamma/beta are of shape [R, C, CH]
+        };
+    }
+
+
+    namespace ceras_private
+    {
+        // the output shape calculator of `to_nchwc`, [BS, R, C, CH] to [BS, ceil(CH/block), R, C, block]
+        struct nchwc_blocking
+        {
+            unsigned long block;
+
+            std::vector<unsigned long> operator()( std::vector<unsigned long> const& shape ) const noexcept
+            {
+                better_assert( shape.size() == 4, fmt::format( "to_nchwc: expecting a 4D input, but got {} dimensions", shape.size() ) );
+                return std::vector<unsigned long>{ {shape[0], (shape[3] + block - 1) / block, shape[1], shape[2], block} };
+            }
+        };
+
+        // the output shape calculator of `from_nchwc`, [BS, CB, R, C, b] to [BS, R, C, channels]
+        struct nchwc_unblocking
+        {
+            unsigned long channels;
+
+            std::vector<unsigned long> operator()( std::vector<unsigned long> const& shape ) const noexcept
+            {
+                better_assert( shape.size() == 5, fmt::format( "from_nchwc: expecting a NCHWc input, but got {} dimensions", shape.size() ) );
+                better_assert( shape[1] == (channels + shape[4] - 1) / shape[4], fmt::format( "from_nchwc: expecting {} blocks for {} channels, but got {}", (channels + shape[4] - 1) / shape[4], channels, shape[1] ) );
+                return std::vector<unsigned long>{ {shape[0], shape[2], shape[3], channels} };
+            }
+        };
+
+        // the output shape calculator of `to_nchwc( block )( from_nchwc( channels )( y ) )`, [BS, CB, R, C, b] to [BS, ceil(channels/block), R, C, block]
+        struct nchwc_reblocking
+        {
+            unsigned long channels;
+            unsigned long block;
+
+            std::vector<unsigned long> operator()( std::vector<unsigned long> const& shape ) const noexcept
+            {
+                return nchwc_blocking{ block }( nchwc_unblocking{ channels }( shape ) );
+            }
+        };
+
+        // the output shape calculator of `from_nchwc( channels )( to_nchwc( block )( x ) )`, [BS, R, C, CH] to [BS, R, C, channels]
+        struct nchwc_rechanneling
+        {
+            unsigned long block;
+            unsigned long channels;
+
+            std::vector<unsigned long> operator()( std::vector<unsigned long> const& shape ) const noexcept
+            {
+                return nchwc_unblocking{ channels }( nchwc_blocking{ block }( shape ) );
+            }
+        };
+
+        template< typename T >
+        struct is_nchwc_blocking_operator : std::false_type {};
+
+        template< typename Operator, typename Forward_Action, typename Backward_Action >
+        struct is_nchwc_blocking_operator< unary_operator<Operator, Forward_Action, Backward_Action, nchwc_blocking> > : std::true_type {};
+
+        template< typename T >
+        inline constexpr bool is_nchwc_blocking_operator_v = is_nchwc_blocking_operator<T>::value;
+
+        template< typename T >
+        struct is_nchwc_unblocking_operator : std::false_type {};
+
+        template< typename Operator, typename Forward_Action, typename Backward_Action >
+        struct is_nchwc_unblocking_operator< unary_operator<Operator, Forward_Action, Backward_Action, nchwc_unblocking> > : std::true_type {};
+
+        template< typename T >
+        inline constexpr bool is_nchwc_unblocking_operator_v = is_nchwc_unblocking_operator<T>::value;
+
+        // copies a [BS, R, C, CH] tensor to the [BS, CB, R, C, block] layout, or back
+        template< Tensor Tsor >
+        void convert_nchwc( Tsor const& input, std::vector<unsigned long> const& nhwc_shape, unsigned long block, bool to_blocks, Tsor& output )
+        {
+            auto const[batch, rows, cols, channels] = std::make_tuple( nhwc_shape[0], nhwc_shape[1], nhwc_shape[2], nhwc_shape[3] );
+            if ( to_blocks )
+            {
+                output.resize( nchwc_blocking{ block }( nhwc_shape ) );
+                backend::nhwc_to_nchwc( input.data(), batch, rows, cols, channels, block, output.data() );
+                return;
+            }
+            output.resize( nhwc_shape );
+            backend::nchwc_to_nhwc( input.data(), batch, rows, cols, channels, block, output.data() );
+        }
+
+        // whether the channels of a [BS, CB, R, C, b] tensor from `channels` on, in its last block, are zeros
+        template< Tensor Tsor >
+        bool is_nchwc_tail_zero( Tsor const& input, unsigned long channels )
+        {
+            std::vector<unsigned long> const& shape = input.shape();
+            auto const[batch, blocks, pixels, block] = std::make_tuple( shape[0], shape[1], shape[2]*shape[3], shape[4] );
+            unsigned long const first = channels - (blocks - 1) * block;
+            for ( auto b : range( batch ) )
+                for ( auto p : range( pixels ) )
+                {
+                    auto const* tail = input.data() + ( ( b * blocks + blocks - 1 ) * pixels + p ) * block;
+                    if ( std::any_of( tail + first, tail + block, []( auto v ){ return v != decltype(v){0}; } ) )
+                        return false;
+                }
+            return true;
+        }
+
+        // the convolution of a [BS, CB, R, C, b] input with [NC, r, c, CH] kernels, see `backend/nchwc_conv2d.hpp`
+        struct nchwc_conv2d_context
+        {
+            unsigned long row_stride_;
+            unsigned long col_stride_;
+            unsigned long row_dilation_;
+            unsigned long col_dilation_;
+            std::string padding_;
+
+            backend::conv2d_geometry geometry( std::vector<unsigned long> const& x, std::vector<unsigned long> const& kernel ) const noexcept
+            {
+                better_assert( x.size() == 5, fmt::format( "nchwc_conv2d: expecting a NCHWc input, but got {} dimensions", x.size() ) );
+                better_assert( kernel.size() == 4, fmt::format( "nchwc_conv2d: expecting a 4D kernel, but got {} dimensions", kernel.size() ) );
+                better_assert( x[1] == (kernel[3] + x[4] - 1) / x[4], fmt::format( "nchwc_conv2d: expecting {} input blocks for kernels of {} channels, but got {}", (kernel[3] + x[4] - 1) / x[4], kernel[3], x[1] ) );
+                backend::conv2d_geometry g{ x[0], x[2], x[3], kernel[3], kernel[0], kernel[1], kernel[2], row_stride_, col_stride_, 0, 0, row_dilation_, col_dilation_ };
+                if ( padding_ == "same" )
+                {
+                    g.row_padding = ( (g.kernel_rows&1) + g.kernel_rows + (g.kernel_rows - 1) * (row_dilation_ - 1) - row_stride_ ) >> 1;
+                    g.col_padding = ( (g.kernel_cols&1) + g.kernel_cols + (g.kernel_cols - 1) * (col_dilation_ - 1) - col_stride_ ) >> 1;
+                }
+                return g;
+            }
+
+            std::vector<unsigned long> output_shape( std::vector<unsigned long> const& x, std::vector<unsigned long> const& kernel ) const noexcept
+            {
+                backend::conv2d_geometry const& g = geometry( x, kernel );
+                return std::vector<unsigned long>{ {x[0], (g.new_channels + x[4] - 1) / x[4], g.output_rows(), g.output_cols(), x[4]} };
+            }
+
             auto make_forward() const noexcept
             {
-                return []( unsigned long stride, std::shared_ptr<std::any> forward_cache ) noexcept
+                return [*this]( std::shared_ptr<std::any> forward_cache, std::shared_ptr<std::any> workspace_cache ) noexcept
                 {
-                    return [=]<Tensor Tsor>( Tsor const& input ) noexcept
+                    return [=, *this]<Tensor Tsor>( Tsor const& x, Tsor const& kernel ) noexcept
                     {
                         typedef typename Tsor::value_type value_type;
-                        better_assert( input.ndim() == 4, "Expecting a 4D tensor, but got ", input.ndim() );
-
-                        std::vector<unsigned long> shape = input.shape();
-                        auto const[batch_size, row, col, channel] = std::make_tuple(shape[0], shape[1], shape[2], shape[3]);
-                        Tsor input_ = input;
-                        view_4d<value_type> ts{ input_.data(), batch_size, row, col, channel };
-
                         Tsor& ans = context_cast<Tsor>( forward_cache );
-                        ans.resize( {batch_size, row*stride, col*stride, channel} );
-                        std::fill( ans.begin(), ans.end(), value_type{0} );
+                        ans.resize( output_shape( x.shape(), kernel.shape() ) );
+                        backend::nchwc_conv2d( x.data(), kernel.data(), geometry( x.shape(), kernel.shape() ), x.shape()[4], ans.data(),
+                                               context_cast<backend::nchwc_conv2d_workspace<value_type>>( workspace_cache ) );
+                        return ans;
+                    };
+                };
+            }
 
-                        view_4d<value_type> t1{ ans.data(), batch_size, row*stride, col*stride, channel };
+            auto make_backward() const noexcept
+            {
+                return [*this]( std::shared_ptr<std::any> backward_cache_lhs, std::shared_ptr<std::any> backward_cache_rhs, std::shared_ptr<std::any> workspace_cache ) noexcept
+                {
+                    return [=, *this]<Tensor Tsor>( Tsor const& x, Tsor const& kernel, Tsor const&, Tsor const& grad, Tsor* x_target = nullptr, Tsor* kernel_target = nullptr ) noexcept
+                    {
+                        typedef typename Tsor::value_type value_type;
+                        backend::conv2d_geometry const& g = geometry( x.shape(), kernel.shape() );
+                        backend::nchwc_conv2d_workspace<value_type>& workspace = context_cast<backend::nchwc_conv2d_workspace<value_type>>( workspace_cache );
+
+                        Tsor& x_grad = context_cast<Tsor>( backward_cache_lhs );
+                        if ( !x_target )
+                            x_grad.resize( x.shape() );
+                        backend::nchwc_conv2d_input_gradient( grad.data(), kernel.data(), g, x.shape()[4], x_target ? x_target->data() : x_grad.data(), x_target != nullptr, workspace );
+
+                        Tsor& kernel_grad = context_cast<Tsor>( backward_cache_rhs );
+                        if ( !kernel_target )
+                            kernel_grad.resize( kernel.shape() );
+                        backend::nchwc_conv2d_kernel_gradient( x.data(), grad.data(), g, x.shape()[4], kernel_target ? kernel_target->data() : kernel_grad.data(), kernel_target != nullptr, workspace );
+                        return std::make_tuple( x_grad, kernel_grad );
+                    };
+                };
+            }
+        };//nchwc_conv2d_context
+    }//namespace ceras_private
 
-                        for ( auto bs : range(batch_size) )
-                            for ( auto r : range(row) ) // row for ts
-                                for ( auto c : range(col) ) // col for ts
-                                    for ( auto ch : range(channel) )
-                                        for ( auto _r : range( (r*stride), ((r*stride)+stride) ) ) // row for t1
-                                            for ( auto _c : range( (c*stride), ((c*stride)+stride) ) ) // col for t1
-                                                t1[bs][_r][_c][ch] = ts[bs][r][c][ch];
+    ///
+    /// @brief Converts a [BS, R, C, CH] input to the channel-blocked NCHWc layout [BS, ceil(CH/block), R, C, block], see `backend/nchwc_conv2d.hpp`.
+    /// @param block The number of channels of a block, 4, 8 or 16, best the SIMD width of the type.
+    ///
+    /// The channels past CH in the last block, the tail, are zeros, and are never read into real channels by the operators on NCHWc tensors.
+    /// These are `nchwc_conv2d`, `max_pooling_2d`, `average_pooling_2d` and `nchwc_batch_normalization`, together with the elementwise operators,
+    /// such as `relu` or `+` on tensors of the same shape, which do not depend on the layout.
+    ///
+    /// The converters are meant for the boundaries of a NCHWc part of the graph: converting back a tensor just converted, or the other way around,
+    /// with the same parameters returns the tensor itself, so that the layers written as NHWC layers around `from_nchwc` and `to_nchwc` keep the data
+    /// blocked between them. That is `to_nchwc( b )` of `from_nchwc( CH )( y )` when y has blocks of b channels, and `from_nchwc( CH )` of
+    /// `to_nchwc( b )( x )` when x has CH channels; with other parameters, the tensor is converted twice.
+    ///
+    /// Example code:
+    ///
+    /// \code{.cpp}
+    /// auto x = variable{ random<float>( {16, 32, 32, 3} ) };
+    /// auto w1 = variable{ randn<float>( {32, 3, 3, 3} ) };
+    /// auto w2 = variable{ randn<float>( {64, 3, 3, 32} ) };
+    /// auto y1 = from_nchwc( 32 )( relu( nchwc_conv2d( 1, 1, 1, 1, "same" )( to_nchwc( 16 )( x ), w1 ) ) ); // [16, 32, 32, 32]
+    /// auto y2 = from_nchwc( 64 )( nchwc_conv2d( 1, 1, 1, 1, "same" )( to_nchwc( 16 )( y1 ), w2 ) ); // y1 is not converted: the second conv reads the output of the relu
+    /// \endcode
+    ///
+    inline auto to_nchwc( unsigned long block=16 ) noexcept
+    {
+        better_assert( backend::is_nchwc_block( block ), "to_nchwc: expecting blocks of 4, 8 or 16 channels, but got ", block );
+        std::shared_ptr<std::any> forward_cache = std::make_shared<std::any>();
+        std::shared_ptr<std::any> backward_cache = std::make_shared<std::any>();
+
+        return [block, forward_cache, backward_cache]<Expression Ex>( Ex const& ex ) noexcept
+        {
+            if constexpr( ceras_private::is_nchwc_unblocking_operator_v<Ex> )
+            {
+                // the blocked input of `from_nchwc` is returned itself if it has blocks of `block` channels, and a zero tail after the channels kept
+                unsigned long const channels = ex.output_shape_calculator_.channels;
+                auto const& is_identity = [block, channels]<Tensor Tsor>( Tsor const& input )
+                {
+                    return input.shape()[4] == block && ceras_private::is_nchwc_tail_zero( input, channels );
+                };
+                return make_unary_operator
+                (
+                    [block, channels, is_identity, forward_cache]<Tensor Tsor>( Tsor const& input ) noexcept
+                    {
+                        std::vector<unsigned long> const& shape = input.shape();
+                        std::vector<unsigned long> const& nhwc_shape = ceras_private::nchwc_unblocking{ channels }( shape );
+                        if ( is_identity( input ) )
+                            return input;
+                        Tsor nhwc;
+                        ceras_private::convert_nchwc( input, nhwc_shape, shape[4], false, nhwc );
+                        Tsor& ans = context_cast<Tsor>( forward_cache );
+                        ceras_private::convert_nchwc( nhwc, nhwc_shape, block, true, ans );
+                        return ans;
+                    },
+                    [block, channels, is_identity, backward_cache]<Tensor Tsor>( Tsor const& input, Tsor const&, Tsor const& grad ) noexcept
+                    {
+                        if ( is_identity( input ) )
+                            return grad;
+                        std::vector<unsigned long> const& shape = input.shape();
+                        std::vector<unsigned long> const& nhwc_shape = ceras_private::nchwc_unblocking{ channels }( shape );
+                        Tsor nhwc;
+                        ceras_private::convert_nchwc( grad, nhwc_shape, block, false, nhwc );
+                        Tsor& ans = context_cast<Tsor>( backward_cache );
+                        ceras_private::convert_nchwc( nhwc, nhwc_shape, shape[4], true, ans );
                         return ans;
-                    };
-                };
+                    },
+                    "ToNCHWc",
+                    ceras_private::nchwc_reblocking{ channels, block }
+                )( ex.op_ );
             }
-
-            auto make_backward() const noexcept
+            else
             {
-                return []( unsigned long stride, std::shared_ptr<std::any> backward_cache ) noexcept
-                {
-                    return [=]<Tensor Tsor>( Tsor const& input, Tsor const&, Tsor const& grad ) noexcept
+                return make_unary_operator
+                (
+                    [block, forward_cache]<Tensor Tsor>( Tsor const& input ) noexcept
+                    {
+                        Tsor& ans = context_cast<Tsor>( forward_cache );
+                        ceras_private::convert_nchwc( input, input.shape(), block, true, ans );
+                        return ans;
+                    },
+                    [block, backward_cache]<Tensor Tsor>( Tsor const& input, Tsor const&, Tsor const& grad ) noexcept
                     {
-                        typedef typename Tsor::value_type value_type;
-                        std::vector<unsigned long> const& shape = input.shape();
-                        auto const[batch_size, row, col, channel] = std::make_tuple(shape[0], shape[1], shape[2], shape[3]);
-
                         Tsor& ans = context_cast<Tsor>( backward_cache );
-                        ans.resize( input.shape() );
-                        std::fill( ans.begin(), ans.end(), value_type{0} );
-
-                        view_4d<value_type> ta{ ans.data(), batch_size, row, col, channel };
-
-                        Tsor grad_ = grad;
-                        view_4d<value_type> tg{ grad_.data(), batch_size, row*stride, col*stride, channel };
-
-                        for ( auto bs : range( batch_size ) )
-                            for ( auto r : range( row ) )
-                                for ( auto c : range( col ) )
-                                    for ( auto ch : range( channel ) )
-                                        for ( auto _r : range( (r*stride), ((r*stride)+stride) ) ) // row for tg
-                                            for ( auto _c : range( (c*stride), ((c*stride)+stride) ) ) // col for tg
-                                                ta[bs][r][c][ch] += tg[bs][_r][_c][ch];
+                        ceras_private::convert_nchwc( grad, input.shape(), block, false, ans );
                         return ans;
-                    };
-                };
+                    },
+                    "ToNCHWc",
+                    ceras_private::nchwc_blocking{ block }
+                )( ex );
             }
-        }; // up_sampling_2d_context
-
-    } // anonymous namespace
+        };
+    }
 
-    inline auto up_sampling_2d( unsigned long stride ) noexcept
+    ///
+    /// @brief Converts a [BS, CB, R, C, b] input in the NCHWc layout back to [BS, R, C, channels], dropping the tail, see `to_nchwc`.
+    ///
+    inline auto from_nchwc( unsigned long channels ) noexcept
     {
-        better_assert( stride > 1, "Expecting up_sampling_pooling_2d stride greater than 1, but got ", stride );
-
+        better_assert( channels > 0, "from_nchwc: expecting at least 1 channel." );
         std::shared_ptr<std::any> forward_cache = std::make_shared<std::any>();
         std::shared_ptr<std::any> backward_cache = std::make_shared<std::any>();
 
-        return [stride, forward_cache, backward_cache]<Expression Ex>( Ex const& ex ) noexcept
+        return [channels, forward_cache, backward_cache]<Expression Ex>( Ex const& ex ) noexcept
         {
-            return make_unary_operator
-            (
-                up_sampling_2d_context{}.make_forward()( stride, forward_cache ),
-                up_sampling_2d_context{}.make_backward()( stride, backward_cache ),
-                "UpSampling2D",
-                [=]( std::vector<unsigned long> const& shape ) noexcept
-                {
-                    better_assert( shape.size()==4, fmt::format( "expecting shape size of 4, but got {}", shape.size() ) );
-                    return std::vector<unsigned long>{ {shape[0], shape[1]*stride, shape[2]*stride, shape[3]} };
-                }
-            )( ex );
+            if constexpr( ceras_private::is_nchwc_blocking_operator_v<Ex> )
+            {
+                // the input of `to_nchwc` is returned itself if it has `channels` channels
+                unsigned long const block = ex.output_shape_calculator_.block;
+                return make_unary_operator
+                (
+                    [block, channels, forward_cache]<Tensor Tsor>( Tsor const& input ) noexcept
+                    {
+                        if ( *(input.shape().rbegin()) == channels )
+                            return input;
+                        Tsor blocked;
+                        ceras_private::convert_nchwc( input, input.shape(), block, true, blocked );
+                        Tsor& ans = context_cast<Tsor>( forward_cache );
+                        ceras_private::convert_nchwc( blocked, ceras_private::nchwc_unblocking{ channels }( blocked.shape() ), block, false, ans );
+                        return ans;
+                    },
+                    [block, channels, backward_cache]<Tensor Tsor>( Tsor const& input, Tsor const&, Tsor const& grad ) noexcept
+                    {
+                        if ( *(input.shape().rbegin()) == channels )
+                            return grad;
+                        Tsor blocked;
+                        ceras_private::convert_nchwc( grad, grad.shape(), block, true, blocked );
+                        Tsor& ans = context_cast<Tsor>( backward_cache );
+                        ceras_private::convert_nchwc( blocked, input.shape(), block, false, ans );
+                        return ans;
+                    },
+                    "FromNCHWc",
+                    ceras_private::nchwc_rechanneling{ block, channels }
+                )( ex.op_ );
+            }
+            else
+            {
+                return make_unary_operator
+                (
+                    [channels, forward_cache]<Tensor Tsor>( Tsor const& input ) noexcept
+                    {
+                        std::vector<unsigned long> const& shape = input.shape();
+                        Tsor& ans = context_cast<Tsor>( forward_cache );
+                        ceras_private::convert_nchwc( input, ceras_private::nchwc_unblocking{ channels }( shape ), shape[4], false, ans );
+                        return ans;
+                    },
+                    [channels, backward_cache]<Tensor Tsor>( Tsor const& input, Tsor const&, Tsor const& grad ) noexcept
+                    {
+                        std::vector<unsigned long> const& shape = input.shape();
+                        Tsor& ans = context_cast<Tsor>( backward_cache );
+                        ceras_private::convert_nchwc( grad, ceras_private::nchwc_unblocking{ channels }( shape ), shape[4], true, ans );
+                        return ans;
+                    },
+                    "FromNCHWc",
+                    ceras_private::nchwc_unblocking{ channels }
+                )( ex );
+            }
         };
     }
 
-    // an alias name
-    inline auto upsampling_2d( unsigned long stride ) noexcept
+    ///
+    /// @brief 2D convolution of a [BS, CB, R, C, b] input in the NCHWc layout with NC kernels of [r, c, CH], producing a [BS, ceil(NC/b), new_R, new_C, b] output.
+    ///
+    /// The kernels are the kernels of `general_conv2d`, kept as [NC, r, c, CH], and the output is in the layout of the input, its tail being zeros.
+    ///
+    auto inline nchwc_conv2d
+    (
+        unsigned long const row_stride=1, unsigned long const col_stride=1,
+        unsigned long const row_dilation=1, unsigned long const col_dilation=1,
+        std::string const& padding="valid"
+    ) noexcept
     {
-        return up_sampling_2d( stride );
+        better_assert( padding == "valid" || padding == "same", "nchwc_conv2d: expecting `valid` or `same` padding, but got ", padding );
+        ceras_private::nchwc_conv2d_context const context{ row_stride, col_stride, row_dilation, col_dilation, padding };
+        return [context]<Expression Ex, Expression Ey>( Ex const& lhs_ex, Ey const& rhs_ex ) noexcept
+        {
+            std::shared_ptr<std::any> forward_cache = std::make_shared<std::any>();
+            std::shared_ptr<std::any> backward_cache_lhs = std::make_shared<std::any>();
+            std::shared_ptr<std::any> backward_cache_rhs = std::make_shared<std::any>();
+            std::shared_ptr<std::any> workspace_cache = std::make_shared<std::any>();
+            return make_binary_operator( context.make_forward()( forward_cache, workspace_cache ),
+                                         context.make_backward()( backward_cache_lhs, backward_cache_rhs, workspace_cache ),
+                                         "NCHWcConv2D",
+                                         [context]( std::vector<unsigned long> const& x, std::vector<unsigned long> const& kernel ) noexcept { return context.output_shape( x, kernel ); } )( lhs_ex, rhs_ex );
+        };
     }
 
-
-
+    ///
+    /// @brief `normalization_batch` of a [BS, CB, R, C, b] input in the NCHWc layout, the statistics of every channel being over the batch, the rows and the columns.
+    ///
     template< typename T=double > requires std::floating_point<T>
-    inline auto normalization_batch( T const momentum=0.98 ) noexcept
+    inline auto nchwc_normalization_batch( T const momentum=0.98 ) noexcept
     {
         std::shared_ptr<std::any> global_average_cache = std::make_shared<std::any>();
         std::shared_ptr<std::any> global_variance_cache = std::make_shared<std::any>();
@@ -1932,130 +3527,89 @@ namespace ceras
         std::shared_ptr<std::any> forward_cache = std::make_shared<std::any>();
         std::shared_ptr<std::any> backward_cache = std::make_shared<std::any>();
 
+        // the element (bs, cb, p, o) of a NCHWc tensor, p being the pixel, is of the channel cb*b+o
+        auto const& for_each_element = []( std::vector<unsigned long> const& shape, auto const& func )
+        {
+            auto const[batch, blocks, pixels, block] = std::make_tuple( shape[0], shape[1], shape[2]*shape[3], shape[4] );
+            for ( auto bs : range( batch ) )
+                for ( auto cb : range( blocks ) )
+                    for ( auto p : range( pixels ) )
+                        for ( auto o : range( block ) )
+                            func( ((bs*blocks+cb)*pixels+p)*block+o, cb*block+o );
+        };
+
         return [=]<Expression Ex>( Ex const& ex ) noexcept
         {
             return make_unary_operator
             (
                 [=]<Tensor Tsor>( Tsor const& input ) noexcept
                 {
-                    better_assert( input.ndim() > 1, "normalization_batch requires input dimension at least 2, got ", input.ndim() );
-
+                    better_assert( input.ndim() == 5, "nchwc_normalization_batch: expecting a NCHWc input, but got dimension ", input.ndim() );
                     typedef typename Tsor::value_type value_type;
-                    //typedef typename Tsor::allocator allocator;
-
                     std::vector<unsigned long> const& shape = input.shape();
-                    unsigned long const channels = *(shape.rbegin());
+                    unsigned long const channels = shape[1] * shape[4];
                     unsigned long const rest_dims = input.size() / channels;
 
-                    view_2d<value_type> input_{ input.data(), rest_dims, channels };
+                    Tsor& ans = context_cast<Tsor>( forward_cache );
+                    ans.resize( shape ); // the batch sizes for training and for prediction are not necessarily same
 
-                    // case of prediction phase, in this phase, the batch size could be 1, and it is not possible to calculate the variance
-                    if ( learning_phase == 0 ) // defined in 'config.hpp'
+                    // case of prediction phase, see `normalization_batch`
+                    if ( learning_phase == 0 )
                     {
-                        // fix for the special case when prediction is executed before the training, typically in a GAN
-                        Tsor& global_average_test = context_cast<Tsor>( global_average_cache );
-                        if ( global_average_test.empty() )
+                        Tsor& global_average = context_cast<Tsor>( global_average_cache );
+                        if ( global_average.empty() )
                             return input;
-
-                        // normal case. i.e., the global_average_cache and global_variance_cache are not empty
-                        Tsor& global_average = context_extract<Tsor>( global_average_cache );
                         Tsor& global_variance = context_extract<Tsor>( global_variance_cache );
-
-                        Tsor& ans = context_cast<Tsor>( forward_cache, zeros_like( input ) );
-                        ans.resize( input.shape() ); // well, the batch sizes for training and for prediction are not necessarily same
-
-                        view_2d<value_type> ans_{ ans.data(), rest_dims, channels };
-                        {
-                            for ( auto r : range( rest_dims ) )
-                                for ( auto c : range( channels ) )
-                                    ans_[r][c] = (input_[r][c] - global_average[c]) / std::sqrt( global_variance[c] + eps );
-                        }
+                        for_each_element( shape, [&]( unsigned long idx, unsigned long c ){ ans[idx] = (input[idx] - global_average[c]) / std::sqrt( global_variance[c] + eps ); } );
                         return ans;
                     }
 
-                    //calculate average along the last channel
                     Tsor& average = context_cast<Tsor>( average_cache );
-                    {
-                        average.resize( {channels, } );
-                        std::fill( average.begin(), average.end(), value_type{0} );
-
-                        for ( auto idx : range( rest_dims ) )
-                            for ( auto jdx : range( channels ) )
-                                average[jdx] += input_[idx][jdx];
-
-                        average /= static_cast<value_type>(rest_dims);
-                    }
+                    average.resize( {channels,} );
+                    std::fill( average.begin(), average.end(), value_type{0} );
+                    for_each_element( shape, [&]( unsigned long idx, unsigned long c ){ average[c] += input[idx]; } );
+                    average /= static_cast<value_type>( rest_dims );
 
-                    //calculate Variance along the last channel
                     Tsor& variance = context_cast<Tsor>( variance_cache );
-                    {
-                        variance.resize( {channels,} );
-                        std::fill( variance.begin(), variance.end(), value_type{0} );
-                        for ( auto idx : range( rest_dims ) )
-                            for ( auto jdx : range( channels ) )
-                                variance[jdx] += std::pow( input_[idx][jdx] - average[jdx], 2 );
-
-                        variance /= static_cast<value_type>( rest_dims );
-                    }
+                    variance.resize( {channels,} );
+                    std::fill( variance.begin(), variance.end(), value_type{0} );
+                    for_each_element( shape, [&]( unsigned long idx, unsigned long c ){ variance[c] += std::pow( input[idx] - average[c], 2 ); } );
+                    variance /= static_cast<value_type>( rest_dims );
 
+                    for_each_element( shape, [&]( unsigned long idx, unsigned long c ){ ans[idx] = ( input[idx] - average[c] ) / std::sqrt( variance[c] + eps ); } );
 
-                    Tsor& ans = context_cast<Tsor>( forward_cache );
-                    ans.resize( input.shape() ); // the batch sizes for training and for prediction are not necessarily same
-                    view_2d<value_type> ans_{ ans.data(), rest_dims, channels };
-                    {
-                        for ( auto idx : range( rest_dims ) )
-                            for ( auto jdx : range( channels ) )
-                                ans_[idx][jdx] = ( input_[idx][jdx] - average[jdx] ) / std::sqrt( variance[jdx] + eps );
-                    }
-
-                    // update global average and global variance
+                    Tsor& global_average = context_cast<Tsor>( global_average_cache, zeros_like( average ) );
+                    Tsor& global_variance = context_cast<Tsor>( global_variance_cache, zeros_like( variance ) );
+                    for ( auto idx : range( global_average.size() ) )
                     {
-                        Tsor& global_average = context_cast<Tsor>( global_average_cache, zeros_like( average ) );
-                        // Note: No obvious different is observed between initializing global_variance to zeros and to ones with MNIST example:
-                        //       initializing global_variance to zeros, after 10 epochs mnist gives an error of 0.026
-                        //       initializing global_variance to ones, after 10 epochs mnist gives an error of 0.028
-                        Tsor& global_variance = context_cast<Tsor>( global_variance_cache, zeros_like( variance ) );
-                        //Tsor& global_variance = context_cast<Tsor>( global_variance_cache, ones_like( variance ) );
-                        for ( auto idx : range( global_average.size() ) )
-                        {
-                            global_average[idx] = global_average[idx] * momentum + average[idx] * ( 1.0 - momentum );
-                            global_variance[idx] = global_variance[idx] * momentum + variance[idx] * ( 1.0 - momentum );
-                        }
+                        global_average[idx] = global_average[idx] * momentum + average[idx] * ( 1.0 - momentum );
+                        global_variance[idx] = global_variance[idx] * momentum + variance[idx] * ( 1.0 - momentum );
                     }
-
                     return ans;
                 },
 
                 [=]<Tensor Tsor>( Tsor const& input, Tsor const&, Tsor const& grad ) noexcept
                 {
-                    typedef typename Tsor::value_type value_type;
                     Tsor& variance = context_extract<Tsor>( variance_cache );
-
-                    std::vector<unsigned long> const& shape = input.shape();
-                    unsigned long const channels = *(shape.rbegin());
-                    unsigned long const rest_dims = input.size() / channels;
-
-                    Tsor& ans = context_cast<Tsor>( backward_cache, zeros_like( input ) );
-                    view_2d<value_type> ans_{ans.data(), rest_dims, channels };
-                    view_2d<value_type> grad_{grad.data(), rest_dims, channels };
-                    for ( auto r : range( rest_dims ) )
-                        for ( auto c : range( channels ) )
-                            ans_[r][c] = grad_[r][c] / std::sqrt( variance[c] + eps );
+                    Tsor& ans = context_cast<Tsor>( backward_cache );
+                    ans.resize( input.shape() );
+                    for_each_element( input.shape(), [&]( unsigned long idx, unsigned long c ){ ans[idx] = grad[idx] / std::sqrt( variance[c] + eps ); } );
                     return ans;
                 },
-                "Normalization"
+                "NCHWcNormalization"
             )( ex );
         };
     }
 
-
-
+    ///
+    /// @brief `batch_normalization` of a [BS, CB, R, C, b] input in the NCHWc layout, gamma and beta being of shape [CB, 1, 1, b].
+    ///
     template< typename T > requires std::floating_point<T>
-    inline auto batch_normalization( T const momentum=0.98 ) noexcept
+    inline auto nchwc_batch_normalization( T const momentum=0.98 ) noexcept
     {
         return [=]<Expression Ex, Variable Va>( Ex const& ex, Va const& gamma, Va const& beta ) noexcept
         {
-            return elementwise_product( normalization_batch(momentum)(ex), gamma ) + beta; // multiply and sum along the batch: normalization is of shape [BS, R, C, CH], gamma/beta are of shape [R, C, CH]
+            return elementwise_product( nchwc_normalization_batch(momentum)(ex), gamma ) + beta;
         };
     }
 
@@ -2526,7 +4080,7 @@ namespace ceras
                 zero_padding_2d_context{}.make_forward()( top, bottom, left, right, forward_cache ),
                 zero_padding_2d_context{}.make_backward()( top, bottom, left, right, backward_cache ),
                 "ZeroPadding2D",
-                [=]( std::vector<unsigned long> const& shape ) noexcept { return std::vector<unsigned long>{ {shape[0], shape[1]+top+bottom, shape[2]+left+right, shape[3]} }; }
+                ceras_private::window_2d{ static_cast<long>( top ), static_cast<long>( bottom ), static_cast<long>( left ), static_cast<long>( right ) }
             )( ex );
         };
     }
@@ -2645,11 +4199,8 @@ namespace ceras
             (
                 cropping_2d_context{}.make_forward()( top, bottom, left, right, forward_cache ),
                 cropping_2d_context{}.make_backward()( top, bottom, left, right, backward_cache ),
-                "ZeroPadding2D",
-                [=]( std::vector<unsigned long> const& shape ) noexcept
-                {
-                    return std::vector<unsigned long>{ {shape[0], shape[1]-top-bottom, shape[2]-left-right, shape[3]} };
-                }
+                "Cropping2D",
+                ceras_private::window_2d{ -static_cast<long>( top ), -static_cast<long>( bottom ), -static_cast<long>( left ), -static_cast<long>( right ) }
             )( ex );
         };
     }
@@ -2908,18 +4459,20 @@ namespace ceras
                         view_2d v_index{ index.data(), iterations, stride }; // example: viewing as a matrix of ( 2, 20 )
                         view_3d v3{ input.data(), iterations, scales, stride }; // example: viewing as a tube of ( 2, 3, 20 )
 
-                        // reduce minimal elements along the selected axis
-                        for ( auto it : range( iterations ) ) // example: range (2)
-                            for ( auto st : range( stride ) ) // example: range (20)
-                            {
-                                // reduce the minimal elements along the column of st
-                                auto min_itor = std::min_element( v3[it].col_begin(st), v3[it].col_end(st) );
-                                v2[it][st] = *min_itor;
+                        // reduce minimal elements along the selected axis, see `backend/reduction.hpp`
+                        typedef typename Tsor::value_type value_type;
+                        backend::reduce_axis<value_type>( input.data(), iterations, scales, stride, []( value_type x ){ return x; }, []( value_type x, value_type y ){ return std::min( x, y ); }, ans.data() );
 
-                                // record the minimal position offset with respect to the head of the column
-                                unsigned long const offset = std::distance( v3[it].col_begin(st), min_itor );
-                                v_index[it][st] = offset;
-                            }
+                        // record the first minimal position along the axis, row by row
+                        parallel( [&]( unsigned long it )
+                        {
+                            std::fill( v_index[it], v_index[it] + stride, scales );
+                            for ( auto sc : range( scales ) )
+                                for ( auto st : range( stride ) )
+                                    if ( v_index[it][st] == scales && v3[it][sc][st] == v2[it][st] )
+                                        v_index[it][st] = sc;
+                            std::replace( v_index[it], v_index[it] + stride, scales, 0UL ); // NaNs
+                        }, 0UL, iterations );
 
                         return ans;
                     };
@@ -2996,8 +4549,8 @@ namespace ceras
                 [=]( std::vector<unsigned long> const& shape ) noexcept
                 {
                     std::vector<unsigned long> ans = shape;
-                    if ( axis >= shape.size() ) axis = shape.size() - 1;
-                    std::copy( ans.begin()+axis+1, ans.end(), ans.begin()+axis );
+                    unsigned long const ax = std::min( axis, shape.size()-1 );
+                    std::copy( ans.begin()+ax+1, ans.end(), ans.begin()+ax );
                     ans.resize( ans.size() - 1 );
                     return ans;
                 }
@@ -3042,18 +4595,20 @@ namespace ceras
                         view_2d v_index{ index.data(), iterations, stride }; // example: viewing as a matrix of ( 2, 20 )
                         view_3d v3{ input.data(), iterations, scales, stride }; // example: viewing as a tube of ( 2, 3, 20 )
 
-                        // reduce maximal elements along the selected axis
-                        for ( auto it : range( iterations ) ) // example: range (2)
-                            for ( auto st : range( stride ) ) // example: range (20)
-                            {
-                                // reduce the maximal elements along the column of st
-                                auto max_itor = std::max_element( v3[it].col_begin(st), v3[it].col_end(st) );
-                                v2[it][st] = *max_itor;
+                        // reduce maximal elements along the selected axis, see `backend/reduction.hpp`
+                        typedef typename Tsor::value_type value_type;
+                        backend::reduce_axis<value_type>( input.data(), iterations, scales, stride, []( value_type x ){ return x; }, []( value_type x, value_type y ){ return std::max( x, y ); }, ans.data() );
 
-                                // record the maximal position offset with respect to the head of the column
-                                unsigned long const offset = std::distance( v3[it].col_begin(st), max_itor );
-                                v_index[it][st] = offset;
-                            }
+                        // record the first maximal position along the axis, row by row
+                        parallel( [&]( unsigned long it )
+                        {
+                            std::fill( v_index[it], v_index[it] + stride, scales );
+                            for ( auto sc : range( scales ) )
+                                for ( auto st : range( stride ) )
+                                    if ( v_index[it][st] == scales && v3[it][sc][st] == v2[it][st] )
+                                        v_index[it][st] = sc;
+                            std::replace( v_index[it], v_index[it] + stride, scales, 0UL ); // NaNs
+                        }, 0UL, iterations );
 
                         return ans;
                     };
@@ -3130,8 +4685,8 @@ namespace ceras
                 [=]( std::vector<unsigned long> const& shape ) noexcept
                 {
                     std::vector<unsigned long> ans = shape;
-                    if ( axis >= shape.size() ) axis = shape.size() - 1;
-                    std::copy( ans.begin()+axis+1, ans.end(), ans.begin()+axis );
+                    unsigned long const ax = std::min( axis, shape.size()-1 );
+                    std::copy( ans.begin()+ax+1, ans.end(), ans.begin()+ax );
                     ans.resize( ans.size() - 1 );
                     return ans;
                 }
@@ -3146,9 +4701,11 @@ namespace ceras
     {
         struct reduce_sum_context
         {
+            bool average = false; // true for the means along the axis
+
             auto make_forward() const noexcept
             {
-                return []( unsigned long axis, std::shared_ptr<std::any> forward_cache ) noexcept
+                return [average=average]( unsigned long axis, std::shared_ptr<std::any> forward_cache ) noexcept
                 {
                     return [=]<Tensor Tsor>( Tsor const& input ) noexcept
                     {
@@ -3170,14 +4727,12 @@ namespace ceras
                         Tsor& ans = context_cast<Tsor>( forward_cache );
                         ans.resize( output_shape ); // example: ans shape is ( 2, 4, 5 )
 
-                        // create 2D and 3D view
-                        view_2d v2{ ans.data(), iterations, stride }; // example: viewing as a matrix of shape ( 2, 20 )
-                        view_3d v3{ input.data(), iterations, scales, stride }; // example: viewing as a tube of ( 2, 3, 20 )
-
-                        // reduce sum along the selected axis
-                        for ( auto it : range( iterations ) ) // example: range (2)
-                            for ( auto st : range( stride ) ) // example: range (20)
-                                v2[it][st] = std::accumulate( v3[it].col_begin(st), v3[it].col_end(st), value_type{0} );
+                        // reduce sum along the selected axis, viewing the input as a tube of ( 2, 3, 20 ), see `backend/reduction.hpp`
+                        typedef accumulator_t<value_type> accumulator_type;
+                        accumulator_type const factor = average ? accumulator_type{1} / static_cast<accumulator_type>( scales ) : accumulator_type{1};
+                        backend::reduce_axis<accumulator_type>( input.data(), iterations, scales, stride, []( value_type x ){ return static_cast<accumulator_type>( x ); }, std::plus<accumulator_type>{}, ans.data() );
+                        if ( average )
+                            for_each( ans.begin(), ans.end(), [factor]( value_type& v ){ v = static_cast<value_type>( static_cast<accumulator_type>( v ) * factor ); } );
 
                         return ans;
                     };
@@ -3186,10 +4741,11 @@ namespace ceras
 
             auto make_backward() const noexcept
             {
-                return []( unsigned long axis, std::shared_ptr<std::any> backward_cache ) noexcept
+                return [average=average]( unsigned long axis, std::shared_ptr<std::any> backward_cache ) noexcept
                 {
                     return [=]<Tensor Tsor>( Tsor const& input, Tsor const& , Tsor const& grad ) noexcept
                     {
+                        typedef typename Tsor::value_type value_type;
                         unsigned long const ax = std::min( axis, input.shape().size()-1 );
 
                         // example: for an input tensor of shape ( 2, 3, 4, 5 ), and axis is 1
@@ -3200,14 +4756,17 @@ namespace ceras
 
                         Tsor& ans = context_cast<Tsor>( backward_cache );
                         ans.resize( shape ); // example: ans shape is ( 2, 3, 4, 5 )
-                        ans.reset();
 
                         view_3d v3{ ans.data(), iterations, scales, stride }; // example: view as a cube of ( 2, 3, 20 )
                         view_2d v2{ grad.data(), iterations, stride }; // example: viewing as a matrix of ( 2, 20 )
 
-                        for ( auto it : range( iterations ) ) // example: range( 2 )
-                            for ( auto st : range( stride ) ) // example: range( 20 )
-                                std::fill( v3[it].col_begin( st ), v3[it].col_end( st ), v2[it][st] );
+                        // broadcast the rows of the gradient along the axis
+                        value_type const factor = average ? value_type{1} / static_cast<value_type>( scales ) : value_type{1};
+                        parallel( [&]( unsigned long it ) // example: range( 2 )
+                        {
+                            for ( auto sc : range( scales ) ) // example: range( 3 )
+                                std::transform( v2[it], v2[it] + stride, v3[it][sc], [factor]( value_type g ){ return g * factor; } );
+                        }, 0UL, iterations );
 
                         return ans;
                     };
@@ -3245,8 +4804,45 @@ namespace ceras
                 [=]( std::vector<unsigned long> const& shape ) noexcept
                 {
                     std::vector<unsigned long> ans = shape;
-                    if ( axis >= shape.size() ) axis = shape.size() - 1;
-                    std::copy( ans.begin()+axis+1, ans.end(), ans.begin()+axis );
+                    unsigned long const ax = std::min( axis, shape.size()-1 );
+                    std::copy( ans.begin()+ax+1, ans.end(), ans.begin()+ax );
+                    ans.resize( ans.size() - 1 );
+                    return ans;
+                }
+            )
+            ( ex );
+        };
+    }
+
+    ///
+    /// @brief Reduce mean elements along an axis.
+    /// @param axis The axis along which to reduce mean.
+    ///
+    /// Example code:
+    /// \code{.cpp}
+    /// auto a = variable{ random<float>( {2, 3, 5} ) };
+    /// auto b = reduce_mean( 0 )( a ); // <- output shape is ( 3, 5 )
+    /// auto b = reduce_mean( 1 )( a ); // <- output shape is ( 2, 5 )
+    /// auto b = reduce_mean( -1 )( a ); // <- output shape is ( 2, 3 )
+    /// \endcode
+    ///
+    inline auto reduce_mean( unsigned long axis ) noexcept
+    {
+        std::shared_ptr<std::any> forward_cache = std::make_shared<std::any>();
+        std::shared_ptr<std::any> backward_cache = std::make_shared<std::any>();
+
+        return [axis, forward_cache, backward_cache]<Expression Ex>( Ex const& ex ) noexcept
+        {
+            return make_unary_operator
+            (
+                reduce_sum_context{ true }.make_forward()( axis, forward_cache ),
+                reduce_sum_context{ true }.make_backward()( axis, backward_cache ),
+                "ReduceMean",
+                [=]( std::vector<unsigned long> const& shape ) noexcept
+                {
+                    std::vector<unsigned long> ans = shape;
+                    unsigned long const ax = std::min( axis, shape.size()-1 );
+                    std::copy( ans.begin()+ax+1, ans.end(), ans.begin()+ax );
                     ans.resize( ans.size() - 1 );
                     return ans;
                 }
@@ -3680,14 +5276,14 @@ namespace ceras
                                     {
                                         Tsor& ans = context_cast<Tsor>( forward_cache );
                                         ans.resize( input.shape() );
-                                        for_each( input.begin(), input.end(), ans.begin(), []( auto x, auto& v ) noexcept { v = std::erf(x); } );
+                                        backend::vector_math::transform( []( auto x ){ return backend::vector_math::erf( x ); }, input.size(), ans.data(), input.data() );
                                         return ans;
                                     },
                                     [backward_cache]<Tensor Tsor>( Tsor const& input, Tsor const&, Tsor const& grad ) noexcept
                                     {
                                         Tsor& ans = context_cast<Tsor>( backward_cache );
                                         ans.resize( input.shape() );
-                                        for_each( input.begin(), input.end(), grad.begin(), ans.begin(), []( auto x, auto g, auto& v ) noexcept { v = typename Tsor::value_type{1.12837916709551257389} * g * std::exp(-x*x); } );
+                                        backend::vector_math::transform( []( auto x, auto g ){ return typename Tsor::value_type{1.12837916709551257389} * g * backend::vector_math::exp( -x*x ); }, input.size(), ans.data(), input.data(), grad.data() );
                                         return ans;
                                     },
                                     "Erf"
@@ -3725,7 +5321,7 @@ namespace ceras
                                     {
                                         Tsor& ans = context_cast<Tsor>( backward_cache );
                                         ans.resize( input.shape() );
-                                        for_each( input.begin(), input.end(), grad.begin(), ans.begin(), []( auto x, auto g, auto& v ) noexcept { v = typename Tsor::value_type{-1.12837916709551257389} * g * std::exp(-x*x); } );
+                                        backend::vector_math::transform( []( auto x, auto g ){ return typename Tsor::value_type{-1.12837916709551257389} * g * backend::vector_math::exp( -x*x ); }, input.size(), ans.data(), input.data(), grad.data() );
                                         return ans;
                                     },
                                     "Erfc"
@@ -3755,7 +5351,7 @@ namespace ceras
                                     {
                                         Tsor& ans = context_cast<Tsor>( forward_cache );
                                         ans.resize( input.shape() );
-                                        for_each( input.begin(), input.end(), ans.begin(), []( auto x, auto& v ) noexcept { v = std::exp(x); } );
+                                        backend::vector_math::transform( []( auto x ){ return backend::vector_math::exp( x ); }, input.size(), ans.data(), input.data() );
                                         return ans;
                                     },
                                     [backward_cache]<Tensor Tsor>( Tsor const& input, Tsor const& output, Tsor const& grad ) noexcept
@@ -3829,7 +5425,7 @@ namespace ceras
                                     {
                                         Tsor& ans = context_cast<Tsor>( forward_cache );
                                         ans.resize( input.shape() );
-                                        for_each( input.begin(), input.end(), ans.begin(), []( auto x, auto& v ) noexcept { v = std::expm1(x); } );
+                                        backend::vector_math::transform( []( auto x ){ return backend::vector_math::expm1( x ); }, input.size(), ans.data(), input.data() );
                                         return ans;
                                     },
                                     [backward_cache]<Tensor Tsor>( Tsor const& input, Tsor const& output, Tsor const& grad ) noexcept
@@ -3989,7 +5585,7 @@ namespace ceras
                                     {
                                         Tsor& ans = context_cast<Tsor>( forward_cache );
                                         ans.resize( input.shape() );
-                                        for_each( input.begin(), input.end(), ans.begin(), []( auto x, auto& v ) noexcept { v = std::log(x); } );
+                                        backend::vector_math::transform( []( auto x ){ return backend::vector_math::log( x ); }, input.size(), ans.data(), input.data() );
                                         return ans;
                                     },
                                     [backward_cache]<Tensor Tsor>( Tsor const& input, Tsor const&, Tsor const& grad ) noexcept
@@ -4063,7 +5659,7 @@ namespace ceras
                                     {
                                         Tsor& ans = context_cast<Tsor>( forward_cache );
                                         ans.resize( input.shape() );
-                                        for_each( input.begin(), input.end(), ans.begin(), []( auto x, auto& v ) noexcept { v = std::log1p(x); } );
+                                        backend::vector_math::transform( []( auto x ){ return backend::vector_math::log1p( x ); }, input.size(), ans.data(), input.data() );
                                         return ans;
                                     },
                                     [backward_cache]<Tensor Tsor>( Tsor const& input, Tsor const&, Tsor const& grad ) noexcept
@@ -4448,7 +6044,7 @@ namespace ceras
                                     {
                                         Tsor& ans = context_cast<Tsor>( forward_cache );
                                         ans.resize( input.shape() );
-                                        for_each( input.begin(), input.end(), ans.begin(), []( auto x, auto& v ) noexcept { v = std::tanh(x); } );
+                                        backend::vector_math::transform( []( auto x ){ return backend::vector_math::tanh( x ); }, input.size(), ans.data(), input.data() );
                                         return ans;
                                     },
                                     [backward_cache]<Tensor Tsor>( Tsor const& input, Tsor const& output, Tsor const& grad ) noexcept
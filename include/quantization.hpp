@@ -0,0 +1,227 @@
+#ifndef QUANTIZATIONHPPWZXKVYRNJTLOBMUAEDCFIHSPGQWZXKVYRNJTLOBMUAEDCFIHSPGQWZXKVY
+#define QUANTIZATIONHPPWZXKVYRNJTLOBMUAEDCFIHSPGQWZXKVYRNJTLOBMUAEDCFIHSPGQWZXKVY
+
+#include "./includes.hpp"
+#include "./config.hpp"
+#include "./tensor.hpp"
+#include "./variable.hpp"
+#include "./backend/int8_gemm.hpp"
+#include "./utils/singleton.hpp"
+#include "./utils/better_assert.hpp"
+
+//
+// Int8 post-training quantization of the Dense and Conv2D layers.
+//
+// A quantizable operator computes `y = x * W` with x of [rows x depth] and W of [depth x columns].
+// With int8 enabled and in inference (`learning_phase == 0`), x is quantized per tensor, W per output column (symmetric, [-127, 127]),
+// the product runs in `backend::int8_gemm`, and the int32 results are scaled back to float in the GEMM epilogue, together with the bias and the activation.
+//
+// Calibration runs the model once in float on a sample batch. Each quantizable operator met on the way records the range of every channel of its input,
+// and packs its weights. As the int32 accumulation runs over the input channels, the activation scale is set by the widest channel.
+// After training the weights again, the model needs to be quantized again.
+//
+
+namespace ceras
+{
+
+    ///
+    /// @brief Int8 state of a quantizable operator.
+    ///
+    struct quantization_state
+    {
+        std::vector<float> input_ranges;            ///< max |x| of each input channel, collected during calibration
+        float input_scale = 1.0f;                   ///< quantization step of the inputs
+        std::vector<float> weight_scales;           ///< quantization step of each output column of the weights
+        backend::packed_int8_matrix weights;        ///< packed int8 weights
+        unsigned long float_weight_bytes = 0;       ///< memory of the float weights
+        bool enabled = false;                       ///< true once calibrated
+        unsigned long generation = 0;               ///< `variable_data_generation` when the weights were quantized
+        std::vector<std::uint8_t> activations;      ///< workspace of the quantized inputs
+
+        ///
+        /// @brief Records the input ranges of one calibration run and quantizes the weights.
+        /// @param x The input, element (r, p) at `x[r*x_row_stride+p*x_depth_stride]`.
+        /// @param w The weights, element (p, c) at `w[p*w_depth_stride+c*w_column_stride]`.
+        ///
+        void calibrate( float const* x, unsigned long rows, unsigned long depth, unsigned long x_row_stride, unsigned long x_depth_stride,
+                        float const* w, unsigned long columns, unsigned long w_depth_stride, unsigned long w_column_stride )
+        {
+            input_ranges.resize( depth, 0.0f );
+            if ( x_depth_stride == 1 )
+            {
+                for ( unsigned long r = 0; r != rows; ++r )
+                    for ( unsigned long p = 0; p != depth; ++p )
+                        input_ranges[p] = std::max( input_ranges[p], std::abs( x[r*x_row_stride+p] ) );
+            }
+            else
+            {
+                for ( unsigned long p = 0; p != depth; ++p )
+                    for ( unsigned long r = 0; r != rows; ++r )
+                        input_ranges[p] = std::max( input_ranges[p], std::abs( x[r*x_row_stride+p*x_depth_stride] ) );
+            }
+
+            weight_scales.resize( columns );
+            for ( unsigned long c = 0; c != columns; ++c )
+            {
+                float range = 0.0f;
+                for ( unsigned long p = 0; p != depth; ++p )
+                    range = std::max( range, std::abs( w[p*w_depth_stride+c*w_column_stride] ) );
+                weight_scales[c] = ( range > 0.0f ) ? range / 127.0f : 1.0f;
+            }
+
+            std::vector<std::int8_t> quantized_weights( depth * columns );
+            for ( unsigned long p = 0; p != depth; ++p )
+                for ( unsigned long c = 0; c != columns; ++c )
+                {
+                    float const v = std::nearbyint( w[p*w_depth_stride+c*w_column_stride] / weight_scales[c] );
+                    quantized_weights[p*columns+c] = static_cast<std::int8_t>( std::min( std::max( v, -127.0f ), 127.0f ) );
+                }
+            weights = backend::pack_int8_matrix( quantized_weights.data(), depth, columns, columns, 1 );
+            float_weight_bytes = depth * columns * sizeof(float);
+        }
+
+        ///
+        /// @brief Fixes the input scale from the recorded ranges, and enables the int8 path.
+        ///
+        void finalize() noexcept
+        {
+            float const range = input_ranges.empty() ? 0.0f : *std::max_element( input_ranges.begin(), input_ranges.end() );
+            input_scale = ( range > 0.0f ) ? range / 127.0f : 1.0f;
+            enabled = !weights.empty();
+            generation = variable_data_generation;
+        }
+
+        ///
+        /// @brief Int8 product of x and the packed weights.
+        /// @param epilogue Called as `epilogue( values, row, col, cols )` with the `cols` dequantized results of row `row` from column `col`.
+        ///
+        template< typename Epilogue >
+        void run( float const* x, unsigned long rows, unsigned long x_row_stride, unsigned long x_depth_stride, Epilogue const& epilogue )
+        {
+            backend::quantize_int8_activations( x, rows, weights.depth, x_row_stride, x_depth_stride, input_scale, activations );
+            backend::int8_gemm( activations.data(), rows, weights, [this, &epilogue]( std::int32_t const* acc, unsigned long row, unsigned long col, unsigned long cols )
+            {
+                float values[backend::int8_gemm_private::nr];
+                for ( unsigned long c = 0; c != cols; ++c )
+                    values[c] = static_cast<float>( acc[c] ) * ( input_scale * weight_scales[col+c] );
+                epilogue( values, row, col, cols );
+            } );
+        }
+    };
+
+    ///
+    /// @brief Quantizable operators met during a calibration run.
+    ///
+    struct quantization_calibration
+    {
+        bool active = false;
+        std::vector<std::shared_ptr<quantization_state>> states;
+
+        void record( std::shared_ptr<quantization_state> const& state )
+        {
+            if ( std::find( states.begin(), states.end(), state ) == states.end() )
+            {
+                state->input_ranges.clear();
+                states.push_back( state );
+            }
+        }
+    };
+
+    inline quantization_calibration& get_quantization_calibration()
+    {
+        return singleton<quantization_calibration>::instance();
+    }
+
+    ///
+    /// @brief Accuracy and memory of a quantized model against its float version.
+    ///
+    struct quantization_report
+    {
+        unsigned long quantized_operators = 0;  ///< Dense and Conv2D operators running in int8
+        unsigned long float_weight_bytes = 0;   ///< memory of their float weights
+        unsigned long int8_weight_bytes = 0;    ///< memory of their int8 weights and scales
+        double max_absolute_error = 0.0;        ///< max |y_int8 - y_float|
+        double mean_absolute_error = 0.0;       ///< mean |y_int8 - y_float|
+        double relative_error = 0.0;            ///< ||y_int8 - y_float|| / ||y_float||
+        double top1_agreement = 1.0;            ///< fraction of samples whose argmax over the last axis is unchanged
+    };
+
+    inline std::ostream& operator << ( std::ostream& os, quantization_report const& report )
+    {
+        os << "quantized operators: " << report.quantized_operators << "\n";
+        os << "weights: " << report.float_weight_bytes << " bytes in float, " << report.int8_weight_bytes << " bytes in int8\n";
+        os << "max absolute error: " << report.max_absolute_error << "\n";
+        os << "mean absolute error: " << report.mean_absolute_error << "\n";
+        os << "relative error: " << report.relative_error << "\n";
+        os << "top-1 agreement: " << report.top1_agreement << "\n";
+        return os;
+    }
+
+    ///
+    /// @brief Calibrates the Dense and Conv2D operators of a model with a sample batch and switches them to int8 for `predict`.
+    ///
+    /// @param m The model, with a float output.
+    /// @param calibration_batch Samples to collect the input ranges from.
+    /// @param evaluation_batch Samples to compare the int8 and the float predictions on.
+    /// @return The states of the quantized operators, and the accuracy report.
+    ///
+    template< typename Model, Tensor Tsor >
+    std::tuple<std::vector<std::shared_ptr<quantization_state>>, quantization_report> quantize( Model& m, Tsor const& calibration_batch, Tsor const& evaluation_batch )
+    {
+        auto& calibration = get_quantization_calibration();
+        calibration.states.clear();
+        calibration.active = true;
+        m.predict( calibration_batch );
+        calibration.active = false;
+        std::vector<std::shared_ptr<quantization_state>> states;
+        states.swap( calibration.states );
+
+        for ( auto& state : states )
+            state->enabled = false;
+        Tsor const float_prediction = m.predict( evaluation_batch ).deep_copy();
+        for ( auto& state : states )
+            state->finalize();
+        Tsor const int8_prediction = m.predict( evaluation_batch ).deep_copy();
+
+        quantization_report report;
+        for ( auto const& state : states )
+        {
+            ++report.quantized_operators;
+            report.float_weight_bytes += state->float_weight_bytes;
+            report.int8_weight_bytes += state->weights.depth * state->weights.columns + state->weight_scales.size() * sizeof(float);
+        }
+
+        double error_norm = 0.0;
+        double norm = 0.0;
+        for ( auto idx : range( float_prediction.size() ) )
+        {
+            double const diff = std::abs( static_cast<double>( int8_prediction[idx] ) - static_cast<double>( float_prediction[idx] ) );
+            report.max_absolute_error = std::max( report.max_absolute_error, diff );
+            report.mean_absolute_error += diff;
+            error_norm += diff * diff;
+            norm += static_cast<double>( float_prediction[idx] ) * static_cast<double>( float_prediction[idx] );
+        }
+        if ( !float_prediction.empty() )
+            report.mean_absolute_error /= float_prediction.size();
+        report.relative_error = ( norm > 0.0 ) ? std::sqrt( error_norm / norm ) : std::sqrt( error_norm );
+
+        unsigned long const classes = float_prediction.empty() ? 0UL : *(float_prediction.shape().rbegin());
+        if ( classes > 1 )
+        {
+            unsigned long const samples = float_prediction.size() / classes;
+            unsigned long agreed = 0;
+            for ( auto s : range( samples ) )
+            {
+                auto const f = float_prediction.begin() + s * classes;
+                auto const q = int8_prediction.begin() + s * classes;
+                agreed += std::max_element( f, f + classes ) - f == std::max_element( q, q + classes ) - q;
+            }
+            report.top1_agreement = static_cast<double>( agreed ) / static_cast<double>( samples );
+        }
+
+        return std::make_tuple( states, report );
+    }
+
+}//namespace ceras
+
+#endif//QUANTIZATIONHPPWZXKVYRNJTLOBMUAEDCFIHSPGQWZXKVYRNJTLOBMUAEDCFIHSPGQWZXKVY
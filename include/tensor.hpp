@@ -3,9 +3,13 @@
 
 #include "./backend/cblas.hpp"
 #include "./backend/cuda.hpp"
+#include "./backend/gemm_autotuner.hpp"
+#include "./backend/packed_gemm.hpp"
+#include "./backend/reduction.hpp"
 #include "./config.hpp"
 #include "./includes.hpp"
 #include "./utils/better_assert.hpp"
+#include "./utils/bfloat16.hpp"
 //#include "./utils/buffered_allocator.hpp"
 #include "./utils/cached_allocator.hpp"
 #include "./utils/debug.hpp"
@@ -478,7 +482,10 @@ namespace ceras
         constexpr auto as_type() const noexcept
         {
             tensor<U, typename std::allocator_traits<Allocator>::rebind_alloc<U>> ans{ (*this).shape() };
-            std::copy( (*this).begin(), (*this).end(), ans.begin() );
+            if constexpr( std::is_same_v<T, bfloat16> || std::is_same_v<U, bfloat16> )
+                convert( (*this).data(), (*this).size(), ans.data() );
+            else
+                std::copy( (*this).begin(), (*this).end(), ans.begin() );
             return ans;
         }
     }; // struct tensor
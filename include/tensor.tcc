@@ -423,37 +423,30 @@ namespace ceras
     }
 
 
-    // C <= A * B
+    // C <= alpha * A * B + beta * C
     // where A or A' is [m x n], B or B' is [n x k] and C is [m x k]
-    template< typename T > requires std::floating_point<T>
-    void gemm_cpu( T const* A, bool a_transposed, T const* B, bool b_transposed, unsigned long m, unsigned long n, unsigned long k, T* C )
-    {
-        auto a_view = view_2d{ A, m, n, a_transposed };
-        auto b_view = view_2d{ B, n, k, b_transposed };
-        auto c_view = view_2d{ C, m, k };
-
-        std::fill_n( C, m*k, T{0} );
-
-        if ( a_transposed == false && b_transposed == false )
-            for ( auto r = 0UL; r != m; ++r )
-                for ( auto idx = 0UL; idx != n; ++idx )
-                    for ( auto c = 0UL; c != k; ++c )
-                        c_view[r][c] += a_view[r][idx] * b_view[idx][c];
-        else if ( a_transposed == false && b_transposed == true )
-            for ( auto r = 0UL; r != m; ++r )
-                for ( auto idx = 0UL; idx != n; ++idx )
-                    for ( auto c = 0UL; c != k; ++c )
-                        c_view[r][c] += a_view[r][idx] * b_view[c][idx];
-        else if ( a_transposed == true && b_transposed == false )
-            for ( auto r = 0UL; r != m; ++r )
-                for ( auto idx = 0UL; idx != n; ++idx )
-                    for ( auto c = 0UL; c != k; ++c )
-                        c_view[r][c] += a_view[idx][r] * b_view[idx][c];
-        else
-            for ( auto r = 0UL; r != m; ++r )
-                for ( auto idx = 0UL; idx != n; ++idx )
-                    for ( auto c = 0UL; c != k; ++c )
-                        c_view[r][c] += a_view[idx][r] * b_view[c][idx];
+    // an optional epilogue is applied to every row segment of C once finished, see `backend::packed_gemm`
+    // the blocking, the number of threads and the choice between the built-in kernel and CBLAS come from the autotuner
+    template< typename T, typename Epilogue = backend::gemm_no_epilogue > requires std::floating_point<T>
+    void gemm_cpu( T const* A, bool a_transposed, T const* B, bool b_transposed, unsigned long m, unsigned long n, unsigned long k, T* C, Epilogue const& epilogue = Epilogue{},
+                   std::type_identity_t<T> alpha = T{1}, std::type_identity_t<T> beta = T{0} )
+    {
+        backend::gemm_tuning const& tuning = backend::query_gemm_tuning<T>( m, n, k );
+
+        if constexpr( cblas_mode )
+        {
+            if ( tuning.use_cblas )
+            {
+                cblas_gemm( A, a_transposed, B, b_transposed, m, n, k, C, alpha, beta );
+                if constexpr( !std::is_same_v<Epilogue, backend::gemm_no_epilogue> )
+                    parallel( [&]( unsigned long r ){ epilogue( C + r * k, r, 0UL, k ); }, 0UL, m );
+                return;
+            }
+        }
+
+        unsigned long const lda = a_transposed ? m : n;
+        unsigned long const ldb = b_transposed ? n : k;
+        backend::parallel_packed_gemm( A, lda, a_transposed, B, ldb, b_transposed, m, n, k, C, k, tuning.threads, tuning.blocking, epilogue, alpha, beta );
     }
 
     // this function is used to update the threshod 'cuda_gemm_threshold' defined in '../config.hpp', only considering float case
@@ -493,10 +486,12 @@ namespace ceras
         }
     }
 
-    // C <= A * B
+    // C <= alpha * A * B + beta * C
     // where A or A' is [m x n], B or B' is [n x k] and C is [m x k]
+    // C is overwritten with the default alpha = 1 and beta = 0; beta = 1 accumulates the product into C, such as a gradient into the gradient of a variable
     template< typename T > requires std::floating_point<T>
-    void gemm( T const* A, bool a_transposed, T const* B, bool b_transposed, unsigned long m, unsigned long n, unsigned long k, T* C )
+    void gemm( T const* A, bool a_transposed, T const* B, bool b_transposed, unsigned long m, unsigned long n, unsigned long k, T* C,
+               std::type_identity_t<T> alpha = T{1}, std::type_identity_t<T> beta = T{0} )
     {
         if ( cuda_gemm_threshold == 0 ) // global variable defined in config.h
             update_cuda_gemm_threshold();
@@ -506,21 +501,35 @@ namespace ceras
             unsigned long const operations = m * n * k;
 
             if ( operations >= cuda_gemm_threshold )
-                cuda_gemm( A, a_transposed, B, b_transposed, m, n, k, C );
+                cuda_gemm( A, a_transposed, B, b_transposed, m, n, k, C, alpha, beta );
             else
-                gemm_cpu( A, a_transposed, B, b_transposed, m, n, k, C );
+                gemm_cpu( A, a_transposed, B, b_transposed, m, n, k, C, backend::gemm_no_epilogue{}, alpha, beta );
+        }
+        else // the autotuner decides between the built-in kernel and CBLAS
+        {
+            gemm_cpu( A, a_transposed, B, b_transposed, m, n, k, C, backend::gemm_no_epilogue{}, alpha, beta );
         }
-        else if constexpr( cblas_mode )
+    }
+
+    // C <= alpha * A * B + beta * C, followed by `epilogue( C + r * k, r, col, cols )` on row segments of C
+    // where A or A' is [m x n], B or B' is [n x k] and C is [m x k]
+    // the CPU kernel applies the epilogue to each tile while it is still in cache, other backends apply it after the multiplication
+    template< typename T, typename Epilogue > requires std::floating_point<T> && std::invocable<Epilogue const&, T*, unsigned long, unsigned long, unsigned long>
+    void gemm( T const* A, bool a_transposed, T const* B, bool b_transposed, unsigned long m, unsigned long n, unsigned long k, T* C, Epilogue const& epilogue,
+               std::type_identity_t<T> alpha = T{1}, std::type_identity_t<T> beta = T{0} )
+    {
+        if constexpr( cuda_mode )
         {
-            cblas_gemm( A, a_transposed, B, b_transposed, m, n, k, C );
+            gemm( A, a_transposed, B, b_transposed, m, n, k, C, alpha, beta );
+            parallel( [&]( unsigned long r ){ epilogue( C + r * k, r, 0UL, k ); }, 0UL, m );
         }
         else
         {
-            gemm_cpu( A, a_transposed, B, b_transposed, m, n, k, C );
+            gemm_cpu( A, a_transposed, B, b_transposed, m, n, k, C, epilogue, alpha, beta );
         }
     }
 
-    template< typename T >  requires std::floating_point<T> // this one only for non-transposed 2d View
+    template< typename T >  requires std::floating_point<accumulator_t<T>> // this one only for non-transposed 2d View
     void gemm( view_2d<T> const& x, view_2d<T> const& y, view_2d<T>& ans ) //note: direct copy of x and y
     {
         auto const [x_row, x_col] = x.shape();
@@ -534,6 +543,77 @@ namespace ceras
         gemm( x.data(), x.transposed_, y.data(), y.transposed_, x_row, x_col, y_col, ans.data() );
     }
 
+    // C[b] <= alpha * A[b] * B[b] + beta * C[b], for b in [0, batch)
+    // where A[b] or A[b]' is [m x n] starting from A + b * a_stride, B[b] or B[b]' is [n x k] starting from B + b * b_stride, and C[b] is [m x k] starting from C + b * m * k
+    // a stride of 0 broadcasts the same matrix to all the batches
+    template< typename T > requires std::floating_point<T>
+    void gemm_batched( T const* A, bool a_transposed, unsigned long a_stride, T const* B, bool b_transposed, unsigned long b_stride,
+                       unsigned long batch, unsigned long m, unsigned long n, unsigned long k, T* C, std::type_identity_t<T> alpha = T{1}, std::type_identity_t<T> beta = T{0} )
+    {
+        if constexpr( cuda_mode || cblas_mode )
+        {
+            for ( auto b : range( batch ) )
+                gemm( A + b * a_stride, a_transposed, B + b * b_stride, b_transposed, m, n, k, C + b * m * k, alpha, beta );
+        }
+        else
+        {
+            unsigned long const lda = a_transposed ? m : n;
+            unsigned long const ldb = b_transposed ? n : k;
+            unsigned long const threads = get_num_threads();
+
+            if ( batch >= threads || batch * m * n * k < (1UL << 17) ) // one product per thread
+            {
+                unsigned long const threshold = ( batch * m * n * k < (1UL << 17) ) ? batch : 1UL;
+                parallel( [&]( unsigned long b )
+                {
+                    backend::packed_gemm( A + b * a_stride, lda, a_transposed, B + b * b_stride, ldb, b_transposed, m, n, k, C + b * m * k, k,
+                                          backend::default_gemm_blocking<T>(), backend::gemm_no_epilogue{}, alpha, beta );
+                }, 0UL, batch, threshold );
+            }
+            else // too few batches to feed all the cores, parallel inside each of the products
+            {
+                for ( auto b : range( batch ) )
+                    backend::parallel_packed_gemm( A + b * a_stride, lda, a_transposed, B + b * b_stride, ldb, b_transposed, m, n, k, C + b * m * k, k,
+                                                   0UL, backend::default_gemm_blocking<T>(), backend::gemm_no_epilogue{}, alpha, beta );
+            }
+        }
+    }
+
+    // C <= alpha * A * B + beta * C for bfloat16 matrices, followed by the optional `epilogue( C + r * k, r, col, cols )` on row segments of C
+    // A and B are widened to float while packed, the products are accumulated in float and rounded to bfloat16 in the GEMM epilogue
+    // CUDA and CBLAS have no bfloat16 path, the built-in kernel is always used
+    template< typename Epilogue = backend::gemm_no_epilogue > requires std::invocable<Epilogue const&, bfloat16*, unsigned long, unsigned long, unsigned long>
+    void gemm( bfloat16 const* A, bool a_transposed, bfloat16 const* B, bool b_transposed, unsigned long m, unsigned long n, unsigned long k, bfloat16* C,
+               Epilogue const& epilogue = Epilogue{}, float alpha = 1.0f, float beta = 0.0f )
+    {
+        backend::gemm_tuning const tuning = backend::query_gemm_tuning<float>( m, n, k );
+        thread_local std::vector<float> accumulator; // reused across the calls, not read when `beta` is 0
+        accumulator.resize( m * k );
+        if ( beta != 0.0f )
+            convert( C, m * k, accumulator.data() );
+        backend::parallel_packed_gemm( A, a_transposed ? m : n, a_transposed, B, b_transposed ? n : k, b_transposed, m, n, k, accumulator.data(), k,
+                                       tuning.threads, tuning.blocking, [C, k, &epilogue]( float const* ptr, unsigned long row, unsigned long col, unsigned long cols )
+        {
+            bfloat16* dst = C + row * k + col;
+            convert( ptr, cols, dst );
+            if constexpr( !std::is_same_v<Epilogue, backend::gemm_no_epilogue> )
+                epilogue( dst, row, col, cols );
+        }, alpha, beta );
+    }
+
+    inline void gemm( bfloat16 const* A, bool a_transposed, bfloat16 const* B, bool b_transposed, unsigned long m, unsigned long n, unsigned long k, bfloat16* C,
+                      float alpha, float beta )
+    {
+        gemm( A, a_transposed, B, b_transposed, m, n, k, C, backend::gemm_no_epilogue{}, alpha, beta );
+    }
+
+    inline void gemm_batched( bfloat16 const* A, bool a_transposed, unsigned long a_stride, bfloat16 const* B, bool b_transposed, unsigned long b_stride,
+                              unsigned long batch, unsigned long m, unsigned long n, unsigned long k, bfloat16* C, float alpha = 1.0f, float beta = 0.0f )
+    {
+        for ( auto b : range( batch ) )
+            gemm( A + b * a_stride, a_transposed, B + b * b_stride, b_transposed, m, n, k, C + b * m * k, alpha, beta );
+    }
+
     // always prefer channel-last data format
     // Example:
     //
@@ -673,6 +753,39 @@ namespace ceras
         return ans;
     }
 
+    ///
+    /// @brief Batched matrix multiplication.
+    /// @param lhs A tensor of shape [B, M, K].
+    /// @param rhs A tensor of shape [B, K, N], or [K, N] to be shared by all the batches.
+    /// @param ans A tensor of shape [B, M, N], resized if necessary.
+    ///
+    template< Tensor Tsor >
+    void batched_multiply( Tsor const& lhs, Tsor const& rhs, Tsor& ans ) noexcept
+    {
+        better_assert( 3 == lhs.ndim(), "expecting lhs tensor has 3 dimensions, but got ", lhs.ndim() );
+        better_assert( 2 == rhs.ndim() || 3 == rhs.ndim(), "expecting rhs tensor has 2 or 3 dimensions, but got ", rhs.ndim() );
+
+        auto const& lhs_shape = lhs.shape();
+        auto const& rhs_shape = rhs.shape();
+        auto const [batch, m, k] = std::make_tuple( lhs_shape[0], lhs_shape[1], lhs_shape[2] );
+        unsigned long const n = *(rhs_shape.rbegin());
+        better_assert( k == *(rhs_shape.rbegin()+1), fmt::format( "expecting lhs.shape[2] == rhs.shape[-2], but got {} and {}", k, *(rhs_shape.rbegin()+1) ) );
+        if ( 3 == rhs.ndim() )
+            better_assert( batch == rhs_shape[0], fmt::format( "expecting same batch size, but got {} and {}", batch, rhs_shape[0] ) );
+
+        unsigned long const rhs_stride = ( 3 == rhs.ndim() ) ? k * n : 0UL;
+        ans.resize( {batch, m, n} );
+        gemm_batched( lhs.data(), false, m * k, rhs.data(), false, rhs_stride, batch, m, k, n, ans.data() );
+    }
+
+    template< Tensor Tsor >
+    Tsor batched_multiply( Tsor const& lhs, Tsor const& rhs ) noexcept
+    {
+        Tsor ans;
+        batched_multiply( lhs, rhs, ans );
+        return ans;
+    }
+
     template< Tensor Tsor >
     Tsor operator * ( Tsor const& lhs, Tsor const& rhs ) noexcept
     {
@@ -736,7 +849,10 @@ namespace ceras
     template< Tensor Tsor >
     Tsor reduce_sum( Tsor const& tsor )
     {
-        auto result = std::reduce( tsor.data(), tsor.data()+tsor.size(), typename Tsor::value_type{0} );
+        typedef typename Tsor::value_type value_type;
+        typedef accumulator_t<value_type> accumulator_type;
+        if ( tsor.empty() ) return Tsor{ std::vector<unsigned long>{1}, {value_type{0},} };
+        auto result = static_cast<value_type>( backend::reduce_all<accumulator_type>( tsor.data(), tsor.size(), []( value_type x ){ return static_cast<accumulator_type>( x ); }, std::plus<accumulator_type>{} ) );
         return Tsor{ std::vector<unsigned long>{1}, {result,} };
     }
 
@@ -953,10 +1069,7 @@ namespace ceras
         typedef typename Tsor::value_type value_type;
         better_assert( tsor.size() != 0, "tensor::max error: input tensor should not be empty!" );
         if ( tsor.size() == 0 ) return value_type{0};
-        value_type ans = std::numeric_limits<value_type>::min();
-        for ( auto idx : range( tsor.size() ) )
-            ans = std::max( tsor[idx], ans );
-        return ans;
+        return backend::reduce_all<value_type>( tsor.data(), tsor.size(), []( value_type x ){ return x; }, []( value_type x, value_type y ){ return std::max( x, y ); } );
     }
 
     template< Tensor Tsor >
@@ -971,10 +1084,7 @@ namespace ceras
         typedef typename Tsor::value_type value_type;
         better_assert( tsor.size() != 0, "tensor::min error: input tensor should not be empty!" );
         if ( tsor.size() == 0 ) return value_type{0};
-        value_type ans = std::numeric_limits<value_type>::max();
-        for ( auto idx : range( tsor.size() ) )
-            ans = std::min( tsor[idx], ans );
-        return ans;
+        return backend::reduce_all<value_type>( tsor.data(), tsor.size(), []( value_type x ){ return x; }, []( value_type x, value_type y ){ return std::min( x, y ); } );
     }
 
     template< Tensor Tsor >
@@ -987,8 +1097,9 @@ namespace ceras
     auto sum( Tsor const& tsor )
     {
         typedef typename Tsor::value_type value_type;
+        typedef accumulator_t<value_type> accumulator_type;
         better_assert( tsor.size() != 0, "tensor::sum error: input tensor should not be empty!" );
-        return std::accumulate( tsor.data(), tsor.data()+tsor.size(), value_type{0} );
+        return static_cast<value_type>( backend::reduce_all<accumulator_type>( tsor.data(), tsor.size(), []( value_type x ){ return static_cast<accumulator_type>( x ); }, std::plus<accumulator_type>{} ) );
     }
 
     template< Tensor Tsor >
@@ -1004,7 +1115,9 @@ namespace ceras
     {
         typedef typename Tsor::value_type value_type;
         better_assert( tsor.size() != 0, "tensor::sum error: input tensor should not be empty!" );
-        return std::sqrt( std::accumulate( tsor.data(), tsor.data()+tsor.size(), value_type{0}, []( value_type x, value_type y ){ return x + y*y; }  ) ) / static_cast<value_type>( tsor.size() );
+        typedef accumulator_t<value_type> accumulator_type;
+        accumulator_type const squares = backend::reduce_all<accumulator_type>( tsor.data(), tsor.size(), []( value_type x ){ return static_cast<accumulator_type>( x ) * static_cast<accumulator_type>( x ); }, std::plus<accumulator_type>{} );
+        return static_cast<value_type>( std::sqrt( squares ) / static_cast<accumulator_type>( tsor.size() ) );
     }
 
     template< Tensor Tsor >
@@ -1028,7 +1141,8 @@ namespace ceras
         {
             value_type const mx = *std::max_element( mat[idx], mat[idx+1] );
             for_each( mat[idx], mat[idx+1], [mx]( auto& v ){ v -= mx; } );
-            value_type const ac = std::accumulate( mat[idx], mat[idx+1], value_type{0}, []( value_type init, value_type val ){ return init + std::exp(val); } );
+            typedef accumulator_t<value_type> accumulator_type;
+            accumulator_type const ac = std::accumulate( mat[idx], mat[idx+1], accumulator_type{0}, []( accumulator_type init, accumulator_type val ){ return init + std::exp(val); } );
             for_each( mat[idx], mat[idx+1], [ac]( auto& v ){ v = std::exp(v) / (ac+eps); } );
         }
         return ans;
@@ -1067,15 +1181,18 @@ namespace ceras
         unsigned long const n = _shape[axis];
         _shape[axis] = 1UL;
 
+        // narrow types such as bfloat16 are reduced in float
+        typedef typename Tsor::value_type value_type;
+        typedef accumulator_t<value_type> accumulator_type;
+        auto const& accumulate = [&func]( accumulator_type const& a, accumulator_type const& b ){ return static_cast<accumulator_type>( func( a, b ) ); };
+
+        // `func` associative and commutative, see `backend/reduction.hpp`, `init` combined once with the reduced values
+        std::vector<accumulator_type> reduced( pres * post );
+        if ( n != 0 )
+            backend::reduce_axis<accumulator_type>( ts.data(), pres, n, post, []( value_type x ){ return static_cast<accumulator_type>( x ); }, accumulate, reduced.data() );
         Tsor ans{ _shape };
-        auto itor = ans.begin();
-        for ( auto idx : range( pres ) )
-            for ( auto jdx : range( post ) )
-            {
-                auto start = ts.begin() + idx * post * n + jdx;
-                stride_iterator si{ start, static_cast<std::int64_t>(post) };
-                *itor++ = std::reduce( si, si+n, init, func );
-            }
+        for ( auto idx : range( pres * post ) )
+            ans[idx] = static_cast<value_type>( ( n != 0 ) ? accumulate( static_cast<accumulator_type>( init ), reduced[idx] ) : static_cast<accumulator_type>( init ) );
 
         if ( !keepdims )
         {
@@ -1093,7 +1210,7 @@ namespace ceras
         return reduce( ts, axis, typename Tsor::value_type{0}, []( auto const& a, auto const& b ){ return a+b; }, keepdims );
     }
 
-    template <Tensor Tsor> requires std::floating_point<typename Tsor::value_type>
+    template <Tensor Tsor> requires std::floating_point<accumulator_t<typename Tsor::value_type>>
     Tsor mean( Tsor const& ts, unsigned long axis, bool keepdims=false ) noexcept
     {
         typedef typename Tsor::value_type value_type;
@@ -1102,7 +1219,7 @@ namespace ceras
         return reduce( ts, axis, value_type{0}, []( auto const& a, auto const& b ){ return a+b; }, keepdims ) / static_cast<value_type>( _shape[axis] );
     }
 
-    template <Tensor Tsor> requires std::floating_point<typename Tsor::value_type>
+    template <Tensor Tsor> requires std::floating_point<accumulator_t<typename Tsor::value_type>>
     Tsor variance( Tsor const& ts, unsigned long axis, bool keepdims=false ) noexcept
     {
         Tsor x = mean( ts, axis, true );
@@ -1111,7 +1228,7 @@ namespace ceras
         return mean( x, axis, keepdims );
     }
 
-    template <Tensor Tsor> requires std::floating_point<typename Tsor::value_type>
+    template <Tensor Tsor> requires std::floating_point<accumulator_t<typename Tsor::value_type>>
     Tsor standard_deviation( Tsor const& ts, unsigned long axis, bool keepdims=false ) noexcept
     {
         Tsor x = variance( ts, axis, keepdims );
@@ -1119,14 +1236,16 @@ namespace ceras
         return x;
     }
 
-    template <Tensor Tsor> requires std::floating_point<typename Tsor::value_type>
+    template <Tensor Tsor> requires std::floating_point<accumulator_t<typename Tsor::value_type>>
     typename Tsor::value_type var( Tsor const& ts ) noexcept
     {
+        typedef typename Tsor::value_type value_type;
+        typedef accumulator_t<value_type> accumulator_type;
         auto x = ts - mean(ts);
-        return std::inner_product( x.begin(), x.end(), x.begin(), typename Tsor::value_type{0} );
+        return static_cast<value_type>( backend::reduce_all<accumulator_type>( x.data(), x.size(), []( value_type v ){ return static_cast<accumulator_type>( v ) * static_cast<accumulator_type>( v ); }, std::plus<accumulator_type>{} ) );
     }
 
-    template <Tensor Tsor> requires std::floating_point<typename Tsor::value_type>
+    template <Tensor Tsor> requires std::floating_point<accumulator_t<typename Tsor::value_type>>
     typename Tsor::value_type std( Tsor const& ts ) noexcept
     {
         return std::sqrt( var(ts) );
@@ -1135,7 +1254,7 @@ namespace ceras
     template <Tensor Tsor>
     Tsor max( Tsor const& ts, unsigned long axis, bool keepdims=false ) noexcept
     {
-        return reduce( ts, axis, std::numeric_limits<typename Tsor::value_type>::min(), []( auto const& a, auto const& b ){ return a > b ? a : b; }, keepdims );
+        return reduce( ts, axis, std::numeric_limits<typename Tsor::value_type>::lowest(), []( auto const& a, auto const& b ){ return a > b ? a : b; }, keepdims );
     }
 
     template <Tensor Tsor>
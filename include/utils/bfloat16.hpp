@@ -0,0 +1,162 @@
+#ifndef BFLOATSIXTEENHPPKQZXWYRVNTJLMOBUAEDCFIHSPGKQZXWYRVNTJLMOBUAEDCFIHSPGKQZXW
+#define BFLOATSIXTEENHPPKQZXWYRVNTJLMOBUAEDCFIHSPGKQZXWYRVNTJLMOBUAEDCFIHSPGKQZXW
+
+#include "../includes.hpp"
+#include "../config.hpp"
+#include "./parallel.hpp"
+
+namespace ceras
+{
+
+    ///
+    /// @brief 16-bit brain floating point number, the upper half of a float32: 1 sign bit, 8 exponent bits and 7 mantissa bits.
+    ///
+    /// It has the range of float32 with 2 to 3 significant decimal digits, and takes half of the memory.
+    /// Arithmetic is carried out in float32: a `bfloat16` converts implicitly to `float`, and the results are rounded to nearest even when stored back.
+    ///
+    /// Example code:
+    /// \code{.cpp}
+    /// bfloat16 x = 1.0f;
+    /// bfloat16 y = x * 3.14159f; // computed in float32, then rounded to 3.140625
+    /// auto t = random<float>( {16, 16} ).as_type<bfloat16>();
+    /// \endcode
+    ///
+    struct bfloat16
+    {
+        std::uint16_t bits_;
+
+        bfloat16() noexcept = default; // trivial, so that tensors of bfloat16 are plain memory
+
+        template< typename T > requires std::is_arithmetic_v<T>
+        constexpr bfloat16( T value ) noexcept : bits_{ round( static_cast<float>( value ) ) } {}
+
+        constexpr operator float() const noexcept
+        {
+            return std::bit_cast<float>( static_cast<std::uint32_t>( bits_ ) << 16 );
+        }
+
+        static constexpr bfloat16 from_bits( std::uint16_t bits ) noexcept
+        {
+            bfloat16 ans;
+            ans.bits_ = bits;
+            return ans;
+        }
+
+        constexpr std::uint16_t bits() const noexcept { return bits_; }
+
+        ///
+        /// @brief The upper 16 bits of a float, rounded to nearest even. NaNs stay (quiet) NaNs.
+        ///
+        static constexpr std::uint16_t round( float x ) noexcept
+        {
+            std::uint32_t const u = std::bit_cast<std::uint32_t>( x );
+            if ( ( u & 0x7fffffffU ) > 0x7f800000U )
+                return static_cast<std::uint16_t>( ( u >> 16 ) | 0x0040U );
+            return static_cast<std::uint16_t>( ( u + 0x7fffU + ( ( u >> 16 ) & 1U ) ) >> 16 );
+        }
+
+        constexpr bfloat16& operator += ( float other ) noexcept { return *this = bfloat16{ static_cast<float>( *this ) + other }; }
+        constexpr bfloat16& operator -= ( float other ) noexcept { return *this = bfloat16{ static_cast<float>( *this ) - other }; }
+        constexpr bfloat16& operator *= ( float other ) noexcept { return *this = bfloat16{ static_cast<float>( *this ) * other }; }
+        constexpr bfloat16& operator /= ( float other ) noexcept { return *this = bfloat16{ static_cast<float>( *this ) / other }; }
+    };
+
+    static_assert( sizeof(bfloat16) == 2 && std::is_trivial_v<bfloat16> );
+
+    inline std::ostream& operator << ( std::ostream& os, bfloat16 x )
+    {
+        return os << static_cast<float>( x );
+    }
+
+    ///
+    /// @brief Type used to accumulate sums of T: float for bfloat16, T itself otherwise.
+    ///
+    template< typename T >
+    struct accumulator
+    {
+        typedef T type;
+    };
+
+    template<>
+    struct accumulator<bfloat16>
+    {
+        typedef float type;
+    };
+
+    template< typename T >
+    using accumulator_t = typename accumulator<T>::type;
+
+    ///
+    /// @brief Converts n elements from or to bfloat16, in parallel for long arrays.
+    ///
+    template< typename From, typename To > requires std::is_same_v<From, bfloat16> || std::is_same_v<To, bfloat16>
+    void convert( From const* src, unsigned long n, To* dst ) noexcept
+    {
+        unsigned long const block = 1UL << 16;
+        parallel( [=]( unsigned long task )
+        {
+            unsigned long const first = task * block;
+            unsigned long const last = std::min( n, first + block );
+            if constexpr( std::is_same_v<From, float> && std::is_same_v<To, bfloat16> )
+            {
+                // on bits, for the vectorizer
+                std::uint32_t const* s = reinterpret_cast<std::uint32_t const*>( src );
+                std::uint16_t* d = reinterpret_cast<std::uint16_t*>( dst );
+                for ( unsigned long idx = first; idx != last; ++idx )
+                {
+                    std::uint32_t const u = s[idx];
+                    std::uint16_t const rounded = static_cast<std::uint16_t>( ( u + 0x7fffU + ( ( u >> 16 ) & 1U ) ) >> 16 );
+                    std::uint16_t const nan = static_cast<std::uint16_t>( ( u >> 16 ) | 0x0040U );
+                    d[idx] = ( ( u & 0x7fffffffU ) > 0x7f800000U ) ? nan : rounded;
+                }
+            }
+            else if constexpr( std::is_same_v<From, bfloat16> && std::is_same_v<To, float> )
+            {
+                std::uint16_t const* s = reinterpret_cast<std::uint16_t const*>( src );
+                std::uint32_t* d = reinterpret_cast<std::uint32_t*>( dst );
+                for ( unsigned long idx = first; idx != last; ++idx )
+                    d[idx] = static_cast<std::uint32_t>( s[idx] ) << 16;
+            }
+            else
+            {
+                for ( unsigned long idx = first; idx != last; ++idx )
+                    dst[idx] = static_cast<To>( src[idx] );
+            }
+        }, 0UL, ( n + block - 1 ) / block, 1UL );
+    }
+
+}//namespace ceras
+
+namespace std
+{
+    template<>
+    class numeric_limits<ceras::bfloat16>
+    {
+    public:
+        static constexpr bool is_specialized = true;
+        static constexpr bool is_signed = true;
+        static constexpr bool is_integer = false;
+        static constexpr bool is_exact = false;
+        static constexpr bool has_infinity = true;
+        static constexpr bool has_quiet_NaN = true;
+        static constexpr bool has_signaling_NaN = true;
+        static constexpr int digits = 8;
+        static constexpr int digits10 = 2;
+        static constexpr int max_digits10 = 4;
+        static constexpr int radix = 2;
+        static constexpr int min_exponent = -125;
+        static constexpr int max_exponent = 128;
+
+        static constexpr ceras::bfloat16 min() noexcept { return ceras::bfloat16::from_bits( 0x0080 ); }
+        static constexpr ceras::bfloat16 max() noexcept { return ceras::bfloat16::from_bits( 0x7f7f ); }
+        static constexpr ceras::bfloat16 lowest() noexcept { return ceras::bfloat16::from_bits( 0xff7f ); }
+        static constexpr ceras::bfloat16 epsilon() noexcept { return ceras::bfloat16::from_bits( 0x3c00 ); }
+        static constexpr ceras::bfloat16 round_error() noexcept { return ceras::bfloat16::from_bits( 0x3f00 ); }
+        static constexpr ceras::bfloat16 infinity() noexcept { return ceras::bfloat16::from_bits( 0x7f80 ); }
+        static constexpr ceras::bfloat16 quiet_NaN() noexcept { return ceras::bfloat16::from_bits( 0x7fc0 ); }
+        static constexpr ceras::bfloat16 signaling_NaN() noexcept { return ceras::bfloat16::from_bits( 0x7fa0 ); }
+        static constexpr ceras::bfloat16 denorm_min() noexcept { return ceras::bfloat16::from_bits( 0x0001 ); }
+    };
+}//namespace std
+
+#endif//BFLOATSIXTEENHPPKQZXWYRVNTJLMOBUAEDCFIHSPGKQZXWYRVNTJLMOBUAEDCFIHSPGKQZXW
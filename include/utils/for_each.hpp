@@ -49,7 +49,7 @@ namespace ceras
             {
                 f( *(begin1+idx), *(beginn+idx)... );
             };
-            parallel( func, 0UL, n );
+            parallel( func, 0UL, n, 4096UL ); // a few elementwise operations per index, not worth waking the pool for small tensors
             return f;
         }
 
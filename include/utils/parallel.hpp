@@ -4,68 +4,92 @@
 #include "../includes.hpp"
 #include "../config.hpp"
 #include "./range.hpp"
+#include "./thread_pool.hpp"
 
 namespace ceras
 {
 
 #if 1
 
+    namespace parallel_private
+    {
+        // the time, in seconds, spent timing the first indices of a range, the minimal time of a task, and the time under which a range runs serially
+        inline constexpr double probe_time = 2.0e-6;
+        inline constexpr double task_time = 2.0e-5;
+        inline constexpr double serial_time = 1.0e-5;
+
+        inline double elapsed( std::chrono::steady_clock::time_point since ) noexcept
+        {
+            return std::chrono::duration<double>( std::chrono::steady_clock::now() - since ).count();
+        }
+    }//namespace parallel_private
+
+    ///
+    /// @brief Calls func(i) for every i in [dim_first, dim_last), on the threads of the work-stealing pool, see `thread_pool.hpp`.
+    /// @param threshold The ranges of at most `threshold` indices run serially on the calling thread.
+    ///
+    /// The indices run in no particular order. The grain of the tasks comes from the time taken by the first indices, which the calling thread runs
+    /// on its own: the cheap loops run in few large tasks, or serially if the whole range would not pay for waking the pool, and the costly ones
+    /// are split down to single indices. A range of a few indices per thread is not timed, its indices being taken for costly ones.
+    /// A `parallel` nested in another one shares its tasks with the idle threads.
+    ///
     template< typename Function, std::unsigned_integral Integer_Type >
     void parallel( Function const& func, Integer_Type dim_first, Integer_Type dim_last, unsigned long threshold = 8 ) // 1d parallel
     {
-        if constexpr( parallel_mode == 0 )
+        auto const& serial = [&func]( Integer_Type first, Integer_Type last )
         {
-            for ( auto a : range( dim_first, dim_last ) )
+            for ( auto a = first; a < last; ++a )
                 func( a );
+        };
+
+        if constexpr( parallel_mode == 0 )
+        {
+            serial( dim_first, dim_last );
             return;
         }
         else // <- this is constexpr-if, `else` is a must
         {
-            unsigned int const total_cores = std::thread::hardware_concurrency();
-
             // case of non-parallel or small jobs
-            if ( (total_cores <= 1) || ((dim_last - dim_first) <= threshold) )
+            if ( dim_last <= dim_first || (dim_last - dim_first) <= threshold )
             {
-                for ( auto a : range( dim_first, dim_last ) )
-                    func( a );
+                serial( dim_first, dim_last );
                 return;
             }
-
-            // case of small job numbers
-            std::vector<std::thread> threads;
-            if ( dim_last - dim_first <= total_cores )
+            thread_pool& pool = thread_pool::instance();
+            unsigned long const threads = pool.size();
+            if ( threads <= 1 )
             {
-                for ( auto index = dim_first; index != dim_last; ++index )
-                    threads.emplace_back( std::thread{[&func, index](){ func( index ); }} );
-                for ( auto& th : threads )
-                    th.join();
+                serial( dim_first, dim_last );
                 return;
             }
 
-            // case of more jobs than CPU cores
-            auto const& job_slice = [&func]( Integer_Type a, Integer_Type b )
-            {
-                if ( a >= b ) return;
-                while ( a != b )
-                    func(a++);
-            };
-
-            threads.reserve( total_cores-1 );
-            std::uint_least64_t tasks_per_thread = ( dim_last - dim_first + total_cores - 1 ) / total_cores;
-
-            for ( auto index : range( total_cores-1 ) )
+            // timing the first indices, doubling their number until `probe_time` or a quarter of the range
+            unsigned long const total = static_cast<unsigned long>( dim_last - dim_first );
+            unsigned long probed = 0;
+            unsigned long grain = 1;
+            if ( total > 4 * threads )
             {
-                Integer_Type first = tasks_per_thread * index + dim_first;
-                first = std::min( first, dim_last );
-                Integer_Type last =  first + tasks_per_thread;
-                last = std::min( last, dim_last );
-                threads.emplace_back( std::thread{ job_slice, first, last } );
+                auto const start = std::chrono::steady_clock::now();
+                double time = 0.0;
+                for ( unsigned long batch = 1; time < parallel_private::probe_time && probed + batch <= total / 4; batch *= 2 )
+                {
+                    serial( static_cast<Integer_Type>( dim_first + probed ), static_cast<Integer_Type>( dim_first + probed + batch ) );
+                    probed += batch;
+                    time = parallel_private::elapsed( start );
+                }
+                double const cost = time / static_cast<double>( std::max( 1UL, probed ) );
+                if ( cost * static_cast<double>( total - probed ) < parallel_private::serial_time )
+                {
+                    serial( static_cast<Integer_Type>( dim_first + probed ), dim_last );
+                    return;
+                }
+                grain = static_cast<unsigned long>( parallel_private::task_time / std::max( cost, 1.0e-12 ) );
+                grain = std::clamp( grain, 1UL, std::max( 1UL, ( total - probed ) / threads ) );
             }
 
-            job_slice( tasks_per_thread*(total_cores-1), dim_last );
-
-            for ( auto& th : threads )
-                th.join();
+            Integer_Type const first = static_cast<Integer_Type>( dim_first + probed );
+            if ( !pool.run( [&func]( unsigned long a ){ func( static_cast<Integer_Type>( a ) ); }, static_cast<unsigned long>( first ), static_cast<unsigned long>( dim_last ), grain ) )
+                serial( first, dim_last ); // the pool is taken by the job of another thread
         }
     }//parallel
 
@@ -94,6 +118,65 @@ namespace ceras
         parallel( func, Integer_Type{0}, dim_last );
     }//parallel
 
+    ///
+    /// @brief Reduces func(i) over the indices i in [first, last), with the associative operator `combine` and its identity `init`.
+    /// @param grain The number of indices reduced by a task, 0 to split the range into 64 tasks.
+    ///
+    /// The partial results of the tasks are combined in the order of the indices, so that, with a fixed grain, the result does not depend on
+    /// the number of threads, nor on the scheduling, even for floating point additions.
+    ///
+    /// Example code:
+    ///
+    /// \code{.cpp}
+    /// std::vector<double> v( 1000000, 0.5 );
+    /// double const sum = ceras::parallel_reduce( 0UL, v.size(), 0.0, [&]( unsigned long i ){ return v[i]; }, std::plus<double>{} );
+    /// \endcode
+    ///
+    template< std::unsigned_integral Integer_Type, typename T, typename Function, typename Combine >
+    T parallel_reduce( Integer_Type first, Integer_Type last, T const& init, Function const& func, Combine const& combine, unsigned long grain = 0 )
+    {
+        if ( last <= first )
+            return init;
+        unsigned long const total = static_cast<unsigned long>( last - first );
+        grain = grain ? grain : std::max( 1UL, ( total + 63 ) / 64 );
+        unsigned long const tasks = ( total + grain - 1 ) / grain;
+
+        std::vector<T> partials( tasks, init );
+        parallel( [&]( unsigned long task )
+        {
+            T partial = init;
+            unsigned long const end = std::min( total, ( task + 1 ) * grain );
+            for ( unsigned long idx = task * grain; idx != end; ++idx )
+                partial = combine( partial, func( static_cast<Integer_Type>( first + idx ) ) );
+            partials[task] = partial;
+        }, 0UL, tasks, 1UL );
+
+        T ans = init;
+        for ( auto const& partial : partials )
+            ans = combine( ans, partial );
+        return ans;
+    }
+
+    ///
+    /// @brief Runs the functions passed, possibly at the same time, and returns once all of them have returned.
+    ///
+    /// Example code:
+    ///
+    /// \code{.cpp}
+    /// ceras::parallel_invoke( [&](){ s.run( branch_1 ); }, [&](){ s.run( branch_2 ); } );
+    /// \endcode
+    ///
+    template< typename... Functions >
+    void parallel_invoke( Functions const&... funcs )
+    {
+        auto const& invoke = [&]( unsigned long idx )
+        {
+            unsigned long current = 0;
+            ( ( current++ == idx ? static_cast<void>( funcs() ) : void() ), ... );
+        };
+        parallel( invoke, 0UL, static_cast<unsigned long>( sizeof...( Functions ) ), 1UL );
+    }
+
 }//namespace ceras
 
 #endif//DVAOHBLMHGJXDTYKVKKSMCBAWCSHIBSLFWQARMEWBWMLKQGWFMOSTQFRQDXHJYHJELKQIHEXF
@@ -0,0 +1,309 @@
+#ifndef THREADPOOLHPPWKQZJXRMVNTYLOBUEADCFIHSPGWKQZJXRMVNTYLOBUEADCFIHSPGWKQZJXRMV
+#define THREADPOOLHPPWKQZJXRMVNTYLOBUEADCFIHSPGWKQZJXRMVNTYLOBUEADCFIHSPGWKQZJXRMV
+
+#include "../includes.hpp"
+#include "../config.hpp"
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+//
+// The process-wide work-stealing scheduler behind `parallel`.
+//
+// Every thread of the pool owns a deque of tasks, a task being a range of indices of a job. A thread running a task larger than the grain of its job
+// splits it in halves, pushes the upper half to the back of its deque, and goes on with the lower half, until the lower half fits the grain.
+// A thread out of work pops the back of its own deque, and steals from the front of the deques of the other threads, where the largest ranges are.
+// The ranges taking longer than expected are thus shared by the idle threads, and the irregular loops keep all the threads busy until their end.
+//
+// A job submitted from inside a task, a nested `parallel`, pushes its tasks to the deque of the thread running it, so the nested jobs are shared by the
+// idle threads without any new thread. The thread waiting for a job only runs tasks of this job, stealing them if needed.
+// A thread out of the pool submits through the slot 0, one thread at a time: while the slot is taken, the jobs of other threads run serially.
+//
+// The workers are created once, pinned to their own cores on Linux, and sleep on a condition variable when there is nothing to steal.
+// The pool has `CERAS_NUM_THREADS` threads, the submitting thread included, if set, and as many threads as cores otherwise; `set_num_threads` resizes it.
+// Pinning is disabled by the environment variable `CERAS_THREAD_AFFINITY=0`.
+//
+
+namespace ceras
+{
+
+    namespace thread_pool_private
+    {
+        // the slot of the calling thread in the pool, -1 out of the pool
+        inline thread_local long current_slot = -1;
+
+        inline unsigned long default_threads()
+        {
+            if ( char const* threads = std::getenv( "CERAS_NUM_THREADS" ); threads && *threads )
+                if ( long const n = std::atol( threads ); n > 0 )
+                    return static_cast<unsigned long>( n );
+            return std::max( 1U, std::thread::hardware_concurrency() );
+        }
+
+        inline bool affinity_enabled()
+        {
+            static bool const enabled = []()
+            {
+                char const* flag = std::getenv( "CERAS_THREAD_AFFINITY" );
+                return !( flag && std::string{ flag } == std::string{ "0" } );
+            }();
+            return enabled;
+        }
+
+        // pins the calling thread to a core, the submitting thread being left to the scheduler
+        inline void pin_to_core( [[maybe_unused]] unsigned long core )
+        {
+#if defined(__linux__)
+            unsigned long const cores = std::max( 1U, std::thread::hardware_concurrency() );
+            cpu_set_t cpu_set;
+            CPU_ZERO( &cpu_set );
+            CPU_SET( core % cores, &cpu_set );
+            pthread_setaffinity_np( pthread_self(), sizeof(cpu_set_t), &cpu_set );
+#endif
+        }
+
+        // func is called on [begin, end) sub-ranges of at most `grain` indices; `pending` counts the tasks not yet run to their end
+        struct job
+        {
+            void const* func = nullptr;
+            void (*invoke)( void const*, unsigned long, unsigned long ) = nullptr;
+            unsigned long grain = 1;
+            std::atomic<unsigned long> pending{ 0 };
+        };
+
+        struct task
+        {
+            job* owner;
+            unsigned long begin;
+            unsigned long end;
+        };
+
+        struct task_deque
+        {
+            std::mutex mutex;
+            std::deque<task> tasks;
+        };
+    }//namespace thread_pool_private
+
+    struct thread_pool
+    {
+        typedef thread_pool_private::job job;
+        typedef thread_pool_private::task task;
+
+        std::vector<std::thread> workers_;
+        std::vector<std::unique_ptr<thread_pool_private::task_deque>> deques_; // the deque of the slot i, the slot 0 being the one of the submitting thread
+        std::mutex mutex_;                  // guards the sleeps of the workers
+        std::condition_variable wake_;      // wakes the sleeping workers on a new task, or on stopping
+        std::atomic<unsigned long> epoch_{ 0 };     // incremented on every task pushed
+        std::atomic<unsigned long> sleeping_{ 0 };  // workers sleeping on `wake_`
+        std::atomic<bool> stopping_{ false };
+        std::mutex submission_mutex_;       // held by the thread out of the pool submitting a job through the slot 0
+
+        thread_pool( unsigned long threads = thread_pool_private::default_threads() ) { start( threads ); }
+        ~thread_pool() { stop(); }
+        thread_pool( thread_pool const& ) = delete;
+        thread_pool& operator = ( thread_pool const& ) = delete;
+
+        ///
+        /// @brief The number of threads running a job, the submitting thread included.
+        ///
+        unsigned long size() const noexcept { return workers_.size() + 1; }
+
+        ///
+        /// @brief Replaces the workers by `threads-1` new ones, waiting for the running job first.
+        ///
+        void resize( unsigned long threads )
+        {
+            std::lock_guard<std::mutex> submission{ submission_mutex_ };
+            stop();
+            start( threads );
+        }
+
+        ///
+        /// @brief Calls func(i) for every i in [first, last), on the threads of the pool, in tasks of at most `grain` indices.
+        /// @return False if the slot 0 is taken by a job of another thread out of the pool, in which case func is not called.
+        ///
+        template< typename Function >
+        bool run( Function const& func, unsigned long first, unsigned long last, unsigned long grain )
+        {
+            std::unique_lock<std::mutex> submission{ submission_mutex_, std::defer_lock };
+            long const slot = thread_pool_private::current_slot;
+            if ( slot < 0 && !submission.try_lock() )
+                return false;
+
+            job j;
+            j.func = &func;
+            j.invoke = []( void const* f, unsigned long begin, unsigned long end )
+            {
+                Function const& function = *static_cast<Function const*>( f );
+                for ( ; begin != end; ++begin )
+                    function( begin );
+            };
+            j.grain = std::max( 1UL, grain );
+            j.pending.store( 1, std::memory_order_relaxed );
+
+            unsigned long const own = slot < 0 ? 0UL : static_cast<unsigned long>( slot );
+            thread_pool_private::current_slot = static_cast<long>( own );
+            run_task( task{ &j, first, last }, own );
+
+            // helps with the tasks of this job left, then waits for the ones being run by the other threads
+            for ( unsigned long idle = 0; j.pending.load( std::memory_order_acquire ) != 0; )
+            {
+                if ( std::optional<task> t = take( own, &j ); t )
+                {
+                    run_task( *t, own );
+                    idle = 0;
+                }
+                else if ( ++idle > 16 )
+                    std::this_thread::yield();
+            }
+            thread_pool_private::current_slot = slot;
+            return true;
+        }
+
+        // runs a task, splitting it to the grain first
+        void run_task( task t, unsigned long slot )
+        {
+            job& j = *(t.owner);
+            while ( t.end - t.begin > j.grain )
+            {
+                unsigned long const middle = t.begin + ( t.end - t.begin ) / 2;
+                j.pending.fetch_add( 1, std::memory_order_relaxed );
+                push( slot, task{ t.owner, middle, t.end } );
+                t.end = middle;
+            }
+            j.invoke( j.func, t.begin, t.end );
+            j.pending.fetch_sub( 1, std::memory_order_acq_rel );
+        }
+
+        void push( unsigned long slot, task const& t )
+        {
+            {
+                auto& deque = *(deques_[slot]);
+                std::lock_guard<std::mutex> lock{ deque.mutex };
+                deque.tasks.push_back( t );
+            }
+            epoch_.fetch_add( 1 );
+            if ( sleeping_.load() != 0 )
+            {
+                { std::lock_guard<std::mutex> lock{ mutex_ }; }
+                wake_.notify_one();
+            }
+        }
+
+        // a task of the job `owner`, or of any job if null: the back of the own deque first, then the front of the others
+        std::optional<task> take( unsigned long slot, job const* owner )
+        {
+            {
+                auto& deque = *(deques_[slot]);
+                std::lock_guard<std::mutex> lock{ deque.mutex };
+                if ( !deque.tasks.empty() && ( !owner || deque.tasks.back().owner == owner ) )
+                {
+                    task const t = deque.tasks.back();
+                    deque.tasks.pop_back();
+                    return t;
+                }
+            }
+            for ( unsigned long offset = 1; offset != deques_.size(); ++offset )
+            {
+                auto& deque = *(deques_[(slot + offset) % deques_.size()]);
+                std::lock_guard<std::mutex> lock{ deque.mutex };
+                for ( auto itor = deque.tasks.begin(); itor != deque.tasks.end(); ++itor )
+                    if ( !owner || (*itor).owner == owner )
+                    {
+                        task const t = *itor;
+                        deque.tasks.erase( itor );
+                        return t;
+                    }
+            }
+            return std::nullopt;
+        }
+
+        void worker( unsigned long slot )
+        {
+            if ( thread_pool_private::affinity_enabled() )
+                thread_pool_private::pin_to_core( slot );
+            thread_pool_private::current_slot = static_cast<long>( slot );
+
+            for ( unsigned long idle = 0; !stopping_.load(); )
+            {
+                unsigned long const epoch = epoch_.load();
+                if ( std::optional<task> t = take( slot, nullptr ); t )
+                {
+                    run_task( *t, slot );
+                    idle = 0;
+                    continue;
+                }
+                if ( ++idle < 64 )
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+                std::unique_lock<std::mutex> lock{ mutex_ };
+                sleeping_.fetch_add( 1 );
+                wake_.wait( lock, [&](){ return stopping_.load() || epoch_.load() != epoch; } );
+                sleeping_.fetch_sub( 1 );
+                idle = 0;
+            }
+        }
+
+        void start( unsigned long threads )
+        {
+            stopping_ = false;
+            deques_.clear();
+            for ( unsigned long slot = 0; slot < threads; ++slot )
+                deques_.emplace_back( std::make_unique<thread_pool_private::task_deque>() );
+            workers_.reserve( threads );
+            for ( unsigned long slot = 1; slot < threads; ++slot )
+                workers_.emplace_back( [this, slot](){ worker( slot ); } );
+        }
+
+        void stop()
+        {
+            {
+                std::lock_guard<std::mutex> lock{ mutex_ };
+                stopping_ = true;
+            }
+            wake_.notify_all();
+            for ( auto& th : workers_ )
+                th.join();
+            workers_.clear();
+        }
+
+        static thread_pool& instance()
+        {
+            static thread_pool pool;
+            return pool;
+        }
+    };
+
+    ///
+    /// @brief Sets the number of threads running the parallel regions, the calling thread included.
+    ///
+    /// Example code:
+    ///
+    /// \code{.cpp}
+    /// ceras::set_num_threads( 4 ); // or CERAS_NUM_THREADS=4 in the environment
+    /// \endcode
+    ///
+    inline void set_num_threads( unsigned long threads )
+    {
+        thread_pool::instance().resize( std::max( 1UL, threads ) );
+    }
+
+    ///
+    /// @brief The number of threads running the parallel regions, the calling thread included.
+    ///
+    inline unsigned long get_num_threads()
+    {
+        if constexpr( parallel_mode == 0 )
+            return 1UL;
+        else
+            return thread_pool::instance().size();
+    }
+
+}//namespace ceras
+
+#endif//THREADPOOLHPPWKQZJXRMVNTYLOBUEADCFIHSPGWKQZJXRMVNTYLOBUEADCFIHSPGWKQZJXRMV
@@ -21,6 +21,13 @@ namespace ceras
     template< Tensor Tsor >
     ceras_private::session<Tsor>& get_default_session();
 
+    ///
+    /// @brief Incremented on every non-const access to the data of a variable.
+    ///
+    /// The caches derived from the weights, such as the filter transforms of the Winograd convolution, are reused during the inference while it is unchanged.
+    ///
+    inline std::atomic<unsigned long> variable_data_generation = 0;
+
     template< Tensor Tsor >
     struct variable_state
     {
@@ -90,8 +97,40 @@ namespace ceras
                     state.gradient_.resize( state.data_.shape() );
             }
             state.gradient_ += grad; // collecting all the gradients from its children nodes, will be called mulitple times in a single backward pass
+            apply_regularizers();
+        }
+
+        ///
+        /// @brief The gradient buffer, for the operators accumulating their gradients into it directly, such as `gemm` with beta = 1.
+        /// @return A pointer to the gradient, nullptr if this variable is not trainable.
+        ///
+        /// After accumulating into the buffer, the operator calls `backward_accumulated()` in place of `backward( grad )`.
+        ///
+        tensor_type* gradient_accumulator() noexcept
+        {
+            if (!trainable_) return nullptr;
+
+            auto& state = *((*this).state_);
+            if (state.gradient_.shape() != state.data_.shape())
+            {
+                state.gradient_.resize( state.data_.shape() );
+                state.gradient_.reset( value_type{0} );
+            }
+            return std::addressof( state.gradient_ );
+        }
+
+        ///
+        /// @brief Backward pass of a gradient already accumulated into `gradient_accumulator()`.
+        ///
+        void backward_accumulated() noexcept
+        {
+            if (!trainable_) return;
+            apply_regularizers();
+        }
 
-            // apply regularizers
+        void apply_regularizers() noexcept
+        {
+            auto& state = *((*this).state_);
             if (!(regularizer_.synchronized_)) // in case of multiple invoke of this method in a same backward pass
             {
                 if ( regularizer_.l1_ >= eps ) // l1 regularizer
@@ -130,6 +169,7 @@ namespace ceras
 
         tensor_type& data()
         {
+            ++variable_data_generation; // the data may be modified by the caller
             auto& state = *((*this).state_);
             return state.data_;
         }
@@ -0,0 +1,97 @@
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch.hpp"
+
+#include "../include/ceras.hpp"
+#include <cmath>
+
+using namespace ceras;
+
+// element (b, r, c) of a [B, R, C] tensor, or of a [R, C] tensor shared by all the batches
+template< Tensor Tsor >
+auto at( Tsor const& ts, unsigned long b, unsigned long r, unsigned long c )
+{
+    auto const& shape = ts.shape();
+    unsigned long const rows = *(shape.rbegin()+1);
+    unsigned long const cols = *(shape.rbegin());
+    unsigned long const offset = ( ts.ndim() == 3 ) ? b * rows * cols : 0UL;
+    return ts[offset + r * cols + c];
+}
+
+void check_batched_matmul( unsigned long batch, unsigned long m, unsigned long k, unsigned long n, bool shared_rhs )
+{
+    auto a = variable{ random<double>( {batch, m, k} ) };
+    auto b = shared_rhs ? variable{ random<double>( {k, n} ) } : variable{ random<double>( {batch, k, n} ) };
+    auto ab = batched_matmul( a, b );
+
+    auto& s = get_default_session<tensor<double>>();
+    auto const& result = s.run( ab );
+    REQUIRE( result.shape() == std::vector<unsigned long>{ {batch, m, n} } );
+
+    auto const& A = a.data();
+    auto const& B = b.data();
+    for ( auto bs : range( batch ) )
+        for ( auto r : range( m ) )
+            for ( auto c : range( n ) )
+            {
+                double ref = 0.0;
+                for ( auto idx : range( k ) )
+                    ref += at( A, bs, r, idx ) * at( B, bs, idx, c );
+                REQUIRE( std::abs( at( result, bs, r, c ) - ref ) < 1.0e-10 );
+            }
+
+    auto const& grad = random_like( result );
+    ab.backward( grad );
+
+    // dA[b] = grad[b] * B[b]^T
+    auto const& a_grad = a.gradient();
+    for ( auto bs : range( batch ) )
+        for ( auto r : range( m ) )
+            for ( auto c : range( k ) )
+            {
+                double ref = 0.0;
+                for ( auto idx : range( n ) )
+                    ref += at( grad, bs, r, idx ) * at( B, bs, c, idx );
+                REQUIRE( std::abs( at( a_grad, bs, r, c ) - ref ) < 1.0e-10 );
+            }
+
+    // dB[b] = A[b]^T * grad[b], accumulated over the batches if B is shared
+    auto const& b_grad = b.gradient();
+    for ( auto r : range( k ) )
+        for ( auto c : range( n ) )
+        {
+            if ( shared_rhs )
+            {
+                double ref = 0.0;
+                for ( auto bs : range( batch ) )
+                    for ( auto idx : range( m ) )
+                        ref += at( A, bs, idx, r ) * at( grad, bs, idx, c );
+                REQUIRE( std::abs( at( b_grad, 0, r, c ) - ref ) < 1.0e-10 );
+            }
+            else
+            {
+                for ( auto bs : range( batch ) )
+                {
+                    double ref = 0.0;
+                    for ( auto idx : range( m ) )
+                        ref += at( A, bs, idx, r ) * at( grad, bs, idx, c );
+                    REQUIRE( std::abs( at( b_grad, bs, r, c ) - ref ) < 1.0e-10 );
+                }
+            }
+        }
+}
+
+TEST_CASE("batched_matmul", "[batched_matmul]")
+{
+    check_batched_matmul( 1, 1, 1, 1, false );
+    check_batched_matmul( 3, 4, 5, 6, false );
+    check_batched_matmul( 17, 9, 13, 11, false );
+    check_batched_matmul( 2, 67, 129, 35, false );
+}
+
+TEST_CASE("batched_matmul_shared_rhs", "[batched_matmul_shared_rhs]")
+{
+    check_batched_matmul( 1, 2, 3, 4, true );
+    check_batched_matmul( 5, 7, 3, 2, true );
+    check_batched_matmul( 33, 8, 16, 24, true );
+}
+
@@ -0,0 +1,113 @@
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch.hpp"
+
+#include "../include/ceras.hpp"
+#include <cmath>
+
+using namespace ceras;
+
+TEST_CASE("bfloat16_conversion", "[bfloat16_conversion]")
+{
+    REQUIRE( bfloat16{ 1.0f }.bits() == 0x3f80 );
+    REQUIRE( bfloat16{ -2.0 }.bits() == 0xc000 );
+    REQUIRE( bfloat16{ 0 }.bits() == 0x0000 );
+    REQUIRE( static_cast<float>( bfloat16{ 3.0f } ) == 3.0f );
+
+    // round to nearest, ties to even
+    REQUIRE( static_cast<float>( bfloat16{ 1.0f + std::ldexp( 1.0f, -8 ) } ) == 1.0f );
+    REQUIRE( static_cast<float>( bfloat16{ 1.0f + 3.0f * std::ldexp( 1.0f, -8 ) } ) == 1.0f + std::ldexp( 1.0f, -6 ) );
+    REQUIRE( static_cast<float>( bfloat16{ 1.0f + std::ldexp( 1.0f, -8 ) + std::ldexp( 1.0f, -12 ) } ) == 1.0f + std::ldexp( 1.0f, -7 ) );
+    REQUIRE( static_cast<float>( bfloat16{ 3.14159f } ) == 3.140625f );
+
+    // special values
+    REQUIRE( std::isnan( static_cast<float>( bfloat16{ std::numeric_limits<float>::quiet_NaN() } ) ) );
+    REQUIRE( std::isnan( static_cast<float>( bfloat16{ std::bit_cast<float>( 0x7f800001U ) } ) ) ); // NaN with low payload only
+    REQUIRE( std::isinf( static_cast<float>( bfloat16{ std::numeric_limits<float>::infinity() } ) ) );
+    REQUIRE( std::isinf( static_cast<float>( bfloat16{ std::numeric_limits<float>::max() } ) ) ); // rounds up to infinity
+    REQUIRE( static_cast<float>( std::numeric_limits<bfloat16>::max() ) == 0x1.fep127f );
+    REQUIRE( static_cast<float>( std::numeric_limits<bfloat16>::epsilon() ) == std::ldexp( 1.0f, -7 ) );
+
+    // every bfloat16 survives the round trip through float, and the bulk conversion matches the scalar one
+    std::vector<bfloat16> all( 1UL << 16 );
+    for ( auto idx : range( all.size() ) )
+        all[idx] = bfloat16::from_bits( static_cast<std::uint16_t>( idx ) );
+    std::vector<float> widened( all.size() );
+    convert( all.data(), all.size(), widened.data() );
+    std::vector<bfloat16> narrowed( all.size() );
+    convert( widened.data(), widened.size(), narrowed.data() );
+    auto const& is_nan = []( bfloat16 x ){ return ( x.bits() & 0x7fffU ) > 0x7f80U; }; // on bits, std::isnan being folded away under -ffinite-math-only
+    for ( auto idx : range( all.size() ) )
+    {
+        if ( is_nan( all[idx] ) )
+            REQUIRE( is_nan( narrowed[idx] ) );
+        else
+            REQUIRE( narrowed[idx].bits() == all[idx].bits() );
+    }
+
+    auto const& x = random<float>( {1000,} );
+    auto const& y = x.as_type<bfloat16>();
+    for ( auto idx : range( x.size() ) )
+        REQUIRE( y[idx].bits() == bfloat16{ x[idx] }.bits() );
+}
+
+TEST_CASE("bfloat16_arithmetic", "[bfloat16_arithmetic]")
+{
+    bfloat16 x = 1.5f;
+    bfloat16 y = 2;
+    REQUIRE( x + y == 3.5f );
+    REQUIRE( x * y == 3.0f );
+    REQUIRE( x < y );
+    x += y;
+    REQUIRE( x == 3.5f );
+    x *= 0.5f;
+    REQUIRE( x == 1.75f );
+    REQUIRE( std::exp( bfloat16{ 0 } ) == 1.0f );
+
+    auto a = random<float>( {3, 5} ).as_type<bfloat16>();
+    auto b = random<float>( {3, 5} ).as_type<bfloat16>();
+    std::vector<bfloat16> expected( a.size() );
+    for ( auto idx : range( a.size() ) )
+        expected[idx] = static_cast<float>( a[idx] ) + static_cast<float>( b[idx] );
+    auto c = a + b;
+    for ( auto idx : range( c.size() ) )
+        REQUIRE( c[idx].bits() == expected[idx].bits() );
+}
+
+TEST_CASE("bfloat16_reduction", "[bfloat16_reduction]")
+{
+    // accumulating in bfloat16 would stop at 256
+    tensor<bfloat16> ones{ {4096,}, bfloat16{ 1 } };
+    REQUIRE( static_cast<float>( sum( ones ) ) == 4096.0f );
+    REQUIRE( static_cast<float>( reduce_sum( ones )[0] ) == 4096.0f );
+
+    ones.reshape( {512, 8} );
+    auto const& column_sums = sum( ones, 0 );
+    REQUIRE( column_sums.size() == 8 );
+    for ( auto idx : range( column_sums.size() ) )
+        REQUIRE( static_cast<float>( column_sums[idx] ) == 512.0f );
+    auto const& column_means = mean( ones, 0 );
+    for ( auto idx : range( column_means.size() ) )
+        REQUIRE( static_cast<float>( column_means[idx] ) == 1.0f );
+}
+
+TEST_CASE("bfloat16_gemm", "[bfloat16_gemm]")
+{
+    for ( auto [m, n, k] : { std::make_tuple( 1UL, 1UL, 1UL ), std::make_tuple( 7UL, 13UL, 5UL ), std::make_tuple( 67UL, 301UL, 129UL ) } )
+    {
+        auto const& a = random<float>( {m, n} ).as_type<bfloat16>();
+        auto const& b = random<float>( {n, k} ).as_type<bfloat16>();
+        auto const& c = multiply( a, b );
+        REQUIRE( c.shape() == std::vector<unsigned long>{ {m, k} } );
+
+        // the float product of the same bfloat16 inputs, rounded once
+        auto const& ref = multiply( a.as_type<float>(), b.as_type<float>() );
+        for ( auto idx : range( c.size() ) )
+            REQUIRE( c[idx].bits() == bfloat16{ ref[idx] }.bits() );
+
+        // accumulated onto the previous product, through the float buffer of the previous call
+        auto accumulated = c.deep_copy();
+        gemm( a.data(), false, b.data(), false, m, n, k, accumulated.data(), 1.0f, 1.0f );
+        for ( auto idx : range( c.size() ) )
+            REQUIRE( accumulated[idx].bits() == bfloat16{ static_cast<float>( c[idx] ) + ref[idx] }.bits() );
+    }
+}
@@ -0,0 +1,146 @@
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch.hpp"
+
+#include "../include/ceras.hpp"
+#include <cmath>
+
+using namespace ceras;
+
+namespace
+{
+    std::string read_file( std::string const& file_path )
+    {
+        std::ifstream ifs{ file_path };
+        return std::string{ std::istreambuf_iterator<char>{ ifs }, std::istreambuf_iterator<char>{} };
+    }
+
+    // a convolution in an autotuning scope against the same convolution out of any scope
+    void check_autotuned_conv2d( unsigned long channels, unsigned long new_channels, unsigned long kernel, unsigned long stride, std::string const& padding )
+    {
+        auto const& input = random<double>( {2, 9, 8, channels}, -1.0, 1.0 );
+        auto const& weights = random<double>( {new_channels, kernel, kernel, channels}, -1.0, 1.0 );
+
+        auto x = variable{ input.deep_copy() };
+        auto w = variable{ weights.deep_copy() };
+        auto y = general_conv2d( stride, stride, 1, 1, padding )( x, w );
+
+        auto x_ref = variable{ input.deep_copy() };
+        auto w_ref = variable{ weights.deep_copy() };
+        auto y_ref = general_conv2d( stride, stride, 1, 1, padding )( x_ref, w_ref );
+
+        auto& s = get_default_session<tensor<double>>();
+        auto const& expected = s.run( y_ref ).deep_copy();
+        auto const& grad = random_like( expected, -1.0, 1.0 );
+        y_ref.backward( grad );
+        {
+            backend::conv2d_autotuning_scope const autotuning;
+            auto const& output = s.run( y ).deep_copy();
+            REQUIRE( output.shape() == expected.shape() );
+            for ( auto idx : range( output.size() ) )
+                REQUIRE( std::abs( output[idx] - expected[idx] ) < 1.0e-10 );
+        }
+        y.backward( grad ); // out of the scope, with the algorithm tuned in the forward pass
+        for ( auto idx : range( input.size() ) )
+            REQUIRE( std::abs( x.gradient()[idx] - x_ref.gradient()[idx] ) < 1.0e-10 );
+        for ( auto idx : range( weights.size() ) )
+            REQUIRE( std::abs( w.gradient()[idx] - w_ref.gradient()[idx] ) < 1.0e-10 );
+    }
+}
+
+TEST_CASE("conv2d_autotuner_cache", "[conv2d_autotuner_cache]")
+{
+    std::string const file_path = (std::filesystem::temp_directory_path() / "ceras_test_conv2d_tuning" / "conv2d_tuning.txt").string();
+    std::filesystem::remove( file_path );
+    std::vector<std::string> const candidates{ "direct", "implicit_gemm", "img2col" };
+
+    {
+        backend::conv2d_autotuner<float> tuner{ file_path };
+        REQUIRE( tuner.query( "training 1", candidates, []( unsigned long idx ){ return std::vector<double>{ 3.0, 1.0, 2.0 }[idx]; } ) == 1 );
+        REQUIRE( std::filesystem::exists( file_path ) );
+    }
+
+    {
+        // a record of another cpu should be kept
+        std::ofstream ofs{ file_path, std::ios_base::app };
+        ofs << "some other cpu\tfloat32\ttraining 1\tdirect\n";
+    }
+
+    {
+        backend::conv2d_autotuner<float> tuner{ file_path };
+        bool timed = false;
+        auto const& time = [&]( unsigned long idx ){ timed = true; return std::vector<double>{ 1.0, 2.0, 3.0 }[idx]; };
+        REQUIRE( tuner.query( "training 1", candidates, time ) == 1 ); // from the file
+        REQUIRE( !timed );
+        REQUIRE( tuner.query( "training 1", { "direct", "img2col" }, time ) == 0 ); // the recorded algorithm is not a candidate
+        REQUIRE( timed );
+        REQUIRE( tuner.query( "inference 2", { "grouped" }, time ) == 0 );
+    }
+
+    {
+        std::string const& content = read_file( file_path );
+        REQUIRE( content.find( "some other cpu" ) != std::string::npos );
+        REQUIRE( content.find( "\ttraining 1\tdirect\n" ) != std::string::npos );
+        REQUIRE( content.find( "inference 2" ) == std::string::npos ); // a single candidate is not recorded
+        REQUIRE( std::count( content.begin(), content.end(), '\n' ) == 2 );
+    }
+
+    std::filesystem::remove_all( std::filesystem::path{ file_path }.parent_path() );
+}
+
+TEST_CASE("conv2d_autotuning_scope", "[conv2d_autotuning_scope]")
+{
+    std::string const file_path = (std::filesystem::temp_directory_path() / "ceras_test_conv2d_tuning_2.txt").string();
+    std::filesystem::remove( file_path );
+    backend::conv2d_autotuner<double>& tuner = singleton<backend::conv2d_autotuner<double>>::instance();
+    tuner.file_path_ = file_path;
+    tuner.tunings_.clear();
+    tuner.loaded_ = false;
+
+    REQUIRE( !backend::conv2d_autotuning_enabled() );
+    {
+        backend::conv2d_autotuning_scope const autotuning;
+        REQUIRE( backend::conv2d_autotuning_enabled() );
+    }
+    REQUIRE( !backend::conv2d_autotuning_enabled() );
+
+    check_autotuned_conv2d( 3, 4, 1, 1, "valid" ); // pointwise, implicit GEMM, img2col
+    check_autotuned_conv2d( 8, 8, 3, 1, "same" ); // Winograd, direct, implicit GEMM, img2col
+    check_autotuned_conv2d( 3, 4, 5, 2, "valid" ); // implicit GEMM, img2col
+    REQUIRE( tuner.tunings_.size() == 3 );
+    REQUIRE( std::count_if( tuner.tunings_.begin(), tuner.tunings_.end(), []( auto const& t ){ return t.first.starts_with( "training " ); } ) == 3 );
+
+    // the inference is tuned apart
+    learning_phase = 0;
+    check_autotuned_conv2d( 3, 4, 5, 2, "valid" );
+    learning_phase = 1;
+    REQUIRE( tuner.tunings_.size() == 4 );
+    std::string const& content = read_file( file_path );
+    REQUIRE( std::count( content.begin(), content.end(), '\n' ) == 4 );
+    REQUIRE( content.find( "\tinference 2x9x8x3 4x5x5 s2x2 p0x0 d1x1\t" ) != std::string::npos );
+
+    std::filesystem::remove( file_path );
+}
+
+TEST_CASE("conv2d_compiled_model_autotuning", "[conv2d_compiled_model_autotuning]")
+{
+    std::string const file_path = (std::filesystem::temp_directory_path() / "ceras_test_conv2d_tuning_3.txt").string();
+    std::filesystem::remove( file_path );
+    backend::conv2d_autotuner<float>& tuner = singleton<backend::conv2d_autotuner<float>>::instance();
+    tuner.file_path_ = file_path;
+    tuner.tunings_.clear();
+    tuner.loaded_ = false;
+
+    auto x = Input( {8, 8, 3} );
+    auto y = Flatten()( Conv2D( 4, {3, 3}, "same" )( x ) );
+    auto m = model{ x, y };
+    auto cm = m.compile( MeanSquaredError(), SGD( 2UL, 0.01f ) );
+
+    auto const& inputs = random<float>( {2, 8, 8, 3} );
+    auto const& outputs = random<float>( {2, 256} );
+    cm.train_on_batch( inputs, outputs );
+    REQUIRE( tuner.tunings_.size() == 1 );
+    REQUIRE( (*(tuner.tunings_.begin())).first == std::string{ "training 2x8x8x3 4x3x3 s1x1 p1x1 d1x1" } );
+    REQUIRE( !backend::conv2d_autotuning_enabled() );
+
+    std::filesystem::remove( file_path );
+}
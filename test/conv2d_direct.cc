@@ -0,0 +1,66 @@
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch.hpp"
+
+#include "../include/ceras.hpp"
+#include "./conv2d_reference.hpp"
+#include <cmath>
+
+using namespace ceras;
+using namespace conv2d_reference;
+
+TEST_CASE("conv2d_pointwise", "[conv2d_pointwise]")
+{
+    check_conv2d( conv2d_case{ 2, 7, 9, 5, 11, 1, 1, 1, 1, "valid" } );
+    check_conv2d( conv2d_case{ 3, 4, 4, 64, 40, 1, 1, 1, 1, "same" } );
+}
+
+TEST_CASE("conv2d_direct_3x3", "[conv2d_direct_3x3]")
+{
+    // odd sizes, channels crossing the register tile and the kernel gradient blocks
+    check_conv2d( conv2d_case{ 2, 8, 8, 3, 16, 3, 3, 1, 1, "same" } );
+    check_conv2d( conv2d_case{ 2, 9, 11, 5, 7, 3, 3, 1, 1, "valid" } );
+    check_conv2d( conv2d_case{ 1, 13, 13, 17, 70, 3, 3, 2, 1, "same" } );
+    check_conv2d( conv2d_case{ 3, 10, 7, 4, 33, 3, 3, 2, 1, "valid" } );
+    check_conv2d( conv2d_case{ 1, 3, 3, 2, 5, 3, 3, 1, 1, "valid" } );
+}
+
+TEST_CASE("conv2d_direct_1x1_strided", "[conv2d_direct_1x1_strided]")
+{
+    check_conv2d( conv2d_case{ 2, 9, 8, 6, 19, 1, 1, 2, 1, "valid" } );
+}
+
+TEST_CASE("conv2d_img2col_fallback", "[conv2d_img2col_fallback]")
+{
+    check_conv2d( conv2d_case{ 2, 9, 9, 3, 6, 5, 5, 1, 1, "same" } );
+    check_conv2d( conv2d_case{ 2, 11, 11, 2, 4, 3, 3, 1, 2, "valid" } );
+}
+
+TEST_CASE("conv2d_gradient_accumulated", "[conv2d_gradient_accumulated]")
+{
+    // a kernel shared by two convolutions gets the sum of both gradients
+    for ( unsigned long kernel : { 1UL, 3UL, 5UL } )
+    {
+        auto x1 = variable{ random<double>( {2, 6, 6, 4} ) };
+        auto x2 = variable{ random<double>( {2, 6, 6, 4} ) };
+        auto w = variable{ random<double>( {5, kernel, kernel, 4} ) };
+        auto y1 = general_conv2d( 1, 1, 1, 1, "same" )( x1, w );
+        auto y2 = general_conv2d( 1, 1, 1, 1, "same" )( x2, w );
+        auto y = y1 + y2;
+
+        auto& s = get_default_session<tensor<double>>();
+        auto const& grad = random_like( s.run( y ) );
+        y.backward( grad );
+        auto const expected = w.gradient().deep_copy();
+
+        auto w1 = variable{ w.data().deep_copy() };
+        auto w2 = variable{ w.data().deep_copy() };
+        auto z1 = general_conv2d( 1, 1, 1, 1, "same" )( x1, w1 );
+        auto z2 = general_conv2d( 1, 1, 1, 1, "same" )( x2, w2 );
+        s.run( z1 );
+        s.run( z2 );
+        z1.backward( grad );
+        z2.backward( grad );
+        for ( auto idx : range( expected.size() ) )
+            REQUIRE( std::abs( expected[idx] - ( w1.gradient()[idx] + w2.gradient()[idx] ) ) < 1.0e-10 );
+    }
+}
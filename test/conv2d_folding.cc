@@ -0,0 +1,118 @@
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch.hpp"
+
+#include "../include/ceras.hpp"
+#include <cmath>
+
+using namespace ceras;
+
+namespace
+{
+    // runs a few training forward passes for the batch normalizations to gather their statistics
+    template< typename Model >
+    void gather_statistics( Model& m, tensor<float> const& batch )
+    {
+        auto& s = get_default_session<tensor<float>>();
+        for ( [[maybe_unused]] auto idx : range( 3 ) )
+        {
+            s.bind( m.place_holder_, random_like( batch ) );
+            s.run( m.expression_ );
+        }
+    }
+
+    template< typename Model >
+    void check_folding( Model& m, tensor<float> const& batch, unsigned long folded_operators )
+    {
+        m.unfreeze();
+        auto const& expected = m.predict( batch ).deep_copy();
+
+        m.freeze();
+        auto const& traced = m.predict( batch ).deep_copy(); // folding along this prediction
+        REQUIRE( m.folded_operators_.size() == folded_operators );
+        auto const& folded = m.predict( batch ).deep_copy();
+
+        REQUIRE( folded.shape() == expected.shape() );
+        for ( auto idx : range( expected.size() ) )
+        {
+            REQUIRE( traced[idx] == expected[idx] );
+            REQUIRE( std::abs( folded[idx] - expected[idx] ) < 1.0e-4f * ( 1.0f + std::abs( expected[idx] ) ) );
+        }
+    }
+}
+
+TEST_CASE("conv2d_bn_relu_folding", "[conv2d_bn_relu_folding]")
+{
+    auto x = Input( {10, 10, 6} );
+    auto gamma = variable{ random<float>( {8,}, 0.5f, 1.5f ) };
+    auto beta = variable{ random<float>( {8,} ) };
+    auto y = relu( batch_normalization( 0.9f )( Conv2D( 8, {3, 3}, "same" )( x ), gamma, beta ) );
+    auto m = model{ x, y };
+
+    auto const& batch = random<float>( {3, 10, 10, 6} );
+    gather_statistics( m, batch );
+    check_folding( m, batch, 6 ); // conv2d, bias, normalization, gamma, beta, relu
+
+    // the folding is refreshed once the weights are modified
+    beta.data()[0] += 1.0f;
+    check_folding( m, batch, 6 );
+    auto const& expected = m.predict( batch ).deep_copy();
+    gamma.data()[1] *= 2.0f;
+    auto const& refolded = m.predict( batch ).deep_copy();
+    m.unfreeze();
+    auto const& unfolded = m.predict( batch );
+    bool changed = false;
+    for ( auto idx : range( unfolded.size() ) )
+    {
+        REQUIRE( std::abs( refolded[idx] - unfolded[idx] ) < 1.0e-4f * ( 1.0f + std::abs( unfolded[idx] ) ) );
+        changed = changed || refolded[idx] != expected[idx];
+    }
+    REQUIRE( changed );
+
+    // training is not affected by the folding
+    m.freeze();
+    m.predict( batch );
+    auto& s = get_default_session<tensor<float>>();
+    s.bind( x, batch );
+    auto const& trained = s.run( y ).deep_copy();
+    m.unfreeze();
+    s.bind( x, batch );
+    auto const& reference = s.run( y );
+    for ( auto idx : range( reference.size() ) )
+        REQUIRE( trained[idx] == reference[idx] );
+}
+
+TEST_CASE("depthwise_conv2d_bn_leaky_relu_folding", "[depthwise_conv2d_bn_leaky_relu_folding]")
+{
+    auto x = Input( {9, 9, 4} );
+    auto y = leaky_relu( 0.1f )( BatchNormalization( 0.9f )( DepthwiseConv2D( {3, 3}, "same", {2, 2}, {1, 1}, 2 )( x ) ) );
+    auto m = model{ x, y };
+
+    auto const& batch = random<float>( {2, 9, 9, 4} );
+    gather_statistics( m, batch );
+    check_folding( m, batch, 6 );
+}
+
+TEST_CASE("dense_bn_relu_folding", "[dense_bn_relu_folding]")
+{
+    auto x = Input( {20,} );
+    auto y = relu( BatchNormalization( 0.9f )( Dense( 16 )( x ) ) );
+    auto z = Dense( 4, true, 0.0f, 0.0f, 0.0f, 0.0f, "relu" )( y ); // not foldable, the activation is fused already
+    auto m = model{ x, z };
+
+    auto const& batch = random<float>( {32, 20} );
+    gather_statistics( m, batch );
+    check_folding( m, batch, 5 ); // dense, normalization, gamma, beta, relu
+}
+
+TEST_CASE("branched_conv2d_folding", "[branched_conv2d_folding]")
+{
+    // the output of the convolution is read twice, it cannot be folded
+    auto x = Input( {6, 6, 3} );
+    auto w = variable{ random<float>( {4, 3, 3, 3} ) };
+    auto c = general_conv2d( 1, 1, 1, 1, "same" )( x, w );
+    auto y = relu( c ) + c;
+    auto m = model{ x, y };
+
+    auto const& batch = random<float>( {2, 6, 6, 3} );
+    check_folding( m, batch, 0 );
+}
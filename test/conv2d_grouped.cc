@@ -0,0 +1,83 @@
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch.hpp"
+
+#include "../include/ceras.hpp"
+#include <cmath>
+
+using namespace ceras;
+
+namespace
+{
+    struct grouped_case
+    {
+        unsigned long batch, rows, cols, channels, new_channels, groups, kernel, stride, dilation;
+        std::string padding;
+    };
+
+    void check_grouped_conv2d( grouped_case const& c )
+    {
+        unsigned long const group_channels = c.channels / c.groups;
+        unsigned long const group_new_channels = c.new_channels / c.groups;
+        unsigned long const taps = c.kernel * c.kernel;
+        auto const& input = random<double>( {c.batch, c.rows, c.cols, c.channels} );
+        auto const& weights = random<double>( {c.new_channels, c.kernel, c.kernel, group_channels} );
+
+        // the same convolution with dense kernels, zero outside of the groups
+        tensor<double> dense_weights = zeros<double>( {c.new_channels, c.kernel, c.kernel, c.channels} );
+        for ( auto nc : range( c.new_channels ) )
+            for ( auto cg : range( group_channels ) )
+                for ( auto tap : range( taps ) )
+                    dense_weights[(nc*c.channels+(nc/group_new_channels)*group_channels+cg)*taps+tap] = weights[(nc*group_channels+cg)*taps+tap];
+
+        auto x = variable{ input.deep_copy() };
+        auto w = variable{ weights.deep_copy() };
+        auto y = ( c.groups == c.channels && group_channels == 1 ) ? depthwise_conv2d( c.stride, c.stride, c.dilation, c.dilation, c.padding )( x, w )
+                                                                  : grouped_conv2d( c.groups, c.stride, c.stride, c.dilation, c.dilation, c.padding )( x, w );
+
+        auto x_ref = variable{ input.deep_copy() };
+        auto w_ref = variable{ dense_weights };
+        auto y_ref = general_conv2d( c.stride, c.stride, c.dilation, c.dilation, c.padding )( x_ref, w_ref );
+
+        auto& s = get_default_session<tensor<double>>();
+        auto const& expected = s.run( y_ref ).deep_copy();
+        auto const& output = s.run( y ).deep_copy();
+        REQUIRE( output.shape() == expected.shape() );
+        for ( auto idx : range( output.size() ) )
+            REQUIRE( std::abs( output[idx] - expected[idx] ) < 1.0e-10 );
+
+        auto const& grad = random_like( output );
+        y_ref.backward( grad );
+        y.backward( grad );
+        for ( auto idx : range( input.size() ) )
+            REQUIRE( std::abs( x.gradient()[idx] - x_ref.gradient()[idx] ) < 1.0e-10 );
+        for ( auto nc : range( c.new_channels ) )
+            for ( auto cg : range( group_channels ) )
+                for ( auto tap : range( taps ) )
+                    REQUIRE( std::abs( w.gradient()[(nc*group_channels+cg)*taps+tap] - w_ref.gradient()[(nc*c.channels+(nc/group_new_channels)*group_channels+cg)*taps+tap] ) < 1.0e-10 );
+    }
+}
+
+TEST_CASE("depthwise_conv2d", "[depthwise_conv2d]")
+{
+    check_grouped_conv2d( grouped_case{ 2, 9, 9, 24, 24, 24, 3, 1, 1, "same" } );
+    check_grouped_conv2d( grouped_case{ 2, 11, 10, 5, 10, 5, 3, 2, 1, "same" } ); // depth multiplier of 2, strided
+    check_grouped_conv2d( grouped_case{ 1, 12, 12, 7, 7, 7, 5, 1, 2, "valid" } ); // dilated
+}
+
+TEST_CASE("grouped_conv2d", "[grouped_conv2d]")
+{
+    check_grouped_conv2d( grouped_case{ 2, 8, 8, 12, 20, 4, 3, 1, 1, "same" } );
+    check_grouped_conv2d( grouped_case{ 2, 9, 7, 12, 4, 4, 1, 2, 1, "valid" } ); // one output channel per group
+    check_grouped_conv2d( grouped_case{ 1, 10, 10, 6, 9, 3, 3, 2, 1, "valid" } );
+    check_grouped_conv2d( grouped_case{ 2, 9, 9, 32, 48, 2, 3, 1, 2, "same" } ); // wide groups, as implicit GEMMs
+}
+
+TEST_CASE("grouped_conv2d_layers", "[grouped_conv2d_layers]")
+{
+    auto x = variable{ random<float>( {2, 8, 8, 16} ) };
+    auto y = DepthwiseConv2D( {3, 3}, "same", {1, 1}, {1, 1}, 2 )( x );
+    auto z = GroupedConv2D( 8, {3, 3}, 4, "valid" )( y );
+    auto& s = get_default_session<tensor<float>>();
+    REQUIRE( s.run( y ).shape() == std::vector<unsigned long>{ {2, 8, 8, 32} } );
+    REQUIRE( s.run( z ).shape() == std::vector<unsigned long>{ {2, 6, 6, 8} } );
+}
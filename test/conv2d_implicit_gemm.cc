@@ -0,0 +1,40 @@
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch.hpp"
+
+#include "../include/ceras.hpp"
+#include "./conv2d_reference.hpp"
+#include <cmath>
+
+using namespace ceras;
+using namespace conv2d_reference;
+
+TEST_CASE("implicit_gemm_kernels", "[implicit_gemm_kernels]")
+{
+    check_conv2d( conv2d_case{ 2, 9, 9, 3, 6, 5, 5, 1, 1, "same" } );
+    check_conv2d( conv2d_case{ 1, 12, 10, 4, 5, 7, 7, 2, 1, "valid" } );
+    check_conv2d( conv2d_case{ 2, 8, 11, 3, 7, 1, 5, 1, 1, "same" } ); // not square
+    check_conv2d( conv2d_case{ 2, 11, 11, 2, 4, 3, 3, 1, 2, "valid" } ); // dilated
+    check_conv2d( conv2d_case{ 1, 13, 13, 5, 3, 3, 3, 3, 1, "valid" } ); // stride wider than the kernel
+    check_conv2d( conv2d_case{ 2, 12, 11, 3, 4, 5, 5, 2, 2, "same" } ); // padded, strided and dilated, most patches crossing the borders
+}
+
+TEST_CASE("implicit_gemm_blocks", "[implicit_gemm_blocks]")
+{
+    // more output pixels, kernel elements and channels than the cache blocks of the packed GEMM
+    check_conv2d( conv2d_case{ 3, 14, 14, 12, 100, 5, 5, 1, 1, "same" } );
+}
+
+TEST_CASE("implicit_gemm_float", "[implicit_gemm_float]")
+{
+    auto const& input = random<float>( {2, 10, 10, 8} );
+    auto const& weights = random<float>( {16, 5, 5, 8}, -0.2f, 0.2f );
+    auto x = variable{ input };
+    auto w = variable{ weights };
+    auto y = general_conv2d( 1, 1, 1, 1, "same" )( x, w );
+    auto y_ref = reference_conv2d( x, w, conv2d_case{ 2, 10, 10, 8, 16, 5, 5, 1, 1, "same" } );
+    auto& s = get_default_session<tensor<float>>();
+    auto const& expected = s.run( y_ref ).deep_copy();
+    auto const& output = s.run( y ).deep_copy();
+    for ( auto idx : range( output.size() ) )
+        REQUIRE( std::abs( output[idx] - expected[idx] ) < 1.0e-4f * ( 1.0f + std::abs( expected[idx] ) ) );
+}
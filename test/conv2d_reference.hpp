@@ -0,0 +1,73 @@
+#ifndef CONV2DREFERENCEHPPKXWQZMRTVNLJYOBEUADGCFIHSPKXWQZMRTVNLJYOBEUADGCFIHSPKXWQZ
+#define CONV2DREFERENCEHPPKXWQZMRTVNLJYOBEUADGCFIHSPKXWQZMRTVNLJYOBEUADGCFIHSPKXWQZ
+
+//
+// The convolution as composed before the convolution algorithms: img2col, multiply, transpose and reshape.
+// Shared by the tests of the algorithms, `conv2d_direct.cc`, `conv2d_implicit_gemm.cc` and `conv2d_winograd.cc`.
+//
+
+#include "../include/ceras.hpp"
+#include <cmath>
+
+namespace conv2d_reference
+{
+    using namespace ceras;
+
+    struct conv2d_case
+    {
+        unsigned long batch, rows, cols, channels, new_channels, kernel_rows, kernel_cols, stride, dilation;
+        std::string padding;
+    };
+
+    inline unsigned long same_padding( unsigned long kernel, unsigned long stride, unsigned long dilation )
+    {
+        return ( (kernel&1) + ( kernel + (kernel-1)*(dilation-1) - stride ) ) >> 1;
+    }
+
+    template< Expression Ex, Expression Ey >
+    auto reference_conv2d( Ex const& x, Ey const& kernel, conv2d_case const& c )
+    {
+        bool const same = c.padding == "same";
+        unsigned long const row_padding = same ? same_padding( c.kernel_rows, c.stride, c.dilation ) : 0;
+        unsigned long const col_padding = same ? same_padding( c.kernel_cols, c.stride, c.dilation ) : 0;
+        unsigned long const output_rows = ( c.rows + 2 * row_padding - ( c.dilation * (c.kernel_rows - 1) + 1 ) ) / c.stride + 1;
+        unsigned long const output_cols = ( c.cols + 2 * col_padding - ( c.dilation * (c.kernel_cols - 1) + 1 ) ) / c.stride + 1;
+        auto columns = img2col( c.kernel_rows, c.kernel_cols, row_padding, col_padding, c.stride, c.stride, c.dilation, c.dilation )( x );
+        auto flatten_kernel = reshape( {c.kernel_rows*c.kernel_cols*c.channels,} )( kernel );
+        return reshape( {output_rows, output_cols, c.new_channels} )( transpose( flatten_kernel * columns ) );
+    }
+
+    // general_conv2d against the reference, the output and the gradients of the input and of the kernel
+    inline void check_conv2d( conv2d_case const& c )
+    {
+        auto const& input = random<double>( {c.batch, c.rows, c.cols, c.channels} );
+        auto const& weights = random<double>( {c.new_channels, c.kernel_rows, c.kernel_cols, c.channels} );
+
+        auto x = variable{ input.deep_copy() };
+        auto w = variable{ weights.deep_copy() };
+        auto y = general_conv2d( c.stride, c.stride, c.dilation, c.dilation, c.padding )( x, w );
+
+        auto x_ref = variable{ input.deep_copy() };
+        auto w_ref = variable{ weights.deep_copy() };
+        auto y_ref = reference_conv2d( x_ref, w_ref, c );
+
+        auto& s = get_default_session<tensor<double>>();
+        auto const& expected = s.run( y_ref ).deep_copy();
+        auto const& output = s.run( y ).deep_copy();
+        REQUIRE( output.shape() == expected.shape() );
+        REQUIRE( y.shape() == expected.shape() );
+        for ( auto idx : range( output.size() ) )
+            REQUIRE( std::abs( output[idx] - expected[idx] ) < 1.0e-10 );
+
+        auto const& grad = random_like( output );
+        y_ref.backward( grad );
+        y.backward( grad );
+        for ( auto idx : range( input.size() ) )
+            REQUIRE( std::abs( x.gradient()[idx] - x_ref.gradient()[idx] ) < 1.0e-10 );
+        for ( auto idx : range( weights.size() ) )
+            REQUIRE( std::abs( w.gradient()[idx] - w_ref.gradient()[idx] ) < 1.0e-10 );
+    }
+
+}//namespace conv2d_reference
+
+#endif//CONV2DREFERENCEHPPKXWQZMRTVNLJYOBEUADGCFIHSPKXWQZMRTVNLJYOBEUADGCFIHSPKXWQZ
@@ -0,0 +1,98 @@
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch.hpp"
+
+#include "../include/ceras.hpp"
+#include <cmath>
+
+using namespace ceras;
+
+namespace
+{
+    struct transpose_case
+    {
+        unsigned long batch, rows, cols, channels, new_channels, kernel, stride, dilation;
+        std::string padding;
+        unsigned long new_rows, new_cols;
+    };
+
+    void check_conv2d_transpose( transpose_case const& c )
+    {
+        unsigned long const taps = c.kernel * c.kernel;
+        auto const& input = random<double>( {c.batch, c.rows, c.cols, c.channels}, -1.0, 1.0 );
+        auto const& weights = random<double>( {c.new_channels, c.kernel, c.kernel, c.channels}, -1.0, 1.0 );
+
+        auto x = variable{ input.deep_copy() };
+        auto w = variable{ weights.deep_copy() };
+        auto y = conv2d_transpose( c.kernel, c.kernel, c.stride, c.stride, c.dilation, c.dilation, c.padding )( x, w );
+        REQUIRE( y.shape() == std::vector<unsigned long>{ {c.batch, c.new_rows, c.new_cols, c.new_channels} } );
+
+        auto& s = get_default_session<tensor<double>>();
+        auto const& output = s.run( y ).deep_copy();
+        REQUIRE( output.shape() == std::vector<unsigned long>{ {c.batch, c.new_rows, c.new_cols, c.new_channels} } );
+
+        // the naive scatter, and its gradients
+        long const dilated = static_cast<long>( c.dilation * ( c.kernel - 1 ) + 1 );
+        long const stride = static_cast<long>( c.stride );
+        long const padding = c.padding == "same" ? std::max( dilated - stride, 0L ) / 2 : 0L;
+        auto const& grad = random_like( output, -1.0, 1.0 );
+        tensor<double> expected = zeros_like( output );
+        tensor<double> x_grad = zeros_like( input );
+        tensor<double> w_grad = zeros_like( weights );
+        for ( auto b : range( c.batch ) )
+            for ( auto iy : range( c.rows ) )
+                for ( auto ix : range( c.cols ) )
+                    for ( auto u : range( c.kernel ) )
+                        for ( auto v : range( c.kernel ) )
+                        {
+                            long const oy = static_cast<long>( iy * c.stride + u * c.dilation ) - padding;
+                            long const ox = static_cast<long>( ix * c.stride + v * c.dilation ) - padding;
+                            if ( oy < 0 || ox < 0 || oy >= static_cast<long>( c.new_rows ) || ox >= static_cast<long>( c.new_cols ) )
+                                continue;
+                            for ( auto nc : range( c.new_channels ) )
+                                for ( auto ch : range( c.channels ) )
+                                {
+                                    unsigned long const o = ( ( b * c.new_rows + oy ) * c.new_cols + ox ) * c.new_channels + nc;
+                                    unsigned long const i = ( ( b * c.rows + iy ) * c.cols + ix ) * c.channels + ch;
+                                    unsigned long const k = ( nc * c.channels + ch ) * taps + u * c.kernel + v;
+                                    expected[o] += input[i] * weights[k];
+                                    x_grad[i] += grad[o] * weights[k];
+                                    w_grad[k] += grad[o] * input[i];
+                                }
+                        }
+
+        for ( auto idx : range( output.size() ) )
+            REQUIRE( std::abs( output[idx] - expected[idx] ) < 1.0e-10 );
+
+        y.backward( grad );
+        for ( auto idx : range( input.size() ) )
+            REQUIRE( std::abs( x.gradient()[idx] - x_grad[idx] ) < 1.0e-10 );
+        for ( auto idx : range( weights.size() ) )
+            REQUIRE( std::abs( w.gradient()[idx] - w_grad[idx] ) < 1.0e-10 );
+    }
+}
+
+TEST_CASE("conv2d_transpose_valid", "[conv2d_transpose_valid]")
+{
+    check_conv2d_transpose( transpose_case{ 2, 5, 4, 3, 4, 3, 1, 1, "valid", 7, 6 } );
+    check_conv2d_transpose( transpose_case{ 2, 5, 4, 3, 4, 3, 2, 1, "valid", 11, 9 } );
+    check_conv2d_transpose( transpose_case{ 1, 4, 4, 5, 2, 2, 2, 1, "valid", 8, 8 } ); // no overlap
+    check_conv2d_transpose( transpose_case{ 1, 4, 3, 2, 3, 3, 2, 2, "valid", 11, 9 } ); // dilated
+}
+
+TEST_CASE("conv2d_transpose_same", "[conv2d_transpose_same]")
+{
+    check_conv2d_transpose( transpose_case{ 2, 5, 5, 3, 4, 3, 1, 1, "same", 5, 5 } );
+    check_conv2d_transpose( transpose_case{ 2, 4, 5, 6, 5, 3, 2, 1, "same", 8, 10 } ); // odd cropping
+    check_conv2d_transpose( transpose_case{ 2, 4, 4, 3, 8, 4, 2, 1, "same", 8, 8 } );
+    check_conv2d_transpose( transpose_case{ 1, 3, 3, 2, 2, 5, 3, 1, "same", 9, 9 } );
+}
+
+TEST_CASE("conv2d_transpose_layer", "[conv2d_transpose_layer]")
+{
+    auto x = Input( {7, 7, 16} );
+    auto y = Conv2DTranspose( 8, {3, 3}, "same", {2, 2} )( x );
+    REQUIRE( *(y.shape().rbegin()) == 8 );
+    auto m = model{ x, y };
+    auto const& prediction = m.predict( random<float>( {2, 7, 7, 16} ) );
+    REQUIRE( prediction.shape() == std::vector<unsigned long>{ {2, 14, 14, 8} } );
+}
@@ -0,0 +1,105 @@
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch.hpp"
+
+#include "../include/ceras.hpp"
+#include <cmath>
+
+using namespace ceras;
+
+namespace
+{
+    struct window_case
+    {
+        unsigned long batch, rows, cols, channels, new_channels, groups, kernel, stride;
+        std::string padding;
+        long top, bottom, left, right; // zero padding if positive, cropping if negative
+    };
+
+    void check_conv2d_window( window_case const& c )
+    {
+        unsigned long const new_rows = static_cast<unsigned long>( static_cast<long>( c.rows ) + c.top + c.bottom );
+        unsigned long const new_cols = static_cast<unsigned long>( static_cast<long>( c.cols ) + c.left + c.right );
+        auto const& input = random<double>( {c.batch, c.rows, c.cols, c.channels}, -1.0, 1.0 );
+        auto const& weights = random<double>( {c.new_channels, c.kernel, c.kernel, c.channels / c.groups}, -1.0, 1.0 );
+
+        // the padded or cropped input, materialized
+        tensor<double> windowed = zeros<double>( {c.batch, new_rows, new_cols, c.channels} );
+        auto const& source_offset = [&]( unsigned long b, unsigned long r, unsigned long col ) -> long
+        {
+            long const sr = static_cast<long>( r ) - c.top;
+            long const sc = static_cast<long>( col ) - c.left;
+            if ( sr < 0 || sc < 0 || sr >= static_cast<long>( c.rows ) || sc >= static_cast<long>( c.cols ) )
+                return -1;
+            return ( ( static_cast<long>( b * c.rows ) + sr ) * static_cast<long>( c.cols ) + sc ) * static_cast<long>( c.channels );
+        };
+        for ( auto b : range( c.batch ) )
+            for ( auto r : range( new_rows ) )
+                for ( auto col : range( new_cols ) )
+                    if ( long const offset = source_offset( b, r, col ); offset >= 0 )
+                        for ( auto ch : range( c.channels ) )
+                            windowed[((b*new_rows+r)*new_cols+col)*c.channels+ch] = input[offset+ch];
+
+        auto x = variable{ input.deep_copy() };
+        auto w = variable{ weights.deep_copy() };
+        std::vector<unsigned long> const window{ static_cast<unsigned long>( std::abs( c.top ) ), static_cast<unsigned long>( std::abs( c.bottom ) ),
+                                                 static_cast<unsigned long>( std::abs( c.left ) ), static_cast<unsigned long>( std::abs( c.right ) ) };
+        auto conv = grouped_conv2d( c.groups, c.stride, c.stride, 1, 1, c.padding );
+        auto y = c.top > 0 ? conv( zero_padding_2d( window )( x ), w ) : conv( cropping_2d( window )( x ), w );
+
+        auto x_ref = variable{ windowed };
+        auto w_ref = variable{ weights.deep_copy() };
+        auto y_ref = grouped_conv2d( c.groups, c.stride, c.stride, 1, 1, c.padding )( x_ref, w_ref );
+        REQUIRE( y.shape() == y_ref.shape() );
+
+        auto& s = get_default_session<tensor<double>>();
+        auto const& expected = s.run( y_ref ).deep_copy();
+        auto const& output = s.run( y ).deep_copy();
+        REQUIRE( output.shape() == expected.shape() );
+        for ( auto idx : range( output.size() ) )
+            REQUIRE( std::abs( output[idx] - expected[idx] ) < 1.0e-10 );
+
+        auto const& grad = random_like( output, -1.0, 1.0 );
+        y_ref.backward( grad );
+        y.backward( grad );
+        tensor<double> x_grad = zeros_like( input );
+        for ( auto b : range( c.batch ) )
+            for ( auto r : range( new_rows ) )
+                for ( auto col : range( new_cols ) )
+                    if ( long const offset = source_offset( b, r, col ); offset >= 0 )
+                        for ( auto ch : range( c.channels ) )
+                            x_grad[offset+ch] = x_ref.gradient()[((b*new_rows+r)*new_cols+col)*c.channels+ch];
+        for ( auto idx : range( input.size() ) )
+            REQUIRE( std::abs( x.gradient()[idx] - x_grad[idx] ) < 1.0e-10 );
+        for ( auto idx : range( weights.size() ) )
+            REQUIRE( std::abs( w.gradient()[idx] - w_ref.gradient()[idx] ) < 1.0e-10 );
+    }
+}
+
+TEST_CASE("conv2d_symmetric_padding", "[conv2d_symmetric_padding]")
+{
+    check_conv2d_window( window_case{ 2, 7, 6, 3, 4, 1, 3, 1, "valid", 1, 1, 1, 1 } ); // direct
+    check_conv2d_window( window_case{ 2, 7, 6, 3, 4, 1, 3, 2, "same", 2, 2, 1, 1 } );
+    check_conv2d_window( window_case{ 1, 8, 8, 32, 32, 1, 3, 1, "same", 1, 1, 1, 1 } ); // winograd
+    check_conv2d_window( window_case{ 2, 6, 5, 3, 4, 1, 5, 1, "valid", 2, 2, 2, 2 } ); // implicit gemm
+    check_conv2d_window( window_case{ 2, 5, 5, 3, 4, 1, 1, 1, "valid", 1, 1, 2, 2 } ); // 1x1 kernel
+    check_conv2d_window( window_case{ 2, 6, 6, 4, 8, 4, 3, 1, "valid", 1, 1, 1, 1 } ); // depthwise
+}
+
+TEST_CASE("conv2d_asymmetric_padding", "[conv2d_asymmetric_padding]")
+{
+    check_conv2d_window( window_case{ 2, 7, 6, 3, 4, 1, 3, 1, "valid", 1, 2, 1, 3 } );
+    check_conv2d_window( window_case{ 2, 7, 6, 3, 4, 1, 3, 2, "same", 2, 1, 1, 2 } );
+    check_conv2d_window( window_case{ 1, 8, 8, 32, 32, 1, 3, 1, "same", 1, 2, 2, 1 } );
+    check_conv2d_window( window_case{ 2, 6, 5, 3, 4, 1, 5, 1, "valid", 3, 1, 1, 2 } );
+    check_conv2d_window( window_case{ 2, 5, 5, 3, 4, 1, 1, 1, "valid", 1, 2, 2, 1 } );
+    check_conv2d_window( window_case{ 2, 6, 6, 4, 8, 2, 3, 1, "same", 1, 2, 1, 2 } ); // grouped
+}
+
+TEST_CASE("conv2d_cropping", "[conv2d_cropping]")
+{
+    check_conv2d_window( window_case{ 2, 9, 8, 3, 4, 1, 3, 1, "valid", -1, -1, -1, -1 } );
+    check_conv2d_window( window_case{ 2, 9, 8, 3, 4, 1, 3, 2, "same", -2, -1, -1, -2 } );
+    check_conv2d_window( window_case{ 1, 10, 10, 32, 32, 1, 3, 1, "same", -1, -1, -1, -1 } );
+    check_conv2d_window( window_case{ 2, 9, 8, 3, 4, 1, 1, 1, "valid", -1, -2, -2, -1 } );
+    check_conv2d_window( window_case{ 2, 8, 8, 4, 8, 4, 3, 1, "valid", -1, -2, -1, -1 } );
+}
@@ -0,0 +1,97 @@
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch.hpp"
+
+#include "../include/ceras.hpp"
+#include "./conv2d_reference.hpp"
+#include <cmath>
+
+using namespace ceras;
+using namespace conv2d_reference;
+
+namespace
+{
+    template< typename T >
+    void check_winograd( unsigned long batch, unsigned long rows, unsigned long cols, unsigned long channels, unsigned long new_channels, std::string const& padding, T tolerance )
+    {
+        auto const& input = random<T>( {batch, rows, cols, channels} );
+        auto const& weights = random<T>( {new_channels, 3, 3, channels}, T{-0.5}, T{0.5} );
+
+        auto x = variable{ input.deep_copy() };
+        auto w = variable{ weights.deep_copy() };
+        auto y = general_conv2d( 1, 1, 1, 1, padding )( x, w );
+
+        auto x_ref = variable{ input.deep_copy() };
+        auto w_ref = variable{ weights.deep_copy() };
+        auto y_ref = reference_conv2d( x_ref, w_ref, conv2d_case{ batch, rows, cols, channels, new_channels, 3, 3, 1, 1, padding } );
+
+        auto& s = get_default_session<tensor<T>>();
+        auto const& expected = s.run( y_ref ).deep_copy();
+        auto const& output = s.run( y ).deep_copy();
+        REQUIRE( output.shape() == expected.shape() );
+        for ( auto idx : range( output.size() ) )
+            REQUIRE( std::abs( output[idx] - expected[idx] ) < tolerance * ( 1 + std::abs( expected[idx] ) ) );
+
+        auto const& grad = random_like( output );
+        y_ref.backward( grad );
+        y.backward( grad );
+        for ( auto idx : range( input.size() ) )
+            REQUIRE( std::abs( x.gradient()[idx] - x_ref.gradient()[idx] ) < tolerance * ( 1 + std::abs( x_ref.gradient()[idx] ) ) );
+        for ( auto idx : range( weights.size() ) )
+            REQUIRE( std::abs( w.gradient()[idx] - w_ref.gradient()[idx] ) < tolerance * ( 1 + std::abs( w_ref.gradient()[idx] ) ) );
+    }
+}
+
+TEST_CASE("winograd_2x2", "[winograd_2x2]")
+{
+    // outputs smaller than 8 pixels, odd sizes leaving partial tiles
+    check_winograd<double>( 2, 6, 7, 32, 40, "same", 1.0e-10 );
+    check_winograd<double>( 1, 7, 9, 33, 32, "valid", 1.0e-10 );
+    check_winograd<float>( 2, 5, 5, 64, 32, "same", 1.0e-3f );
+}
+
+TEST_CASE("winograd_4x4", "[winograd_4x4]")
+{
+    check_winograd<double>( 2, 16, 16, 32, 48, "same", 1.0e-10 );
+    check_winograd<double>( 1, 13, 11, 70, 33, "valid", 1.0e-10 );
+    check_winograd<float>( 2, 12, 12, 64, 64, "same", 1.0e-3f );
+}
+
+TEST_CASE("winograd_filter_transform_cache", "[winograd_filter_transform_cache]")
+{
+    // in inference, the filter transform is reused until the weights change
+    auto x = variable{ random<double>( {1, 10, 10, 32} ) };
+    auto w = variable{ random<double>( {32, 3, 3, 32} ) };
+    auto y = general_conv2d( 1, 1, 1, 1, "same" )( x, w );
+    auto y_ref = reference_conv2d( x, w, conv2d_case{ 1, 10, 10, 32, 32, 3, 3, 1, 1, "same" } );
+    auto& s = get_default_session<tensor<double>>();
+
+    learning_phase = 0;
+    for ( auto step : range( 3 ) )
+    {
+        if ( step == 2 )
+            for ( auto& v : w.data() )
+                v *= -2.0;
+        auto const& output = s.run( y ).deep_copy();
+        auto const& expected = s.run( y_ref ).deep_copy();
+        for ( auto idx : range( output.size() ) )
+            REQUIRE( std::abs( output[idx] - expected[idx] ) < 1.0e-10 * ( 1 + std::abs( expected[idx] ) ) );
+    }
+
+    // a kernel which is not a variable may change in place without bumping the generation, and is transformed on every run
+    auto k = place_holder<tensor<double>>{};
+    auto kernel = random<double>( {32, 3, 3, 32} );
+    s.bind( k, kernel );
+    auto z = general_conv2d( 1, 1, 1, 1, "same" )( x, k );
+    auto z_ref = reference_conv2d( x, k, conv2d_case{ 1, 10, 10, 32, 32, 3, 3, 1, 1, "same" } );
+    for ( auto step : range( 3 ) )
+    {
+        if ( step == 2 )
+            for ( auto& v : kernel )
+                v *= -2.0;
+        auto const& output = s.run( z ).deep_copy();
+        auto const& expected = s.run( z_ref ).deep_copy();
+        for ( auto idx : range( output.size() ) )
+            REQUIRE( std::abs( output[idx] - expected[idx] ) < 1.0e-10 * ( 1 + std::abs( expected[idx] ) ) );
+    }
+    learning_phase = 1;
+}
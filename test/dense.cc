@@ -0,0 +1,66 @@
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch.hpp"
+
+#include "../include/ceras.hpp"
+#include <cmath>
+
+using namespace ceras;
+
+// fused `dense( activation )( x, w, b )` against `activation( x * w + b )`, expecting identical results
+template< typename Activation >
+void check_dense( unsigned long batch, unsigned long input_size, unsigned long output_size, std::string const& name, Activation const& activation )
+{
+    auto x = variable{ random<float>( {batch, input_size} ) };
+    auto w = variable{ random<float>( {input_size, output_size} ) };
+    auto b = variable{ random<float>( {1, output_size} ) };
+
+    auto fused = dense( name )( x, w, b );
+    auto unfused = activation( x * w + b );
+
+    auto& s = get_default_session<tensor<float>>();
+    auto const& fused_output = s.run( fused ).deep_copy();
+    auto const& unfused_output = s.run( unfused ).deep_copy();
+    REQUIRE( fused_output.shape() == unfused_output.shape() );
+    for ( auto idx : range( fused_output.size() ) )
+        REQUIRE( fused_output[idx] == unfused_output[idx] );
+
+    auto const& grad = random_like( fused_output );
+
+    s.run( fused );
+    fused.backward( grad );
+    auto const& x_grad = x.gradient().deep_copy();
+    auto const& w_grad = w.gradient().deep_copy();
+    auto const& b_grad = b.gradient().deep_copy();
+
+    s.run( unfused ); // resets the gradients of the variables
+    unfused.backward( grad );
+    for ( auto idx : range( x_grad.size() ) )
+        REQUIRE( x_grad[idx] == x.gradient()[idx] );
+    for ( auto idx : range( w_grad.size() ) )
+        REQUIRE( w_grad[idx] == w.gradient()[idx] );
+    for ( auto idx : range( b_grad.size() ) )
+        REQUIRE( b_grad[idx] == b.gradient()[idx] );
+}
+
+TEST_CASE("dense", "[dense]")
+{
+    for ( auto [batch, input_size, output_size] : { std::make_tuple( 1UL, 1UL, 1UL ), std::make_tuple( 7UL, 13UL, 5UL ), std::make_tuple( 32UL, 100UL, 130UL ), std::make_tuple( 67UL, 257UL, 33UL ) } )
+    {
+        check_dense( batch, input_size, output_size, "linear", []( auto const& ex ){ return ex; } );
+        check_dense( batch, input_size, output_size, "relu", []( auto const& ex ){ return relu( ex ); } );
+        check_dense( batch, input_size, output_size, "leaky_relu", []( auto const& ex ){ return leaky_relu( 0.2f )( ex ); } );
+        check_dense( batch, input_size, output_size, "sigmoid", []( auto const& ex ){ return sigmoid( ex ); } );
+        check_dense( batch, input_size, output_size, "tanh", []( auto const& ex ){ return tanh( ex ); } );
+    }
+}
+
+TEST_CASE("dense_layer", "[dense_layer]")
+{
+    auto x = Input( {12,} );
+    auto y = Dense( 8, true, 0.0f, 0.0f, 0.0f, 0.0f, "relu" )( x );
+    auto z = Dense( 3 )( y );
+    auto m = model{ x, z };
+    auto const& prediction = m.predict( random<float>( {5, 12} ) );
+    REQUIRE( prediction.shape() == std::vector<unsigned long>{ {5, 3} } );
+}
+
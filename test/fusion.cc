@@ -0,0 +1,154 @@
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch.hpp"
+
+#include "../include/ceras.hpp"
+#include <cmath>
+
+using namespace ceras;
+
+namespace
+{
+    void require_close( tensor<double> const& lhs, tensor<double> const& rhs, double const tolerance=1.0e-10 )
+    {
+        REQUIRE( lhs.shape() == rhs.shape() );
+        for ( auto idx : range( lhs.size() ) )
+            REQUIRE( std::abs( lhs[idx] - rhs[idx] ) < tolerance );
+    }
+
+    // the fused y against the chain of operators y_ref, in value and in the gradients of the variables
+    template< Expression Ex, Expression Ey, Variable... Va >
+    void check_against_chain( Ex& y, Ey& y_ref, std::pair<Va&, Va&>... variables )
+    {
+        auto& s = get_default_session<tensor<double>>();
+        auto const& expected = s.run( y_ref ).deep_copy();
+        auto const& output = s.run( y ).deep_copy();
+        require_close( output, expected );
+
+        auto const& grad = random_like( expected, -1.0, 1.0 );
+        y_ref.backward( grad );
+        y.backward( grad );
+        ( require_close( variables.first.gradient(), variables.second.gradient() ), ... );
+    }
+}
+
+TEST_CASE("fusion_dual", "[fusion_dual]")
+{
+    using fusion::dual;
+    auto const& f = []( auto x, auto y ){ return sigmoid( x * y ) + exp( -square( x ) ) / y - log( 2.0 + sin( y ) ) * 3.0; };
+    dual<double, 2> const x{ 0.7, {1.0, 0.0} };
+    dual<double, 2> const y{ -1.3, {0.0, 1.0} };
+    auto const& z = f( x, y );
+    REQUIRE( f( dual<double, 0>{ 0.7, {} }, dual<double, 0>{ -1.3, {} } ).primal == z.primal );
+
+    // against central differences
+    double const h = 1.0e-6;
+    auto const& evaluate = [&]( double a, double b ){ return f( dual<double, 0>{ a, {} }, dual<double, 0>{ b, {} } ).primal; };
+    REQUIRE( std::abs( z.derivative[0] - ( evaluate( 0.7+h, -1.3 ) - evaluate( 0.7-h, -1.3 ) ) / (h+h) ) < 1.0e-6 );
+    REQUIRE( std::abs( z.derivative[1] - ( evaluate( 0.7, -1.3+h ) - evaluate( 0.7, -1.3-h ) ) / (h+h) ) < 1.0e-6 );
+
+    // out of the range of clip, or below the lower side of max, the derivative vanishes
+    REQUIRE( clip( dual<float, 1>{ 3.0f, {1.0f} }, 0.0f, 1.0f ).derivative[0] == 0.0f );
+    REQUIRE( clip( dual<float, 1>{ 0.5f, {1.0f} }, 0.0f, 1.0f ).derivative[0] == 1.0f );
+    REQUIRE( max( 0.0, dual<float, 1>{ -2.0f, {1.0f} } ).primal == 0.0f );
+    REQUIRE( max( 0.0, dual<float, 1>{ -2.0f, {1.0f} } ).derivative[0] == 0.0f );
+}
+
+TEST_CASE("fusion_unary", "[fusion_unary]")
+{
+    auto const& input = random<double>( {7, 11}, -2.0, 2.0 );
+    {
+        auto x = variable{ input.deep_copy() };
+        auto y = gaussian( x );
+        auto x_ref = variable{ input.deep_copy() };
+        auto y_ref = exp( negative( square( x_ref ) ) );
+        check_against_chain( y, y_ref, std::pair<decltype(x)&, decltype(x)&>{ x, x_ref } );
+    }
+    {
+        auto x = variable{ input.deep_copy() };
+        auto y = heaviside_step( 3.0 )( x );
+        auto x_ref = variable{ input.deep_copy() };
+        auto y_ref = sigmoid( value( 6.0 ) * x_ref );
+        check_against_chain( y, y_ref, std::pair<decltype(x)&, decltype(x)&>{ x, x_ref } );
+    }
+    {
+        auto x = variable{ input.deep_copy() };
+        auto y = fuse( []( auto v ){ return tanh( v ) * cos( v ) + sqrt( abs( v ) + 1.0 ); } )( x );
+        auto x_ref = variable{ input.deep_copy() };
+        auto y_ref = elementwise_product( tanh( x_ref ), cos( x_ref ) ) + sqrt( abs( x_ref ) + value( 1.0 ) );
+        check_against_chain( y, y_ref, std::pair<decltype(x)&, decltype(x)&>{ x, x_ref } );
+    }
+}
+
+TEST_CASE("fusion_binary", "[fusion_binary]")
+{
+    auto const& labels = random<double>( {9, 5}, 0.0, 1.0 );
+    auto const& predictions = random<double>( {9, 5}, 0.05, 0.95 );
+    typedef decltype( variable{ labels } ) variable_type;
+    {
+        auto a = variable{ labels.deep_copy() };
+        auto b = variable{ predictions.deep_copy() };
+        auto y = binary_cross_entropy_loss( a, b );
+        auto a_ref = variable{ labels.deep_copy() };
+        auto b_ref = variable{ predictions.deep_copy() };
+        auto y_ref = mean_reduce( negative( hadamard_product( a_ref, log( b_ref ) ) + hadamard_product( ( value{1.0} - a_ref ), log( value{1.0} - b_ref ) ) ) );
+        check_against_chain( y, y_ref, std::pair<variable_type&, variable_type&>{ a, a_ref }, std::pair<variable_type&, variable_type&>{ b, b_ref } );
+    }
+    {
+        auto a = variable{ labels.deep_copy() };
+        auto b = variable{ predictions.deep_copy() };
+        auto y = mean_squared_logarithmic_error( a, b );
+        auto a_ref = variable{ labels.deep_copy() };
+        auto b_ref = variable{ predictions.deep_copy() };
+        auto y_ref = sum_reduce( square( minus( log( value{1.0} + clip(eps)(a_ref) ), log( value{1.0} + clip(eps)(b_ref) ) ) ) );
+        check_against_chain( y, y_ref, std::pair<variable_type&, variable_type&>{ a, a_ref }, std::pair<variable_type&, variable_type&>{ b, b_ref } );
+    }
+    {
+        auto a = variable{ labels.deep_copy() };
+        auto b = variable{ predictions.deep_copy() };
+        auto y = hinge_loss( a, b );
+        auto a_ref = variable{ labels.deep_copy() };
+        auto b_ref = variable{ predictions.deep_copy() };
+        auto y_ref = mean_reduce( maximum( value{0.0}, value{1.0} - hadamard_product( a_ref, b_ref ) ) );
+        check_against_chain( y, y_ref, std::pair<variable_type&, variable_type&>{ a, a_ref }, std::pair<variable_type&, variable_type&>{ b, b_ref } );
+    }
+    {
+        auto a = variable{ labels.deep_copy() };
+        auto b = variable{ predictions.deep_copy() };
+        auto y = mean_squared_error( a, b );
+        auto a_ref = variable{ labels.deep_copy() };
+        auto b_ref = variable{ predictions.deep_copy() };
+        auto y_ref = mean_reduce( square( minus( a_ref, b_ref ) ) );
+        check_against_chain( y, y_ref, std::pair<variable_type&, variable_type&>{ a, a_ref }, std::pair<variable_type&, variable_type&>{ b, b_ref } );
+    }
+    {
+        auto a = variable{ labels.deep_copy() };
+        auto b = variable{ predictions.deep_copy() };
+        auto y = abs_loss( a, b );
+        auto a_ref = variable{ labels.deep_copy() };
+        auto b_ref = variable{ predictions.deep_copy() };
+        auto y_ref = sum_reduce( abs( minus( a_ref, b_ref ) ) );
+        check_against_chain( y, y_ref, std::pair<variable_type&, variable_type&>{ a, a_ref }, std::pair<variable_type&, variable_type&>{ b, b_ref } );
+    }
+}
+
+TEST_CASE("fusion_broadcasting", "[fusion_broadcasting]")
+{
+    auto const& input = random<double>( {4, 6}, -1.0, 1.0 );
+    auto const& bias = random<double>( {1, 6}, -1.0, 1.0 );
+    auto x = variable{ input.deep_copy() };
+    auto b = variable{ bias.deep_copy() };
+    auto y = fuse( []( auto v, auto c ){ return tanh( v + c ) * c; }, "TanhBias" )( x, b );
+    REQUIRE( y.shape() == std::vector<unsigned long>{ {4, 6} } );
+
+    auto x_ref = variable{ input.deep_copy() };
+    auto b_ref = variable{ bias.deep_copy() };
+    auto y_ref = elementwise_product( tanh( x_ref + b_ref ), b_ref );
+    check_against_chain( y, y_ref, std::pair<decltype(x)&, decltype(x)&>{ x, x_ref }, std::pair<decltype(b)&, decltype(b)&>{ b, b_ref } );
+
+    // a value operand
+    auto z = fuse( []( auto v, auto c ){ return v * c; } )( x, value{ 2.0 } );
+    auto& s = get_default_session<tensor<double>>();
+    auto const& output = s.run( z );
+    for ( auto idx : range( input.size() ) )
+        REQUIRE( std::abs( output[idx] - 2.0 * input[idx] ) < 1.0e-12 );
+}
@@ -0,0 +1,119 @@
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch.hpp"
+
+#include "../include/ceras.hpp"
+#include <cmath>
+
+using namespace ceras;
+
+// reference alpha * op(A) * op(B) + beta * C, with op(A) [m x n] and op(B) [n x k], C not read if beta is 0
+template< typename T >
+std::vector<T> naive_gemm( T const* A, bool a_transposed, T const* B, bool b_transposed, unsigned long m, unsigned long n, unsigned long k, T const* C, T alpha, T beta )
+{
+    std::vector<T> ans( m*k, T{0} );
+    for ( auto r : range( m ) )
+        for ( auto c : range( k ) )
+        {
+            T product{0};
+            for ( auto idx : range( n ) )
+            {
+                T const a = a_transposed ? A[idx*m+r] : A[r*n+idx];
+                T const b = b_transposed ? B[c*n+idx] : B[idx*k+c];
+                product += a * b;
+            }
+            ans[r*k+c] = ( beta == T{0} ) ? alpha * product : alpha * product + beta * C[r*k+c];
+        }
+    return ans;
+}
+
+TEST_CASE("gemm_alpha_beta", "[gemm_alpha_beta]")
+{
+    // shapes crossing the kc block, so that later blocks accumulate onto the scaled C
+    std::vector<std::array<unsigned long, 3>> const shapes{ {{1, 1, 1}}, {{7, 13, 5}}, {{33, 300, 47}}, {{130, 520, 70}} };
+    for ( auto const& [m, n, k] : shapes )
+        for ( auto [alpha, beta] : { std::make_tuple( 1.0, 0.0 ), std::make_tuple( 1.0, 1.0 ), std::make_tuple( -2.0, 0.5 ), std::make_tuple( 0.5, -1.0 ) } )
+            for ( auto a_transposed : { false, true } )
+                for ( auto b_transposed : { false, true } )
+                {
+                    auto A = random<double>( {m*n,} );
+                    auto B = random<double>( {n*k,} );
+                    auto C = random<double>( {m*k,} );
+                    auto const& ref = naive_gemm( A.data(), a_transposed, B.data(), b_transposed, m, n, k, C.data(), alpha, beta );
+                    gemm( A.data(), a_transposed, B.data(), b_transposed, m, n, k, C.data(), alpha, beta );
+                    for ( auto idx : range( m*k ) )
+                        REQUIRE( std::abs( C[idx] - ref[idx] ) < 1.0e-12 * (n+1) );
+                }
+}
+
+TEST_CASE("gemm_beta_one_bit_identical", "[gemm_beta_one_bit_identical]")
+{
+    // with a single kc block, accumulating into C gives the same bits as adding a temporary product to C
+    unsigned long const m = 37, n = 200, k = 71;
+    auto A = random<float>( {m*n,} );
+    auto B = random<float>( {n*k,} );
+    auto C = random<float>( {m*k,} );
+    auto product = zeros<float>( {m*k,} );
+    gemm( A.data(), false, B.data(), true, m, n, k, product.data() );
+    auto expected = C.deep_copy();
+    for ( auto idx : range( m*k ) )
+        expected[idx] += product[idx];
+    gemm( A.data(), false, B.data(), true, m, n, k, C.data(), 1.0f, 1.0f );
+    for ( auto idx : range( m*k ) )
+        REQUIRE( C[idx] == expected[idx] );
+}
+
+TEST_CASE("gemm_batched_alpha_beta", "[gemm_batched_alpha_beta]")
+{
+    unsigned long const batch = 5, m = 9, n = 17, k = 11;
+    auto A = random<double>( {batch*m*n,} );
+    auto B = random<double>( {n*k,} );
+    auto C = random<double>( {batch*m*k,} );
+    std::vector<double> ref;
+    for ( auto b : range( batch ) )
+    {
+        auto const& r = naive_gemm( A.data() + b*m*n, false, B.data(), false, m, n, k, C.data() + b*m*k, 2.0, 1.0 );
+        ref.insert( ref.end(), r.begin(), r.end() );
+    }
+    gemm_batched( A.data(), false, m*n, B.data(), false, 0UL, batch, m, n, k, C.data(), 2.0, 1.0 );
+    for ( auto idx : range( batch*m*k ) )
+        REQUIRE( std::abs( C[idx] - ref[idx] ) < 1.0e-12 * (n+1) );
+}
+
+TEST_CASE("gradient_accumulated_into_variable", "[gradient_accumulated_into_variable]")
+{
+    // a kernel shared by two products, both of its gradients accumulated into the gradient of the variable
+    unsigned long const batch = 6, input_size = 300, output_size = 7;
+    auto x1 = variable{ random<double>( {batch, input_size} ) };
+    auto x2 = variable{ random<double>( {batch, input_size} ) };
+    auto w = variable{ random<double>( {input_size, output_size} ) };
+    auto v = variable{ random<double>( {input_size, output_size} ), 0.0, 0.01 }; // with l2 regularizer
+    auto y = x1 * w + x2 * w + x1 * v;
+
+    auto& s = get_default_session<tensor<double>>();
+    auto const& output = s.run( y );
+    auto const& grad = random_like( output );
+    y.backward( grad );
+
+    // x1' * grad + x2' * grad
+    auto const& g1 = naive_gemm( x1.data().data(), true, grad.data(), false, input_size, batch, output_size, static_cast<double const*>( nullptr ), 1.0, 0.0 );
+    auto const& g2 = naive_gemm( x2.data().data(), true, grad.data(), false, input_size, batch, output_size, static_cast<double const*>( nullptr ), 1.0, 0.0 );
+    for ( auto idx : range( input_size * output_size ) )
+        REQUIRE( std::abs( w.gradient()[idx] - ( g1[idx] + g2[idx] ) ) < 1.0e-10 );
+
+    // x1' * grad + 2 * l2 * v
+    for ( auto idx : range( input_size * output_size ) )
+        REQUIRE( std::abs( v.gradient()[idx] - ( g1[idx] + 2.0 * 0.01 * v.data()[idx] ) ) < 1.0e-10 );
+
+    // grad * w' + grad * v'
+    auto const& gw = naive_gemm( grad.data(), false, w.data().data(), true, batch, output_size, input_size, static_cast<double const*>( nullptr ), 1.0, 0.0 );
+    auto const& gv = naive_gemm( grad.data(), false, v.data().data(), true, batch, output_size, input_size, static_cast<double const*>( nullptr ), 1.0, 0.0 );
+    for ( auto idx : range( batch * input_size ) )
+        REQUIRE( std::abs( x1.gradient()[idx] - ( gw[idx] + gv[idx] ) ) < 1.0e-10 );
+
+    // a frozen kernel gets no gradient
+    w.trainable( false );
+    auto z = x1 * w;
+    z.backward( random_like( s.run( z ) ) );
+    for ( auto idx : range( input_size * output_size ) )
+        REQUIRE( w.gradient()[idx] == 0.0 );
+}
@@ -0,0 +1,98 @@
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch.hpp"
+
+#include "../include/ceras.hpp"
+#include <cmath>
+
+using namespace ceras;
+
+TEST_CASE("gemm_autotuner_classes", "[gemm_autotuner_classes]")
+{
+    REQUIRE( backend::classify_gemm( 1, 512, 1000 ) == backend::gemm_shape_class::gemv );
+    REQUIRE( backend::classify_gemm( 1000, 512, 4 ) == backend::gemm_shape_class::gemv );
+    REQUIRE( backend::classify_gemm( 32, 288, 100352 ) == backend::gemm_shape_class::tall_skinny );
+    REQUIRE( backend::classify_gemm( 256, 256, 300 ) == backend::gemm_shape_class::square );
+}
+
+TEST_CASE("gemm_autotuner_cache", "[gemm_autotuner_cache]")
+{
+    std::string const file_path = (std::filesystem::temp_directory_path() / "ceras_test_gemm_tuning" / "gemm_tuning.txt").string();
+    std::filesystem::remove( file_path );
+
+    backend::gemm_tuning tuned;
+    {
+        backend::gemm_autotuner<float> tuner{ file_path };
+        tuned = tuner.query( 64, 576, 4096 );
+        REQUIRE( tuned.blocking.mc > 0 );
+        REQUIRE( tuned.blocking.kc > 0 );
+        REQUIRE( tuned.blocking.nc > 0 );
+        REQUIRE( std::filesystem::exists( file_path ) );
+    }
+
+    {
+        // a record of another cpu should be kept
+        std::ofstream ofs{ file_path, std::ios_base::app };
+        ofs << "some other cpu\tfloat32\t2 0 48 128 1024 3\n";
+    }
+
+    {
+        backend::gemm_autotuner<float> tuner{ file_path };
+        tuner.load();
+        REQUIRE( tuner.tunings_.size() == 1 );
+        auto const& loaded = tuner.tunings_[backend::gemm_shape_class::tall_skinny];
+        REQUIRE( loaded.use_cblas == tuned.use_cblas );
+        REQUIRE( loaded.blocking.mc == tuned.blocking.mc );
+        REQUIRE( loaded.blocking.kc == tuned.blocking.kc );
+        REQUIRE( loaded.blocking.nc == tuned.blocking.nc );
+        REQUIRE( loaded.threads == tuned.threads );
+
+        tuner.loaded_ = true;
+        tuner.query( 1, 1024, 1024 ); // tunes and saves the gemv class
+    }
+
+    {
+        std::ifstream ifs{ file_path };
+        std::string content{ std::istreambuf_iterator<char>{ ifs }, std::istreambuf_iterator<char>{} };
+        REQUIRE( content.find( "some other cpu" ) != std::string::npos );
+        REQUIRE( std::count( content.begin(), content.end(), '\n' ) == 3 );
+    }
+
+    std::filesystem::remove_all( std::filesystem::path{ file_path }.parent_path() );
+}
+
+TEST_CASE("gemm_autotuner_in_memory", "[gemm_autotuner_in_memory]")
+{
+    // without a tuning file, the tunings are kept in memory only
+    backend::gemm_autotuner<float> tuner{ std::string{} };
+    auto const& tuned = tuner.query( 64, 576, 4096 );
+    REQUIRE( tuner.tunings_.size() == 1 );
+    REQUIRE( tuner.query( 64, 576, 4096 ).blocking.mc == tuned.blocking.mc );
+
+    // a class being timed by another thread gets the default setting rather than waiting
+    tuner.timing_[static_cast<unsigned long>( backend::gemm_shape_class::square )] = true;
+    auto const& pending = tuner.query( 256, 256, 300 );
+    auto const& expected = backend::default_gemm_tuning<float>();
+    REQUIRE( pending.use_cblas == expected.use_cblas );
+    REQUIRE( pending.blocking.mc == expected.blocking.mc );
+    REQUIRE( pending.blocking.kc == expected.blocking.kc );
+    REQUIRE( pending.threads == expected.threads );
+    REQUIRE( tuner.tunings_.size() == 1 );
+}
+
+TEST_CASE("gemm_autotuner_gemm", "[gemm_autotuner_gemm]")
+{
+    // products large enough to go through the tuned settings
+    unsigned long const m = 300, n = 100, k = 200;
+    auto A = random<double>( {m, n} );
+    auto B = random<double>( {n, k} );
+    auto C = A * B;
+    for ( auto r : range( m ) )
+        for ( auto c : range( k ) )
+        {
+            double ref = 0.0;
+            for ( auto idx : range( n ) )
+                ref += A[r*n+idx] * B[idx*k+c];
+            REQUIRE( std::abs( C[r*k+c] - ref ) < 1.0e-10 );
+        }
+}
+
@@ -0,0 +1,94 @@
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch.hpp"
+
+#include "../include/ceras.hpp"
+#include <cmath>
+
+using namespace ceras;
+
+// reference C = op(A) * op(B), with op(A) [m x n] and op(B) [n x k]
+template< typename T >
+std::vector<T> naive_gemm( T const* A, bool a_transposed, T const* B, bool b_transposed, unsigned long m, unsigned long n, unsigned long k )
+{
+    std::vector<T> ans( m*k, T{0} );
+    for ( auto r : range( m ) )
+        for ( auto c : range( k ) )
+            for ( auto idx : range( n ) )
+            {
+                T const a = a_transposed ? A[idx*m+r] : A[r*n+idx];
+                T const b = b_transposed ? B[c*n+idx] : B[idx*k+c];
+                ans[r*k+c] += a * b;
+            }
+    return ans;
+}
+
+template< typename T >
+void check_gemm_cpu( unsigned long m, unsigned long n, unsigned long k, T tolerance )
+{
+    for ( auto a_transposed : { false, true } )
+        for ( auto b_transposed : { false, true } )
+        {
+            auto A = random<T>( {m*n,} );
+            auto B = random<T>( {n*k,} );
+            auto C = random<T>( {m*k,} ); // previous values must be overwritten
+            gemm_cpu( A.data(), a_transposed, B.data(), b_transposed, m, n, k, C.data() );
+            auto const& ref = naive_gemm( A.data(), a_transposed, B.data(), b_transposed, m, n, k );
+            for ( auto idx : range( m*k ) )
+                REQUIRE( std::abs( C[idx] - ref[idx] ) < tolerance * (n+1) );
+        }
+}
+
+TEST_CASE("gemm_cpu_small", "[gemm_cpu_small]")
+{
+    for ( auto m : range( 1UL, 20UL ) )
+        for ( auto n : range( 1UL, 11UL ) )
+            for ( auto k : range( 1UL, 37UL ) )
+            {
+                check_gemm_cpu<float>( m, n, k, 1.0e-5f );
+                check_gemm_cpu<double>( m, n, k, 1.0e-12 );
+            }
+}
+
+TEST_CASE("gemm_cpu_blocked", "[gemm_cpu_blocked]")
+{
+    // shapes crossing the mc/kc/nc cache blocks and leaving partial register tiles
+    check_gemm_cpu<float>( 197, 301, 67, 1.0e-5f );
+    check_gemm_cpu<float>( 7, 513, 4099, 1.0e-5f );
+    check_gemm_cpu<double>( 101, 517, 2053, 1.0e-12 );
+    check_gemm_cpu<double>( 255, 3, 129, 1.0e-12 );
+}
+
+TEST_CASE("gemm_cpu_custom_blocking", "[gemm_cpu_custom_blocking]")
+{
+    unsigned long const m = 53, n = 71, k = 89;
+    auto A = random<float>( {m*n,} );
+    auto B = random<float>( {n*k,} );
+    auto C = zeros<float>( {m*k,} );
+    backend::packed_gemm( A.data(), n, false, B.data(), k, false, m, n, k, C.data(), k, backend::gemm_blocking{ 12, 16, 32 } );
+    auto const& ref = naive_gemm( A.data(), false, B.data(), false, m, n, k );
+    for ( auto idx : range( m*k ) )
+        REQUIRE( std::abs( C[idx] - ref[idx] ) < 1.0e-4f );
+}
+
+TEST_CASE("gemm_cpu_parallel", "[gemm_cpu_parallel]")
+{
+    // square, tall and skinny outputs, split into different number of tiles
+    std::vector<std::array<unsigned long, 3>> const shapes{ {{128, 64, 128}}, {{1031, 37, 5}}, {{16, 75, 9001}}, {{3, 1024, 3}} };
+    for ( auto const& [m, n, k] : shapes )
+        for ( auto threads : { 1UL, 2UL, 3UL, 7UL, 32UL } )
+        {
+            auto partition = backend::make_gemm_partition<float>( m, n, k, threads, 1 );
+            REQUIRE( partition.row_tiles * partition.col_tiles <= threads );
+            if ( k > 1000 * m )
+                REQUIRE( partition.row_tiles == 1 );
+
+            auto A = random<float>( {m*n,} );
+            auto B = random<float>( {n*k,} );
+            auto C = random<float>( {m*k,} );
+            backend::parallel_packed_gemm( A.data(), n, false, B.data(), k, false, m, n, k, C.data(), k, threads );
+            auto const& ref = naive_gemm( A.data(), false, B.data(), false, m, n, k );
+            for ( auto idx : range( m*k ) )
+                REQUIRE( std::abs( C[idx] - ref[idx] ) < 1.0e-5f * (n+1) );
+        }
+}
+
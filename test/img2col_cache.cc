@@ -0,0 +1,87 @@
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch.hpp"
+
+#include "../include/ceras.hpp"
+#include <cmath>
+
+using namespace ceras;
+
+namespace
+{
+    struct img2col_case
+    {
+        unsigned long kernel_rows, kernel_cols, padding, stride, dilation;
+    };
+
+    // runs the same img2col operator on an input of [batch, rows, cols, channels], checking the columns and the gradient against direct loops
+    template< typename Op >
+    void check_img2col( Op const& op, img2col_case const& c, unsigned long batch, unsigned long rows, unsigned long cols, unsigned long channels )
+    {
+        auto const& input = random<double>( {batch, rows, cols, channels} );
+        auto x = variable{ input.deep_copy() };
+        auto y = op( x );
+
+        auto& s = get_default_session<tensor<double>>();
+        auto const& columns = s.run( y ).deep_copy();
+
+        unsigned long const output_rows = ( rows + 2 * c.padding - ( c.dilation * (c.kernel_rows - 1) + 1 ) ) / c.stride + 1;
+        unsigned long const output_cols = ( cols + 2 * c.padding - ( c.dilation * (c.kernel_cols - 1) + 1 ) ) / c.stride + 1;
+        unsigned long const depth = c.kernel_rows * c.kernel_cols * channels;
+        unsigned long const pixels = batch * output_rows * output_cols;
+        REQUIRE( columns.shape() == std::vector<unsigned long>{ {depth, pixels} } );
+
+        auto const& grad = random_like( columns );
+        y.backward( grad );
+        tensor<double> expected_gradient = zeros_like( input );
+
+        for ( auto ch : range( channels ) )
+            for ( auto kh : range( c.kernel_rows ) )
+                for ( auto kw : range( c.kernel_cols ) )
+                    for ( auto bs : range( batch ) )
+                        for ( auto h : range( output_rows ) )
+                            for ( auto w : range( output_cols ) )
+                            {
+                                unsigned long const row = ( ch * c.kernel_rows + kh ) * c.kernel_cols + kw;
+                                unsigned long const col = ( bs * output_rows + h ) * output_cols + w;
+                                long const r = static_cast<long>( h * c.stride + kh * c.dilation ) - static_cast<long>( c.padding );
+                                long const q = static_cast<long>( w * c.stride + kw * c.dilation ) - static_cast<long>( c.padding );
+                                bool const inside = r >= 0 && r < static_cast<long>(rows) && q >= 0 && q < static_cast<long>(cols);
+                                unsigned long const offset = inside ? ( ( bs * rows + r ) * cols + q ) * channels + ch : 0;
+                                REQUIRE( columns[row*pixels+col] == ( inside ? input[offset] : 0.0 ) );
+                                if ( inside )
+                                    expected_gradient[offset] += grad[row*pixels+col];
+                            }
+
+        // col2im sums the contributions to an input element in the order of the loops above, whatever the number of threads
+        for ( auto idx : range( input.size() ) )
+            REQUIRE( x.gradient()[idx] == expected_gradient[idx] );
+    }
+}
+
+TEST_CASE("img2col_cache_batch_sizes", "[img2col_cache_batch_sizes]")
+{
+    img2col_case const c{ 3, 3, 1, 1, 1 };
+    auto op = img2col( c.kernel_rows, c.kernel_cols, c.padding, c.padding, c.stride, c.stride, c.dilation, c.dilation );
+    // training batches, the shorter last batch and single samples, one after another on the same operator
+    for ( unsigned long batch : { 4UL, 1UL, 3UL, 4UL, 1UL } )
+        check_img2col( op, c, batch, 7, 6, 3 );
+}
+
+TEST_CASE("img2col_cache_shapes", "[img2col_cache_shapes]")
+{
+    img2col_case const c{ 2, 3, 2, 2, 2 };
+    auto op = img2col( c.kernel_rows, c.kernel_cols, c.padding, c.padding, c.stride, c.stride, c.dilation, c.dilation );
+    // more spatial shapes than the cache holds, revisiting the evicted ones
+    std::vector<std::array<unsigned long, 4>> const shapes{ { {2, 9, 9, 2}, {1, 10, 8, 2}, {3, 7, 11, 1}, {2, 12, 12, 3}, {1, 8, 8, 2}, {2, 9, 9, 2}, {1, 10, 8, 2} } };
+    for ( auto const& [batch, rows, cols, channels] : shapes )
+        check_img2col( op, c, batch, rows, cols, channels );
+}
+
+TEST_CASE("col2im_parallel", "[col2im_parallel]")
+{
+    // more (sample, channel) tasks than the cores, overlapping kernel windows
+    img2col_case const c{ 5, 5, 2, 1, 1 };
+    auto op = img2col( c.kernel_rows, c.kernel_cols, c.padding, c.padding, c.stride, c.stride, c.dilation, c.dilation );
+    check_img2col( op, c, 6, 11, 13, 17 );
+    check_img2col( op, c, 1, 11, 13, 17 );
+}
@@ -0,0 +1,187 @@
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch.hpp"
+
+#include "../include/ceras.hpp"
+#include <cmath>
+
+using namespace ceras;
+
+namespace
+{
+    void require_close( tensor<double> const& lhs, tensor<double> const& rhs, double const tolerance=1.0e-10 )
+    {
+        REQUIRE( lhs.shape() == rhs.shape() );
+        for ( auto idx : range( lhs.size() ) )
+            REQUIRE( std::abs( lhs[idx] - rhs[idx] ) < tolerance );
+    }
+
+    // y, in NHWC around a NCHWc operator, against y_ref, and the gradients of x against those of x_ref
+    template< Expression Ex, Expression Ey, Variable Va >
+    void check_against_nhwc( Ex& y, Ey& y_ref, Va& x, Va& x_ref, double const tolerance=1.0e-10 )
+    {
+        auto& s = get_default_session<tensor<double>>();
+        auto const& expected = s.run( y_ref ).deep_copy();
+        auto const& output = s.run( y ).deep_copy();
+        require_close( output, expected, tolerance );
+
+        auto const& grad = random_like( expected, -1.0, 1.0 );
+        y_ref.backward( grad );
+        y.backward( grad );
+        require_close( x.gradient(), x_ref.gradient(), tolerance );
+    }
+
+    struct conv_case
+    {
+        unsigned long block, channels, new_channels, kernel, stride, dilation;
+        std::string padding;
+    };
+
+    void check_nchwc_conv2d( conv_case const& c )
+    {
+        auto const& input = random<double>( {2, 9, 8, c.channels}, -1.0, 1.0 );
+        auto const& weights = random<double>( {c.new_channels, c.kernel, c.kernel, c.channels}, -1.0, 1.0 );
+
+        auto x = variable{ input.deep_copy() };
+        auto w = variable{ weights.deep_copy() };
+        auto y = from_nchwc( c.new_channels )( nchwc_conv2d( c.stride, c.stride, c.dilation, c.dilation, c.padding )( to_nchwc( c.block )( x ), w ) );
+
+        auto x_ref = variable{ input.deep_copy() };
+        auto w_ref = variable{ weights.deep_copy() };
+        auto y_ref = general_conv2d( c.stride, c.stride, c.dilation, c.dilation, c.padding )( x_ref, w_ref );
+        REQUIRE( y.shape() == y_ref.shape() );
+
+        check_against_nhwc( y, y_ref, x, x_ref );
+        require_close( w.gradient(), w_ref.gradient() );
+    }
+}
+
+TEST_CASE("nchwc_layout", "[nchwc_layout]")
+{
+    auto const& input = random<double>( {2, 3, 4, 11}, -1.0, 1.0 );
+    tensor<double> blocked{ {2, 3, 3, 4, 4} };
+    backend::nhwc_to_nchwc( input.data(), 2, 3, 4, 11, 4, blocked.data() );
+    for ( auto b : range( 2UL ) )
+        for ( auto p : range( 12UL ) )
+            for ( auto ch : range( 12UL ) )
+                REQUIRE( blocked[((b*3+ch/4)*12+p)*4+ch%4] == ( ch < 11 ? input[(b*12+p)*11+ch] : 0.0 ) ); // the tail is zeros
+
+    tensor<double> back{ input.shape() };
+    backend::nchwc_to_nhwc( blocked.data(), 2, 3, 4, 11, 4, back.data() );
+    require_close( back, input, 1.0e-15 );
+
+    auto x = variable{ input.deep_copy() };
+    auto y = to_nchwc( 8 )( x );
+    REQUIRE( y.shape() == std::vector<unsigned long>{ {2, 2, 3, 4, 8} } );
+    REQUIRE( from_nchwc( 11 )( y ).shape() == input.shape() );
+}
+
+TEST_CASE("nchwc_conv2d", "[nchwc_conv2d]")
+{
+    check_nchwc_conv2d( conv_case{ 8, 3, 4, 3, 1, 1, "same" } );
+    check_nchwc_conv2d( conv_case{ 8, 8, 16, 3, 1, 1, "valid" } );
+    check_nchwc_conv2d( conv_case{ 16, 19, 21, 3, 2, 1, "same" } );
+    check_nchwc_conv2d( conv_case{ 16, 5, 17, 1, 1, 1, "valid" } );
+    check_nchwc_conv2d( conv_case{ 4, 6, 7, 3, 1, 2, "same" } );
+    check_nchwc_conv2d( conv_case{ 8, 10, 9, 5, 2, 1, "valid" } );
+}
+
+TEST_CASE("nchwc_pooling_2d", "[nchwc_pooling_2d]")
+{
+    auto const& input = random<double>( {2, 9, 8, 11}, -1.0, 1.0 );
+    {
+        auto x = variable{ input.deep_copy() };
+        auto y = from_nchwc( 11 )( max_pooling_2d( 3, 3, 2, 2, "same" )( to_nchwc( 8 )( x ) ) );
+        auto x_ref = variable{ input.deep_copy() };
+        auto y_ref = max_pooling_2d( 3, 3, 2, 2, "same" )( x_ref );
+        check_against_nhwc( y, y_ref, x, x_ref );
+    }
+    {
+        auto x = variable{ input.deep_copy() };
+        auto y = from_nchwc( 11 )( average_pooling_2d( 2 )( to_nchwc( 4 )( x ) ) );
+        auto x_ref = variable{ input.deep_copy() };
+        auto y_ref = average_pooling_2d( 2 )( x_ref );
+        check_against_nhwc( y, y_ref, x, x_ref );
+    }
+}
+
+TEST_CASE("nchwc_normalization_batch", "[nchwc_normalization_batch]")
+{
+    auto const& input = random<double>( {4, 5, 6, 11}, -1.0, 1.0 );
+    auto x = variable{ input.deep_copy() };
+    auto y = from_nchwc( 11 )( nchwc_normalization_batch( 0.9 )( to_nchwc( 8 )( x ) ) );
+    auto x_ref = variable{ input.deep_copy() };
+    auto y_ref = normalization_batch( 0.9 )( x_ref );
+    check_against_nhwc( y, y_ref, x, x_ref, 1.0e-8 );
+
+    // with the running statistics
+    learning_phase = 0;
+    auto& s = get_default_session<tensor<double>>();
+    require_close( s.run( y ).deep_copy(), s.run( y_ref ).deep_copy(), 1.0e-8 );
+    learning_phase = 1;
+
+    // blocked gamma and beta broadcast over the batch and the pixels
+    auto z = nchwc_batch_normalization( 0.9 )( to_nchwc( 8 )( x ), variable{ ones<double>( {2, 1, 1, 8} ) }, variable{ zeros<double>( {2, 1, 1, 8} ) } );
+    REQUIRE( z.shape() == std::vector<unsigned long>{ {4, 2, 5, 6, 8} } );
+    auto z_nhwc = from_nchwc( 11 )( z );
+    require_close( s.run( z_nhwc ).deep_copy(), s.run( y_ref ).deep_copy(), 1.0e-8 );
+}
+
+TEST_CASE("nchwc_layout_propagation", "[nchwc_layout_propagation]")
+{
+    auto x = variable{ random<double>( {2, 8, 8, 3}, -1.0, 1.0 ) };
+    auto w1 = variable{ random<double>( {12, 3, 3, 3}, -1.0, 1.0 ) };
+    auto w2 = variable{ random<double>( {5, 3, 3, 12}, -1.0, 1.0 ) };
+
+    // converting back a tensor just converted, with the same parameters, returns the tensor itself
+    auto& s = get_default_session<tensor<double>>();
+    auto blocked = relu( nchwc_conv2d( 1, 1, 1, 1, "same" )( to_nchwc( 8 )( x ), w1 ) );
+    auto same_blocks = to_nchwc( 8 )( from_nchwc( 12 )( blocked ) );
+    REQUIRE( s.run( same_blocks ).data() == s.run( blocked ).data() );
+    auto same_channels = from_nchwc( 3 )( to_nchwc( 8 )( x ) );
+    REQUIRE( s.run( same_channels ).data() == s.run( x ).data() );
+
+    // two NCHWc layers written with converters around each of them, the data staying blocked in between
+    auto y1 = from_nchwc( 12 )( blocked );
+    auto y2 = from_nchwc( 5 )( max_pooling_2d( 2 )( nchwc_conv2d( 1, 1, 1, 1, "same" )( to_nchwc( 8 )( y1 ), w2 ) ) );
+    auto y_ref = max_pooling_2d( 2 )( general_conv2d( 1, 1, 1, 1, "same" )( relu( general_conv2d( 1, 1, 1, 1, "same" )( x, w1 ) ), w2 ) );
+
+    require_close( s.run( y2 ).deep_copy(), s.run( y_ref ).deep_copy() );
+}
+
+TEST_CASE("nchwc_layout_mismatch", "[nchwc_layout_mismatch]")
+{
+    auto const& data = random<double>( {2, 4, 4, 32}, -1.0, 1.0 );
+    auto x = variable{ data.deep_copy() };
+    auto x_ref = variable{ data.deep_copy() };
+    auto& s = get_default_session<tensor<double>>();
+
+    // blocks of another size are converted again
+    auto reblocked = to_nchwc( 8 )( from_nchwc( 32 )( relu( to_nchwc( 16 )( x ) ) ) );
+    auto reblocked_ref = to_nchwc( 8 )( relu( x_ref ) );
+    REQUIRE( s.run( reblocked ).shape() == std::vector<unsigned long>{ {2, 4, 4, 4, 8} } );
+    check_against_nhwc( reblocked, reblocked_ref, x, x_ref );
+
+    // the channels dropped by `from_nchwc` are not kept in the tail of the blocks
+    auto truncated = to_nchwc( 16 )( from_nchwc( 20 )( relu( to_nchwc( 16 )( x ) ) ) );
+    auto truncated_ref = to_nchwc( 16 )( relu( from_nchwc( 20 )( relu( to_nchwc( 16 )( x_ref ) ) ) ) );
+    check_against_nhwc( truncated, truncated_ref, x, x_ref );
+
+    // fewer channels than the input of `to_nchwc`, the first ones
+    auto narrowed = from_nchwc( 20 )( to_nchwc( 16 )( x ) );
+    auto const& output = s.run( narrowed ).deep_copy();
+    REQUIRE( output.shape() == std::vector<unsigned long>{ {2, 4, 4, 20} } );
+    auto const& grad = random_like( output, -1.0, 1.0 );
+    narrowed.backward( grad );
+    auto const& x_grad = x.gradient();
+    for ( auto p : range( 2*4*4 ) )
+        for ( auto ch : range( 32 ) )
+        {
+            if ( ch < 20 )
+            {
+                REQUIRE( output[p*20+ch] == data[p*32+ch] );
+                REQUIRE( x_grad[p*32+ch] == grad[p*20+ch] );
+            }
+            else
+                REQUIRE( x_grad[p*32+ch] == 0.0 );
+        }
+}
@@ -0,0 +1,122 @@
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch.hpp"
+
+#include "../include/ceras.hpp"
+#include <cmath>
+
+using namespace ceras;
+
+namespace
+{
+    struct pooling_case
+    {
+        unsigned long batch, rows, cols, channels, kernel_rows, kernel_cols, row_stride, col_stride;
+        std::string padding;
+        unsigned long new_rows, new_cols;
+    };
+
+    void check_pooling_2d( pooling_case const& c, bool average )
+    {
+        auto const& input = random<double>( {c.batch, c.rows, c.cols, c.channels}, -1.0, 1.0 );
+        auto x = variable{ input.deep_copy() };
+        auto y = average ? average_pooling_2d( c.kernel_rows, c.kernel_cols, c.row_stride, c.col_stride, c.padding )( x )
+                         : max_pooling_2d( c.kernel_rows, c.kernel_cols, c.row_stride, c.col_stride, c.padding )( x );
+        REQUIRE( y.shape() == std::vector<unsigned long>{ {c.batch, c.new_rows, c.new_cols, c.channels} } );
+
+        auto& s = get_default_session<tensor<double>>();
+        auto const& output = s.run( y ).deep_copy();
+        REQUIRE( output.shape() == std::vector<unsigned long>{ {c.batch, c.new_rows, c.new_cols, c.channels} } );
+
+        // the naive pooling, and its gradient
+        long const row_padding = c.padding == "same" ? std::max( static_cast<long>( ( c.new_rows - 1 ) * c.row_stride + c.kernel_rows ) - static_cast<long>( c.rows ), 0L ) / 2 : 0L;
+        long const col_padding = c.padding == "same" ? std::max( static_cast<long>( ( c.new_cols - 1 ) * c.col_stride + c.kernel_cols ) - static_cast<long>( c.cols ), 0L ) / 2 : 0L;
+        auto const& grad = random_like( output, -1.0, 1.0 );
+        tensor<double> x_grad = zeros_like( input );
+        for ( auto b : range( c.batch ) )
+            for ( auto oy : range( c.new_rows ) )
+                for ( auto ox : range( c.new_cols ) )
+                    for ( auto ch : range( c.channels ) )
+                    {
+                        std::vector<unsigned long> window;
+                        for ( auto u : range( c.kernel_rows ) )
+                            for ( auto v : range( c.kernel_cols ) )
+                            {
+                                long const iy = static_cast<long>( oy * c.row_stride + u ) - row_padding;
+                                long const ix = static_cast<long>( ox * c.col_stride + v ) - col_padding;
+                                if ( iy >= 0 && ix >= 0 && iy < static_cast<long>( c.rows ) && ix < static_cast<long>( c.cols ) )
+                                    window.push_back( ( ( b * c.rows + iy ) * c.cols + ix ) * c.channels + ch );
+                            }
+                        unsigned long const o = ( ( b * c.new_rows + oy ) * c.new_cols + ox ) * c.channels + ch;
+                        if ( average )
+                        {
+                            double expected = 0.0;
+                            for ( auto i : window )
+                            {
+                                expected += input[i] / window.size();
+                                x_grad[i] += grad[o] / window.size();
+                            }
+                            REQUIRE( std::abs( output[o] - expected ) < 1.0e-12 );
+                        }
+                        else
+                        {
+                            unsigned long arg = window[0];
+                            for ( auto i : window )
+                                if ( input[i] > input[arg] )
+                                    arg = i;
+                            REQUIRE( output[o] == input[arg] );
+                            x_grad[arg] += grad[o];
+                        }
+                    }
+
+        y.backward( grad );
+        for ( auto idx : range( input.size() ) )
+            REQUIRE( std::abs( x.gradient()[idx] - x_grad[idx] ) < 1.0e-12 );
+    }
+
+    std::vector<pooling_case> const cases
+    {
+        { 2, 8, 8, 3, 2, 2, 2, 2, "valid", 4, 4 },
+        { 2, 9, 7, 5, 2, 2, 2, 2, "valid", 4, 3 },      // the last row and column are dropped
+        { 2, 9, 9, 4, 3, 3, 2, 2, "valid", 4, 4 },      // overlapping windows
+        { 1, 10, 8, 17, 3, 2, 1, 2, "valid", 8, 4 },
+        { 2, 9, 7, 5, 2, 2, 2, 2, "same", 5, 4 },
+        { 2, 13, 13, 6, 3, 3, 2, 2, "same", 7, 7 },     // overlapping windows, padded on both sides
+        { 1, 6, 6, 3, 3, 3, 1, 1, "same", 6, 6 },
+        { 1, 5, 5, 2, 4, 4, 3, 3, "same", 2, 2 },
+    };
+}
+
+TEST_CASE("max_pooling_2d_engine", "[max_pooling_2d_engine]")
+{
+    for ( auto const& c : cases )
+        check_pooling_2d( c, false );
+}
+
+TEST_CASE("average_pooling_2d_engine", "[average_pooling_2d_engine]")
+{
+    for ( auto const& c : cases )
+        check_pooling_2d( c, true );
+}
+
+TEST_CASE("max_pooling_2d_repeated", "[max_pooling_2d_repeated]")
+{
+    // the argmax indices do not leak from a batch to the next one
+    auto x = variable{ random<float>( {2, 8, 8, 4} ) };
+    auto y = MaxPooling2D( 2 )( x );
+    auto& s = get_default_session<tensor<float>>();
+    s.run( y );
+    x.data() = random<float>( {2, 8, 8, 4} );
+    auto const& output = s.run( y ).deep_copy();
+    y.backward( ones_like( output ) );
+    tensor<float> const& gradient = x.gradient();
+    float total = 0.0f;
+    for ( auto idx : range( gradient.size() ) )
+    {
+        REQUIRE( ( gradient[idx] == 0.0f || gradient[idx] == 1.0f ) );
+        total += gradient[idx];
+    }
+    REQUIRE( total == static_cast<float>( output.size() ) );
+
+    auto z = AveragePooling2D( {3, 3}, {2, 2}, "same" )( x );
+    REQUIRE( z.shape() == std::vector<unsigned long>{ {2, 4, 4, 4} } );
+}
@@ -0,0 +1,117 @@
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch.hpp"
+
+#include "../include/ceras.hpp"
+#include <cmath>
+
+using namespace ceras;
+
+void check_int8_gemm( unsigned long rows, unsigned long depth, unsigned long columns )
+{
+    std::mt19937 generator{ 42 };
+    std::uniform_int_distribution<int> distribution{ -127, 127 };
+    std::vector<float> x( rows * depth );
+    std::vector<std::int8_t> w( depth * columns );
+    std::generate( x.begin(), x.end(), [&](){ return static_cast<float>( distribution( generator ) ); } );
+    std::generate( w.begin(), w.end(), [&](){ return static_cast<std::int8_t>( distribution( generator ) ); } );
+
+    std::vector<std::uint8_t> a;
+    backend::quantize_int8_activations( x.data(), rows, depth, depth, 1UL, 1.0f, a ); // unit scale, x is already integral
+    auto const& b = backend::pack_int8_matrix( w.data(), depth, columns, columns, 1 );
+
+    std::vector<std::int32_t> c( rows * columns, -1 );
+    backend::int8_gemm( a.data(), rows, b, [&]( std::int32_t const* acc, unsigned long row, unsigned long col, unsigned long cols )
+    {
+        std::copy_n( acc, cols, c.data() + row * columns + col );
+    } );
+
+    for ( auto r : range( rows ) )
+        for ( auto col : range( columns ) )
+        {
+            std::int32_t ref = 0;
+            for ( auto p : range( depth ) )
+                ref += static_cast<std::int32_t>( x[r*depth+p] ) * static_cast<std::int32_t>( w[p*columns+col] );
+            REQUIRE( c[r*columns+col] == ref );
+        }
+}
+
+TEST_CASE("int8_gemm", "[int8_gemm]")
+{
+    for ( auto [rows, depth, columns] : { std::make_tuple( 1UL, 1UL, 1UL ), std::make_tuple( 7UL, 13UL, 5UL ), std::make_tuple( 9UL, 64UL, 33UL ),
+                                          std::make_tuple( 65UL, 130UL, 64UL ), std::make_tuple( 130UL, 1027UL, 97UL ) } )
+        check_int8_gemm( rows, depth, columns );
+}
+
+// the int8 prediction of a batch held out of the calibration against its float prediction, within a few int8 steps of the range of the outputs,
+// as the rounding errors of the inputs and of the weights of both layers add up to about two steps
+void check_held_out( tensor<float> const& float_prediction, tensor<float> const& int8_prediction )
+{
+    REQUIRE( int8_prediction.shape() == float_prediction.shape() );
+    float const largest = std::abs( *std::max_element( float_prediction.begin(), float_prediction.end(), []( float a, float b ){ return std::abs( a ) < std::abs( b ); } ) );
+    float const tolerance = 4.0f * largest / 127.0f;
+    for ( auto idx : range( int8_prediction.size() ) )
+        REQUIRE( std::abs( int8_prediction[idx] - float_prediction[idx] ) <= tolerance );
+}
+
+TEST_CASE("quantized_dense", "[quantized_dense]")
+{
+    auto x = Input( {64,} );
+    auto y = Dense( 128, true, 0.0f, 0.0f, 0.0f, 0.0f, "relu" )( x );
+    auto z = Dense( 10 )( y );
+    auto m = model{ x, z };
+
+    auto const& batch = random<float>( {256, 64} );
+    auto const& held_out_batch = random<float>( {256, 64} );
+    auto const& float_prediction = m.predict( batch ).deep_copy();
+    auto const& held_out_float_prediction = m.predict( held_out_batch ).deep_copy();
+
+    auto const& report = m.quantize( batch );
+    REQUIRE( report.quantized_operators == 2 );
+    REQUIRE( report.float_weight_bytes == (64*128 + 128*10) * sizeof(float) );
+    REQUIRE( report.int8_weight_bytes * 3 < report.float_weight_bytes );
+    REQUIRE( report.relative_error < 0.05 );
+    REQUIRE( report.top1_agreement > 0.9 );
+
+    check_held_out( held_out_float_prediction, m.predict( held_out_batch ).deep_copy() );
+
+    m.dequantize();
+    auto const& dequantized_prediction = m.predict( batch );
+    for ( auto idx : range( dequantized_prediction.size() ) )
+        REQUIRE( dequantized_prediction[idx] == float_prediction[idx] );
+
+    // the int8 weights are dropped once the float weights are trained again
+    m.quantize( batch );
+    auto cm = m.compile( MeanSquaredError(), SGD( 256UL, 0.1f ) );
+    cm.train_on_batch( batch, random<float>( {256, 10} ) );
+    auto const& trained_prediction = m.predict( batch ).deep_copy();
+    REQUIRE( m.quantized_operators_.empty() );
+    m.quantize( batch );
+    m.dequantize();
+    auto const& float_trained_prediction = m.predict( batch );
+    for ( auto idx : range( trained_prediction.size() ) )
+        REQUIRE( trained_prediction[idx] == float_trained_prediction[idx] );
+}
+
+TEST_CASE("quantized_conv2d", "[quantized_conv2d]")
+{
+    auto x = Input( {12, 12, 3} );
+    auto y = relu( Conv2D( 16, {3, 3}, "same" )( x ) );
+    auto z = Conv2D( 8, {3, 3}, "valid" )( y );
+    auto m = model{ x, z };
+
+    auto const& batch = random<float>( {4, 12, 12, 3} );
+    auto const& held_out_batch = random<float>( {4, 12, 12, 3} );
+    auto const& float_prediction = m.predict( batch ).deep_copy();
+    auto const& held_out_float_prediction = m.predict( held_out_batch ).deep_copy();
+
+    auto const& report = m.quantize( batch );
+    REQUIRE( report.quantized_operators == 2 );
+    REQUIRE( report.relative_error < 0.05 );
+
+    check_held_out( held_out_float_prediction, m.predict( held_out_batch ).deep_copy() );
+
+    m.dequantize();
+    auto const& dequantized_prediction = m.predict( batch );
+    for ( auto idx : range( dequantized_prediction.size() ) )
+        REQUIRE( dequantized_prediction[idx] == float_prediction[idx] );
+}
@@ -0,0 +1,167 @@
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch.hpp"
+
+#include "../include/ceras.hpp"
+#include <cmath>
+
+using namespace ceras;
+
+namespace
+{
+    // the reduction of the tensor of shape (pres, n, post) along its second axis, in long double
+    template< typename T, typename Function >
+    std::vector<long double> reference( tensor<T> const& ts, unsigned long axis, long double init, Function const& func )
+    {
+        auto const& shape = ts.shape();
+        unsigned long const pres = std::accumulate( shape.begin(), shape.begin()+axis, 1UL, std::multiplies<unsigned long>{} );
+        unsigned long const post = std::accumulate( shape.begin()+axis+1, shape.end(), 1UL, std::multiplies<unsigned long>{} );
+        unsigned long const n = shape[axis];
+        std::vector<long double> ans( pres * post, init );
+        for ( auto i : range( pres ) )
+            for ( auto k : range( n ) )
+                for ( auto j : range( post ) )
+                    ans[i*post+j] = func( ans[i*post+j], static_cast<long double>( ts[(i*n+k)*post+j] ) );
+        return ans;
+    }
+
+    template< typename T >
+    void require_close( tensor<T> const& output, std::vector<long double> const& expected, long double tolerance )
+    {
+        REQUIRE( output.size() == expected.size() );
+        for ( auto idx : range( output.size() ) )
+            REQUIRE( std::abs( static_cast<long double>( output[idx] ) - expected[idx] ) <= tolerance * std::max( 1.0L, std::abs( expected[idx] ) ) );
+    }
+}
+
+TEST_CASE("reduction_accuracy", "[reduction_accuracy]")
+{
+    // four millions of floats, summed pairwise
+    tensor<float> const ts{ {4000037UL,}, 0.1f };
+    long double const expected = 4000037.0L * static_cast<long double>( 0.1f );
+    REQUIRE( std::abs( static_cast<long double>( sum( ts ) ) - expected ) / expected < 1.0e-6L );
+    REQUIRE( std::abs( static_cast<long double>( reduce_sum( ts )[0] ) - expected ) / expected < 1.0e-6L );
+    REQUIRE( std::abs( static_cast<long double>( mean( ts ) ) - 0.1L ) < 1.0e-7L );
+
+    // along the outer axis, in the columns
+    tensor<float> const columns{ {1000003UL, 3UL}, 0.1f };
+    auto const& s = sum( columns, 0 );
+    for ( auto idx : range( 3 ) )
+        REQUIRE( std::abs( static_cast<long double>( s[idx] ) - 1000003.0L * static_cast<long double>( 0.1f ) ) / ( 1000003.0L * 0.1L ) < 1.0e-6L );
+
+    // the results do not depend on the number of threads
+    auto const& values = random<float>( {3000017UL,}, -1.0f, 1.0f );
+    auto const& matrix = random<double>( {70001UL, 19UL}, -1.0, 1.0 );
+    set_num_threads( 1 );
+    float const sum_1 = sum( values );
+    auto const& columns_1 = sum( matrix, 0 );
+    for ( unsigned long threads : { 2UL, 4UL } )
+    {
+        set_num_threads( threads );
+        REQUIRE( sum( values ) == sum_1 );
+        auto const& columns_n = sum( matrix, 0 );
+        for ( auto idx : range( columns_n.size() ) )
+            REQUIRE( columns_n[idx] == columns_1[idx] );
+    }
+}
+
+TEST_CASE("reduction_axis", "[reduction_axis]")
+{
+    auto const& plus = []( long double x, long double y ){ return x + y; };
+    auto const& maximum = []( long double x, long double y ){ return std::max( x, y ); };
+    auto const& minimum = []( long double x, long double y ){ return std::min( x, y ); };
+    long double const inf = std::numeric_limits<long double>::infinity();
+
+    // inner, middle and outer axes, short and long
+    for ( auto const& shape : { std::vector<unsigned long>{ {5, 7, 3} }, std::vector<unsigned long>{ {2, 300, 257} }, std::vector<unsigned long>{ {3, 1031, 2} }, std::vector<unsigned long>{ {1, 2, 20000} } } )
+    {
+        auto const& ts = random<double>( shape, -2.0, -1.0 ); // negative values, for the maxima
+        for ( auto axis : range( shape.size() ) )
+        {
+            require_close( sum( ts, axis ), reference( ts, axis, 0.0L, plus ), 1.0e-13L );
+            require_close( max( ts, axis ), reference( ts, axis, -inf, maximum ), 0.0L );
+            require_close( min( ts, axis ), reference( ts, axis, inf, minimum ), 0.0L );
+            auto const& expected_mean = reference( ts, axis, 0.0L, plus );
+            auto const& output_mean = mean( ts, axis, true );
+            REQUIRE( output_mean.shape()[axis] == 1 );
+            for ( auto idx : range( output_mean.size() ) )
+                REQUIRE( std::abs( output_mean[idx] - static_cast<double>( expected_mean[idx] / shape[axis] ) ) < 1.0e-13 );
+        }
+    }
+
+    // over all the elements
+    auto const& ts = random<double>( {37, 41}, -1.0, 1.0 );
+    long double expected_sum = 0.0L;
+    long double expected_squares = 0.0L;
+    for ( auto v : ts )
+    {
+        expected_sum += v;
+        expected_squares += static_cast<long double>( v ) * v;
+    }
+    REQUIRE( std::abs( sum( ts ) - static_cast<double>( expected_sum ) ) < 1.0e-12 );
+    REQUIRE( std::abs( norm( ts ) - static_cast<double>( std::sqrt( expected_squares ) / ts.size() ) ) < 1.0e-14 );
+    REQUIRE( max( ts ) == *std::max_element( ts.begin(), ts.end() ) );
+    REQUIRE( min( ts ) == *std::min_element( ts.begin(), ts.end() ) );
+    REQUIRE( max( tensor<float>{ {3,}, -2.0f } ) == -2.0f );
+
+    // the initial value of a reduction is combined once
+    auto const& r = reduce( ts, 1, 1.0, []( auto a, auto b ){ return a + b; } );
+    auto const& expected = reference( ts, 1, 1.0L, plus );
+    require_close( r, expected, 1.0e-13L );
+}
+
+TEST_CASE("reduction_operators", "[reduction_operators]")
+{
+    auto const& input = random<double>( {4, 300, 5}, -1.0, 1.0 );
+    auto& s = get_default_session<tensor<double>>();
+    for ( auto axis : range( 3UL ) )
+    {
+        auto const& shape = input.shape();
+        unsigned long const pres = std::accumulate( shape.begin(), shape.begin()+axis, 1UL, std::multiplies<unsigned long>{} );
+        unsigned long const post = std::accumulate( shape.begin()+axis+1, shape.end(), 1UL, std::multiplies<unsigned long>{} );
+        unsigned long const n = shape[axis];
+
+        auto x = variable{ input.deep_copy() };
+        auto y_sum = reduce_sum( axis )( x );
+        auto y_mean = reduce_mean( axis )( x );
+        auto y_max = reduce_max( axis )( x );
+        auto y_min = reduce_min( axis )( x );
+
+        auto const& expected_sum = reference( input, axis, 0.0L, []( long double a, long double b ){ return a + b; } );
+        require_close( s.run( y_sum ), expected_sum, 1.0e-13L );
+        auto const& output_mean = s.run( y_mean );
+        for ( auto idx : range( output_mean.size() ) )
+            REQUIRE( std::abs( output_mean[idx] - static_cast<double>( expected_sum[idx] / n ) ) < 1.0e-14 );
+        require_close( s.run( y_max ), reference( input, axis, -1.0e10L, []( long double a, long double b ){ return std::max( a, b ); } ), 0.0L );
+        require_close( s.run( y_min ), reference( input, axis, 1.0e10L, []( long double a, long double b ){ return std::min( a, b ); } ), 0.0L );
+
+        // the gradients are broadcast along the axis, or sent to the position of the extremum
+        auto const& grad = random<double>( std::vector<unsigned long>( s.run( y_sum ).shape() ), -1.0, 1.0 );
+        auto const& output_max = s.run( y_max ).deep_copy();
+        auto const& output_min = s.run( y_min ).deep_copy();
+        for ( auto [ex_idx, scale] : { std::make_pair( 0, 1.0 ), std::make_pair( 1, 1.0 / n ) } )
+        {
+            s.run( y_sum );
+            s.run( y_mean );
+            if ( ex_idx == 0 ) y_sum.backward( grad ); else y_mean.backward( grad );
+            auto const& g = x.gradient();
+            for ( auto i : range( pres ) )
+                for ( auto k : range( n ) )
+                    for ( auto j : range( post ) )
+                        REQUIRE( std::abs( g[(i*n+k)*post+j] - grad[i*post+j] * scale ) < 1.0e-15 );
+        }
+        s.run( y_max );
+        y_max.backward( grad );
+        auto const& g_max = x.gradient().deep_copy();
+        s.run( y_min );
+        y_min.backward( grad );
+        auto const& g_min = x.gradient().deep_copy();
+        for ( auto i : range( pres ) )
+            for ( auto k : range( n ) )
+                for ( auto j : range( post ) )
+                {
+                    double const v = input[(i*n+k)*post+j];
+                    REQUIRE( g_max[(i*n+k)*post+j] == ( v == output_max[i*post+j] ? grad[i*post+j] : 0.0 ) );
+                    REQUIRE( g_min[(i*n+k)*post+j] == ( v == output_min[i*post+j] ? grad[i*post+j] : 0.0 ) );
+                }
+    }
+}
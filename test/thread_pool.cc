@@ -0,0 +1,150 @@
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch.hpp"
+
+#include "../include/ceras.hpp"
+
+using namespace ceras;
+
+namespace
+{
+    // every index of [first, last) is visited exactly once
+    template< std::unsigned_integral Integer_Type >
+    void check_parallel( Integer_Type first, Integer_Type last, unsigned long threshold = 8 )
+    {
+        std::vector<std::atomic<unsigned long>> visits( static_cast<unsigned long>( last ) + 1 );
+        parallel( [&]( Integer_Type idx ){ visits[idx].fetch_add( 1 ); }, first, last, threshold );
+        for ( unsigned long idx = 0; idx != visits.size(); ++idx )
+            REQUIRE( visits[idx].load() == ( ( idx >= first && idx < last ) ? 1UL : 0UL ) );
+    }
+}
+
+TEST_CASE("thread_pool_parallel", "[thread_pool_parallel]")
+{
+    set_num_threads( 4 );
+    REQUIRE( get_num_threads() == 4 );
+
+    check_parallel( 0UL, 1UL );
+    check_parallel( 0UL, 9UL );
+    check_parallel( 0UL, 1000UL );
+    check_parallel( 5UL, 5UL );
+    check_parallel( 7UL, 3UL );
+    check_parallel( 100UL, 1003UL ); // not starting at 0
+    check_parallel( 3UL, 13UL, 1UL );
+    check_parallel( 17U, 20000U );
+
+    // the pool is reused from a call to the next
+    std::set<std::thread::id> ids;
+    std::mutex mutex;
+    for ( [[maybe_unused]] auto _ : range( 10 ) )
+        parallel( [&]( unsigned long ){ std::this_thread::sleep_for( std::chrono::microseconds( 100 ) ); std::lock_guard<std::mutex> lock{ mutex }; ids.insert( std::this_thread::get_id() ); }, 0UL, 64UL );
+    REQUIRE( ids.size() <= 4 );
+}
+
+TEST_CASE("thread_pool_nested", "[thread_pool_nested]")
+{
+    set_num_threads( 3 );
+
+    // nested parallel regions share their tasks with the idle threads
+    std::vector<std::atomic<unsigned long>> visits( 64 * 64 );
+    parallel( [&]( unsigned long outer )
+    {
+        parallel( [&]( unsigned long inner ){ visits[outer*64+inner].fetch_add( 1 ); }, 0UL, 64UL );
+    }, 0UL, 64UL );
+    for ( auto const& v : visits )
+        REQUIRE( v.load() == 1 );
+
+    // jobs submitted by several threads at once
+    std::vector<std::vector<unsigned long>> results( 4, std::vector<unsigned long>( 1000, 0 ) );
+    std::vector<std::thread> threads;
+    for ( auto t : range( 4UL ) )
+        threads.emplace_back( [&results, t]()
+        {
+            for ( [[maybe_unused]] auto _ : range( 20 ) )
+                parallel( [&]( unsigned long idx ){ results[t][idx] += idx; }, 0UL, 1000UL );
+        } );
+    for ( auto& th : threads )
+        th.join();
+    for ( auto const& result : results )
+        for ( auto idx : range( 1000UL ) )
+            REQUIRE( result[idx] == 20 * idx );
+}
+
+TEST_CASE("thread_pool_size", "[thread_pool_size]")
+{
+    set_num_threads( 1 );
+    REQUIRE( get_num_threads() == 1 );
+    check_parallel( 0UL, 100UL );
+
+    set_num_threads( 0 ); // at least the calling thread
+    REQUIRE( get_num_threads() == 1 );
+
+    set_num_threads( 2 );
+    REQUIRE( get_num_threads() == 2 );
+    std::vector<float> v( 100000, 1.0f );
+    for_each( v.begin(), v.end(), []( float& x ){ x *= 2.0f; } );
+    REQUIRE( std::all_of( v.begin(), v.end(), []( float x ){ return x == 2.0f; } ) );
+
+    // the GEMM partitions its work for the threads of the pool
+    auto const& a = random<float>( {70, 50} );
+    auto const& b = random<float>( {50, 90} );
+    auto const& c = a * b;
+    set_num_threads( 3 );
+    auto const& d = a * b;
+    for ( auto idx : range( c.size() ) )
+        REQUIRE( std::abs( c[idx] - d[idx] ) < 1.0e-4f );
+}
+
+TEST_CASE("thread_pool_grain", "[thread_pool_grain]")
+{
+    set_num_threads( 4 );
+
+    // a cheap loop is not worth waking the pool
+    std::set<std::thread::id> ids;
+    std::mutex mutex;
+    std::vector<double> v( 500, 1.0 );
+    parallel( [&]( unsigned long idx ){ v[idx] *= 2.0; if ( idx % 100 == 0 ) { std::lock_guard<std::mutex> lock{ mutex }; ids.insert( std::this_thread::get_id() ); } }, 0UL, v.size() );
+    REQUIRE( ids == std::set<std::thread::id>{ std::this_thread::get_id() } );
+    REQUIRE( std::all_of( v.begin(), v.end(), []( double x ){ return x == 2.0; } ) );
+
+    // an irregular and costly loop is shared by the threads
+    ids.clear();
+    std::vector<std::atomic<unsigned long>> visits( 97 );
+    parallel( [&]( unsigned long idx )
+    {
+        std::this_thread::sleep_for( std::chrono::microseconds( idx % 7 == 0 ? 2000 : 100 ) );
+        visits[idx].fetch_add( 1 );
+        std::lock_guard<std::mutex> lock{ mutex };
+        ids.insert( std::this_thread::get_id() );
+    }, 0UL, visits.size() );
+    for ( auto const& visit : visits )
+        REQUIRE( visit.load() == 1 );
+    REQUIRE( ids.size() > 1 );
+}
+
+TEST_CASE("thread_pool_reduce_invoke", "[thread_pool_reduce_invoke]")
+{
+    auto const& values = random<double>( {100003}, -1.0, 1.0 );
+    auto const& sum = [&](){ return parallel_reduce( 0UL, values.size(), 0.0, [&]( unsigned long idx ){ return values[idx]; }, std::plus<double>{} ); };
+
+    // the result does not depend on the number of threads, the tasks being combined in order
+    set_num_threads( 1 );
+    double const expected = sum();
+    for ( unsigned long threads : { 2UL, 3UL, 4UL } )
+    {
+        set_num_threads( threads );
+        REQUIRE( sum() == expected );
+    }
+    REQUIRE( std::abs( expected - std::accumulate( values.begin(), values.end(), 0.0 ) ) < 1.0e-8 );
+    REQUIRE( parallel_reduce( 5UL, 5UL, 3.0, [&]( unsigned long idx ){ return values[idx]; }, std::plus<double>{} ) == 3.0 );
+    REQUIRE( parallel_reduce( 0U, 1000U, 0UL, []( unsigned int idx ){ return static_cast<unsigned long>( idx ); }, []( unsigned long a, unsigned long b ){ return std::max( a, b ); }, 7 ) == 999UL );
+
+    // the functions run once each, with a parallel loop in each of them
+    std::atomic<unsigned long> calls{ 0 };
+    std::vector<double> a( 10000, 0.0 ), b( 10000, 0.0 );
+    parallel_invoke( [&](){ parallel( [&]( unsigned long idx ){ a[idx] = 1.0; }, 0UL, a.size() ); calls.fetch_add( 1 ); },
+                     [&](){ parallel( [&]( unsigned long idx ){ b[idx] = 2.0; }, 0UL, b.size() ); calls.fetch_add( 1 ); },
+                     [&](){ calls.fetch_add( 1 ); return 3; } );
+    REQUIRE( calls.load() == 3 );
+    REQUIRE( std::all_of( a.begin(), a.end(), []( double x ){ return x == 1.0; } ) );
+    REQUIRE( std::all_of( b.begin(), b.end(), []( double x ){ return x == 2.0; } ) );
+}
@@ -0,0 +1,156 @@
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch.hpp"
+
+#include "../include/ceras.hpp"
+#include <cmath>
+
+using namespace ceras;
+using namespace ceras::backend;
+
+namespace
+{
+    // the distance in units in the last place between two finite values of the same sign
+    template< std::floating_point T >
+    double ulp_distance( T x, T y )
+    {
+        if ( x == y ) return 0.0;
+        if ( std::isnan( x ) || std::isnan( y ) ) return ( std::isnan( x ) && std::isnan( y ) ) ? 0.0 : 1.0e30;
+        if ( std::isinf( x ) || std::isinf( y ) ) return 1.0e30;
+        // in long double, the subnormals of T being flushed to zero under -Ofast
+        long double const larger = std::max( std::abs( static_cast<long double>( x ) ), std::abs( static_cast<long double>( y ) ) );
+        int const exponent = std::max( std::ilogb( larger ), std::numeric_limits<T>::min_exponent - 1 );
+        long double const ulp = std::ldexp( 1.0L, exponent - std::numeric_limits<T>::digits + 1 );
+        return static_cast<double>( std::abs( static_cast<long double>( x ) - static_cast<long double>( y ) ) / ulp );
+    }
+
+    // the largest error of the function over the inputs, against the reference function evaluated in long double
+    template< std::floating_point T, typename Function, typename Reference >
+    double max_ulp( std::vector<T> const& inputs, Function const& func, Reference const& reference )
+    {
+        std::vector<T> outputs( inputs.size() );
+        vector_math::transform( func, inputs.size(), outputs.data(), inputs.data() );
+        double ans = 0.0;
+        for ( auto idx : range( inputs.size() ) )
+        {
+            T const expected = static_cast<T>( reference( static_cast<long double>( inputs[idx] ) ) );
+            double const error = ulp_distance( outputs[idx], expected );
+            if ( error > ans )
+                ans = error;
+        }
+        return ans;
+    }
+
+    template< std::floating_point T >
+    std::vector<T> uniform( T lower, T upper, unsigned long n = 100003 )
+    {
+        auto const& values = random<T>( {n}, lower, upper );
+        return std::vector<T>( values.begin(), values.end() );
+    }
+
+    template< std::floating_point T >
+    void check_accuracy()
+    {
+        REQUIRE( max_ulp( uniform<T>( -80.0, 80.0 ), []( auto x ){ return vector_math::exp( x ); }, []( long double x ){ return std::exp( x ); } ) <= 2.0 );
+        REQUIRE( max_ulp( uniform<T>( -1.0, 1.0 ), []( auto x ){ return vector_math::exp( x ); }, []( long double x ){ return std::exp( x ); } ) <= 2.0 );
+        REQUIRE( max_ulp( uniform<T>( -3.0, 3.0 ), []( auto x ){ return vector_math::expm1( x ); }, []( long double x ){ return std::expm1( x ); } ) <= 3.0 );
+        REQUIRE( max_ulp( uniform<T>( 0.0, 1000.0 ), []( auto x ){ return vector_math::log( x ); }, []( long double x ){ return std::log( x ); } ) <= 2.0 );
+        REQUIRE( max_ulp( uniform<T>( 0.5, 2.0 ), []( auto x ){ return vector_math::log( x ); }, []( long double x ){ return std::log( x ); } ) <= 2.0 );
+        REQUIRE( max_ulp( uniform<T>( -0.9, 10.0 ), []( auto x ){ return vector_math::log1p( x ); }, []( long double x ){ return std::log1p( x ); } ) <= 4.0 );
+        REQUIRE( max_ulp( uniform<T>( -12.0, 12.0 ), []( auto x ){ return vector_math::tanh( x ); }, []( long double x ){ return std::tanh( x ); } ) <= 4.0 );
+        REQUIRE( max_ulp( uniform<T>( -0.1, 0.1 ), []( auto x ){ return vector_math::tanh( x ); }, []( long double x ){ return std::tanh( x ); } ) <= 4.0 );
+        REQUIRE( max_ulp( uniform<T>( -30.0, 30.0 ), []( auto x ){ return vector_math::sigmoid( x ); }, []( long double x ){ return 1.0L / ( 1.0L + std::exp( -x ) ); } ) <= 4.0 );
+        REQUIRE( max_ulp( uniform<T>( -30.0, 30.0 ), []( auto x ){ return vector_math::softplus( x ); }, []( long double x ){ return std::log1p( std::exp( x ) ); } ) <= 4.0 );
+        REQUIRE( max_ulp( uniform<T>( -7.0, 7.0 ), []( auto x ){ return vector_math::erf( x ); }, []( long double x ){ return std::erf( x ); } ) <= 4.0 );
+        REQUIRE( max_ulp( uniform<T>( -2.0, 2.0 ), []( auto x ){ return vector_math::erf( x ); }, []( long double x ){ return std::erf( x ); } ) <= 4.0 );
+    }
+
+    template< std::floating_point T >
+    void check_special_values()
+    {
+    #if defined(__FINITE_MATH_ONLY__) && __FINITE_MATH_ONLY__
+        // the infinities and the NaNs are not expected under -ffinite-math-only, nor the subnormals under -Ofast
+        std::vector<T> const inputs{ T{0}, T{1000}, T{-1000}, T{-1}, T{1} };
+    #else
+        T const inf = std::numeric_limits<T>::infinity();
+        T const nan = std::numeric_limits<T>::quiet_NaN();
+        std::vector<T> const inputs{ T{0}, T{-0.0}, inf, -inf, nan, T{1000}, T{-1000}, std::numeric_limits<T>::denorm_min(), T{-1}, T{1} };
+    #endif
+        auto const& check = [&]( auto const& func, auto const& reference )
+        {
+            std::vector<T> outputs( inputs.size() );
+            vector_math::transform( func, inputs.size(), outputs.data(), inputs.data() );
+            for ( auto idx : range( inputs.size() ) )
+            {
+                T const expected = reference( inputs[idx] );
+                if ( std::isnan( expected ) )
+                    REQUIRE( std::isnan( outputs[idx] ) );
+                else if ( std::isinf( expected ) || expected == T{0} )
+                    REQUIRE( outputs[idx] == expected );
+                else
+                    REQUIRE( ulp_distance( outputs[idx], expected ) <= 4.0 );
+            }
+        };
+        check( []( auto x ){ return vector_math::exp( x ); }, []( T x ){ return std::exp( x ); } );
+        check( []( auto x ){ return vector_math::expm1( x ); }, []( T x ){ return std::expm1( x ); } );
+        check( []( auto x ){ return vector_math::log( x ); }, []( T x ){ return std::log( x ); } );
+        check( []( auto x ){ return vector_math::log1p( x ); }, []( T x ){ return std::log1p( x ); } );
+        check( []( auto x ){ return vector_math::tanh( x ); }, []( T x ){ return std::tanh( x ); } );
+        check( []( auto x ){ return vector_math::erf( x ); }, []( T x ){ return std::erf( x ); } );
+        check( []( auto x ){ return vector_math::sigmoid( x ); }, []( T x ){ return T{1} / ( T{1} + std::exp( -x ) ); } );
+    }
+}
+
+TEST_CASE("vector_math_float", "[vector_math_float]")
+{
+    check_accuracy<float>();
+    check_special_values<float>();
+}
+
+TEST_CASE("vector_math_double", "[vector_math_double]")
+{
+    check_accuracy<double>();
+    check_special_values<double>();
+}
+
+TEST_CASE("vector_math_strict", "[vector_math_strict]")
+{
+    // the strict mode gives the results of the C library, the last elements of an array included
+    strict_math = 1;
+    auto const& inputs = uniform<double>( -5.0, 5.0, 1003 );
+    std::vector<double> tanh_outputs( inputs.size() );
+    vector_math::transform( []( auto x ){ return vector_math::tanh( x ); }, inputs.size(), tanh_outputs.data(), inputs.data() );
+    std::vector<double> exp_outputs( inputs.size() );
+    vector_math::transform( []( auto x ){ return vector_math::exp( x ); }, inputs.size(), exp_outputs.data(), inputs.data() );
+    for ( auto idx : range( inputs.size() ) )
+    {
+        REQUIRE( tanh_outputs[idx] == std::tanh( inputs[idx] ) );
+        REQUIRE( exp_outputs[idx] == std::exp( inputs[idx] ) );
+    }
+    strict_math = 0;
+}
+
+TEST_CASE("vector_math_operators", "[vector_math_operators]")
+{
+    // the operators against their scalar definitions
+    auto const& input = random<double>( {17, 13}, -3.0, 3.0 );
+    auto x = variable{ input.deep_copy() };
+    auto& s = get_default_session<tensor<double>>();
+    auto check = [&]( auto& ex, auto const& reference )
+    {
+        auto const& output = s.run( ex );
+        for ( auto idx : range( input.size() ) )
+            REQUIRE( std::abs( output[idx] - reference( input[idx] ) ) <= 1.0e-14 * std::max( 1.0, std::abs( reference( input[idx] ) ) ) );
+    };
+    auto e = exp( x );
+    check( e, []( double v ){ return std::exp( v ); } );
+    auto t = tanh( x );
+    check( t, []( double v ){ return std::tanh( v ); } );
+    auto g = sigmoid( x );
+    check( g, []( double v ){ return 1.0 / ( 1.0 + std::exp( -v ) ); } );
+    auto p = softplus( x );
+    check( p, []( double v ){ return std::log1p( std::exp( v ) ); } );
+    auto f = erf( x );
+    check( f, []( double v ){ return std::erf( v ); } );
+    auto l = log( exp( x ) );
+    check( l, []( double v ){ return v; } );
+}